@@ -0,0 +1,154 @@
+/*
+ * Benchmarks the latency of a Get request with the community string checked by
+ * reading the agent's config file, as usnmpd did, against its access control list.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "SnmpAgent.h"
+#include "acl.h"
+
+#define REQUESTS 20000
+#define CFG_FILE "aclbench.cfg"
+
+static unsigned char get[] = {  /* A Get request for B.1.1.0, community "public" */
+	SEQUENCE_OF, 39, INTEGER, 1, 0, OCTET_STRING, 6, 'p', 'u', 'b', 'l', 'i', 'c',
+	GET_REQUEST, 26, INTEGER, 2, 0x12, 0x34, INTEGER, 1, 0, INTEGER, 1, 0,
+	SEQUENCE, 14, SEQUENCE, 12, OBJECT_IDENTIFIER, 8, 0x2B, 6, 1, 2, 1, 1, 1, 0, NULL_ITEM, 0 };
+
+static ACL *acl;
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* The checker of usnmpd, reading the config file for each request */
+static Boolean checkFile(SnmpAgentCtx *ctx, char *cstr, int reqType)
+{
+	char roCommunity[COMM_STR_SIZE], rwCommunity[COMM_STR_SIZE];
+	LIST *keylist; KEY *key;
+
+	keylist = keylistnew();
+	keylistread(keylist, CFG_FILE);
+	keylistgohead(keylist);
+	if ( (key=keylistgokey(keylist, ctx->remoteIpAddr)) ||
+		(key=keylistgokey(keylist, "0.0.0.0")) )
+		sscanf(key->val, "%[^,],%[^,],%*s", roCommunity, rwCommunity);
+	keylistfree(keylist);
+	if ( key && ( strcmp(cstr, rwCommunity)==0 ||
+		   (reqType!=SET_REQUEST && strcmp(cstr, roCommunity)==0) ) )
+		return TRUE;
+	else
+		return FALSE;
+}
+
+static Boolean checkAcl(SnmpAgentCtx *ctx, char *cstr, int reqType)
+{
+	return aclcheck(acl, ctx->remoteIpAddr, cstr, reqType);
+}
+
+/* Microseconds per request served by ctx, over REQUESTS or a second */
+static double serve(SnmpAgentCtx *ctx)
+{
+	struct timespec t;
+	int i, ok = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < REQUESTS && (i & 63 || elapsed(&t) < 1e6); i++) {
+		memcopy(ctx->request->buffer, get, sizeof(get));
+		ctx->request->index = 0;
+		ctx->request->len = sizeof(get);
+		if (parseSNMPMessageCtx(ctx) > 0) ok++;
+	}
+	if (ok != i) printf("Only %d of %d requests answered!\n", ok, i);
+	return elapsed(&t) / i;
+}
+
+/* A config file of n managers, the requester being the last */
+static void bench(SnmpAgentCtx *ctx, int n)
+{
+	FILE *f;
+	int i;
+	double tn, tf, ta;
+
+	if ((f = fopen(CFG_FILE, "w")) == NULL) return;
+	for (i = 1; i < n; i++)
+		fprintf(f, "10.%d.%d.%d=public,private,public\n", i >> 16, (i >> 8) & 255, i & 255);
+	fprintf(f, "%s=public,private,public\n", ctx->remoteIpAddr);
+	fclose(f);
+	acl = aclnew(CFG_FILE);
+
+	setCheckCommunityCtx(ctx, NULL);
+	tn = serve(ctx);
+	setCheckCommunityCtx(ctx, checkFile);
+	tf = serve(ctx);
+	setCheckCommunityCtx(ctx, checkAcl);
+	ta = serve(ctx);
+	printf("%8d %12.3f %12.3f %12.3f\n", n, tn, tf, ta);
+
+	aclfree(acl);
+	remove(CFG_FILE);
+}
+
+int main(int argc, char *argv[])
+{
+	MIBLIST *miblist;
+	SnmpAgentCtx *ctx;
+	char *descr = (char *)malloc(MIB_DATA_SIZE);
+	int n;
+
+	endianness = endian();
+	miblist = miblistnew(0);
+	strcpy(descr, "uSNMP agent");
+	miblistadd(miblist, "B.1.1.0", OCTET_STRING, RD_ONLY, descr, strlen(descr));
+	ctx = newSnmpAgentCtx(miblist, "public", "private");
+	strcpy(ctx->remoteIpAddr, "127.0.0.1");
+
+	printf("Microseconds per Get request, community string unchecked, checked from file, and by ACL\n");
+	printf("%8s %12s %12s %12s\n", "Managers", "Unchecked", "File", "ACL");
+	if (argc > 1)
+		bench(ctx, atoi(argv[1]));
+	else
+		for (n = 2; n <= 200; n *= 10)
+			bench(ctx, n);
+	freeSnmpAgentCtx(ctx);
+	miblistfree(miblist);
+	return 0;
+}
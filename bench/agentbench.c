@@ -0,0 +1,187 @@
+/*
+ * Benchmarks agent throughput against the number of worker threads.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "SnmpAgent.h"
+
+#define PORT 16261
+#define CLIENTS 8
+#define SECONDS 2
+#define MAX_WORKERS 8
+
+static volatile int stop, batched;
+static unsigned char getRequest[REQUEST_BUFFER_SIZE];
+static int getRequestLen;
+
+/* A Get request for four objects, community "public" */
+static void buildGet( void )
+{
+	struct messageStruct vblist;
+	unsigned char vbBuffer[VB_BUFFER_SIZE], *p = getRequest;
+	static unsigned char head[] = { INTEGER, 1, SNMP_V1, OCTET_STRING, 6, 'p', 'u', 'b', 'l', 'i', 'c' };
+	static unsigned char pdu[] = { INTEGER, 1, 1, INTEGER, 1, 0, INTEGER, 1, 0 };
+
+	vblist.buffer = vbBuffer; vblist.size = VB_BUFFER_SIZE;
+	vblistReset(&vblist);
+	vblistAdd(&vblist, "B.1.1.0", NULL_ITEM, NULL, 0);
+	vblistAdd(&vblist, "B.1.2.0", NULL_ITEM, NULL, 0);
+	vblistAdd(&vblist, "B.1.5.0", NULL_ITEM, NULL, 0);
+	vblistAdd(&vblist, "B.1.7.0", NULL_ITEM, NULL, 0);
+	/* All lengths fit in one byte */
+	*p++ = SEQUENCE_OF; *p++ = sizeof(head) + 2 + sizeof(pdu) + vblist.len;
+	memcpy(p, head, sizeof(head)); p += sizeof(head);
+	*p++ = GET_REQUEST; *p++ = sizeof(pdu) + vblist.len;
+	memcpy(p, pdu, sizeof(pdu)); p += sizeof(pdu);
+	memcpy(p, vblist.buffer, vblist.len); p += vblist.len;
+	getRequestLen = p - getRequest;
+}
+
+static void setTimeout( int fd )
+{
+	struct timeval tv = { 0, 100000 };
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static void *worker( void *arg )
+{
+	SnmpAgentCtx *ctx = (SnmpAgentCtx *)arg;
+	int result[SNMP_BATCH_SIZE];
+
+	while (!stop)
+		if (batched) processSNMPBatchCtx(ctx, result);
+		else processSNMPCtx(ctx);
+	return NULL;
+}
+
+/* Sends a request and waits for its response, one at a time */
+static void *client( void *arg )
+{
+	long *count = (long *)arg;
+	struct sockaddr_in to;
+	unsigned char buf[RESPONSE_BUFFER_SIZE];
+	int fd = socket(PF_INET, SOCK_DGRAM, 0);
+
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+	to.sin_port = htons(PORT);
+	to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	connect(fd, (struct sockaddr *)&to, sizeof(to));
+	setTimeout(fd);
+	while (!stop) {
+		send(fd, getRequest, getRequestLen, 0);
+		if (recv(fd, buf, sizeof(buf), 0) > 0) (*count)++;
+	}
+	close(fd);
+	return NULL;
+}
+
+/* Returns the requests served per second by n workers */
+static double bench( int n )
+{
+	SnmpAgentCtx *ctx[MAX_WORKERS];
+	pthread_t wt[MAX_WORKERS], ct[CLIENTS];
+	long count[CLIENTS], total = 0;
+	int i;
+
+	stop = 0;
+	for (i = 0; i < n; i++) {
+		ctx[i] = newSnmpAgentCtx(mibTree, "public", "private");
+		if (bindSnmpAgentCtx(ctx[i], PORT) == FAIL) {
+			printf("Unable to bind to port %d\n", PORT);
+			exit(1);
+		}
+		setTimeout(ctx[i]->snmpfd);
+		pthread_create(&wt[i], NULL, worker, ctx[i]);
+	}
+	for (i = 0; i < CLIENTS; i++) {
+		count[i] = 0;
+		pthread_create(&ct[i], NULL, client, &count[i]);
+	}
+	sleep(SECONDS);
+	stop = 1;
+	for (i = 0; i < CLIENTS; i++) {
+		pthread_join(ct[i], NULL);
+		total += count[i];
+	}
+	for (i = 0; i < n; i++) {
+		pthread_join(wt[i], NULL);
+		freeSnmpAgentCtx(ctx[i]);
+	}
+	return (double)total / SECONDS;
+}
+
+int main(int argc, char *argv[])
+{
+	int n, max = MAX_WORKERS;
+	double base = 0, rate, brate;
+	char *descr = strdup("uSNMP agent benchmark"), *contact = strdup("bench"), *location = strdup("here");
+	MIB *thismib;
+	int32_t i = 7;
+
+	if (argc > 1 && (max = atoi(argv[1])) > MAX_WORKERS) max = MAX_WORKERS;
+	endianness = endian();
+	reusePort = TRUE;
+	mibTree = miblistnew(0);
+	miblistadd(mibTree, "B.1.1.0", OCTET_STRING, RD_ONLY, descr, strlen(descr));
+	miblistadd(mibTree, "B.1.2.0", OCTET_STRING, RD_ONLY, contact, strlen(contact));
+	miblistadd(mibTree, "B.1.5.0", OCTET_STRING, RD_WR, location, strlen(location));
+	thismib = miblistadd(mibTree, "B.1.7.0", INTEGER, RD_ONLY, NULL, 0);
+	mibsetvalue(thismib, &i, 0);
+	buildGet();
+
+	printf("Get requests per second served by worker threads, %d clients, %ld processors\n",
+		CLIENTS, sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%8s %12s %8s %12s %8s\n", "Workers", "Requests/s", "Speedup", "Batched", "Speedup");
+	for (n = 1; n <= max; n *= 2) {
+		batched = 0;
+		rate = bench(n);
+		batched = 1;
+		brate = bench(n);
+		if (n == 1) base = rate;
+		printf("%8d %12.0f %8.2f %12.0f %8.2f\n", n, rate, base > 0 ? rate / base : 0,
+			brate, base > 0 ? brate / base : 0);
+	}
+	miblistfree(mibTree);
+	return 0;
+}
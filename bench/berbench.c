@@ -0,0 +1,178 @@
+/*
+ * Benchmarks building multi-varbind responses forwards, with length fields
+ * patched in afterwards, against building them backwards in a single pass.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "varbind.h"
+
+#define BUILDS 100000
+
+static unsigned char head[] = {  /* version, community "public" */
+	INTEGER, 1, 0, OCTET_STRING, 6, 'p', 'u', 'b', 'l', 'i', 'c' };
+static unsigned char pduhead[] = {  /* request-id, error-status, error-index */
+	INTEGER, 2, 0x12, 0x34, INTEGER, 1, 0, INTEGER, 1, 0 };
+
+static char oidstr[VB_BUFFER_SIZE][16];
+static MIB vbs[VB_BUFFER_SIZE];
+static unsigned char value[VB_BUFFER_SIZE];
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* n varbinds under P.38644.1, each an OCTET STRING of vlen bytes */
+static void mkvbs(int n, int vlen)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		sprintf(oidstr[i], "P.38644.1.%d.0", i + 1);
+		str2oid(oidstr[i], &vbs[i].oid);
+		vbs[i].dataType = OCTET_STRING;
+		vbs[i].dataLen = vlen;
+		vbs[i].u.octetstring = value;
+	}
+}
+
+/*
+ * The forward build, as the agent did it: the headers go in with provisional
+ * lengths, each varbind is appended and its lengths patched, and the enclosing
+ * lengths are patched last, shifting what follows whenever a length field grows.
+ */
+static int buildForward(struct messageStruct *resp, int n)
+{
+	int i, pdu, list, vb, val, len, vblen = 0;
+
+	resp->buffer[0] = SEQUENCE_OF; resp->buffer[1] = 0;
+	memcopy(resp->buffer+2, head, sizeof(head));
+	pdu = 2 + sizeof(head);
+	resp->buffer[pdu] = GET_RESPONSE; resp->buffer[pdu+1] = 0;
+	memcopy(resp->buffer+pdu+2, pduhead, sizeof(pduhead));
+	list = pdu+2+sizeof(pduhead);
+	resp->buffer[list] = SEQUENCE; resp->buffer[list+1] = 0;
+
+	vb = list+2;
+	for (i = 0; i < n; i++) {
+		if (vb+4+OID_SIZE*5+3+vbs[i].dataLen > resp->size) return BUFFER_FULL;
+		resp->buffer[vb] = SEQUENCE; resp->buffer[vb+1] = 0;
+		resp->buffer[vb+2] = OBJECT_IDENTIFIER;
+		resp->buffer[vb+3] = oid2ber(&vbs[i].oid, resp->buffer+vb+4);
+		val = vb+4+resp->buffer[vb+3];
+		resp->buffer[val] = vbs[i].dataType; resp->buffer[val+1] = 0;
+		memcopy(resp->buffer+val+2, vbs[i].u.octetstring, vbs[i].dataLen);
+		len = 1 + insertRespLen(resp, val, resp, val, vbs[i].dataLen) + vbs[i].dataLen;
+		len += val-(vb+2);
+		len += 1 + insertRespLen(resp, vb, resp, vb, len);
+		vblen += len;
+		vb += len;
+	}
+	len = 1 + insertRespLen(resp, list, resp, list, vblen) + vblen;
+	len += sizeof(pduhead);
+	len += 1 + insertRespLen(resp, pdu, resp, pdu, len);
+	len += sizeof(head);
+	len += 1 + insertRespLen(resp, 0, resp, 0, len);
+	return len;
+}
+
+/* The single pass: everything is prepended, innermost and last first. */
+static int buildBackward(struct messageStruct *resp, int n)
+{
+	int i, len, vlen, olen, hlen, vblen = 0;
+
+	resp->index = resp->size;
+	for (i = n-1; i >= 0; i--) {
+		if ((vlen = prependValue(resp, &vbs[i])) < 0 ||
+			(olen = prependOid(resp, &vbs[i].oid)) < 0 ||
+			(hlen = prependHeader(resp, SEQUENCE, vlen+olen)) < 0)
+			return BUFFER_FULL;
+		vblen += vlen+olen+hlen;
+	}
+	if ((hlen = prependHeader(resp, SEQUENCE, vblen)) < 0 ||
+		prependBytes(resp, pduhead, sizeof(pduhead)) < 0)
+		return BUFFER_FULL;
+	len = vblen + hlen + sizeof(pduhead);
+	if ((hlen = prependHeader(resp, GET_RESPONSE, len)) < 0 ||
+		prependBytes(resp, head, sizeof(head)) < 0)
+		return BUFFER_FULL;
+	len += hlen + sizeof(head);
+	if ((hlen = prependHeader(resp, SEQUENCE_OF, len)) < 0)
+		return BUFFER_FULL;
+	return len + hlen;
+}
+
+int main(void)
+{
+	static int shape[][2] = { {5, 220}, {10, 100}, {20, 40}, {40, 12}, {56, 4} };
+	unsigned char fwd[RESPONSE_BUFFER_SIZE+OID_SIZE*5+8];  /* Slack to patch the last varbind in place */
+	unsigned char bwd[RESPONSE_BUFFER_SIZE];
+	struct messageStruct f, b;
+	struct timespec start;
+	double tf, tb;
+	int i, j, n, flen = 0, blen = 0;
+
+	endianness = endian();
+	memset(value, 'x', sizeof(value));
+	f.buffer = fwd; f.size = sizeof(fwd);
+	b.buffer = bwd; b.size = sizeof(bwd);
+
+	printf("Microseconds per GetResponse, forward with patched lengths vs single-pass prepend\n");
+	printf("%8s %8s %8s %10s %10s\n", "Varbinds", "Value", "Bytes", "Forward", "Prepend");
+	for (i = 0; i < (int)(sizeof(shape)/sizeof(shape[0])); i++) {
+		n = shape[i][0];
+		mkvbs(n, shape[i][1]);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (j = 0; j < BUILDS; j++)
+			flen = buildForward(&f, n);
+		tf = elapsed(&start);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (j = 0; j < BUILDS; j++)
+			blen = buildBackward(&b, n);
+		tb = elapsed(&start);
+
+		if (flen != blen || memcmp(fwd, bwd+b.index, blen) != 0)
+			printf("Encoding mismatch at %d varbinds!\n", n);
+		printf("%8d %8d %8d %10.3f %10.3f\n", n, shape[i][1], blen, tf / BUILDS, tb / BUILDS);
+	}
+	return 0;
+}
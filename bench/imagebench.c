@@ -0,0 +1,135 @@
+/*
+ * Benchmarks loading a MIB tree at start-up, from its data file against from
+ * a MIB image mapped into memory.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "mibimage.h"
+#include "mibutil.h"
+
+#define DAT_FILE "imagebench.dat"
+#define IMG_FILE "imagebench.img"
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static long filesize(char *fn)
+{
+	struct stat st;
+
+	return stat(fn, &st) == 0 ? (long)st.st_size : 0;
+}
+
+/* Writes n values of a table under P.38644.30.1.1, an integer, a string and
+   an IP address of each row, as refreshbench does */
+static void mkfile(int n)
+{
+	FILE *f = fopen(DAT_FILE, "w");
+	int i;
+
+	for (i = 0; i < n; i++)
+		switch (i % 3) {
+			case 0:
+				fprintf(f, "P.38644.30.1.1.1.%d=I,W,%d\n", i/3+1, i);
+				break;
+			case 1:
+				fprintf(f, "P.38644.30.1.1.2.%d=S,W,70-6f-72-74-2d%02x [port-%c]\n", i/3+1,
+					0x30 + i % 10, '0' + i % 10);
+				break;
+			default:
+				fprintf(f, "P.38644.30.1.1.3.%d=A,R,0a-00-%02x-%02x [10.0.%u.%u]\n", i/3+1,
+					(i >> 8) & 255, i & 255, (i >> 8) & 255, i & 255);
+		}
+	fclose(f);
+}
+
+static void bench(int n)
+{
+	struct timespec t;
+	MIBLIST *miblist;
+	MIBIMAGE *img;
+	double tr, tw, to;
+	int nr, no;
+
+	mkfile(n);
+	miblist = miblistnew(0);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	miblistread(miblist, DAT_FILE);
+	tr = elapsed(&t);
+	nr = miblistsize(miblist);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	mibimagewrite(miblist, IMG_FILE);
+	tw = elapsed(&t);
+	miblistfree(miblist);
+
+	miblist = miblistnew(0);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	img = mibimageopen(miblist, IMG_FILE);
+	to = elapsed(&t);
+	no = miblistsize(miblist);
+	miblistfree(miblist);
+	if (img) mibimageclose(img);
+	if (nr != n || no != n)
+		printf("%d values read as %d nodes, and %d from the image!\n", n, nr, no);
+
+	printf("%8d %12.1f %12.1f %12.1f %10ld %10ld\n", n, tr / 1e3, to / 1e3, tw / 1e3,
+		filesize(DAT_FILE) / 1024, filesize(IMG_FILE) / 1024);
+}
+
+int main(int argc, char *argv[])
+{
+	int n;
+
+	printf("Milliseconds to load a MIB tree from its data file and from its image, and to\n");
+	printf("write the image, with the size of each file in KB\n");
+	printf("%8s %12s %12s %12s %10s %10s\n", "Nodes", "Read(dat)", "Open(image)", "Write(image)",
+		"Data(KB)", "Image(KB)");
+	if (argc > 1)
+		bench(atoi(argv[1]));
+	else
+		for (n = 10000; n <= 100000; n *= 10)
+			bench(n);
+	remove(DAT_FILE);
+	remove(IMG_FILE);
+	return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Benchmarks persisting Sets to a MIB data file, rewritten on each Set against
+ * appended to a journal committed each Set or in groups.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mibjournal.h"
+#include "mibutil.h"
+
+#define SETS 200
+#define GROUP 100
+
+static char datfn[FILENAME_MAX], jnlfn[FILENAME_MAX];
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* Writes n writable values, alternately an integer and a string, of a table
+   under P.38644.30.1.1, and reads them into a tree */
+static MIBLIST *mktree(int n)
+{
+	MIBLIST *miblist = miblistnew(0);
+	FILE *f = fopen(datfn, "w");
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (i % 2)
+			fprintf(f, "P.38644.30.1.1.2.%d=S,W,%02x-%02x-41\n", i/2+1, i & 255, (i >> 8) & 255);
+		else
+			fprintf(f, "P.38644.30.1.1.1.%d=I,W,%d\n", i/2+1, i);
+	fclose(f);
+	miblistread(miblist, datfn);
+	return miblist;
+}
+
+/* Sets the integer of row i+1 to v, as the set callback of usnmpd does */
+static MIB *setone(MIBLIST *miblist, int i, uint32_t v)
+{
+	OID oid = { 7, { 'P', 38644, 30, 1, 1, 1, 0 } };
+	MIB *thismib;
+
+	oid.array[6] = i + 1;
+	if ((thismib = miblistfind(miblist, &oid))) mibsetvalue(thismib, &v, INT_SIZE);
+	return thismib;
+}
+
+static void bench(int n)
+{
+	struct timespec t;
+	MIBLIST *miblist = mktree(n);
+	MIBJOURNAL *j;
+	double tw, ts, tg, tc;
+	int i;
+
+	/* As usnmpd did, the whole file each Set */
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < SETS; i++) {
+		setone(miblist, i, i);
+		miblistwrite(miblist, datfn);
+	}
+	tw = elapsed(&t);
+
+	unlink(jnlfn);
+	j = mibjournalnew(miblist, datfn, jnlfn, 1L << 30);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < SETS; i++) {
+		mibjournalappend(j, setone(miblist, i, i+1));
+		mibjournalsync(j);
+	}
+	ts = elapsed(&t);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < SETS; i++) {
+		mibjournalappend(j, setone(miblist, i, i+2));
+		if (i % GROUP == GROUP-1) mibjournalsync(j);
+	}
+	mibjournalsync(j);
+	tg = elapsed(&t);
+	j->limit = 0;  /* Due now */
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	mibjournalcompact(j);
+	tc = elapsed(&t);
+
+	printf("%8d %14.3f %14.3f %14.3f %12.3f %8u\n", n, tw / SETS / 1e3, ts / SETS / 1e3,
+		tg / SETS / 1e3, tc / 1e3, (unsigned int) j->commits);
+	mibjournalfree(j);
+	miblistfree(miblist);
+}
+
+int main(int argc, char *argv[])
+{
+	char *dir = argc > 2 ? argv[2] : ".";
+
+	snprintf(datfn, sizeof(datfn), "%s/journalbench.dat", dir);
+	snprintf(jnlfn, sizeof(jnlfn), "%s/journalbench.jnl", dir);
+	printf("Milliseconds to persist a Set, rewriting the data file against journaled and\n");
+	printf("synced each Set or every %d, and to compact the journal, in %s\n", GROUP, dir);
+	printf("%8s %14s %14s %14s %12s %8s\n", "Nodes", "Rewrite", "Journal", "Group", "Compact",
+		"Commits");
+	if (argc > 1)
+		bench(atoi(argv[1]));
+	else {
+		bench(1000);
+		bench(10000);
+		bench(50000);
+	}
+	unlink(datfn);
+	unlink(jnlfn);
+	return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * Benchmarks logging traps to a binary log file, and scanning it for an OID
+ * prefix, against printing them as text and parsing the text back.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "snmplog.h"
+#include "mibutil.h"
+
+#define LINE_SIZE 256
+
+static unsigned char head[] = {  /* version, community "public" */
+	INTEGER, 1, 0, OCTET_STRING, 6, 'p', 'u', 'b', 'l', 'i', 'c' };
+static unsigned char text[] = { 'l', 'i', 'n', 'k', 'D', 'o', 'w', 'n' };
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* Trap i, of enterprise P.38644.30.(i%10), with a time stamp, an integer and
+   a string varbind, built backwards into msg. */
+static int mktrap(struct messageStruct *msg, int i)
+{
+	OID oid;
+	MIB mib;
+	unsigned char addr[4] = { 10, 0, 0, 0 };
+	int len, vlen;
+
+	msg->index = msg->len = msg->size;
+	str2oid("B.1.2.2.1.2.0", &oid);  /* ifDescr */
+	oid.array[oid.len-1] = i % 100;
+	mib.dataType = OCTET_STRING; mib.dataLen = sizeof(text); mib.u.octetstring = text;
+	len = prependValue(msg, &mib);
+	len += prependOid(msg, &oid);
+	vlen = len + prependHeader(msg, SEQUENCE, len);
+	str2oid("P.38644.30.0.1.0", &oid);
+	oid.array[3] = i % 10; oid.array[5] = i % 100;
+	len = prependInt(msg, INTEGER, i);
+	len += prependOid(msg, &oid);
+	vlen += len + prependHeader(msg, SEQUENCE, len);
+	str2oid("B.1.3.0", &oid);
+	len = prependInt(msg, TIMETICKS, i);
+	len += prependOid(msg, &oid);
+	vlen += len + prependHeader(msg, SEQUENCE, len);
+	len = vlen + prependHeader(msg, SEQUENCE_OF, vlen);
+	len += prependInt(msg, TIMETICKS, i);
+	len += prependInt(msg, INTEGER, i % 10);
+	len += prependInt(msg, INTEGER, ENTERPRISE_SPECIFIC);
+	addr[3] = i & 0xFF; addr[2] = (i >> 8) & 0xFF;
+	len += prependBytes(msg, addr, 4);
+	len += prependHeader(msg, IP_ADDRESS, 4);
+	str2oid("P.38644.30.0", &oid);
+	oid.array[3] = i % 10;
+	len += prependOid(msg, &oid);
+	len += prependHeader(msg, TRAP_PACKET, len);
+	len += prependBytes(msg, head, sizeof(head));
+	return prependHeader(msg, SEQUENCE_OF, len) + len;
+}
+
+/* Prints a trap as usnmptrapd does */
+static void printTrap(FILE *f, MSGVIEW *msg)
+{
+	OID entoid;
+	char oid[64];
+
+	fprintf(f, "Community: %.*s\n", msg->communityLen, (char *) msg->community);
+	ber2oid(msg->enterprise, msg->enterpriseLen, &entoid);
+	oid2str(&entoid, oid); fprintf(f, "Enterprise OID: %s\n", oid);
+	fprintf(f, "Agent address: %u.%u.%u.%u\n", msg->agentAddr[0], msg->agentAddr[1],
+		msg->agentAddr[2], msg->agentAddr[3]);
+	fprintf(f, "Generic trap code: %u\n", (unsigned int) msg->generic);
+	fprintf(f, "Specific trap code: %u\n", (unsigned int) msg->specific);
+	fprintf(f, "Timestamp: %u\n", (unsigned int) msg->timestamp);
+	fprintf(f, "Trap varbind:\n");
+	vbviewPrint(msg->vb, msg->nvb, f);
+}
+
+/* Whether the OID of a text line starts with the BER-encoded prefix */
+static Boolean textmatch(OID *oid, unsigned char *prefix, int len)
+{
+	unsigned char ber[OID_SIZE*5];
+
+	return oid2ber(oid, ber) >= len && memcmp(ber, prefix, len) == 0;
+}
+
+/* Counts the traps in the text file fn of the enterprise or with a varbind
+   under prefix, parsing each line back. */
+static int textscan(char *fn, unsigned char *prefix, int len)
+{
+	char line[LINE_SIZE];
+	unsigned char octetdata[LINE_SIZE];
+	FILE *f = fopen(fn, "r");
+	OID oid;
+	MIB mib;
+	Boolean found = FALSE;
+	int n = 0;
+
+	while (fgets(line, LINE_SIZE, f)) {
+		if (strncmp(line, "Community:", 10) == 0) {
+			n += found; found = FALSE;
+		}
+		else if (strncmp(line, "Enterprise OID: ", 16) == 0) {
+			line[strcspn(line, "\n")] = '\0';
+			if (str2oid(line+16, &oid) && textmatch(&oid, prefix, len)) found = TRUE;
+		}
+		else if (strchr(line, '=')) {
+			mib.u.octetstring = octetdata;
+			if (mibscan(&mib, line) == SUCCESS && textmatch(&mib.oid, prefix, len)) found = TRUE;
+		}
+	}
+	fclose(f);
+	return n + found;
+}
+
+int main(int argc, char *argv[])
+{
+	struct timespec t;
+	struct messageStruct trap;
+	struct sockaddr_in from;
+	unsigned char buffer[REQUEST_BUFFER_SIZE], prefix[OID_SIZE*5];
+	char logfn[64], textfn[64];
+	VBVIEW vb[VBVIEW_MAX(REQUEST_BUFFER_SIZE)];
+	MSGVIEW msg;
+	SNMPLOG *l;
+	LOGREC rec;
+	FILE *f;
+	int i, n = argc > 1 ? atoi(argv[1]) : 1000000, len, plen, nb, nt;
+	uint32_t pos;
+	double ta, tb, tp, tt;
+	long bsize, tsize;
+
+	endianness = endian();
+	trap.buffer = buffer; trap.size = REQUEST_BUFFER_SIZE;
+	from.sin_family = AF_INET; from.sin_port = htons(TRAP_DST_PORT);
+	inet_pton(AF_INET, "127.0.0.1", &from.sin_addr);
+	plen = str2ber("P.38644.30.3", prefix);
+	sprintf(logfn, "/tmp/logbench.%d.log", (int) getpid());
+	sprintf(textfn, "/tmp/logbench.%d.txt", (int) getpid());
+
+	/* A record takes about 120 bytes */
+	unlink(logfn);
+	if ((l = snmplognew(logfn, n * 128 + (1 << 20))) == NULL) {
+		printf("Fail to create %s.\n", logfn);
+		return -1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < n; i++) {
+		len = mktrap(&trap, i);
+		msgView(buffer+trap.index, len, &msg, vb, VBVIEW_MAX(REQUEST_BUFFER_SIZE));
+		snmplogappend(l, (struct sockaddr *)&from, &msg);
+	}
+	bsize = l->end;
+	snmplogfree(l);
+	ta = elapsed(&t);
+
+	f = fopen(textfn, "w");
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < n; i++) {
+		len = mktrap(&trap, i);
+		msgView(buffer+trap.index, len, &msg, vb, VBVIEW_MAX(REQUEST_BUFFER_SIZE));
+		printTrap(f, &msg);
+	}
+	tsize = ftell(f);
+	fclose(f);
+	tp = elapsed(&t);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	l = snmplogopen(logfn);
+	for (nb = 0, pos = 0; (pos = snmplognext(l, pos, &rec)); )
+		nb += snmplogmatch(&rec, prefix, plen);
+	snmplogfree(l);
+	tb = elapsed(&t);
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	nt = textscan(textfn, prefix, plen);
+	tt = elapsed(&t);
+	if (nb != n / 10 + (n % 10 > 3) || nt != nb)
+		printf("Scans found %d and %d traps of %d!\n", nb, nt, n);
+
+	printf("Logging %d traps and finding those under P.38644.30.3, binary vs text\n", n);
+	printf("%8s %10s %14s %14s %12s\n", "Format", "MB", "Write(us/trap)", "Scan(us/trap)", "Scan/s");
+	printf("%8s %10.1f %14.3f %14.3f %12.0f\n", "Binary", bsize / 1e6, ta / n, tb / n, n / tb * 1e6);
+	printf("%8s %10.1f %14.3f %14.3f %12.0f\n", "Text", tsize / 1e6, tp / n, tt / n, n / tt * 1e6);
+	unlink(logfn);
+	unlink(textfn);
+	return 0;
+}
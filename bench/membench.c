@@ -0,0 +1,193 @@
+/*
+ * Benchmarks the memory a MIB tree loaded from its data file takes, with a
+ * malloc() for each node and value, as miblistread() once did, and from the heap,
+ * a slab and an arena of mempool.h.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include "mibutil.h"
+
+#define DAT_FILE "membench.dat"
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* Bytes in use on the heap, with the overhead of each malloc(), and those
+   of large blocks mapped apart from it */
+static long heapused(void)
+{
+	struct mallinfo2 mi = mallinfo2();
+
+	return (long)(mi.uordblks + mi.hblkhd);
+}
+
+/* Writes n values of a table under P.38644.30.1.1, an integer, a string and
+   an IP address of each row, as imagebench does */
+static void mkfile(int n)
+{
+	FILE *f = fopen(DAT_FILE, "w");
+	int i;
+
+	for (i = 0; i < n; i++)
+		switch (i % 3) {
+			case 0:
+				fprintf(f, "P.38644.30.1.1.1.%d=I,W,%d\n", i/3+1, i);
+				break;
+			case 1:
+				fprintf(f, "P.38644.30.1.1.2.%d=S,W,70-6f-72-74-2d%02x [port-%c]\n", i/3+1,
+					0x30 + i % 10, '0' + i % 10);
+				break;
+			default:
+				fprintf(f, "P.38644.30.1.1.3.%d=A,R,0a-00-%02x-%02x [10.0.%u.%u]\n", i/3+1,
+					(i >> 8) & 255, i & 255, (i >> 8) & 255, i & 255);
+		}
+	fclose(f);
+}
+
+static int isoctet(MIB *thismib)
+{
+	return thismib->dataType == OCTET_STRING || thismib->dataType == OBJECT_IDENTIFIER ||
+		thismib->dataType == IP_ADDRESS;
+}
+
+/* Reads the data file as miblistread() once did, with a malloc() for each
+   node, and another of MIB_DATA_SIZE bytes for its value */
+static void readmalloc(MIBLIST *miblist)
+{
+	char buf[MIB_LINE_SIZE];
+	unsigned char octetdata[MIB_LINE_SIZE];
+	FILE *f = fopen(DAT_FILE, "r");
+	MIB mib, *thismib;
+
+	while (fgets(buf, sizeof(buf), f)) {
+		mib.u.octetstring = octetdata;
+		if (mibscan(&mib, buf) != SUCCESS)
+			continue;
+		thismib = (MIB *)malloc(sizeof(MIB));
+		*thismib = mib;
+		thismib->dataSize = 0;
+		thismib->dataInline = 0;
+		thismib->dataHeap = FALSE;  /* The value is freed by freemalloc() */
+		if (isoctet(thismib)) {
+			thismib->u.octetstring = (unsigned char *)malloc(MIB_DATA_SIZE);
+			thismib->dataSize = MIB_DATA_SIZE;
+			memcopy(thismib->u.octetstring, mib.u.octetstring, mib.dataLen);
+		}
+		thismib->get = NULL;
+		thismib->set = NULL;
+		miblistput(miblist, thismib);
+	}
+	fclose(f);
+}
+
+/* Frees the values of the tree read by readmalloc(), which are not kept
+   with their nodes */
+static void freemalloc(MIBLIST *miblist)
+{
+	MIB *thismib;
+
+	for (thismib = miblistgohead(miblist); thismib; thismib = miblistgonext(miblist))
+		if (isoctet(thismib))
+			free(thismib->u.octetstring);
+}
+
+/* Loads the tree of n values with the pool given, or by readmalloc() if
+   old, and prints the heap bytes it takes for each leaf, and the
+   milliseconds to load and to free it */
+static void bench(char *label, int n, int old, MEMPOOL *pool)
+{
+	struct timespec t;
+	MIBLIST *miblist;
+	long base, used;
+	double tl, tf;
+
+	base = heapused();
+	miblist = miblistnew(0);
+	miblistsetpool(miblist, pool);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	if (old)
+		readmalloc(miblist);
+	else
+		miblistread(miblist, DAT_FILE);
+	tl = elapsed(&t);
+	used = heapused() - base;
+	if (miblistsize(miblist) != n)
+		printf("%d values read as %d nodes!\n", n, miblistsize(miblist));
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	if (old)
+		freemalloc(miblist);
+	miblistfree(miblist);
+	if (pool)
+		mempoolfree(pool);
+	tf = elapsed(&t);
+
+	printf("%8d %-8s %12.1f %12.1f %12.1f\n", n, label, (double)used / n, tl / 1e3, tf / 1e3);
+}
+
+/* Each way of loading the tree of n values */
+static void run(int n)
+{
+	mkfile(n);
+	bench("before", n, 1, NULL);
+	bench("heap", n, 0, NULL);
+	bench("slab", n, 0, mempoolslab(0));
+	bench("arena", n, 0, mempoolarena(0));
+}
+
+int main(int argc, char *argv[])
+{
+	int n;
+
+	printf("Heap bytes per leaf of a MIB tree, with its index, and milliseconds to load\n");
+	printf("it from its data file and to free it, a malloc() for each node and value\n");
+	printf("(before), and each node with its value from the heap, a slab and an arena\n");
+	printf("%8s %-8s %12s %12s %12s\n", "Leaves", "Pool", "Bytes/leaf", "Load", "Free");
+	if (argc > 1)
+		run(atoi(argv[1]));
+	else
+		for (n = 10000; n <= 100000; n *= 10)
+			run(n);
+	remove(DAT_FILE);
+	return 0;
+}
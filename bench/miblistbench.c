@@ -0,0 +1,174 @@
+/*
+ * Benchmarks MIB tree lookups of the sorted array and trie against a linked list.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "miblist.h"
+
+#define COLUMNS 10
+#define LOOKUPS 2000
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* A table of COLUMNS columns under P.38644.30.1.1, in lexicographic order */
+static void mkoid(OID *oid, int i, int rows)
+{
+	oid->array[0] = 'P';
+	oid->array[1] = 38644;
+	oid->array[2] = 30;
+	oid->array[3] = 1;
+	oid->array[4] = 1;
+	oid->array[5] = 1 + i / rows;
+	oid->array[6] = 1 + i % rows;
+	oid->len = 7;
+}
+
+static MIB *mknode(MIBLIST *miblist, int i, int rows)
+{
+	MIB *thismib;
+	OID oid;
+
+	mkoid(&oid, i, rows);
+	thismib = miblistnewmib(miblist, &oid, INTEGER, RD_ONLY);
+	thismib->u.intval = i;
+	return thismib;
+}
+
+/* The linked list lookup that the sorted array replaces */
+static MIB *listgooid(LIST *l, OID *oid)
+{
+	MIB *thismib;
+	int i;
+
+	if ( (thismib=(MIB *)listgetthis(l))==NULL ||
+		oidcmp(oid, &thismib->oid)<0 )
+		thismib=(MIB *)listgohead(l);
+	while ( thismib && (i=oidcmp(oid, &thismib->oid))>0 )
+		thismib=(MIB *)listgonext(l);
+	if (thismib==NULL || i)
+		return (MIB *)NULL;
+	else
+		return (MIB *)thismib;
+}
+
+static void bench(int n)
+{
+	struct timespec t;
+	LIST *list;
+	MIBLIST *miblist;
+	MIB *thismib;
+	OID oid, *keys;
+	int i, rows = n / COLUMNS, found;
+	double tl, ta, tt, wl, wa, wt;
+
+	keys = (OID *)malloc(LOOKUPS * sizeof(OID));
+	for (i = 0; i < LOOKUPS; i++)
+		mkoid(&keys[i], rand() % n, rows);
+
+	list = listnew(sizeof(MIB), 0);
+	miblist = miblistnew(0);
+	for (i = 0; i < n; i++) {
+		listputnode(list, mknode(miblist, i, rows), AFTER);
+		miblistput(miblist, mknode(miblist, i, rows));
+	}
+
+	/* Random GETs */
+	found = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < LOOKUPS; i++)
+		if (listgooid(list, &keys[i])) found++;
+	tl = elapsed(&t);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < LOOKUPS; i++)
+		if (miblistgooid(miblist, &keys[i])) found--;
+	ta = elapsed(&t);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < LOOKUPS; i++)
+		if (miblistfind(miblist, &keys[i])) found++;
+	tt = elapsed(&t);
+	if (found != LOOKUPS) printf("Lookup mismatch at %d leaves!\n", n);
+
+	/* A GETNEXT walk of the whole tree, looking up each returned OID */
+	oid.len = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (thismib = (MIB *)listgohead(list); thismib; thismib = (MIB *)listgonext(list)) {
+		oid = thismib->oid;
+		listgooid(list, &oid);
+	}
+	wl = elapsed(&t);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (thismib = miblistgohead(miblist); thismib; thismib = miblistgonext(miblist)) {
+		oid = thismib->oid;
+		miblistgooid(miblist, &oid);
+	}
+	wa = elapsed(&t);
+	oid.len = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	while ((thismib = miblistfindnext(miblist, &oid)))
+		oid = thismib->oid;
+	wt = elapsed(&t);
+
+	printf("%8d %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", n, tl / LOOKUPS,
+		ta / LOOKUPS, tt / LOOKUPS, wl / n, wa / n, wt / n);
+
+	while (listgohead(list) && listdelnode(list))
+		;
+	listfree(list);
+	miblistfree(miblist);
+	free(keys);
+}
+
+int main(int argc, char *argv[])
+{
+	int n;
+
+	srand(1);
+	printf("Microseconds per operation, linked list vs sorted array vs trie index\n");
+	printf("%8s %10s %10s %10s %10s %10s %10s\n", "Leaves", "Get(list)", "Get(array)",
+		"Get(trie)", "Walk(list)", "Walk(array)", "Walk(trie)");
+	if (argc > 1)
+		bench(atoi(argv[1]));
+	else
+		for (n = 1000; n <= 100000; n *= 10)
+			bench(n);
+	return 0;
+}
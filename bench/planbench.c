@@ -0,0 +1,216 @@
+/*
+ * Benchmarks a Get of many OIDs from an agent, one OID a request against
+ * packed by the planner, cold and with the ceiling of the agent learned.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "SnmpAgent.h"
+#include "planner.h"
+
+#define AGENT_PORT 16266
+#define STR_LEN 48  /* Of the values of the second column */
+#define HELD 64  /* Requests the agent holds */
+
+/* The agent, a thread answering on AGENT_PORT each request delay
+   microseconds after it came */
+typedef struct {
+	int fd;
+	int delay;
+	unsigned int stop;
+	SnmpAgentCtx *ctx;
+	struct {
+		double due;
+		struct sockaddr_in from;
+		int len;
+		unsigned char buf[REQUEST_BUFFER_SIZE];
+	} *held;
+} AGENT;
+
+/* Microseconds from an arbitrary start */
+static double usnow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+/* A table under P.38644.30.1.1 of an integer column and a column of strings
+   of STR_LEN bytes */
+static MIB *mknode(int col, int row)
+{
+	MIB *thismib = (MIB *)malloc(sizeof(MIB) + STR_LEN);
+
+	thismib->oid.array[0] = 'P';
+	thismib->oid.array[1] = 38644;
+	thismib->oid.array[2] = 30;
+	thismib->oid.array[3] = 1;
+	thismib->oid.array[4] = 1;
+	thismib->oid.array[5] = col;
+	thismib->oid.array[6] = row;
+	thismib->oid.len = 7;
+	if (col == 1) {
+		thismib->dataType = INTEGER;
+		thismib->dataLen = INT_SIZE;
+		thismib->u.intval = row;
+	}
+	else {
+		thismib->dataType = OCTET_STRING;
+		thismib->dataLen = STR_LEN;
+		thismib->u.octetstring = (unsigned char *)(thismib + 1);
+		memset(thismib->u.octetstring, 'a' + row % 26, STR_LEN);
+	}
+	thismib->dataSize = thismib->dataInline = col == 1 ? 0 : STR_LEN;
+	thismib->dataHeap = FALSE;
+	thismib->access = RD_ONLY;
+	thismib->get = NULL;
+	thismib->set = NULL;
+	return thismib;
+}
+
+static void *agent(void *arg)
+{
+	AGENT *a = (AGENT *)arg;
+	struct messageStruct *req = a->ctx->request, *resp = a->ctx->response;
+	socklen_t fromlen;
+	unsigned int head = 0, tail = 0;
+	int len;
+
+	while (!__atomic_load_n(&a->stop, __ATOMIC_ACQUIRE)) {
+		for (; head - tail < HELD; head++) {
+			fromlen = sizeof(struct sockaddr_in);
+			if ((len = recvfrom(a->fd, a->held[head % HELD].buf, REQUEST_BUFFER_SIZE, MSG_DONTWAIT,
+				(struct sockaddr *)&a->held[head % HELD].from, &fromlen)) < 0)
+				break;
+			a->held[head % HELD].len = len;
+			a->held[head % HELD].due = usnow() + a->delay;
+		}
+		for (; tail != head && a->held[tail % HELD].due <= usnow(); tail++) {
+			memcopy(req->buffer, a->held[tail % HELD].buf, a->held[tail % HELD].len);
+			req->index = 0;
+			req->len = a->held[tail % HELD].len;
+			if (parseSNMPMessageCtx(a->ctx) < 0) continue;
+			sendto(a->fd, resp->buffer+resp->index, resp->len, 0,
+				(struct sockaddr *)&a->held[tail % HELD].from, sizeof(struct sockaddr_in));
+		}
+		usleep(50);
+	}
+	return NULL;
+}
+
+/* Gets both columns of the table in a batch */
+static void bench(char *mode, PLANNER *pl, struct sockaddr_in *to, int rows)
+{
+	PLAN *plan = plannew(pl, (struct sockaddr *)to, "public", GET_REQUEST);
+	char oidstr[32];
+	double t;
+	int i, status;
+
+	for (i = 0; i < 2 * rows; i++) {
+		sprintf(oidstr, "P.38644.30.1.1.%d.%d", 1 + i % 2, 1 + i / 2);
+		planadd(plan, oidstr, NULL_ITEM, NULL, 0);
+	}
+	t = usnow();
+	status = planrun(plan);
+	t = usnow() - t;
+	if (status != SUCCESS)
+		printf("Get of %d OIDs failed!\n", plan->n);
+	printf("%-16s %8d %10u %8u %10d %10.3f\n", mode, plan->n, (unsigned int) plan->requests,
+		(unsigned int) plan->tooBig, plannerlimit(pl, (struct sockaddr *)to), t / 1e6);
+	planfree(plan);
+}
+
+int main(int argc, char *argv[])
+{
+	AGENT a;
+	pthread_t tid;
+	struct sockaddr_in addr;
+	MIBLIST *miblist;
+	POLLER *p;
+	PLANNER *pl;
+	int i, rows = argc > 1 ? atoi(argv[1]) : 250, fd;
+
+	endianness = endian();
+	a.delay = argc > 2 ? atoi(argv[2]) : 2000;
+	miblist = miblistnew(0);
+	for (i = 1; i <= rows; i++) {
+		miblistput(miblist, mknode(1, i));
+		miblistput(miblist, mknode(2, i));
+	}
+	a.ctx = newSnmpAgentCtx(miblist, "public", "private");
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(AGENT_PORT);
+	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+	a.fd = socket(PF_INET, SOCK_DGRAM, 0);
+	if (bind(a.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		printf("Fail to bind port %d.\n", AGENT_PORT);
+		return -1;
+	}
+	a.stop = 0;
+	a.held = malloc(HELD * sizeof(*a.held));
+	pthread_create(&tid, NULL, agent, &a);
+
+	/* One request outstanding, so that each costs a round trip as with
+	   reqSend() */
+	fd = socket(PF_INET, SOCK_DGRAM, 0);
+	p = pollernew(fd, 1, 1000, 2);
+	printf("Get of %d rows of a table of an integer and a %d-byte string, answered in %d microseconds a request\n",
+		rows, STR_LEN, a.delay);
+	printf("%-16s %8s %10s %8s %10s %10s\n", "Packing", "OIDs", "Requests", "TooBig", "Ceiling",
+		"Seconds");
+	pl = plannernew(p, 1, 1);  /* At least one varbind a request */
+	bench("One a request", pl, &addr, rows);
+	plannerfree(pl);
+	pl = plannernew(p, 1, VB_BUFFER_SIZE);
+	bench("VB_BUFFER_SIZE", pl, &addr, rows);
+	plannerfree(pl);
+	pl = plannernew(p, 1, PLANNER_SIZE);
+	bench("Planner, cold", pl, &addr, rows);
+	bench("Planner, warm", pl, &addr, rows);
+	plannerfree(pl);
+
+	__atomic_store_n(&a.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(tid, NULL);
+	pollerfree(p);
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * Benchmarks polling many agents of some latency, one GET request at a time
+ * with reqSend(), against the asynchronous poller of poller.h.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "SnmpMgr.h"
+#include "poller.h"
+
+#define AGENT_PORT 16264
+#define DELAY 2000  /* Microseconds an agent takes to answer */
+#define HELD 65536  /* Requests an agent holds */
+
+/* The agents, one thread answering on AGENT_PORT each GET request DELAY
+   after it came, and dropping one in drop. */
+typedef struct {
+	int fd;
+	int drop;
+	unsigned int stop;
+	struct {
+		double due;
+		struct sockaddr_in from;
+		int len;
+		unsigned char buf[REQUEST_BUFFER_SIZE];
+	} *held;
+} AGENTS;
+
+static uint32_t answered;
+
+/* Microseconds from an arbitrary start */
+static double usnow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static void *agents(void *arg)
+{
+	AGENTS *a = (AGENTS *)arg;
+	MSGVIEW msg;
+	VBVIEW vb[VBVIEW_MAX(REQUEST_BUFFER_SIZE)];
+	socklen_t fromlen;
+	unsigned int head = 0, tail = 0, n = 0;
+	int len;
+
+	while (!__atomic_load_n(&a->stop, __ATOMIC_ACQUIRE)) {
+		for (; head - tail < HELD; head++) {
+			fromlen = sizeof(struct sockaddr_in);
+			if ((len = recvfrom(a->fd, a->held[head % HELD].buf, REQUEST_BUFFER_SIZE, MSG_DONTWAIT,
+				(struct sockaddr *)&a->held[head % HELD].from, &fromlen)) < 0)
+				break;
+			a->held[head % HELD].len = len;
+			a->held[head % HELD].due = usnow() + DELAY;
+		}
+		for (; tail != head && a->held[tail % HELD].due <= usnow(); tail++) {
+			if (a->drop && ++n % a->drop == 0) continue;
+			if (msgView(a->held[tail % HELD].buf, a->held[tail % HELD].len, &msg, vb,
+				VBVIEW_MAX(REQUEST_BUFFER_SIZE)) != SUCCESS)
+				continue;
+			*msg.pduTlv = GET_RESPONSE;
+			sendto(a->fd, a->held[tail % HELD].buf, a->held[tail % HELD].len, 0,
+				(struct sockaddr *)&a->held[tail % HELD].from, sizeof(struct sockaddr_in));
+		}
+		usleep(tail == head ? 200 : 50);
+	}
+	return NULL;
+}
+
+static void counted(POLLER *p, MSGVIEW *msg, void *arg)
+{
+	(void)p;
+	(void)arg;
+	if (msg) answered++;
+}
+
+/* Polls of n requests, at most window outstanding */
+static void pollbench(struct sockaddr_in *to, int n, int window, int timeout)
+{
+	POLLER *p;
+	int fd, k;
+	double t;
+
+	fd = socket(PF_INET, SOCK_DGRAM, 0);
+	p = pollernew(fd, window, timeout, 2);
+	answered = 0;
+	t = usnow();
+	for (k = 0; k < n || pollerpending(p) > 0; ) {
+		for (; k < n; k++)
+			if (pollersend(p, (struct sockaddr *)to, "public", GET_REQUEST, &vblist, counted, NULL) == BUFFER_FULL)
+				break;
+		pollerwait(p, POLLER_TICK);
+	}
+	t = usnow() - t;
+	printf("%8s %8d %8d %12.0f %10u %10u %10u\n", "Poller", window, n, n / t * 1e6,
+		(unsigned int) answered, (unsigned int) p->timedout, (unsigned int) p->retried);
+	pollerfree(p);
+	close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+	AGENTS a;
+	pthread_t tid;
+	struct sockaddr_in addr;
+	int i, n = argc > 1 ? atoi(argv[1]) : 20000, window, seq = 500, rcvbuf = 1 << 22;
+	double t;
+
+	initSnmpMgr(0);
+	vblistAdd(&vblist, "B.1.1.0", NULL_ITEM, NULL, 0);
+	vblistAdd(&vblist, "B.1.3.0", NULL_ITEM, NULL, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(AGENT_PORT);
+	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+	a.fd = socket(PF_INET, SOCK_DGRAM, 0);
+	setsockopt(a.fd, SOL_SOCKET, SO_RCVBUF, (char *)&rcvbuf, sizeof(rcvbuf));
+	if (bind(a.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		printf("Fail to bind port %d.\n", AGENT_PORT);
+		return -1;
+	}
+	a.drop = 0;
+	a.stop = 0;
+	a.held = malloc(HELD * sizeof(*a.held));
+	pthread_create(&tid, NULL, agents, &a);
+
+	printf("GET requests a second to agents answering in %d microseconds\n", DELAY);
+	printf("%8s %8s %8s %12s %10s %10s %10s\n", "Method", "Window", "Polls", "Polls/s",
+		"Answered", "Timed out", "Retries");
+	answered = 0;
+	t = usnow();
+	for (i = 0; i < seq; i++) {
+		reqBuild(&request, GET_REQUEST, i+1, &vblist);
+		if (reqSend(&request, &response, "127.0.0.1", AGENT_PORT, "public", 1) == SUCCESS)
+			answered++;
+	}
+	t = usnow() - t;
+	printf("%8s %8d %8d %12.0f %10u %10s %10s\n", "reqSend", 1, seq, seq / t * 1e6,
+		(unsigned int) answered, "-", "-");
+	for (window = 1; window <= 1000; window *= 10)
+		pollbench(&addr, window == 1 ? seq : n, window, 1000);
+	printf("With one request in 100 dropped, and a timeout of 100 milliseconds\n");
+	a.drop = 100;
+	pollbench(&addr, n, 1000, 100);
+
+	__atomic_store_n(&a.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(tid, NULL);
+	exitSnmpMgr();
+	return 0;
+}
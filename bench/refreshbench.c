@@ -0,0 +1,121 @@
+/*
+ * Benchmarks refreshing a MIB tree from a data file of many values, read in full
+ * each time against reparsing only the lines that changed.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mibfile.h"
+#include "mibutil.h"
+
+#define DAT_FILE "/tmp/refreshbench.dat"
+#define ROUNDS 10
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* Writes n values, alternately an integer and a string, of a table under
+   P.38644.30.1.1, with those i of which i % every == 0 changed in round. */
+static void mkfile(int n, int every, int round)
+{
+	FILE *f = fopen(DAT_FILE, "w");
+	int i, v;
+
+	for (i = 0; i < n; i++) {
+		v = every && i % every == 0 ? i + round : i;
+		if (i % 2)
+			fprintf(f, "P.38644.30.1.1.%d.%d=S,-,%02x-%02x-%02x-%02x\n", 2, i/2+1,
+				v & 255, (v >> 8) & 255, (v >> 16) & 255, 0x41);
+		else
+			fprintf(f, "P.38644.30.1.1.%d.%d=I,-,%d\n", 1, i/2+1, v);
+	}
+	fclose(f);
+}
+
+static void bench(int n, int every)
+{
+	struct timespec t;
+	MIBLIST *full, *incr;
+	MIBFILE *m;
+	double tf = 0, ti = 0;
+	int round;
+	uint32_t parsed;
+
+	full = miblistnew(0);
+	incr = miblistnew(0);
+	mkfile(n, every, 0);
+	miblistread(full, DAT_FILE);
+	m = mibfilenew(incr, DAT_FILE);
+	mibfileread(m);
+	parsed = m->parsed;
+	for (round = 1; round <= ROUNDS; round++) {
+		if (every) mkfile(n, every, round);
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		miblistread(full, DAT_FILE);
+		tf += elapsed(&t);
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		mibfileread(m);
+		ti += elapsed(&t);
+	}
+	if (miblistsize(full) != n || miblistsize(incr) != n)
+		printf("Trees of %d and %d nodes for %d lines!\n", miblistsize(full), miblistsize(incr), n);
+	printf("%8d %8d %14.3f %14.3f %10u\n", n, every ? n / every : 0, tf / ROUNDS / 1e3,
+		ti / ROUNDS / 1e3, (unsigned int)(m->parsed - parsed) / ROUNDS);
+	mibfilefree(m);
+	miblistfree(full);
+	miblistfree(incr);
+}
+
+int main(int argc, char *argv[])
+{
+	int n = argc > 1 ? atoi(argv[1]) : 50000;
+
+	printf("Milliseconds to refresh a MIB tree from its data file, read in full against changed lines only\n");
+	printf("%8s %8s %14s %14s %10s\n", "Lines", "Changed", "miblistread", "mibfileread", "Parsed");
+	bench(n, 0);
+	bench(n, 1000);
+	bench(n, 100);
+	bench(n, 10);
+	bench(n, 1);
+	unlink(DAT_FILE);
+	return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * Benchmarks resolving a host name for each request, looked up every time as
+ * gethostaddr() did, against answered from the cache of resolver.h.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include "resolver.h"
+
+/* Microseconds from an arbitrary start */
+static double usnow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+/* As gethostaddr() was, by gethostbyname() */
+static int lookup(char *host, struct sockaddr_in *sin)
+{
+	struct hostent *he;
+
+	if ((he = gethostbyname(host)) == NULL) return FAIL;
+	memset(sin, 0, sizeof(struct sockaddr_in));
+	sin->sin_family = AF_INET;
+	memmove(&sin->sin_addr, he->h_addr_list[0], he->h_length);
+	return SUCCESS;
+}
+
+static void bench(char *host, int n)
+{
+	RESOLVER *r = resolvernew(RESOLVER_SIZE, RESOLVER_TTL, RESOLVER_NEGTTL);
+	struct sockaddr_in sin;
+	struct sockaddr_storage addr;
+	double t, tl, tr;
+	int i, sl = 0, sr = 0;
+
+	t = usnow();
+	for (i = 0; i < n; i++)
+		sl += lookup(host, &sin) == SUCCESS;
+	tl = usnow() - t;
+	t = usnow();
+	for (i = 0; i < n; i++)
+		sr += resolve(r, host, &addr) == SUCCESS;
+	tr = usnow() - t;
+	printf("%-24s %8d %8d %12.3f %12.3f %10u\n", host, sl, sr, tl / n, tr / n,
+		(unsigned int) r->misses);
+	resolverfree(r);
+}
+
+int main(int argc, char *argv[])
+{
+	int i, n = 10000;
+
+	printf("Microseconds to resolve a name, looked up each time against through the cache\n");
+	printf("%-24s %8s %8s %12s %12s %10s\n", "Name", "Found", "(cached)", "Lookup", "Cached",
+		"Misses");
+	if (argc > 1)
+		for (i = 1; i < argc; i++)
+			bench(argv[i], 100);
+	else {
+		bench("127.0.0.1", n);
+		bench("localhost", n);
+		bench("no.such.host.invalid", 10);
+	}
+	return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * Benchmarks sending a trap to several managers with trapSend(), as usnmpd did,
+ * against a trap sink.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "trapsink.h"
+#include "trapqueue.h"
+
+#define TRAPS 2000
+#define TRAP_PORT 16262
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* Reads the traps that arrived, returning their number */
+static int drain(int fd)
+{
+	unsigned char buf[RESPONSE_BUFFER_SIZE];
+	int n = 0;
+
+	while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+		n++;
+	return n;
+}
+
+static void sinksend(struct messageStruct *trap, void *arg)
+{
+	trapsinksend((TRAPSINK *)arg, trap);
+}
+
+/* Microseconds per trap sent to n managers named dst */
+static void bench(int fd, int n, char *dst)
+{
+	struct timespec t;
+	struct messageStruct trap;
+	unsigned char buffer[REQUEST_BUFFER_SIZE];
+	TRAPSINK *sink;
+	TRAPQUEUE *queue;
+	int i, j, got;
+	double ts, tk, tq;
+
+	trap.buffer = buffer; trap.size = REQUEST_BUFFER_SIZE;
+
+	/* trapSend() wraps the PDU in place, so it is built for each manager */
+	got = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < TRAPS; i++) {
+		for (j = 0; j < n; j++) {
+			trapBuild(&trap, "P.38644.30", "127.0.0.1", AUTHENTICATE_FAIL, 0, NULL);
+			trapSend(&trap, dst, TRAP_PORT, "public");
+		}
+		got += drain(fd);
+	}
+	ts = elapsed(&t);
+	got += drain(fd);
+
+	sink = trapsinknew(60);
+	for (j = 0; j < n; j++)
+		trapsinkadd(sink, dst, TRAP_PORT, "public");
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < TRAPS; i++) {
+		trapBuild(&trap, "P.38644.30", "127.0.0.1", AUTHENTICATE_FAIL, 0, NULL);
+		trapsinksend(sink, &trap);
+		got += drain(fd);
+	}
+	tk = elapsed(&t);
+	got += drain(fd);
+
+	/* A flood of the same trap through a queue sending one a second */
+	queue = trapqueuenew(16, 1000, 1, "P.38644.30.0.1");
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	for (i = 0; i < TRAPS; i++) {
+		trapBuild(&trap, "P.38644.30", "127.0.0.1", AUTHENTICATE_FAIL, 0, NULL);
+		trapqueuepush(queue, &trap);
+		trapqueuedrain(queue, &trap, 0, sinksend, sink);
+		got += drain(fd);
+	}
+	tq = elapsed(&t);
+	got += drain(fd);
+	trapqueuefree(queue);
+	trapsinkfree(sink);
+
+	printf("%9d %10s %12.3f %12.3f %12.3f %8d\n", n, dst, ts / TRAPS, tk / TRAPS, tq / TRAPS, got);
+}
+
+int main(void)
+{
+	struct sockaddr_in addr;
+	int fd, n, size = 1 << 22;
+
+	endianness = endian();
+	fd = socket(PF_INET, SOCK_DGRAM, 0);
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(TRAP_PORT);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		printf("Fail to bind port %d.\n", TRAP_PORT);
+		return FAIL;
+	}
+
+	printf("Microseconds per trap sent to every manager, by trapSend(), by a trap sink, and\n");
+	printf("queued for a trap sink at most once a second\n");
+	printf("%9s %10s %12s %12s %12s %8s\n", "Managers", "Named", "trapSend", "Trap sink", "Queued", "Received");
+	for (n = 1; n <= 16; n *= 4) {
+		bench(fd, n, "127.0.0.1");
+		bench(fd, n, "localhost");
+	}
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,278 @@
+/*
+ * Benchmarks receiving traps from a local load generator, one recvfrom()
+ * at a time against a trap receiver with a ring for a consuming thread.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE  /* for sendmmsg() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "SnmpAgent.h"
+#include "traprecv.h"
+
+#define TRAP_PORT 16263
+#define RING_SIZE 4096
+#define BATCH 64
+
+static unsigned char version[] = { INTEGER, 1, 0 };
+
+typedef struct {
+	double secs;
+	int rate;  /* Traps a second, as fast as possible if 0 */
+	unsigned char *msg;
+	int len;
+	uint32_t sent;
+	int done;  /* Set by the load generator when it ends */
+} LOAD;
+
+/* Seconds since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* A trap of three varbinds, wrapped in a message */
+static int mktrap(unsigned char *buf, int size)
+{
+	struct messageStruct trap, vblist, msg;
+	unsigned char tbuf[REQUEST_BUFFER_SIZE], vbuf[VB_BUFFER_SIZE];
+	uint32_t i = 1;
+	int len;
+
+	trap.buffer = tbuf; trap.size = sizeof(tbuf);
+	vblist.buffer = vbuf; vblist.size = sizeof(vbuf);
+	vblistReset(&vblist);
+	vblistAdd(&vblist, "P.38644.30.1.1.2.10", INTEGER, &i, 0);
+	vblistAdd(&vblist, "B.1.5.0", OCTET_STRING, "field-device-0042", 17);
+	vblistAdd(&vblist, "B.1.3.0", TIMETICKS, &i, 0);
+	trapBuild(&trap, "P.38644.30", "127.0.0.1", ENTERPRISE_SPECIFIC, 2, &vblist);
+	msg.buffer = buf; msg.size = size; msg.index = size;
+	len = prependBytes(&msg, trap.buffer, trap.len);
+	len += prependBytes(&msg, (unsigned char *)"public", 6);
+	len += prependHeader(&msg, OCTET_STRING, 6);
+	len += prependBytes(&msg, version, sizeof(version));
+	len += prependHeader(&msg, SEQUENCE, len);
+	memmove(buf, buf + msg.index, len);
+	return len;
+}
+
+/* The load generator: sends the trap in batches for l->secs at l->rate */
+static void *generate(void *arg)
+{
+	LOAD *l = (LOAD *)arg;
+	struct mmsghdr msgs[BATCH];
+	struct iovec iov;
+	struct sockaddr_in to;
+	struct timespec t, nap;
+	double ahead;
+	int fd, i, n;
+
+	fd = socket(PF_INET, SOCK_DGRAM, 0);
+	memset(&to, 0, sizeof(to));
+	to.sin_family = AF_INET;
+	to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	to.sin_port = htons(TRAP_PORT);
+	connect(fd, (struct sockaddr *)&to, sizeof(to));
+	iov.iov_base = l->msg; iov.iov_len = l->len;
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < BATCH; i++) {
+		msgs[i].msg_hdr.msg_iov = &iov;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	while (elapsed(&t) < l->secs) {
+		if ((n = sendmmsg(fd, msgs, BATCH, 0)) > 0) l->sent += n;
+		else sched_yield();  /* Socket buffer full */
+		if (l->rate > 0 && (ahead = (double)l->sent / l->rate - elapsed(&t)) > 0) {
+			nap.tv_sec = (time_t) ahead;
+			nap.tv_nsec = (long) ((ahead - nap.tv_sec) * 1e9);
+			nanosleep(&nap, NULL);
+		}
+	}
+	close(fd);
+	__atomic_store_n(&l->done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/* What a consumer does with a trap: format it, as usnmptrapd does */
+static void consume(FILE *f, MSGVIEW *msg, VBVIEW *vb)
+{
+	OID entoid;
+	char oid[64];
+
+	fprintf(f, "Community: %.*s\n", msg->communityLen, (char *) msg->community);
+	ber2oid(msg->enterprise, msg->enterpriseLen, &entoid);
+	oid2str(&entoid, oid); fprintf(f, "Enterprise OID: %s\n", oid);
+	fprintf(f, "Agent address: %u.%u.%u.%u\n", msg->agentAddr[0], msg->agentAddr[1],
+		msg->agentAddr[2], msg->agentAddr[3]);
+	fprintf(f, "Generic trap code: %u\n", (unsigned int) msg->generic);
+	fprintf(f, "Specific trap code: %u\n", (unsigned int) msg->specific);
+	fprintf(f, "Timestamp: %u\n", (unsigned int) msg->timestamp);
+	vbviewPrint(vb, msg->nvb, f);
+}
+
+static int bindport(void)
+{
+	struct sockaddr_in addr;
+	struct timeval wait = { 0, TRAPRECV_WAIT * 1000 };
+	int fd, on = 1, size = 1 << 22;
+
+	fd = socket(PF_INET, SOCK_DGRAM, 0);
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(TRAP_PORT);
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		printf("Fail to bind port %d.\n", TRAP_PORT);
+		exit(1);
+	}
+	return fd;
+}
+
+static void *receive(void *arg)
+{
+	traprecvrun((TRAPRECV *)arg);
+	return NULL;
+}
+
+static void report(char *how, LOAD *l, uint32_t got, uint32_t dropped, double secs)
+{
+	printf("%-10s %9d %10u %10.0f %10u %10u %7.2f%%\n", how, l->rate, l->sent, got / secs,
+		dropped, l->sent - got - dropped, l->sent ? 100.0 * (l->sent - got) / l->sent : 0.0);
+}
+
+/* One datagram at a time: recvfrom(), decode and format to out, if any, on
+   one thread */
+static void benchRecvfrom(LOAD *l, FILE *out)
+{
+	unsigned char buf[RESPONSE_BUFFER_SIZE];
+	VBVIEW vb[TRAPRECV_VB];
+	MSGVIEW msg;
+	struct timespec t;
+	pthread_t tid;
+	uint32_t got = 0;
+	int fd = bindport(), len;
+	double secs = 0;
+
+	l->sent = 0; l->done = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	pthread_create(&tid, NULL, generate, l);
+	for (;;) {
+		if ((len = recv(fd, buf, sizeof(buf), 0)) < 0) {
+			if (__atomic_load_n(&l->done, __ATOMIC_ACQUIRE)) break;
+			continue;
+		}
+		if (msgView(buf, len, &msg, vb, TRAPRECV_VB) == SUCCESS && out) consume(out, &msg, vb);
+		got++;
+		secs = elapsed(&t);
+	}
+	pthread_join(tid, NULL);
+	close(fd);
+	report(out ? "recvfrom" : "recvfrom-", l, got, 0, secs);
+}
+
+/* A receiving thread with recvmmsg() into the ring, formatted to out, if
+   any, on this one */
+static void benchRing(LOAD *l, FILE *out)
+{
+	TRAPRECV *r;
+	TRAPREC *rec;
+	struct timespec t;
+	pthread_t gen, rcv;
+	uint32_t got = 0;
+	int fd = bindport();
+	double secs = 0;
+
+	r = traprecvnew(fd, RING_SIZE);
+	l->sent = 0; l->done = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	pthread_create(&rcv, NULL, receive, r);
+	pthread_create(&gen, NULL, generate, l);
+	for (;;) {
+		if ((rec = traprecvwait(r, TRAPRECV_WAIT)) == NULL) {
+			if (__atomic_load_n(&l->done, __ATOMIC_ACQUIRE)) break;
+			continue;
+		}
+		if (rec->status == SUCCESS && out) consume(out, &rec->msg, rec->vb);
+		traprecvpop(r);
+		got++;
+		secs = elapsed(&t);
+	}
+	traprecvstop(r);
+	pthread_join(rcv, NULL);
+	pthread_join(gen, NULL);
+	report(out ? "traprecv" : "traprecv-", l, got, r->dropped, secs);
+	traprecvfree(r);
+	close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned char msg[REQUEST_BUFFER_SIZE];
+	int rates[] = { 50000, 100000, 0 }, i;
+	FILE *out = fopen("/dev/null", "w");
+	LOAD l;
+
+	endianness = endian();
+	l.msg = msg;
+	l.len = mktrap(msg, sizeof(msg));
+	l.secs = argc > 1 ? atof(argv[1]) : 1.0;
+	printf("Traps of %d bytes from a local load generator for %.1f s, formatted as usnmptrapd\n",
+		l.len, l.secs);
+	printf("does, or only decoded (-)\n");
+	printf("%-10s %9s %10s %10s %10s %10s %8s\n", "Receiver", "Rate", "Sent", "Taken/s",
+		"Dropped", "Lost", "Missed");
+	for (i = 0; i < (int)(sizeof(rates)/sizeof(rates[0])); i++) {
+		if (argc > 2 && i > 0) break;
+		l.rate = argc > 2 ? atoi(argv[2]) : rates[i];
+		benchRecvfrom(&l, out);
+		benchRing(&l, out);
+		benchRecvfrom(&l, NULL);
+		benchRing(&l, NULL);
+	}
+	fclose(out);
+	return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * Benchmarks a GetNext walk of a large MIB tree, encoding the OID of each node
+ * found against copying an encoding kept with the node.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "SnmpAgent.h"
+
+#define COLUMNS 10
+
+static unsigned char head[] = {  /* version, community "public" */
+	INTEGER, 1, 0, OCTET_STRING, 6, 'p', 'u', 'b', 'l', 'i', 'c' };
+static unsigned char pduhead[] = {  /* request-id, error-status, error-index */
+	INTEGER, 2, 0x12, 0x34, INTEGER, 1, 0, INTEGER, 1, 0 };
+static unsigned char nullvalue[] = { NULL_ITEM, 0 };
+
+/* Microseconds elapsed since start */
+static double elapsed(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/* A table of COLUMNS columns under P.38644.30.1.1, as in miblistbench. The
+   OID TLV of the node is kept right after it. */
+static MIB *mknode(int i, int rows)
+{
+	MIB *thismib = (MIB *)malloc(sizeof(MIB) + OID_SIZE*5+2);
+	unsigned char *name = (unsigned char *)(thismib + 1);
+
+	thismib->oid.array[0] = 'P';
+	thismib->oid.array[1] = 38644;
+	thismib->oid.array[2] = 30;
+	thismib->oid.array[3] = 1;
+	thismib->oid.array[4] = 1;
+	thismib->oid.array[5] = 1 + i / rows;
+	thismib->oid.array[6] = 1 + i % rows;
+	thismib->oid.len = 7;
+	thismib->dataType = INTEGER;
+	thismib->dataLen = INT_SIZE;
+	thismib->u.intval = i;
+	thismib->dataSize = 0;
+	thismib->dataInline = 0;  /* The OID TLV after it is not a value */
+	thismib->dataHeap = FALSE;
+	thismib->access = RD_ONLY;
+	thismib->get = NULL;
+	thismib->set = NULL;
+	name[0] = OBJECT_IDENTIFIER;
+	name[1] = oid2ber(&thismib->oid, name+2);
+	return thismib;
+}
+
+/* A walk step as the agent makes it: the requested OID is decoded, and the
+   OID of the next node encoded for the response. */
+static int walkEncode(MIBLIST *miblist)
+{
+	unsigned char name[OID_SIZE*5+2] = { OBJECT_IDENTIFIER, 0 };
+	MIB *thismib;
+	OID oid;
+	int steps = 0;
+
+	while (ber2oid(name+2, name[1], &oid), (thismib = miblistfindnext(miblist, &oid))) {
+		name[1] = oid2ber(&thismib->oid, name+2);
+		steps++;
+	}
+	return steps;
+}
+
+/* As above, with the encoded OID of the next node copied instead */
+static int walkCopy(MIBLIST *miblist)
+{
+	unsigned char name[OID_SIZE*5+2] = { OBJECT_IDENTIFIER, 0 }, *kept;
+	MIB *thismib;
+	OID oid;
+	int steps = 0;
+
+	while (ber2oid(name+2, name[1], &oid), (thismib = miblistfindnext(miblist, &oid))) {
+		kept = (unsigned char *)(thismib + 1);
+		memcopy(name, kept, kept[1]+2);
+		steps++;
+	}
+	return steps;
+}
+
+/* GetNext requests through the agent, each for the OID in the last response */
+static int walkAgent(SnmpAgentCtx *ctx)
+{
+	struct messageStruct *req = ctx->request, *resp = ctx->response;
+	unsigned char name[OID_SIZE*5+2] = { OBJECT_IDENTIFIER, 1, 0x2B };
+	MSGVIEW msg;
+	VBVIEW vb[1];
+	int len, steps = 0;
+
+	for (;;) {
+		req->index = req->len = req->size;
+		len = prependBytes(req, nullvalue, sizeof(nullvalue));
+		len += prependBytes(req, name, name[1]+2);
+		len += prependHeader(req, SEQUENCE, len);
+		len += prependHeader(req, SEQUENCE, len);
+		len += prependBytes(req, pduhead, sizeof(pduhead));
+		len += prependHeader(req, GET_NEXT_REQUEST, len);
+		len += prependBytes(req, head, sizeof(head));
+		prependHeader(req, SEQUENCE_OF, len);
+		if (parseSNMPMessageCtx(ctx) < 0 ||
+			msgView(resp->buffer+resp->index, resp->len, &msg, vb, 1) != SUCCESS ||
+			msg.errorStatus != NO_ERR)
+			break;
+		memcopy(name, vb[0].name, vb[0].name[1]+2);
+		steps++;
+	}
+	return steps;
+}
+
+static void bench(int n)
+{
+	struct timespec t;
+	MIBLIST *miblist;
+	SnmpAgentCtx *ctx;
+	int i, rows = n / COLUMNS, se, sc, sa;
+	double te, tc, ta;
+
+	miblist = miblistnew(0);
+	for (i = 0; i < n; i++)
+		miblistput(miblist, mknode(i, rows));
+	ctx = newSnmpAgentCtx(miblist, "public", "private");
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	se = walkEncode(miblist);
+	te = elapsed(&t);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	sc = walkCopy(miblist);
+	tc = elapsed(&t);
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	sa = walkAgent(ctx);
+	ta = elapsed(&t);
+	if (se != n || sc != n || sa != n)
+		printf("Walk of %d leaves took %d, %d and %d steps!\n", n, se, sc, sa);
+
+	printf("%8d %12.3f %12.3f %12.3f %12.0f\n", n, te / n, tc / n, ta / n, n / ta * 1e6);
+
+	freeSnmpAgentCtx(ctx);
+	miblistfree(miblist);
+}
+
+int main(int argc, char *argv[])
+{
+	int n;
+
+	endianness = endian();
+	printf("Microseconds per step of a GetNext walk, OID encoded vs copied, and through the agent\n");
+	printf("%8s %12s %12s %12s %12s\n", "Leaves", "Step(encode)", "Step(copy)",
+		"GetNext", "GetNext/s");
+	if (argc > 1)
+		bench(atoi(argv[1]));
+	else
+		for (n = 10000; n <= 1000000; n *= 10)
+			bench(n);
+	return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Benchmarks walking a table of a local agent answering with some latency,
+ * one GetNext at a time against several chains, varbinds and requests at once.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "SnmpAgent.h"
+#include "walker.h"
+
+#define AGENT_PORT 16265
+#define COLUMNS 10
+#define HELD 4096  /* Requests the agent holds */
+
+/* The agent, a thread answering on AGENT_PORT each request delay
+   microseconds after it came */
+typedef struct {
+	int fd;
+	int delay;
+	unsigned int stop;
+	SnmpAgentCtx *ctx;
+	struct {
+		double due;
+		struct sockaddr_in from;
+		int len;
+		unsigned char buf[REQUEST_BUFFER_SIZE];
+	} *held;
+} AGENT;
+
+/* Microseconds from an arbitrary start */
+static double usnow(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+/* A table of COLUMNS columns under P.38644.30.1.1, as in miblistbench */
+static MIB *mknode(MIBLIST *miblist, int i, int rows)
+{
+	MIB *thismib;
+	OID oid = { 7, { 'P', 38644, 30, 1, 1 } };
+
+	oid.array[5] = 1 + i / rows;
+	oid.array[6] = 1 + i % rows;
+	thismib = miblistnewmib(miblist, &oid, INTEGER, RD_ONLY);
+	thismib->u.intval = i;
+	return thismib;
+}
+
+static void *agent(void *arg)
+{
+	AGENT *a = (AGENT *)arg;
+	struct messageStruct *req = a->ctx->request, *resp = a->ctx->response;
+	socklen_t fromlen;
+	unsigned int head = 0, tail = 0;
+	int len;
+
+	while (!__atomic_load_n(&a->stop, __ATOMIC_ACQUIRE)) {
+		for (; head - tail < HELD; head++) {
+			fromlen = sizeof(struct sockaddr_in);
+			if ((len = recvfrom(a->fd, a->held[head % HELD].buf, REQUEST_BUFFER_SIZE, MSG_DONTWAIT,
+				(struct sockaddr *)&a->held[head % HELD].from, &fromlen)) < 0)
+				break;
+			a->held[head % HELD].len = len;
+			a->held[head % HELD].due = usnow() + a->delay;
+		}
+		for (; tail != head && a->held[tail % HELD].due <= usnow(); tail++) {
+			memcopy(req->buffer, a->held[tail % HELD].buf, a->held[tail % HELD].len);
+			req->index = 0;
+			req->len = a->held[tail % HELD].len;
+			if (parseSNMPMessageCtx(a->ctx) < 0) continue;
+			sendto(a->fd, resp->buffer+resp->index, resp->len, 0,
+				(struct sockaddr *)&a->held[tail % HELD].from, sizeof(struct sockaddr_in));
+		}
+		usleep(50);
+	}
+	return NULL;
+}
+
+static void bench(POLLER *p, struct sockaddr_in *to, int leaves, int chains, int maxvb, int window)
+{
+	WALKER *w = walkernew(p, (struct sockaddr *)to, "public", "P.38644.30.1.1", chains, maxvb, window);
+	double t = usnow();
+	int status = walkerrun(w);
+
+	t = usnow() - t;
+	if (status != SUCCESS || w->found != (uint32_t)leaves)
+		printf("Walk of %d leaves found %u, status %d!\n", leaves, (unsigned int) w->found, status);
+	printf("%8d %8d %8d %10u %10.3f %12.0f\n", chains, maxvb, window, (unsigned int) w->requests,
+		t / 1e6, w->found / t * 1e6);
+	walkerfree(w);
+}
+
+int main(int argc, char *argv[])
+{
+	AGENT a;
+	pthread_t tid;
+	struct sockaddr_in addr;
+	MIBLIST *miblist;
+	POLLER *p;
+	int i, rows = argc > 1 ? atoi(argv[1]) : 200, fd, rcvbuf = 1 << 22;
+
+	endianness = endian();
+	a.delay = argc > 2 ? atoi(argv[2]) : 2000;
+	miblist = miblistnew(0);
+	for (i = 0; i < rows * COLUMNS; i++)
+		miblistput(miblist, mknode(miblist, i, rows));
+	a.ctx = newSnmpAgentCtx(miblist, "public", "private");
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(AGENT_PORT);
+	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+	a.fd = socket(PF_INET, SOCK_DGRAM, 0);
+	setsockopt(a.fd, SOL_SOCKET, SO_RCVBUF, (char *)&rcvbuf, sizeof(rcvbuf));
+	if (bind(a.fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		printf("Fail to bind port %d.\n", AGENT_PORT);
+		return -1;
+	}
+	a.stop = 0;
+	a.held = malloc(HELD * sizeof(*a.held));
+	pthread_create(&tid, NULL, agent, &a);
+
+	fd = socket(PF_INET, SOCK_DGRAM, 0);
+	p = pollernew(fd, 64, 1000, 2);
+	printf("Walk of a table of %d rows and %d columns, answered in %d microseconds a request\n",
+		rows, COLUMNS, a.delay);
+	printf("%8s %8s %8s %10s %10s %12s\n", "Chains", "Varbinds", "Window", "Requests",
+		"Seconds", "Varbinds/s");
+	bench(p, &addr, rows * COLUMNS, 1, 1, 1);
+	for (i = 1; i <= COLUMNS; i *= 2)  /* 1, 2, 4 and 8 requests outstanding */
+		bench(p, &addr, rows * COLUMNS, COLUMNS, 1, i);
+	bench(p, &addr, rows * COLUMNS, COLUMNS, 5, 2);
+	bench(p, &addr, rows * COLUMNS, COLUMNS, COLUMNS, 1);
+
+	__atomic_store_n(&a.stop, 1, __ATOMIC_RELEASE);
+	pthread_join(tid, NULL);
+	pollerfree(p);
+	close(fd);
+	return 0;
+}
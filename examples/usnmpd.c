@@ -37,21 +37,61 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <signal.h>
+#include <sys/stat.h>
 #ifdef _WIN32
 #include "wingetopt.h"
 #else
 #include <unistd.h>
+#include <pthread.h>
 #endif
 #include "SnmpAgent.h"
 #include "keylist.h"
+#include "acl.h"
+#include "trapsink.h"
+#include "trapqueue.h"
+#include "mibfile.h"
+#include "mibjournal.h"
+#include "mibimage.h"
 #include "timer.h"
+#ifdef __linux__
+#include "evloop.h"
+#endif
 
-char *cfg_file = "usnmpd.cfg", *dat_file = "usnmpd.dat";
+char *cfg_file = "usnmpd.cfg", *dat_file = "usnmpd.dat", *jnl_file = NULL, *img_file = NULL;
+ACL *acl;  /* Authorised managers, from cfg_file */
+MIBFILE *mibFile;  /* Refreshes the MIB values from dat_file */
+MIBJOURNAL *journal;  /* The values set, until compacted into dat_file */
+MIBIMAGE *mibImage;  /* The MIB tree at start-up, from img_file */
+#define JOURNAL_LIMIT (256*1024)
+TRAPSINK *trapSink;  /* The managers that traps are sent to */
+TRAPQUEUE *trapQueue;  /* Traps waiting to be sent */
+volatile sig_atomic_t reloadAcl = 0;
+volatile sig_atomic_t refreshDue = 0;  /* Set by the timer, for the loop of serve() */
 void initMibTree( void );
+int loadMibTree( void );
 void timerHandler( void );
+void refreshValues( void );
+void reloadConfig( void );
+void commitSets( void *arg );
 Boolean noAuth = FALSE;
-Boolean checkCommStr(char *cstr, int reqType);
-void trapSend2(struct messageStruct *trap, char *fn);
+Boolean checkCommStr(SnmpAgentCtx *ctx, char *cstr, int reqType);
+void trapSend2(struct messageStruct *trap);
+void loadTrapSink( void );
+int initTrapQueue( void );
+void drainTraps( void *arg );
+void *serve( void *arg );
+void checkResult( SnmpAgentCtx *ctx, int result );
+#ifdef SIGHUP
+void hangupHandler( int sig );
+#endif
+#ifdef __linux__
+void refreshMib( void *arg );
+void configChanged( int fd, void *arg );
+#endif
+#ifndef _WIN32
+int startWorkers( int n, int port );
+#endif
 
 void printHelp( char *prog )
 {
@@ -60,7 +100,12 @@ void printHelp( char *prog )
 	printf("Options: -p Port  default listening port is 161\n");
 	printf("         -c File  default configuration file is usnmpd.cfg\n");
 	printf("         -f File  default MIB definition and data file is usnmpd.dat\n");
+	printf("         -j File  journal of the values set, default is the data file with .jnl\n");
+	printf("         -i File  MIB image to start from, written from the data file if older\n");
 	printf("         -a- do not authenticate community string\n");
+#ifndef _WIN32
+	printf("         -w Workers  number of threads serving requests, default is 1\n");
+#endif
 	printf("         -d turn on debug mode\n");
 	printf("Prefix OID with B:Mgmt-Mib2(1.3.6.1.2.1), E:Experimental(1.3.6.1.3), P:Private(1.3.6.1.4.1)\n");
 	printf("E.g. %s P.38644.30 -f usnmpd.dat\n", prog);
@@ -68,7 +113,11 @@ void printHelp( char *prog )
 
 int main(int argc, char *argv[])
 {
-	int c, port = SNMP_PORT;
+	int c, port = SNMP_PORT, workers = 1;
+#ifdef __linux__
+	EVLOOP *evloop;
+	int aclfd, mibfd;
+#endif
 
 	if ( argc < 2) {
 		printHelp( argv[0] );
@@ -76,7 +125,7 @@ int main(int argc, char *argv[])
 	}
 
 	optind = 1;
-	while ((c = getopt (argc, argv, "p:c:f:ad")) != -1)
+	while ((c = getopt (argc, argv, "p:c:f:j:i:w:ad")) != -1)
 		switch (c) {
 			case 'p':
 				port = atoi(optarg);
@@ -87,6 +136,15 @@ int main(int argc, char *argv[])
 			case 'f':
 				dat_file = optarg;
 				break;
+			case 'j':
+				jnl_file = optarg;
+				break;
+			case 'i':
+				img_file = optarg;
+				break;
+			case 'w':
+				workers = atoi(optarg);
+				break;
 			case 'a':
 				if ( argv[optind][2]=='-' ) noAuth = TRUE;
 				break;
@@ -98,68 +156,259 @@ int main(int argc, char *argv[])
 			default:
 				return FAIL;
 		}
+	if (optind >= argc) {  /* getopt() may have moved the enterprise OID there */
+		printHelp( argv[0] );
+		return FAIL;
+	}
 
-	if ( initSnmpAgent(port, argv[1], "public", "private") == FAIL ) {
+	if ((acl = aclnew(cfg_file)) == NULL || (trapSink = trapsinknew(300)) == NULL) {
+		printf("Fail to load %s.\n", cfg_file);
+		return FAIL;
+	}
+	loadTrapSink();
+#ifdef SIGHUP
+	signal(SIGHUP, hangupHandler);
+#endif
+
+	reusePort = workers > 1;
+	if ( initSnmpAgent(port, argv[optind], "public", "private") == FAIL ) {
 		printf("Fail to initialise agent.\n");
 		return FAIL;
 	}
 	else {
 		initMibTree();
-		timer_start(1000, timerHandler);  /* timer function to update MIB values */
+		if (mibFile == NULL) {
+			printf("Fail to initialise MIB.\n");
+			return FAIL;
+		}
+		if (initTrapQueue() == FAIL) {
+			printf("Fail to initialise trap queue.\n");
+			return FAIL;
+		}
 		trapBuild(&request, enterpriseOID, NULL, COLD_START, 0, NULL);
 		if (debug) printf("Coldstart. ");
-		trapSend2(&request, cfg_file);
-		setCheckCommunity(checkCommStr);
-		printf("Entering loop...\n");
-		for ( ; ; )
-			if ( processSNMP() == COMM_STR_MISMATCH ) {
-				trapBuild(&request, enterpriseOID, NULL, AUTHENTICATE_FAIL, 0, NULL);
-				if (debug) printf("Authentication failure. ");
-				trapSend2(&request, cfg_file);
+		trapSend2(&request);
+		drainTraps(NULL);
+		setCheckCommunityCtx(&snmpAgent, checkCommStr);
+#ifndef _WIN32
+		if (workers > 1) {
+			if (startWorkers(workers-1, port) == FAIL) {
+				printf("Fail to start workers.\n");
+				return FAIL;
 			}
+			printf("Entering loop...\n");
+			serve(&snmpAgent);
+		}
+#endif
+#ifdef __linux__
+		/* Requests and MIB updates are taken in turn on this thread */
+		if ((evloop = evloopnew()) == NULL ||
+			evloopaddagent(evloop, &snmpAgent, checkResult) == FAIL ||
+			evloopaddtimer(evloop, 1000, refreshMib, NULL) == FAIL ||
+			evloopaddtimer(evloop, 100, drainTraps, NULL) == FAIL ||
+			evloopaddtimer(evloop, 100, commitSets, NULL) == FAIL ||
+			(aclfd = aclwatch(acl)) == FAIL ||
+			evloopaddfd(evloop, aclfd, configChanged, NULL) == FAIL ||
+			(mibfd = mibfilewatch(mibFile)) == FAIL ||
+			evloopaddfd(evloop, mibfd, mibfilenotify, mibFile) == FAIL) {
+			printf("Fail to start event loop.\n");
+			return FAIL;
+		}
+		printf("Entering loop...\n");
+		evlooprun(evloop);
+		evloopfree(evloop);
+#else
+		timer_start(1000, timerHandler);  /* timer function to update MIB values */
+		printf("Entering loop...\n");
+		serve(&snmpAgent);
+#endif
 		exitSnmpAgent();
 		return SUCCESS;
 	}
 }
 
-/* Community string checker function */
-Boolean checkCommStr(char *cstr, int reqType)
+/* Serves requests for an agent context */
+void *serve( void *arg )
+{
+	SnmpAgentCtx *ctx = (SnmpAgentCtx *)arg;
+	int i, n, result[SNMP_BATCH_SIZE];
+
+	for ( ; ; ) {
+		for (i = 0, n = processSNMPBatchCtx(ctx, result); i < n; i++)
+			checkResult(ctx, result[i]);
+		if (refreshDue) {
+			refreshDue = 0;
+			refreshValues();
+		}
+		if (ctx->lockMib == NULL)  /* The only thread that sets */
+			commitSets(NULL);
+		else if (journal)
+			mibjournalsync(journal);
+		drainTraps(NULL);
+	}
+	return NULL;
+}
+
+/* Sends a trap on authentication failure */
+void checkResult( SnmpAgentCtx *ctx, int result )
 {
-	char roCommunity[COMM_STR_SIZE], rwCommunity[COMM_STR_SIZE];
-	LIST *keylist; KEY *key;
+	struct messageStruct trap;
+	unsigned char trapBuffer[REQUEST_BUFFER_SIZE];
+
+	(void)ctx;
+	if ( result == COMM_STR_MISMATCH ) {
+		trap.buffer = trapBuffer; trap.size = REQUEST_BUFFER_SIZE;
+		trapBuild(&trap, enterpriseOID, NULL, AUTHENTICATE_FAIL, 0, NULL);
+		if (debug) printf("Authentication failure. ");
+		trapSend2(&trap);
+	}
+}
+
+#ifndef _WIN32
+/* With several workers, each serves requests on a socket of its own bound to
+   the same port, sharing the MIB tree under a read-write lock. The MIB values
+   are refreshed by a thread of their own in place of the timer signal, which
+   parses the data file unlocked and holds the lock only to apply them. */
+pthread_rwlock_t mibLock = PTHREAD_RWLOCK_INITIALIZER;
+
+void lockMib( SnmpAgentCtx *ctx, Boolean exclusive )
+{
+	(void)ctx;
+	if (exclusive) pthread_rwlock_wrlock(&mibLock);
+	else pthread_rwlock_rdlock(&mibLock);
+}
+
+void unlockMib( SnmpAgentCtx *ctx )
+{
+	(void)ctx;
+	pthread_rwlock_unlock(&mibLock);
+}
+
+void *refresh( void *arg )
+{
+	(void)arg;
+	for ( ; ; ) {
+		sleep(1);
+		if (mibfilescan(mibFile) > 0) {
+			pthread_rwlock_wrlock(&mibLock);
+			mibfileapply(mibFile);
+			pthread_rwlock_unlock(&mibLock);
+		}
+		if (journal) {  /* Sets wait, Gets go on */
+			pthread_rwlock_rdlock(&mibLock);
+			mibjournalcompact(journal);
+			pthread_rwlock_unlock(&mibLock);
+		}
+		reloadConfig();
+		trapsinkrefresh(trapSink);
+		drainTraps(NULL);  /* Those held back by their rate limit */
+	}
+	return NULL;
+}
+
+int startWorkers( int n, int port )
+{
+	SnmpAgentCtx *ctx;
+	pthread_t tid;
+
+	setMibLockCtx(&snmpAgent, lockMib, unlockMib);
+	for ( ; n > 0; n--) {
+		if ((ctx = newSnmpAgentCtx(mibTree, roCommunity, rwCommunity)) == NULL ||
+			bindSnmpAgentCtx(ctx, port) == FAIL)
+			return FAIL;
+		setCheckCommunityCtx(ctx, checkCommStr);
+		setMibLockCtx(ctx, lockMib, unlockMib);
+		if (pthread_create(&tid, NULL, serve, ctx) != 0) return FAIL;
+		pthread_detach(tid);
+	}
+	if (pthread_create(&tid, NULL, refresh, NULL) != 0) return FAIL;
+	pthread_detach(tid);
+	return SUCCESS;
+}
+#endif
 
+/* Community string checker function */
+Boolean checkCommStr(SnmpAgentCtx *ctx, char *cstr, int reqType)
+{
 	if (noAuth) return TRUE;
-	keylist = keylistnew();
-	keylistread(keylist, cfg_file);
-	keylistgohead(keylist);
-	if ( (key=keylistgokey(keylist, remoteIpAddr)) ||
-		(key=keylistgokey(keylist, "0.0.0.0")) )
-		sscanf(key->val, "%[^,],%[^,],%*s", roCommunity, rwCommunity);
-	keylistfree(keylist);
-	if ( key && ( strcmp(cstr, rwCommunity)==0 ||
-		   (reqType!=SET_REQUEST && strcmp(cstr, roCommunity)==0) ) )
-		return TRUE;
-	else
-		return FALSE;
-}
-
-/* Send trap to all managers listed in the agent config file */
-void trapSend2(struct messageStruct *trap, char *fn )
-{
-	char trapCommunity[COMM_STR_SIZE];
-	LIST *keylist; KEY *key;
-
-	keylist = keylistnew();
-	keylistread(keylist, fn);
-	keylistgohead(keylist);
-	while ((key=keylistgetthis(keylist))!=NULL) {
-		sscanf(key->val, "%*[^,],%*[^,],%s", trapCommunity);
-		if (strcmp(key->key, "0.0.0.0")!=0)
-			trapSend(trap, key->key, TRAP_DST_PORT, trapCommunity);
-		keylistgonext(keylist);
+	return aclcheck(acl, ctx->remoteIpAddr, cstr, reqType);
+}
+
+/* Adds a manager listed in the agent config file to the trap sink */
+int addTrapDest(ACLENTRY *e, void *arg)
+{
+	struct sockaddr_in6 a;
+	char dst[IP_STR_SIZE];
+
+	(void)arg;
+	if (e->bits == 128) {  /* Not a subnet, nor all others */
+		memset(&a, 0, sizeof(a));
+		a.sin6_family = AF_INET6;
+		memcpy(&a.sin6_addr, e->addr, 16);
+		trapsinkadd(trapSink, sockaddrntop((struct sockaddr *)&a, dst), TRAP_DST_PORT, e->trapCommunity);
 	}
-	keylistfree(keylist);
+	else if (e->bits == ACL_HOSTNAME)  /* Resolved again by the trap sink */
+		trapsinkadd(trapSink, e->key, TRAP_DST_PORT, e->trapCommunity);
+	return 0;
+}
+
+void loadTrapSink( void )
+{
+	trapsinkclear(trapSink);
+	aclwalk(acl, addTrapDest, NULL);
+}
+
+/* Traps of each kind are sent at most once a second, in bursts of up to
+   TRAP_BURST, and authentication failures at most once every
+   AUTH_FAIL_INTERVAL milliseconds. Repeats are counted in a varbind of
+   TRAP_COUNT_ARC under the enterprise OID. */
+#define TRAP_QUEUE_SIZE 16
+#define TRAP_BURST 5
+#define AUTH_FAIL_INTERVAL 10000
+#define TRAP_COUNT_ARC ".0.1"
+
+int initTrapQueue( void )
+{
+	char countOid[MIB_DATA_SIZE];
+
+	snprintf(countOid, sizeof(countOid), "%s%s", enterpriseOID, TRAP_COUNT_ARC);
+	if ((trapQueue = trapqueuenew(TRAP_QUEUE_SIZE, 1000, TRAP_BURST, countOid)) == NULL)
+		return FAIL;
+	return trapqueuelimit(trapQueue, enterpriseOID, AUTHENTICATE_FAIL, 0, AUTH_FAIL_INTERVAL, 1);
+}
+
+/* Queues trap for all managers listed in the agent config file */
+void trapSend2(struct messageStruct *trap)
+{
+	if (trapqueuepush(trapQueue, trap) == FAIL && debug)
+		printf("Trap dropped, %u so far.\n", (unsigned int) trapQueue->dropped);
+}
+
+void sendTrap(struct messageStruct *trap, void *arg)
+{
+	(void)arg;
+	trapsinksend(trapSink, trap);
+}
+
+/* Sends the queued traps that their rate limits allow */
+void drainTraps( void *arg )
+{
+	struct messageStruct trap;
+	unsigned char trapBuffer[REQUEST_BUFFER_SIZE];
+
+	(void)arg;
+	trap.buffer = trapBuffer; trap.size = REQUEST_BUFFER_SIZE;
+	trapqueuedrain(trapQueue, &trap, 0, sendTrap, NULL);
+}
+
+#ifdef SIGHUP
+/* Has the config file read again at the next refresh of the MIB */
+void hangupHandler( int sig )
+{
+	(void)sig;
+	reloadAcl = 1;
 }
+#endif
 
 /* MIB data callback functions */
 int get_uptime(MIB *thismib)
@@ -169,26 +418,98 @@ int get_uptime(MIB *thismib)
 	return SUCCESS;
 }
 
+/* Journals the value set, committed with the other Sets of the batch */
 int set(MIB *thismib, void *ptr, int len)
 {
-	mibsetvalue(thismib, ptr, len);
-	miblistwrite(mibTree, dat_file);
+	if (mibsetvalue(thismib, ptr, len) != SUCCESS)
+		return FAIL;
+	mibjournalappend(journal, thismib);
 	return SUCCESS;
 }
 
-/* Timer function to update MIB values from file periodically */
+/* Commits the values set, and compacts the journal when it is due */
+void commitSets( void *arg )
+{
+	(void)arg;
+	if (journal) {
+		mibjournalsync(journal);
+		mibjournalcompact(journal);
+	}
+}
+
+/* Timer function, from a signal handler or a thread of the timer: only asks
+   serve() to refresh, as the MIB tree may not be changed from there */
 void timerHandler( void )
 {
-	miblistread(mibTree, dat_file);
+	refreshDue = 1;
 }
 
-/* MIB initialization */
+/* Updates MIB values from file periodically, if it changed, and resolves
+   the trap destinations again when due */
+void refreshValues( void )
+{
+	mibfileread(mibFile);
+	reloadConfig();
+	trapsinkrefresh(trapSink);
+}
+
+/* Reads the config file again after SIGHUP */
+void reloadConfig( void )
+{
+	if (reloadAcl) {
+		reloadAcl = 0;
+		if (aclread(acl) != FAIL) loadTrapSink();
+	}
+}
+
+#ifdef __linux__
+void refreshMib( void *arg )
+{
+	(void)arg;
+	refreshValues();
+}
+
+void configChanged( int fd, void *arg )
+{
+	(void)arg;
+	aclnotify(fd, acl);
+	loadTrapSink();
+}
+#endif
+
+/* Puts the MIB image into the tree if it is not older than the data file,
+   which the refresher then reads in the background. Otherwise the data file
+   is read, and the image written again for the next start. */
+int loadMibTree( void )
+{
+	struct stat img, dat;
+
+	if (img_file && stat(img_file, &img) == 0 &&
+		(stat(dat_file, &dat) != 0 || img.st_mtime >= dat.st_mtime) &&
+		(mibImage = mibimageopen(mibTree, img_file)))
+		return SUCCESS;
+	if (mibfileread(mibFile) == FAIL)
+		return FAIL;
+	if (img_file && mibimagewrite(mibTree, img_file) == FAIL)
+		printf("Fail to write %s.\n", img_file);
+	return SUCCESS;
+}
+
+/* MIB initialization, with the values set before replayed from the journal */
 void initMibTree( void )
 {
 	MIB *thismib;
 	OID sysUptime = { 4, { 'B', 1, 3, 0 } };
-	
-	if (miblistread(mibTree, dat_file)==SUCCESS) {
+	static char jnl[FILENAME_MAX];
+
+	if (jnl_file == NULL) {
+		snprintf(jnl, sizeof(jnl), "%s.jnl", dat_file);
+		jnl_file = jnl;
+	}
+	/* Nodes staged by the refresher are freed, and their space used again */
+	miblistsetpool(mibTree, mempoolslab(0));
+	if ((mibFile = mibfilenew(mibTree, dat_file)) && loadMibTree() != FAIL &&
+		(journal = mibjournalnew(mibTree, dat_file, jnl_file, JOURNAL_LIMIT))) {
 		miblistprint(mibTree, stdout);
 		thismib = miblistgohead(mibTree);
 		while (thismib) {
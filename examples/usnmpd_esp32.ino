@@ -1,4 +1,5 @@
 #include <SnmpAgent.h>
+#include <trapqueue.h>
 
 // Agent's IP configuration. Retain these global variable names.
 IPAddress hostIpAddr( 192, 168, 1, 177 ),
@@ -13,9 +14,12 @@ char staPSK[] = "Wifi_Password";
 #define RO_COMMUNITY    "public"				  
 #define RW_COMMUNITY    "private"
 #define TRAP_DST_ADDR   "192.168.1.170"
+#define TRAP_COUNT_OID  ENTERPRISE_OID ".0.1"  // counts traps coalesced
 
 void initMibTree();
 char trapDstAddr[] = TRAP_DST_ADDR;
+TRAPQUEUE *trapQueue;
+void sendTrap(struct messageStruct *, void *);
 
 #if defined( ESP32 )
 char sysDescr[] = "ESP32";
@@ -30,7 +34,8 @@ char sysLocation[] = "placeName";
 int get_uptime(MIB *);
 int get_dio(MIB *);
 int set_dio(MIB *, void *, int);
-int get_ain(MIB *thismib);
+int get_ain(MIBTABLE *, unsigned int, OID *, MIB *);
+int next_ain(MIBTABLE *, unsigned int, OID *);
 
 uint32_t i, j;
 char dInIndex[] = "P.38644.30.1.1.2.10";
@@ -46,6 +51,7 @@ unsigned char c, lastDIN;
 #define GPIO33 33
 #define GPIO34 34
 #define GPIO35 35
+unsigned char ainPins[] = { GPIO33, GPIO34, GPIO35 };
 
 void setup()
 {
@@ -57,6 +63,9 @@ void setup()
 	initMibTree();
 	trapBuild(&request, enterpriseOID, hostIpAddr, COLD_START, 0, NULL); // cold start trap
 	trapSend(&request, trapDstAddr, TRAP_DST_PORT, roCommunity);
+	// traps of each kind at most once a second, authentication failures once a minute
+	trapQueue = trapqueuenew(4, 1000, 2, TRAP_COUNT_OID);
+	trapqueuelimit(trapQueue, enterpriseOID, AUTHENTICATE_FAIL, 0, 60000, 1);
 
 	digitalWrite(GPIO21, LOW); digitalWrite(GPIO22, LOW); digitalWrite(GPIO23, LOW);
 	c=digitalRead(GPIO16); lastDIN = c; // read and store digital input in a byte
@@ -89,7 +98,7 @@ void loop()
 					vblistAdd(&response, dInIndex, INTEGER, &i, 0);
 					trapBuild(&request, enterpriseOID, hostIpAddr, ENTERPRISE_SPECIFIC, 2, &response);
 				}
-				trapSend(&request, trapDstAddr, TRAP_DST_PORT, rwCommunity);
+				trapqueuepush(trapQueue, &request);
 			}
 			x>>=1; lastDIN>>=1;
 		}
@@ -97,14 +106,24 @@ void loop()
 	}
 	if ( processSNMP() == COMM_STR_MISMATCH ) {
 		trapBuild(&request, enterpriseOID, hostIpAddr, AUTHENTICATE_FAIL, 0, NULL); // authentication fail trap
-		trapSend(&request, trapDstAddr, TRAP_DST_PORT, rwCommunity);
+		trapqueuepush(trapQueue, &request);
 	}
+	trapqueuedrain(trapQueue, &request, 0, sendTrap, NULL); // send queued traps that their rate limits allow
 	delay(100);
 }
 
+void sendTrap(struct messageStruct *trap, void *arg)
+{
+	trapSend(trap, trapDstAddr, TRAP_DST_PORT, rwCommunity);
+}
+
 void initMibTree()
 {
 	MIB *thismib;
+	MIBTABLE *tbl;
+
+	// Nodes added once, from chunks rather than a malloc() each
+	miblistsetpool(mibTree, mempoolarena(0));
 
 	/* System MIB */
 
@@ -199,31 +218,10 @@ void initMibTree()
 	i = 0; mibsetvalue(thismib, &i, 0);
 	mibsetcallback(thismib, get_dio, set_dio);
 
-	/* GPIO33-35 are designated for analog inputs. */
-
-	// Analog input #33 index
-	thismib = miblistadd(mibTree, "P.38644.30.3.1.1.33", INTEGER, RD_ONLY, NULL, 0);
-	i = GPIO33; mibsetvalue(thismib, &i, 0);
-	// The value of Analog #25
-	thismib = miblistadd(mibTree, "P.38644.30.3.1.2.33", GAUGE, RD_ONLY, NULL, 0);
-	i = 0; mibsetvalue(thismib, &i, 0);
-	mibsetcallback(thismib, get_ain, NULL);
-
-	// Analog input #34 index
-	thismib = miblistadd(mibTree, "P.38644.30.3.1.1.34", INTEGER, RD_ONLY, NULL, 0);
-	i = GPIO34; mibsetvalue(thismib, &i, 0);
-	// The value of Analog #26
-	thismib = miblistadd(mibTree, "P.38644.30.3.1.2.34", GAUGE, RD_ONLY, NULL, 0);
-	i = 0; mibsetvalue(thismib, &i, 0);
-	mibsetcallback(thismib, get_ain, NULL);
-
-	// Analog input #35 index
-	thismib = miblistadd(mibTree, "P.38644.30.3.1.1.35", INTEGER, RD_ONLY, NULL, 0);
-	i = GPIO35; mibsetvalue(thismib, &i, 0);
-	// The value of Analog #27
-	thismib = miblistadd(mibTree, "P.38644.30.3.1.2.35", GAUGE, RD_ONLY, NULL, 0);
-	i = 0; mibsetvalue(thismib, &i, 0);
-	mibsetcallback(thismib, get_ain, NULL);
+	/* GPIO33-35 are designated for analog inputs, served as a conceptual table
+	   of index and value columns without a MIB node for each cell. */
+	tbl = miblistaddtable(mibTree, "P.38644.30.3.1", 1, 2, NULL);
+	mibtablesetcallback(tbl, get_ain, next_ain, NULL);
 }
 
 int get_uptime(MIB *thismib)
@@ -252,9 +250,31 @@ int set_dio(MIB *thismib, void *ptr, int len)
 	return SUCCESS;
 }
 
-int get_ain(MIB *thismib)
+int get_ain(MIBTABLE *tbl, unsigned int col, OID *index, MIB *vb)
 {
-	c = thismib->oid.array[thismib->oid.len-1];
-	thismib->u.intval = analogRead(c);
-	return SUCCESS;
+	for ( j=0; j<sizeof(ainPins); j++ )
+		if ( index->len==1 && index->array[0]==ainPins[j] ) {
+			if ( col==1 ) {  // index column
+				vb->dataType = INTEGER;
+				vb->u.intval = ainPins[j];
+			}
+			else {  // value column
+				vb->dataType = GAUGE;
+				vb->u.intval = analogRead(ainPins[j]);
+			}
+			vb->dataLen = INT_SIZE;
+			return SUCCESS;
+		}
+	return OID_NOT_FOUND;
+}
+
+int next_ain(MIBTABLE *tbl, unsigned int col, OID *index)
+{
+	for ( j=0; j<sizeof(ainPins); j++ )
+		if ( index->len==0 || ainPins[j]>index->array[0] ) {
+			index->len = 1;
+			index->array[0] = ainPins[j];
+			return SUCCESS;
+		}
+	return FAIL;
 }
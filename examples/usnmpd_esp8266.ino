@@ -1,4 +1,5 @@
 #include <SnmpAgent.h>
+#include <trapqueue.h>
 
 // Agent's IP configuration. Retain these global variable names.
 IPAddress hostIpAddr( 192, 168, 1, 177 ),
@@ -13,9 +14,12 @@ char staPSK[] = "Wifi_Password";
 #define RO_COMMUNITY    "public"				  
 #define RW_COMMUNITY    "private"
 #define TRAP_DST_ADDR   "192.168.1.170"
+#define TRAP_COUNT_OID  ENTERPRISE_OID ".0.1"  // counts traps coalesced
 
 void initMibTree();
 char trapDstAddr[] = TRAP_DST_ADDR;
+TRAPQUEUE *trapQueue;
+void sendTrap(struct messageStruct *, void *);
 
 #if defined( ESP8266 )
 char sysDescr[] = "ESP8266";
@@ -46,6 +50,9 @@ void setup()
 	initMibTree();
 	trapBuild(&request, enterpriseOID, hostIpAddr, COLD_START, 0, NULL); // cold start trap
 	trapSend(&request, trapDstAddr, TRAP_DST_PORT, roCommunity);
+	// traps of each kind at most once a second, authentication failures once a minute
+	trapQueue = trapqueuenew(4, 1000, 2, TRAP_COUNT_OID);
+	trapqueuelimit(trapQueue, enterpriseOID, AUTHENTICATE_FAIL, 0, 60000, 1);
 
 	digitalWrite(D6, LOW); digitalWrite(D7, LOW); digitalWrite(D8, LOW);
 	c=digitalRead(D2); lastDIN = c; // read and store digital input in a byte
@@ -78,7 +85,7 @@ void loop()
 					vblistAdd(&response, dInIndex, INTEGER, &i, 0);
 					trapBuild(&request, enterpriseOID, hostIpAddr, ENTERPRISE_SPECIFIC, 2, &response);
 				}
-				trapSend(&request, trapDstAddr, TRAP_DST_PORT, rwCommunity);
+				trapqueuepush(trapQueue, &request);
 			}
 			x>>=1; lastDIN>>=1;
 		}
@@ -86,15 +93,24 @@ void loop()
 	}
 	if ( processSNMP() == COMM_STR_MISMATCH ) {
 		trapBuild(&request, enterpriseOID, hostIpAddr, AUTHENTICATE_FAIL, 0, NULL); // authentication fail trap
-		trapSend(&request, trapDstAddr, TRAP_DST_PORT, rwCommunity);
+		trapqueuepush(trapQueue, &request);
 	}
+	trapqueuedrain(trapQueue, &request, 0, sendTrap, NULL); // send queued traps that their rate limits allow
 	delay(100);
 }
 
+void sendTrap(struct messageStruct *trap, void *arg)
+{
+	trapSend(trap, trapDstAddr, TRAP_DST_PORT, rwCommunity);
+}
+
 void initMibTree()
 {
 	MIB *thismib;
 
+	// Nodes added once, from chunks rather than a malloc() each
+	miblistsetpool(mibTree, mempoolarena(0));
+
 	/* System MIB */
 
 	// sysDescr Entry
@@ -39,8 +39,13 @@
 #include "wingetopt.h"
 #else
 #include <unistd.h>
+#include <arpa/inet.h>
+#include "snmplog.h"
 #endif
 #include "SnmpMgr.h"
+#include "resolver.h"
+
+#define LOG_SIZE (64 << 20)
 
 void printHelp( char *prog )
 {
@@ -51,6 +56,9 @@ void printHelp( char *prog )
 	printf("         -p Port       default target port is 161\n");
 	printf("         -t Seconds    default time-out is 2 seconds\n");
 	printf("         -d            enables debug mode\n");
+#ifndef _WIN32
+	printf("         -l File       logs the response to a binary log file\n");
+#endif
 	printf("Prefix OID with B:Mgmt-Mib2(1.3.6.1.2.1), E:Experimental(1.3.6.1.3), P:Private(1.3.6.1.4.1)\n");
 	printf("E.g. %s 192.168.1.252 -c public -d B.1.1.0 B.1.2.0 B.1.3.0\n", prog);
 }
@@ -58,10 +66,16 @@ void printHelp( char *prog )
 int main(int argc, char **argv)
 {
 	int c,	port = SNMP_PORT, timeout = 2; 
-	char *target, *community="public", *oid;
+	MSGVIEW msg;
+	VBVIEW vb[VBVIEW_MAX(RESPONSE_BUFFER_SIZE)];
+	char *target, *community="public", *oid, *logfile = NULL;
+#ifndef _WIN32
+	struct sockaddr_storage from;
+	SNMPLOG *log;
+#endif
 
 	optind = 1;
-	while ((c = getopt (argc, argv, "i:c:p:t:dh")) != -1)
+	while ((c = getopt (argc, argv, "i:c:p:t:l:dh")) != -1)
 		switch (c) {
 			case 'i':
 				reqId = atoi(optarg);
@@ -78,6 +92,9 @@ int main(int argc, char **argv)
 			case 'd':
 				debug = TRUE;
 				break;
+			case 'l':
+				logfile = optarg;
+				break;
 			case 'h':
 				printHelp( argv[0] );
 			default:
@@ -102,11 +119,23 @@ int main(int argc, char **argv)
 	}
 	reqBuild( &request, GET_REQUEST, reqId, &vblist );
 	if (reqSend( &request, &response, target, port, community, timeout )==SUCCESS &&
-		parseResponse(&response, remoteCommunity, &reqId, &errorStatus, &errorIndex, &vblist)==SUCCESS) {
-		if (errorStatus != 0)
-			printf("ErrorStatus:%u, ErrorIndex:%u\n", errorStatus, errorIndex);
+		msgView(response.buffer, response.len, &msg, vb, VBVIEW_MAX(RESPONSE_BUFFER_SIZE))==SUCCESS &&
+		msg.pduType == GET_RESPONSE) {
+#ifndef _WIN32
+		if (logfile) {
+			resolve(NULL, remoteIpAddr, &from);  /* Numeric, IPv4 or IPv6 */
+			sockaddrsetport((struct sockaddr *)&from, port);
+			if ((log = snmplognew(logfile, LOG_SIZE)) == NULL ||
+				snmplogappend(log, (struct sockaddr *)&from, &msg) != SUCCESS)
+				printf("Fail to log to %s.\n", logfile);
+			if (log) snmplogfree(log);
+		}
+#endif
+		if (msg.errorStatus != 0)
+			printf("ErrorStatus:%u, ErrorIndex:%u\n", (unsigned int) msg.errorStatus,
+				(unsigned int) msg.errorIndex);
 		else
-			vblistPrint(&vblist, stdout);
+			vbviewPrint(vb, msg.nvb, stdout);
 	}
 	else
 		printf("Fail!\n");
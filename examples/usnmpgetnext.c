@@ -59,6 +59,8 @@ void printHelp( char *prog )
 int main(int argc, char **argv)
 {
 	int c,	port = SNMP_PORT, timeout = 2; 
+	MSGVIEW msg;
+	VBVIEW vb[VBVIEW_MAX(RESPONSE_BUFFER_SIZE)];
 	char *target, *community="public", *oid;
 
 	optind = 1;
@@ -102,11 +104,13 @@ int main(int argc, char **argv)
 	}
 	reqBuild( &request, GET_NEXT_REQUEST, reqId, &vblist );
 	if (reqSend( &request, &response, target, port, community, timeout )==SUCCESS &&
-		parseResponse(&response, remoteCommunity, &reqId, &errorStatus, &errorIndex, &vblist)==SUCCESS) {
-		if (errorStatus != 0)
-			printf("ErrorStatus:%u, ErrorIndex:%u\n", errorStatus, errorIndex);
+		msgView(response.buffer, response.len, &msg, vb, VBVIEW_MAX(RESPONSE_BUFFER_SIZE))==SUCCESS &&
+		msg.pduType == GET_RESPONSE) {
+		if (msg.errorStatus != 0)
+			printf("ErrorStatus:%u, ErrorIndex:%u\n", (unsigned int) msg.errorStatus,
+				(unsigned int) msg.errorIndex);
 		else
-			vblistPrint(&vblist, stdout);
+			vbviewPrint(vb, msg.nvb, stdout);
 	}
 	else
 		printf("Fail!\n");
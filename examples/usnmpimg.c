@@ -0,0 +1,110 @@
+/*
+ * A program to convert a MIB data file, as of usnmpd.dat, to a binary MIB
+ * image that usnmpd maps at start-up, and back.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include "wingetopt.h"
+#else
+#include <unistd.h>
+#endif
+#include "mibimage.h"
+#include "mibutil.h"
+
+void printHelp( char *prog )
+{
+	printf("Usage:\n");
+	printf("%s [OPTIONS] DATA-FILE IMAGE-FILE\n", prog);
+	printf("Options: -r  write the data file from the image instead\n");
+	printf("E.g. %s usnmpd.dat usnmpd.img\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	int c, n;
+	Boolean reverse = FALSE;
+	MIBLIST *miblist;
+	MIBIMAGE *img;
+	MEMPOOL *arena;
+
+	optind = 1;
+	while ((c = getopt (argc, argv, "rh")) != -1)
+		switch (c) {
+			case 'r':
+				reverse = TRUE;
+				break;
+			case 'h':
+				printHelp( argv[0] );
+				/* Fall through */
+			default:
+				return -1;
+		}
+	if ( optind+1 >= argc) {
+		printHelp( argv[0] );
+		return -1;
+	}
+
+	miblist = miblistnew(0);
+	arena = mempoolarena(0);  /* The tree is loaded and freed as a whole */
+	miblistsetpool(miblist, arena);
+	if (reverse) {
+		if ((img = mibimageopen(miblist, argv[optind+1])) == NULL) {
+			printf("Fail to read image %s.\n", argv[optind+1]);
+			return -1;
+		}
+		n = miblistsize(miblist);
+		if (miblistwrite(miblist, argv[optind]) == FAIL) {
+			printf("Fail to write %s.\n", argv[optind]);
+			return -1;
+		}
+		miblistfree(miblist);
+		mibimageclose(img);
+	}
+	else {
+		if (miblistread(miblist, argv[optind]) == FAIL) {
+			printf("Fail to read %s.\n", argv[optind]);
+			return -1;
+		}
+		if ((n = mibimagewrite(miblist, argv[optind+1])) == FAIL) {
+			printf("Fail to write image %s.\n", argv[optind+1]);
+			return -1;
+		}
+		miblistfree(miblist);
+	}
+	if (arena) mempoolfree(arena);
+	printf("%d MIB nodes.\n", n);
+	return 0;
+}
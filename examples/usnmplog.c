@@ -0,0 +1,133 @@
+/*
+ * A program to list the traps and responses in a binary log file, filtered
+ * by OID prefix and time.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "snmplog.h"
+#include "resolver.h"
+#include "mibutil.h"
+
+void printHelp( char *prog )
+{
+	printf("Usage:\n");
+	printf("%s [OPTIONS] FILE\n", prog);
+	printf("Options: -o OID      only records of an enterprise OID or varbind under OID\n");
+	printf("         -s Seconds  only records logged in the last Seconds seconds\n");
+	printf("         -c          count the records only\n");
+	printf("Prefix OID with B:Mgmt-Mib2(1.3.6.1.2.1), E:Experimental(1.3.6.1.3), P:Private(1.3.6.1.4.1)\n");
+	printf("E.g. %s -o P.38644.30 -s 3600 traps.log\n", prog);
+}
+
+void printRecord( LOGREC *rec )
+{
+	VBVIEW vb[VBVIEW_MAX(RESPONSE_BUFFER_SIZE)];
+	struct sockaddr_in6 from;
+	OID entoid;
+	char oid[64], addr[IP_STR_SIZE];
+
+	memset(&from, 0, sizeof(from));
+	from.sin6_family = AF_INET6;
+	memcpy(&from.sin6_addr, rec->addr, 16);
+	printf("Time: %u.%06u, from %s, port %u\n", (unsigned int) rec->sec,
+		(unsigned int) rec->usec, sockaddrntop((struct sockaddr *)&from, addr), rec->port);
+	if (rec->type == TRAP_PACKET) {
+		ber2oid(rec->enterprise, rec->enterpriseLen, &entoid);
+		oid2str(&entoid, oid); printf("Enterprise OID: %s\n", oid);
+		printf("Agent address: %u.%u.%u.%u\n", rec->agentAddr[0], rec->agentAddr[1],
+			rec->agentAddr[2], rec->agentAddr[3]);
+		printf("Generic trap code: %u\n", (unsigned int) rec->generic);
+		printf("Specific trap code: %u\n", (unsigned int) rec->specific);
+		printf("Timestamp: %u\n", (unsigned int) rec->timestamp);
+	}
+	else
+		printf("RequestID:%u, ErrorStatus:%u, ErrorIndex:%u\n", (unsigned int) rec->reqId,
+			(unsigned int) rec->errorStatus, (unsigned int) rec->errorIndex);
+	vbviewPrint(vb, vblistView(rec->vblist, rec->vblistLen, vb, VBVIEW_MAX(RESPONSE_BUFFER_SIZE)), stdout);
+}
+
+int main(int argc, char **argv)
+{
+	int c, prefixLen = 0;
+	unsigned char prefix[OID_SIZE*5];
+	uint32_t pos, since = 0, n = 0;
+	Boolean count = FALSE;
+	SNMPLOG *l;
+	LOGREC rec;
+
+	optind = 1;
+	while ((c = getopt (argc, argv, "o:s:ch")) != -1)
+		switch (c) {
+			case 'o':
+				if ((prefixLen = str2ber(optarg, prefix)) == 0) {
+					printf("Bad OID %s.\n", optarg);
+					return -1;
+				}
+				break;
+			case 's':
+				since = (uint32_t) time(NULL) - atoi(optarg);
+				break;
+			case 'c':
+				count = TRUE;
+				break;
+			case 'h':
+				printHelp( argv[0] );
+				/* Fall through */
+			default:
+				return -1;
+		}
+	if ( optind >= argc) {
+		printHelp( argv[0] );
+		return -1;
+	}
+
+	endianness = endian();
+	if ((l = snmplogopen(argv[optind])) == NULL) {
+		printf("Fail to open %s.\n", argv[optind]);
+		return -1;
+	}
+	/* Spans of records all older than since are skipped by their index */
+	for (pos = since ? snmplogseek(l, since) : 0; (pos = snmplognext(l, pos, &rec)); ) {
+		if (rec.sec < since || (prefixLen && !snmplogmatch(&rec, prefix, prefixLen)))
+			continue;
+		n++;
+		if (!count) printRecord(&rec);
+	}
+	if (count) printf("%u\n", (unsigned int) n);
+	snmplogfree(l);
+	return 0;
+}
@@ -0,0 +1,336 @@
+/*
+ * A program to poll many agents at once with SNMPv1 GET requests, and report
+ * the responses and the polls a second.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "wingetopt.h"
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#endif
+#include "SnmpMgr.h"
+#include "planner.h"
+#include "resolver.h"
+
+#define NAME_SIZE 64
+#define RESOLVERS 16  /* Names looked up at once */
+
+typedef struct {
+	char name[NAME_SIZE];
+	struct sockaddr_storage addr;
+} TARGET;
+
+Boolean quiet = FALSE;
+uint32_t failed = 0;
+char **oids;  /* The OIDs of a poll */
+int noids;
+
+void printHelp( char *prog )
+{
+	printf("Usage:\n");
+	printf("%s [OPTIONS] TARGETS OID...\n", prog);
+	printf("TARGETS is a file of targets, a host name or address, optionally with :Port, one a line\n");
+	printf("An IPv6 address with a port is written [Address]:Port\n");
+	printf("Options: -c Community  default is 'public'\n");
+	printf("         -p Port       default target port is 161\n");
+	printf("         -t mSec       default time-out is 1000 milliseconds a try\n");
+	printf("         -r Retries    default is 2\n");
+	printf("         -w Window     default is at most 1000 requests outstanding\n");
+	printf("         -s Size       default is to pack up to %d bytes of varbinds a request\n", PLANNER_SIZE);
+	printf("         -n Rounds     default is to poll each target once\n");
+	printf("         -q            reports the polls a second only\n");
+	printf("Prefix OID with B:Mgmt-Mib2(1.3.6.1.2.1), E:Experimental(1.3.6.1.3), P:Private(1.3.6.1.4.1)\n");
+	printf("E.g. %s -c public -n 10 -q targets.txt B.1.1.0 B.1.3.0\n", prog);
+}
+
+/* Milliseconds from an arbitrary start */
+double msnow(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+#endif
+}
+
+#ifndef _WIN32
+void *resolveTargets( void *arg )
+{
+	resolverrun((RESOLVER *)arg);
+	return NULL;
+}
+#endif
+
+/* Resolves host of the target, cut at its :Port, an IPv6 address being
+   bare or as [Address]:Port. Returns Success(0), Fail(-1) or RESOLVER_PENDING. */
+int resolveTarget( RESOLVER *r, TARGET *t, int port )
+{
+	char host[NAME_SIZE], *h = host, *p;
+	int ret;
+
+	strcpy(host, t->name);
+	if (host[0] == '[') {
+		h++;
+		if ((p = strchr(h, ']'))) *p++ = '\0';
+		p = (p && *p == ':') ? p+1 : NULL;
+	}
+	else if ((p = strchr(host, ':')) && strchr(p+1, ':') == NULL)
+		*p++ = '\0';
+	else
+		p = NULL;
+#ifdef _WIN32
+	ret = resolve(r, h, &t->addr);
+#else
+	ret = resolverask(r, h, &t->addr);
+#endif
+	sockaddrsetport((struct sockaddr *)&t->addr, p ? atoi(p) : port);
+	return ret;
+}
+
+/* Reads the targets in the file fn, and resolves their names before
+   polling, RESOLVERS at once. Returns their number, or Fail(-1). */
+int readTargets( char *fn, int port, TARGET **targets )
+{
+	char buf[NAME_SIZE+8];
+	FILE *f;
+	int i, n = 0, alloc = 0, pending, *status;
+	RESOLVER *r;
+	TARGET *t;
+#ifndef _WIN32
+	pthread_t tid[RESOLVERS];
+	struct timespec nap = { 0, 1000000 };
+#endif
+
+	if ((f = fopen(fn, "r")) == NULL) return FAIL;
+	*targets = NULL;
+	while (fgets(buf, sizeof(buf), f)) {
+		buf[strcspn(buf, " \t\r\n#")] = '\0';
+		if (buf[0] == '\0') continue;
+		if (n == alloc) {
+			alloc = alloc ? 2*alloc : 256;
+			*targets = (TARGET *)realloc(*targets, alloc * sizeof(TARGET));
+		}
+		t = *targets + n++;
+		strncpy(t->name, buf, NAME_SIZE-1); t->name[NAME_SIZE-1] = '\0';
+	}
+	fclose(f);
+	if (n == 0) return 0;
+	if ((r = resolvernew(n, RESOLVER_TTL, RESOLVER_NEGTTL)) == NULL ||
+		(status = (int *)malloc(n * sizeof(int))) == NULL)
+		return FAIL;
+#ifndef _WIN32
+	for (i = 0; i < RESOLVERS; i++)
+		pthread_create(&tid[i], NULL, resolveTargets, r);
+#endif
+	for (i = 0; i < n; i++)
+		status[i] = RESOLVER_PENDING;
+	do {
+		pending = 0;
+		for (i = 0; i < n; i++)
+			if (status[i] == RESOLVER_PENDING &&
+				(status[i] = resolveTarget(r, *targets + i, port)) == RESOLVER_PENDING)
+				pending++;
+#ifndef _WIN32
+		if (pending) nanosleep(&nap, NULL);
+#endif
+	} while (pending);
+#ifndef _WIN32
+	resolverstop(r);
+	for (i = 0; i < RESOLVERS; i++)
+		pthread_join(tid[i], NULL);
+#endif
+	resolverfree(r);
+	for (i = 0, t = *targets; i < n; i++)
+		if (status[i] == SUCCESS)
+			*t++ = (*targets)[i];
+		else
+			printf("%s: Unknown host.\n", (*targets)[i].name);
+	free(status);
+	return (int)(t - *targets);
+}
+
+/* Prints the results of a poll, the varbinds in the order of the OIDs */
+void printPlan( PLAN *plan, TARGET *t )
+{
+	VBVIEW vb;
+	int i, status, answered = 0;
+
+	for (i = 0; i < plan->n; i++)
+		if (plan->vb[i].status != FAIL) answered++;
+	for (i = 0; i < plan->n; i++)
+		if (plan->vb[i].status != SUCCESS) {
+			failed++;
+			break;
+		}
+	if (quiet) return;
+	if (answered == 0) {
+		printf("%s: No response.\n", t->name);
+		return;
+	}
+	printf("%s:\n", t->name);
+	for (i = 0; i < plan->n; i++)
+		if ((status = planresult(plan, i, &vb)) == SUCCESS)
+			vbviewPrint(&vb, 1, stdout);
+		else if (status == FAIL)
+			printf("%s: No response.\n", oids[i]);
+		else
+			printf("%s: ErrorStatus:%d\n", oids[i], status);
+}
+
+int main(int argc, char **argv)
+{
+	int c, port = SNMP_PORT, timeout = 1000, retries = 2, window = 1000, rounds = 1;
+	int size = PLANNER_SIZE, snmpfd, ntargets, total, k, i, head = 0, nactive = 0;
+	uint32_t requests = 0, tooBig = 0;
+	char *community = "public";
+	TARGET *targets;
+	POLLER *p;
+	PLANNER *pl;
+	PLAN **active, *plan;
+	double start, secs;
+
+	optind = 1;
+	while ((c = getopt (argc, argv, "c:p:t:r:w:s:n:qh")) != -1)
+		switch (c) {
+			case 'c':
+				community = optarg;
+				break;
+			case 'p':
+				port = atoi(optarg);
+				break;
+			case 't':
+				timeout = atoi(optarg);
+				break;
+			case 'r':
+				retries = atoi(optarg);
+				break;
+			case 'w':
+				window = atoi(optarg);
+				break;
+			case 's':
+				size = atoi(optarg);
+				break;
+			case 'n':
+				rounds = atoi(optarg);
+				break;
+			case 'q':
+				quiet = TRUE;
+				break;
+			case 'h':
+				printHelp( argv[0] );
+				/* Fall through */
+			default:
+				return -1;
+		}
+	if ( optind+1 >= argc || window <= 0 || size <= 0) {
+		printHelp( argv[0] );
+		return -1;
+	}
+
+	if ((snmpfd = initSnmpMgr( 0 )) < 0) {  /* use an ephemeral port */
+		printf("Fail to open a socket.\n");
+		return -1;
+	}
+	if ((ntargets = readTargets(argv[optind++], port, &targets)) <= 0) {
+		printf("No target.\n");
+		return -1;
+	}
+	oids = argv + optind;
+	noids = argc - optind;
+	if ((p = pollernew(snmpfd, window, timeout, retries)) == NULL ||
+		(pl = plannernew(p, ntargets, size)) == NULL ||
+		(active = (PLAN **)malloc(window * sizeof(PLAN *))) == NULL) {
+		printf("Fail to start polling.\n");
+		return -1;
+	}
+
+	/* Keeps up to window polls under way, each a batch of the OIDs packed in
+	   as few requests as the target answers. The polls are printed in the
+	   order they were started. */
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+	total = ntargets * rounds;
+	start = msnow();
+	for (k = 0; k < total || nactive > 0; ) {
+		for (; k < total && nactive < window; k++) {
+			if ((plan = plannew(pl, (struct sockaddr *)&targets[k % ntargets].addr, community, GET_REQUEST)) == NULL) {
+				printf("Fail to start polling.\n");
+				return -1;
+			}
+			for (i = 0; i < noids; i++)
+				if (planadd(plan, oids[i], NULL_ITEM, NULL, 0) < 0) {
+					printf("Bad OID %s.\n", oids[i]);
+					return -1;
+				}
+			planstart(plan);
+			active[(head + nactive++) % window] = plan;
+		}
+		for (i = 0; i < nactive; i++)
+			planpump(active[(head + i) % window]);
+		if (pollerwait(p, POLLER_TICK) < 0) break;
+		while (nactive > 0 && plandone(plan = active[head])) {
+			printPlan(plan, &targets[(k - nactive) % ntargets]);
+			requests += plan->requests;
+			tooBig += plan->tooBig;
+			planfree(plan);
+			head = (head + 1) % window;
+			nactive--;
+		}
+	}
+	secs = (msnow() - start) / 1e3;
+	printf("%d polls of %d targets in %.3f seconds, %.0f polls/s: %u answered, %u failed, %u timed out, %u retries\n",
+		total, ntargets, secs, total / secs, (unsigned int) p->answered, (unsigned int) failed,
+		(unsigned int) p->timedout, (unsigned int) p->retried);
+	printf("%u requests for %d OIDs a poll, %u answered tooBig\n", (unsigned int) requests, noids,
+		(unsigned int) tooBig);
+	free(active);
+	plannerfree(pl);
+	pollerfree(p);
+	free(targets);
+	exitSnmpMgr();
+	return 0;
+}
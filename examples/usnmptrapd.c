@@ -43,8 +43,15 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <pthread.h>
+#include "snmplog.h"
 #endif
 #include "SnmpMgr.h"
+#include "traprecv.h"
+#include "resolver.h"
+
+#define RING_SIZE 4096
+#define LOG_SIZE (1 << 30)
 
 void printHelp( char *prog )
 {
@@ -52,23 +59,61 @@ void printHelp( char *prog )
 	printf("%s [OPTIONS]\n", prog);
 	printf("Options: -p Port  default listening port is 162\n");
 	printf("         -d       enables debug mode\n");
+#ifndef _WIN32
+	printf("         -l File  logs traps to a binary log file instead, see usnmplog\n");
+#endif
+}
+
+/* Prints a trap taken from the ring */
+void printTrap( TRAPREC *t )
+{
+	struct messageStruct pkt;
+	OID entoid;
+	char remoteIpAddr[IP_STR_SIZE], oid[64];
+
+	if (debug) {
+		printf("Receive trap from %s, port %u\n", sockaddrntop((struct sockaddr *)&t->from, remoteIpAddr),
+			sockaddrport((struct sockaddr *)&t->from));
+		printf("Trap:");
+		pkt.buffer = t->buf; pkt.len = t->len;
+		showMessage(&pkt);
+	}
+	if (t->status == SUCCESS) {
+		printf("Community: %.*s\n", t->msg.communityLen, (char *) t->msg.community);
+		ber2oid(t->msg.enterprise, t->msg.enterpriseLen, &entoid);
+		oid2str(&entoid, oid); printf("Enterprise OID: %s\n", oid);
+		printf("Agent address: %u.%u.%u.%u\n", t->msg.agentAddr[0], t->msg.agentAddr[1],
+			t->msg.agentAddr[2], t->msg.agentAddr[3]);
+		printf("Generic trap code: %u\n", (unsigned int) t->msg.generic);
+		printf("Specific trap code: %u\n", (unsigned int) t->msg.specific);
+		printf("Timestamp: %u\n", (unsigned int) t->msg.timestamp);
+		printf("Trap varbind:\n");
+		vbviewPrint(t->vb, t->msg.nvb, stdout);
+	}
+	else
+		printf("Trap parse fail!\n");
+}
+
+#ifndef _WIN32
+void *receive( void *arg )
+{
+	traprecvrun((TRAPRECV *)arg);
+	return NULL;
 }
+#endif
 
 int main(int argc, char **argv)
 {
 	int c, port = TRAP_DST_PORT, snmpfd;
-	unsigned int gen, spec, remotePort, timestamp;
-	OID entoid;
-	char agentaddr[16], remoteIpAddr[16], oid[64];
-#ifdef _WIN32
-	int fromlen;
-#else
-	socklen_t fromlen;
+	TRAPRECV *r;
+	TRAPREC *t;
+#ifndef _WIN32
+	pthread_t tid;
+	SNMPLOG *log = NULL;
 #endif
-	struct sockaddr from;
 
 	optind = 1;
-	while ((c = getopt (argc, argv, "p:dh")) != -1)
+	while ((c = getopt (argc, argv, "p:l:dh")) != -1)
 		switch (c) {
 			case 'p':
 				port = atoi(optarg);
@@ -76,37 +121,46 @@ int main(int argc, char **argv)
 			case 'd':
 				debug = TRUE;
 				break;
+#ifndef _WIN32
+			case 'l':
+				if ((log = snmplognew(optarg, LOG_SIZE)) == NULL) {
+					printf("Fail to open log file %s.\n", optarg);
+					return -1;
+				}
+				break;
+#endif
 			case 'h':
 				printHelp( argv[0] );
 			default:
 				return -1;
 		}
 
-	snmpfd = initSnmpMgr( port );
-	fromlen = sizeof(from);
-	while ( (response.len = recvfrom(snmpfd, response.buffer, RESPONSE_BUFFER_SIZE,
-		0, &from, &fromlen)) ) {
-		if (debug) {
-			inet_ntop(AF_INET, &(((struct sockaddr_in *)&from)->sin_addr), remoteIpAddr, 16);
-			remotePort = ntohs(((struct sockaddr_in *)&from)->sin_port);
-			if (debug) printf("Receive trap from %s, port %u\n",
-				remoteIpAddr, remotePort);
-			printf("Trap:");
-			showMessage(&response);
-		}
-		if ( parseTrap(&response, remoteCommunity, &entoid, agentaddr, &gen, &spec,
-			&timestamp, &vblist) == SUCCESS) {
-			printf("Community: %s\n", remoteCommunity);
-			oid2str(&entoid, oid); printf("Enterprise OID: %s\n", oid);
-			printf("Agent address: %s\n", agentaddr);
-			printf("Generic trap code: %u\n", gen);
-			printf("Specific trap code: %u\n", spec);
-			printf("Timestamp: %u\n", timestamp);
-			printf("Trap varbind:\n");
-			vblistPrint(&vblist, stdout);
-		}
-		else
-			printf("Trap parse fail!\n");
+	if ((snmpfd = initSnmpMgr( port )) < 0 || (r = traprecvnew(snmpfd, RING_SIZE)) == NULL) {
+		printf("Fail to listen on port %d.\n", port);
+		return -1;
+	}
+#ifndef _WIN32
+	/* Traps are received on a thread of their own, and printed or logged on
+	   this one as they come off the ring, the output flushed whenever it is
+	   empty. */
+	setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+	if (pthread_create(&tid, NULL, receive, r) != 0) {
+		printf("Fail to start receiving.\n");
+		return -1;
 	}
+	for ( ; ; ) {
+		if ((t = traprecvwait(r, TRAPRECV_WAIT)) == NULL) continue;
+		if (log == NULL || debug)
+			printTrap(t);
+		if (log && t->status == SUCCESS && snmplogappend(log, (struct sockaddr *)&t->from, &t->msg) != SUCCESS)
+			printf("Log full, trap dropped!\n");
+		traprecvpop(r);
+		if (traprecvpeek(r) == NULL) fflush(stdout);
+	}
+#else
+	while (traprecvpoll(r) != FAIL)
+		for ( ; (t = traprecvpeek(r)) != NULL; traprecvpop(r))
+			printTrap(t);
+#endif
 	return 0;
 }
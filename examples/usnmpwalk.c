@@ -0,0 +1,176 @@
+/*
+ * A program to walk a subtree of an agent with SNMPv1 GetNext requests, by
+ * several chains at once, and display the varbinds found in order.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "wingetopt.h"
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+#include "SnmpMgr.h"
+#include "walker.h"
+#include "resolver.h"
+
+void printHelp( char *prog )
+{
+	printf("Usage:\n");
+	printf("%s [OPTIONS] TARGET OID\n", prog);
+	printf("Options: -c Community  default is 'public'\n");
+	printf("         -p Port       default target port is 161\n");
+	printf("         -t mSec       default time-out is 1000 milliseconds a try\n");
+	printf("         -r Retries    default is 2\n");
+	printf("         -j Chains     default is to walk up to 8 columns at once\n");
+	printf("         -v Varbinds   default is at most 8 varbinds a request\n");
+	printf("         -w Window     default is at most 4 requests outstanding\n");
+	printf("         -s            reports the varbinds found, requests sent and time taken\n");
+	printf("         -q            as -s, without the varbinds\n");
+	printf("Prefix OID with B:Mgmt-Mib2(1.3.6.1.2.1), E:Experimental(1.3.6.1.3), P:Private(1.3.6.1.4.1)\n");
+	printf("E.g. %s 192.168.1.252 -c public -j 10 B.2.2\n", prog);
+}
+
+/* Milliseconds from an arbitrary start */
+double msnow(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+#endif
+}
+
+void printVarbind( VBVIEW *vb, void *arg )
+{
+	(void)arg;
+	vbviewPrint(vb, 1, stdout);
+}
+
+int main(int argc, char **argv)
+{
+	int c, port = SNMP_PORT, timeout = 1000, retries = 2, chains = 8, maxvb = 8, window = 4;
+	int snmpfd, status;
+	Boolean stats = FALSE, quiet = FALSE;
+	char *community = "public";
+	struct sockaddr_storage to;
+	POLLER *p;
+	WALKER *w;
+	double start;
+
+	optind = 1;
+	while ((c = getopt (argc, argv, "c:p:t:r:j:v:w:sqh")) != -1)
+		switch (c) {
+			case 'c':
+				community = optarg;
+				break;
+			case 'p':
+				port = atoi(optarg);
+				break;
+			case 't':
+				timeout = atoi(optarg);
+				break;
+			case 'r':
+				retries = atoi(optarg);
+				break;
+			case 'j':
+				chains = atoi(optarg);
+				break;
+			case 'v':
+				maxvb = atoi(optarg);
+				break;
+			case 'w':
+				window = atoi(optarg);
+				break;
+			case 'q':
+				quiet = TRUE;  /* With the statistics of -s */
+				/* Fall through */
+			case 's':
+				stats = TRUE;
+				break;
+			case 'h':
+				printHelp( argv[0] );
+				/* Fall through */
+			default:
+				return -1;
+		}
+	if ( optind+2 != argc) {
+		printHelp( argv[0] );
+		return -1;
+	}
+
+	if ((snmpfd = initSnmpMgr( 0 )) < 0) {  /* use an ephemeral port */
+		printf("Fail to open a socket.\n");
+		return -1;
+	}
+	if (resolve(NULL, argv[optind], &to) != SUCCESS) {
+		printf("%s: Unknown host.\n", argv[optind]);
+		return -1;
+	}
+	sockaddrsetport((struct sockaddr *)&to, port);
+	if ((p = pollernew(snmpfd, window, timeout, retries)) == NULL) {
+		printf("Fail to start the walk.\n");
+		return -1;
+	}
+	if ((w = walkernew(p, (struct sockaddr *)&to, community, argv[optind+1], chains, maxvb, window)) == NULL) {
+		printf("Bad OID %s.\n", argv[optind+1]);
+		pollerfree(p);
+		return -1;
+	}
+
+	start = msnow();
+	status = walkerrun(w);
+	if (!quiet) walkereach(w, printVarbind, NULL);
+	if (status == FAIL)
+		printf("No response.\n");
+	else if (status != SUCCESS)
+		printf("ErrorStatus:%d\n", status);
+	if (stats)
+		printf("%u varbinds in %u requests, %.3f seconds\n", (unsigned int) w->found,
+			(unsigned int) w->requests, (msnow() - start) / 1e3);
+	walkerfree(w);
+	pollerfree(p);
+	exitSnmpMgr();
+	return 0;
+}
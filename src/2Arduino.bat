@@ -6,10 +6,16 @@ md ..\Arduino\SnmpAgent\examples\usnmpd_esp32
 md ..\Arduino\SnmpAgent\examples\usnmpd_esp8266
 copy mib.c ..\Arduino\SnmpAgent
 copy mib.h ..\Arduino\SnmpAgent
+copy mempool.c ..\Arduino\SnmpAgent
+copy mempool.h ..\Arduino\SnmpAgent
 copy list.c ..\Arduino\SnmpAgent
 copy list.h ..\Arduino\SnmpAgent
 copy miblist.c ..\Arduino\SnmpAgent
 copy miblist.h ..\Arduino\SnmpAgent
+copy mibtrie.c ..\Arduino\SnmpAgent
+copy mibtrie.h ..\Arduino\SnmpAgent
+copy mibtable.c ..\Arduino\SnmpAgent
+copy mibtable.h ..\Arduino\SnmpAgent
 copy endian.c ..\Arduino\SnmpAgent
 copy endian.h ..\Arduino\SnmpAgent
 copy misc.c ..\Arduino\SnmpAgent
@@ -21,6 +27,8 @@ copy varbind.h ..\Arduino\SnmpAgent
 copy retval.h ..\Arduino\SnmpAgent
 copy snmpdefs.h ..\Arduino\SnmpAgent
 copy usnmp.h ..\Arduino\SnmpAgent
+copy trapqueue.c ..\Arduino\SnmpAgent
+copy trapqueue.h ..\Arduino\SnmpAgent
 copy SnmpAgent.h ..\Arduino\SnmpAgent
 copy SnmpAgent.c ..\Arduino\SnmpAgent\SnmpAgent.cpp
 copy ..\examples\usnmpd_atmega.ino ..\Arduino\SnmpAgent\examples\usnmpd_atmega
@@ -7,10 +7,16 @@ mkdir ../Arduino/SnmpAgent/examples/usnmpd_esp32
 mkdir ../Arduino/SnmpAgent/examples/usnmpd_esp8266
 cp mib.c ../Arduino/SnmpAgent
 cp mib.h ../Arduino/SnmpAgent
+cp mempool.c ../Arduino/SnmpAgent
+cp mempool.h ../Arduino/SnmpAgent
 cp list.c ../Arduino/SnmpAgent
 cp list.h ../Arduino/SnmpAgent
 cp miblist.c ../Arduino/SnmpAgent
 cp miblist.h ../Arduino/SnmpAgent
+cp mibtrie.c ../Arduino/SnmpAgent
+cp mibtrie.h ../Arduino/SnmpAgent
+cp mibtable.c ../Arduino/SnmpAgent
+cp mibtable.h ../Arduino/SnmpAgent
 cp endian.c ../Arduino/SnmpAgent
 cp endian.h ../Arduino/SnmpAgent
 cp misc.c ../Arduino/SnmpAgent
@@ -22,6 +28,8 @@ cp varbind.h ../Arduino/SnmpAgent
 cp retval.h ../Arduino/SnmpAgent
 cp snmpdefs.h ../Arduino/SnmpAgent
 cp usnmp.h ../Arduino/SnmpAgent
+cp trapqueue.c ../Arduino/SnmpAgent
+cp trapqueue.h ../Arduino/SnmpAgent
 cp SnmpAgent.h ../Arduino/SnmpAgent
 cp SnmpAgent.c ../Arduino/SnmpAgent/SnmpAgent.cpp
 cp ../examples/usnmpd_atmega.ino ../Arduino/SnmpAgent/examples/usnmpd_atmega
@@ -64,6 +64,10 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* for recvmmsg() and sendmmsg() */
+#endif
+
 #ifndef ARDUINO
 #include <stdio.h>
 #include <stdlib.h>
@@ -96,63 +100,24 @@ WiFiUDP Udp;
 #endif
 #else
 #include "mibutil.h"
-char hostIpAddr[16], remoteIpAddr[16];
+#include "resolver.h"
+char hostIpAddr[IP_STR_SIZE], remoteIpAddr[IP_STR_SIZE];
 #endif
 Boolean debug = FALSE;
+Boolean reusePort = FALSE;
 
 uint16_t remotePort;
 char *enterpriseOID;
 char *roCommunity, *rwCommunity, remoteCommunity[COMM_STR_SIZE];
 Boolean (*checkCommunity)(char *commstr, int reqType) = NULL;
-LIST *mibTree;
+MIBLIST *mibTree;
 
 struct messageStruct request, response;
 unsigned char requestBuffer[REQUEST_BUFFER_SIZE], responseBuffer[RESPONSE_BUFFER_SIZE];
 unsigned char errorStatus = 0 , errorIndex = 0;
+SnmpAgentCtx snmpAgent;  /* Default context, using the global variables above */
 
-#define COPY_SEGMENT(x) \
-	{ \
-	request->index += seglen; \
-	memcopy( response->buffer+response->index, request->buffer+x.start, seglen ); \
-	response->index += seglen; \
-	}
-
-int snmpGet(MIB *thismib, struct messageStruct *response, int *len )
-{
-	int error_code;
-
-	if (thismib->get != NULL && (error_code=thismib->get(thismib)) != NO_ERR) return error_code;
-	if ((response->index+3+thismib->dataLen) >= RESPONSE_BUFFER_SIZE)  /* 3 = 1 Tag + 2 Length conservatively*/
-		return BUFFER_FULL;
-	response->buffer[response->index] = thismib->dataType;
-	response->buffer[response->index+1] = 0;  /* Set length field to zero first */
-	switch(thismib->dataType) {
-		case OCTET_STRING :
-		case OBJECT_IDENTIFIER :
-		case IP_ADDRESS :
-			{
-				*len = thismib->dataLen;
-		 		memcopy((unsigned char *) response->buffer+response->index+2, thismib->u.octetstring, *len);
-			}
-			break;
-		case INTEGER :
-		case TIMETICKS :
-		case COUNTER :
-		case GAUGE :
-			{
-				*(response->buffer+response->index+1) = INT_SIZE;
-				h2nl_byte((uint32_t)thismib->u.intval, response->buffer+response->index+2);
-				compactInt(response->buffer+response->index);
-				*len = (int) *(response->buffer+response->index+1);
-			}
-			break;
-		default :
-			return INVALID_DATA_TYPE;
-	}
-	return NO_ERR;
-}
-
-int snmpSet(MIB *thismib, unsigned char dataType, void *val, int vlen)
+int snmpSet(MIB *thismib, MIBTABLE *tbl, unsigned char dataType, void *val, int vlen)
 {
 	uint32_t intval;
 	int error_code;
@@ -165,21 +130,30 @@ int snmpSet(MIB *thismib, unsigned char dataType, void *val, int vlen)
 		case OCTET_STRING :
 		case OBJECT_IDENTIFIER :
 		case IP_ADDRESS :
-			if (thismib->set != NULL) {
-				if ((error_code=thismib->set(thismib, val, vlen)) != NO_ERR)
+			if (vlen > MIB_DATA_SIZE ||  /* Longer than a node may keep */
+				(dataType == IP_ADDRESS && vlen != IP_ADDRESS_SIZE))
+				return INVALID_DATA_TYPE;
+			if (tbl != NULL) {
+				if ((error_code=mibtableset(tbl, thismib, val, vlen)) != NO_ERR)
 					return error_code;
 			}
-			else {
-				thismib->dataLen = vlen;
-	 			memcopy(thismib->u.octetstring, (unsigned char *) val, vlen);
+			else if (thismib->set != NULL) {
+				if ((error_code=thismib->set(thismib, val, vlen)) != NO_ERR)
+					return error_code;
 			}
+			else if (mibsetvalue(thismib, val, vlen) != SUCCESS)
+				return FAIL;
 			break;
 		case INTEGER :
 		case TIMETICKS :
 		case COUNTER :
 		case GAUGE :
 			intval = getValue((unsigned char *)val, vlen, thismib->dataType);
-			if (thismib->set != NULL) {
+			if (tbl != NULL) {
+				if ((error_code=mibtableset(tbl, thismib, &intval, INT_SIZE)) != NO_ERR)
+					return error_code;
+			}
+			else if (thismib->set != NULL) {
 				if ((error_code=thismib->set(thismib, &intval, INT_SIZE)) != NO_ERR)
 					return error_code;
 			}
@@ -194,285 +168,354 @@ int snmpSet(MIB *thismib, unsigned char dataType, void *val, int vlen)
 	return NO_ERR;
 }
 
-int parseVarBind ( int reqType, struct messageStruct *request, struct messageStruct *response )
+/* Copies thismib into cell, with its value in data of size bytes. Returns
+   Success(0), or Fail(-1) if the value is longer, as a user buffer given to
+   miblistadd() may be. */
+static int mibcopy(MIB *cell, unsigned char *data, int size, MIB *thismib)
 {
-	int seglen = 0, size, len;
-	tlvStructType name, value;
-	MIB *thismib;
-	OID oid;
-
-	if (parseTLV(request->buffer, request->index, &name) != SUCCESS ||
-		request->buffer[name.start] != OBJECT_IDENTIFIER ) {
-		errorStatus = BAD_VALUE;
-		return ILLEGAL_DATA;
+	*cell = *thismib;
+	cell->dataInline = 0;
+	cell->dataHeap = FALSE;
+	if (thismib->dataType == OCTET_STRING || thismib->dataType == OBJECT_IDENTIFIER ||
+		thismib->dataType == IP_ADDRESS) {
+		if (thismib->dataLen > size) return FAIL;
+		memcopy(data, thismib->u.octetstring, thismib->dataLen);
+		cell->u.octetstring = data;
+		cell->dataSize = (unsigned short) size;
 	}
+	return SUCCESS;
+}
 
-	/* For normal GET_REQUEST/SET_REQUEST and TRAP_PACKET, copy the NAME (OID) tlv
-	 * over and continue. But for GET_NEXT_REQUEST, identify the next OID, then
-	 * copy it in as if it is the requested object.
+/* Processes the varbind vb of a request, and prepends its response varbind
+   to response, unless response is NULL. Returns the size prepended, or an
+   error code (<0) with ctx->errorStatus set. */
+int parseVarBind ( SnmpAgentCtx *ctx, int reqType, VBVIEW *vb, struct messageStruct *response )
+{
+	int size, ret;
+	MIB *thismib = NULL, cell;
+	MIBTABLE *tbl = NULL, *t;
+	OID oid, next;
+	unsigned char celldata[MIB_DATA_SIZE];
+
+	/* For normal GET_REQUEST/SET_REQUEST and TRAP_PACKET, the NAME (OID) is
+	 * that requested. But for GET_NEXT_REQUEST, identify the next OID, and
+	 * respond as if it is the requested object.
 	 */
-	ber2oid(request->buffer+name.vstart, name.len, &oid);
-	thismib = miblistgooid(mibTree, &oid);
+	ber2oid(vb->oid, vb->oidLen, &oid);
 	if (reqType == GET_REQUEST || reqType == TRAP_PACKET || reqType == SET_REQUEST) {
-		seglen = name.nstart - name.start;
-		COPY_SEGMENT(name);
+		if ((thismib=miblistfind(ctx->mibTree, &oid)) == NULL &&
+			(tbl=miblistgettable(ctx->mibTree, &oid)) != NULL)
+			cell.oid = oid;
 	} else
 		if (reqType == GET_NEXT_REQUEST) {
-			if (thismib!=NULL)
-				thismib = miblistgonext(mibTree);
-			else
-				thismib = miblistgetthis(mibTree);
-			if (thismib==NULL) {  /* end of MIB tree */
-				errorStatus = NO_SUCH_NAME;
+			/* The next OID is the lesser of the next MIB node and the next cell
+			   of each conceptual table */
+			thismib = miblistfindnext(ctx->mibTree, &oid);
+			for (t = ctx->mibTree->tables; t; t = t->next)
+				if (mibtablenext(t, &oid, &next) == SUCCESS &&
+					((tbl==NULL && thismib==NULL) || oidcmp(&next, tbl ? &cell.oid : &thismib->oid) < 0)) {
+					tbl = t;
+					cell.oid = next;
+				}
+			if (tbl != NULL) thismib = NULL;
+			if (thismib==NULL && tbl==NULL) {  /* end of MIB tree */
+				ctx->errorStatus = NO_SUCH_NAME;
 				return OID_NOT_FOUND;
-			} else {
-				/* Skip the name TLV and replace with the next OID in the MIB tree */
-				request->index += name.nstart - name.start;
-				response->buffer[response->index] = OBJECT_IDENTIFIER;
-				response->buffer[response->index+1] = (unsigned char) oid2ber(&thismib->oid,
-				response->buffer+response->index+2);  /* OID length field assumed 1 byte long */
-				seglen = response->buffer[response->index+1]+2;
-				response->index += seglen ;
 			}
 		}
 		else return INVALID_PDU_TYPE;
-	size = seglen;
 
-	/* Parse the value TLV, and process accordingly */
-	parseTLV(request->buffer, request->index, &value);
-	if (reqType == TRAP_PACKET && request->buffer[value.start] != NULL_ITEM) {
-		seglen = value.nstart - value.start;  /* Retained */
-		COPY_SEGMENT(value);
+	/* Fetch the cell of a conceptual table into a MIB node of its own */
+	if (tbl != NULL && (reqType != TRAP_PACKET || vb->type == NULL_ITEM)) {
+		cell.u.octetstring = celldata;
+		cell.dataSize = sizeof(celldata);
+		cell.dataInline = 0;
+		cell.dataHeap = FALSE;
+		switch (mibtableget(tbl, &cell)) {
+			case SUCCESS: thismib = &cell; break;
+			case OID_NOT_FOUND:
+				ctx->errorStatus = NO_SUCH_NAME; return OID_NOT_FOUND;
+			default:
+				ctx->errorStatus = GEN_ERROR; return FAIL;
+		}
+	}
+
+	/* Prepend the value TLV */
+	if (reqType == TRAP_PACKET && vb->type != NULL_ITEM) {
+		if (response == NULL) return 0;
+		size = prependBytes(response, vb->value, vb->val + vb->valLen - vb->value);  /* Retained */
 	}
 	else
-		if (thismib) {
+		if (thismib == NULL) {
+			ctx->errorStatus = NO_SUCH_NAME;
+			return OID_NOT_FOUND;
+		}
+		else
 			if (reqType == SET_REQUEST) {
-				seglen = value.nstart - value.start; /* Retained */
-				COPY_SEGMENT(value);
-				switch (snmpSet( thismib, request->buffer[value.start], request->buffer+value.vstart, value.len )) {
-					case SUCCESS: break;
+				switch (snmpSet( thismib, tbl, vb->type, vb->val, vb->valLen )) {
+					case SUCCESS: return 0;  /* The response echoes the request */
 					case RD_ONLY_ACCESS:
-						errorStatus = READ_ONLY; return RD_ONLY_ACCESS;
+						ctx->errorStatus = READ_ONLY; return RD_ONLY_ACCESS;
 					case INVALID_DATA_TYPE:
-						errorStatus = BAD_VALUE; return INVALID_DATA_TYPE;
+						ctx->errorStatus = BAD_VALUE; return INVALID_DATA_TYPE;
 					default:
-						errorStatus = GEN_ERROR; return FAIL;
+						ctx->errorStatus = GEN_ERROR; return FAIL;
 				}
 			}
 			else
-				if (request->buffer[value.start] != NULL_ITEM)
-					 { errorStatus = BAD_VALUE; return INVALID_DATA_TYPE; }
-				else
-					if (reqType == GET_REQUEST || reqType == TRAP_PACKET || reqType == GET_NEXT_REQUEST) {
-						switch (snmpGet(thismib, response, &len)) {
-							case SUCCESS: break;
-							case BUFFER_FULL:
-								errorStatus = TOO_BIG; return BUFFER_FULL;
-							case INVALID_DATA_TYPE:
-								errorStatus = GEN_ERROR; return INVALID_DATA_TYPE;
-							 default:
-								errorStatus = GEN_ERROR; return FAIL;
+				if (vb->type != NULL_ITEM) {
+					ctx->errorStatus = BAD_VALUE; return INVALID_DATA_TYPE;
+				}
+				else {
+					if (thismib->get != NULL) {  /* Into a copy, as other workers may read the node */
+						if (mibcopy(&cell, celldata, sizeof(celldata), thismib) == FAIL) {
+							ctx->errorStatus = TOO_BIG; return FAIL;
+						}
+						thismib = &cell;
+						if (thismib->get(thismib) != NO_ERR) {
+							ctx->errorStatus = GEN_ERROR; return FAIL;
 						}
-						seglen = 1 + insertRespLen(request, value.start, response, response->index, len) + len;
-						response->index += seglen;
-						/* Skip the NULL TLV in the request stream */
-						request->index += (value.nstart - value.start);
 					}
-		}
-		else {
-			errorStatus = NO_SUCH_NAME;
-			return OID_NOT_FOUND;
-		}
-
-	size += seglen;
-	return size;
-}
-
-int parseSequence ( int reqType, struct messageStruct *request, struct messageStruct *response )
-{
-	int seglen, size, respLoc;
-	tlvStructType seq;
+					if (response == NULL) return 0;
+					size = prependValue(response, thismib);
+				}
+	if (size == INVALID_DATA_TYPE) {
+		ctx->errorStatus = GEN_ERROR; return INVALID_DATA_TYPE;
+	}
 
-	if (request->index >= request->len) return ILLEGAL_LENGTH;
-	if (parseTLV(request->buffer, request->index, &seq) !=SUCCESS ||
-		request->buffer[seq.start] != SEQUENCE ) return ILLEGAL_DATA;
-	seglen = seq.vstart - seq.start;
-	respLoc = response->index;
-	COPY_SEGMENT(seq);
-	size = parseVarBind( reqType, request, response );
+	/* Prepend the NAME TLV and the SEQUENCE header */
 	if (size >= 0) {
-		if (reqType == SET_REQUEST)
-			return (size + seglen);
+		if (reqType == GET_NEXT_REQUEST)
+			ret = prependOid(response, tbl ? &cell.oid : &thismib->oid);
 		else
-			return (size + insertRespLen(request, seq.start, response, respLoc, size) + 1);
+			ret = prependBytes(response, vb->name, vb->oid + vb->oidLen - vb->name);
+		if (ret >= 0) {
+			size += ret;
+			if ((ret = prependHeader(response, SEQUENCE, size)) >= 0)
+				return size + ret;
+		}
 	}
-	else return size;
+	ctx->errorStatus = TOO_BIG;
+	return BUFFER_FULL;
 }
 
-int parseSequenceOf ( int reqType, struct messageStruct *request, struct messageStruct *response )
+/* Processes the varbinds of msg, and prepends the varbind list of the
+   response to response. For a Get or GetNext request, the varbinds are
+   taken last first, so that the length of each TLV is known before it is
+   written, and each byte of the response is written once. Returns the size
+   prepended, or an error code (<0) with ctx->errorStatus and ctx->errorIndex
+   set for the first varbind in error. */
+int parseVarBindList ( SnmpAgentCtx *ctx, int reqType, MSGVIEW *msg, struct messageStruct *response )
 {
-	int ret, seglen, size = 0, respLoc, index = 0;
-	tlvStructType seqof;
+	int i, ret, size = 0, err = SUCCESS;
+	unsigned char errStatus = NO_ERR, errIndex = 0;
+
+	ctx->errorStatus = NO_ERR; ctx->errorIndex = 0;
+	if (reqType == SET_REQUEST) {
+		for (i = 0; i < msg->nvb; i++)
+			if ((ret = parseVarBind(ctx, reqType, msg->vb+i, response)) < 0) {
+				if (ctx->errorStatus == NO_ERR) ctx->errorStatus = GEN_ERROR;
+				ctx->errorIndex = i+1;
+				return ret;
+			}
+		if ((ret = prependBytes(response, msg->vblistTlv, msg->vblistLen)) < 0)
+			ctx->errorStatus = TOO_BIG;
+		return ret;
+	}
 
-	if (request->index >= request->len) return ILLEGAL_LENGTH;
-	if (parseTLV(request->buffer, request->index, &seqof) != SUCCESS ||
-		request->buffer[seqof.start] != SEQUENCE_OF) return ILLEGAL_DATA;
-	seglen = seqof.vstart - seqof.start;
-	respLoc = response->index;
-	COPY_SEGMENT(seqof);
-	errorStatus = NO_ERR; errorIndex = 0;
-	while (request->index < request->len) {
-		index++;
-		if ( (ret=parseSequence( reqType, request, response )) < 0 ) {  /* Indicates error */
-			if (errorStatus==NO_ERR) errorStatus=GEN_ERROR;
-			errorIndex = index;
-			return ret;
+	/* Once a varbind fails, those before it are still processed, but not
+	   written, in case one of them fails too */
+	for (i = msg->nvb-1; i >= 0; i--) {
+		ctx->errorStatus = NO_ERR;
+		if ((ret = parseVarBind(ctx, reqType, msg->vb+i, err == SUCCESS ? response : NULL)) < 0) {
+			err = ret;
+			errStatus = ctx->errorStatus == NO_ERR ? GEN_ERROR : ctx->errorStatus;
+			errIndex = errStatus == TOO_BIG ? 0 : i+1;
 		}
 		else size += ret;
 	}
-	if (reqType == SET_REQUEST)
-		return (size + seglen);
-	else
-		return (size + insertRespLen(request, seqof.start, response, respLoc, size) + 1);
-}
-
-#undef COPY_SEGMENT
-#define COPY_SEGMENT(x) \
-	{ \
-		request.index += seglen; \
-				memcopy( response.buffer+response.index, \
-						 request.buffer+x.start, seglen ); \
-					response.index += seglen; \
+	if (err == SUCCESS && (ret = prependHeader(response, SEQUENCE_OF, size)) < 0) {
+		err = ret;
+		errStatus = TOO_BIG;
 	}
+	ctx->errorStatus = errStatus; ctx->errorIndex = errIndex;
+	return err == SUCCESS ? size + ret : err;
+}
 
-Boolean valid_community(char *commstr, int reqType)
+Boolean valid_community(SnmpAgentCtx *ctx, char *commstr, int reqType)
 {
-	if (checkCommunity != NULL)
-		return checkCommunity(commstr, reqType);
+	if (ctx->checkCommunity != NULL)
+		return ctx->checkCommunity(ctx, commstr, reqType);
 	else
-		if ( strcmp(commstr, rwCommunity)==0 ||
-		     (reqType!=SET_REQUEST && strcmp(commstr, roCommunity)==0) )
+		if ( strcmp(commstr, ctx->rwCommunity)==0 ||
+		     (reqType!=SET_REQUEST && strcmp(commstr, ctx->roCommunity)==0) )
 			return TRUE;
 		else
 			return FALSE;
 }
 
-static int parseRequest ( char *commstr )
+/*
+ * The request is decoded in place by msgView(), and the response built from
+ * the end of its buffer: the varbind list first, then the PDU and message
+ * headers. The response is thus left at response->buffer+response->index.
+ */
+int parseSNMPMessageCtx ( SnmpAgentCtx *ctx )
 {
-	int ret, seglen, size = 0, reqType, reqLoc, reqLen, errStatusLoc, errIndexLoc;
-	tlvStructType tlv;
-
-	if (request.index >= request.len) return ILLEGAL_LENGTH;
-	if ( (ret=parseTLV(request.buffer, request.index, &tlv)) != SUCCESS) return ret;
-	reqType = request.buffer[tlv.start];
+	struct messageStruct *request = ctx->request, *response = ctx->response;
+	unsigned char *req = request->buffer + request->index;
+	int size, ret, reqType;
+	MSGVIEW msg;
+	VBVIEW vb[VBVIEW_MAX(REQUEST_BUFFER_SIZE)];
 
+	if (request->index >= request->len) return ILLEGAL_LENGTH;
+	ret = msgView(req, request->len - request->index, &msg, vb, VBVIEW_MAX(REQUEST_BUFFER_SIZE));
+
+	/* Version and community */
+	if (msg.versionTlv == NULL) return ret;
+	if (msg.version != SNMP_V1) return ILLEGAL_DATA;
+	if (msg.community == NULL) return ret;
+	if (msg.communityLen >= COMM_STR_SIZE) return COMM_STR_ERR;
+	memcopy( (unsigned char *)ctx->remoteCommunity, msg.community, msg.communityLen );
+	ctx->remoteCommunity[msg.communityLen] = '\0';
+
+	/* Request PDU */
+	if (msg.pduTlv == NULL) return ret;
+	reqType = msg.pduType;
 	if ( !VALID_REQUEST(reqType) ) return INVALID_PDU_TYPE;
-	if ( !valid_community( commstr, reqType) ) return COMM_STR_MISMATCH;
-
-	seglen = tlv.vstart - tlv.start;
-	reqLoc = tlv.start; reqLen = seglen + tlv.len;  /* Holds the Request-PDU */
-	COPY_SEGMENT(tlv);
-
-	response.buffer[reqLoc] = GET_RESPONSE;
-
-	/* Parse Request ID */
-	if (parseTLV(request.buffer, request.index, &tlv) != SUCCESS ||
-		request.buffer[tlv.start]!=INTEGER) return REQ_ID_ERR;
-	seglen = tlv.nstart - tlv.start;
-	size += seglen;
-	COPY_SEGMENT(tlv);
-
-	/* Parse Error Status */
-	if (parseTLV(request.buffer, request.index, &tlv) != SUCCESS ||
-		request.buffer[tlv.start]!=INTEGER || tlv.len!=1 ||
-		request.buffer[tlv.vstart]!='\0') return ILLEGAL_ERR_STATUS;
-	errStatusLoc = tlv.vstart;
-	seglen = tlv.nstart - tlv.start;
-	size += seglen;
-	COPY_SEGMENT(tlv);
-
-	/* Parse Error Index */
-	if (parseTLV(request.buffer, request.index, &tlv) != SUCCESS ||
-		request.buffer[tlv.start]!=INTEGER || tlv.len!=1 ||
-		request.buffer[tlv.vstart]!='\0') return ILLEGAL_ERR_INDEX;
-	errIndexLoc = tlv.vstart;
-	seglen = tlv.nstart - tlv.start;
-	size += seglen;
-	COPY_SEGMENT(tlv);
-
-	ret = parseSequenceOf(reqType, &request, &response);
-	if (ret < 0) {
-		if ( errorIndex!=0 ) {
-			/* In the event of a parsing error, the Request-PDU is restored
-				 and added with the error status and index */
-			memcopy(response.buffer+reqLoc, request.buffer+reqLoc, reqLen);
-			response.buffer[reqLoc] = GET_RESPONSE;
-	 		response.buffer[errStatusLoc] = errorStatus;
-			response.buffer[errIndexLoc] = errorIndex;
-			return reqLen;
-		}
-		else return ret;
+	if ( !valid_community( ctx, ctx->remoteCommunity, reqType) ) return COMM_STR_MISMATCH;
+	if (msg.vblistTlv == NULL) return ret;
+	if (msg.errStatusTlv[1] != 1 || msg.errorStatus != NO_ERR) return ILLEGAL_ERR_STATUS;
+	if (msg.errIndexTlv[1] != 1 || msg.errorIndex != 0) return ILLEGAL_ERR_INDEX;
+
+	response->index = response->size;
+	if (ret == BUFFER_FULL) {  /* More varbinds than vb holds */
+		ctx->errorStatus = TOO_BIG;
+		ctx->errorIndex = 0;
+		size = ret;
+	}
+	else if (ret != SUCCESS) {  /* A malformed varbind */
+		ctx->errorStatus = ret == INVALID_DATA_TYPE ? BAD_VALUE : GEN_ERROR;
+		ctx->errorIndex = msg.nvb+1;
+		size = ret;
 	}
 	else {
-		size += ret;
-		return (size + insertRespLen(&request, reqLoc, &response, reqLoc, size) + 1);
+		if (ctx->lockMib) ctx->lockMib(ctx, reqType == SET_REQUEST);
+		size = parseVarBindList(ctx, reqType, &msg, response);
+		if (ctx->unlockMib) ctx->unlockMib(ctx);
+	}
+
+	if (size >= 0 &&
+		(ret = prependBytes(response, msg.reqIdTlv, msg.vblistTlv-msg.reqIdTlv)) >= 0 &&
+		(size += ret, ret = prependHeader(response, GET_RESPONSE, size)) >= 0 &&
+		(size += ret, ret = prependBytes(response, msg.versionTlv, msg.pduTlv-msg.versionTlv)) >= 0 &&
+		(size += ret, ret = prependHeader(response, SEQUENCE_OF, size)) >= 0) {
+		request->index = request->len;
+		return response->len = size + ret;
 	}
+	if (size >= 0) {
+		ctx->errorStatus = TOO_BIG; ctx->errorIndex = 0;
+	}
+	else
+		if (ctx->errorStatus == NO_ERR) return size;
+
+	/* The request is returned with the error status and index */
+	response->index = response->size;
+	if (prependBytes(response, req, msg.len) < 0) return BUFFER_FULL;
+	response->buffer[response->index+(msg.pduTlv-req)] = GET_RESPONSE;
+	response->buffer[response->index+(msg.errStatusTlv-req)+2] = ctx->errorStatus;
+	response->buffer[response->index+(msg.errIndexTlv-req)+2] = ctx->errorIndex;
+	return response->len = msg.len;
 }
 
-static int parseCommunity ( )
+/*
+ * The default context shares request, response and mibTree with the global
+ * variables. Its remaining state is copied to and from the global variables
+ * around each request, so applications written against them keep working.
+ */
+static void importGlobals( void )
 {
-	int seglen, size;
-	tlvStructType community;
+	snmpAgent.mibTree = mibTree;
+	snmpAgent.roCommunity = roCommunity; snmpAgent.rwCommunity = rwCommunity;
+}
 
-	if (request.index >= request.len) return ILLEGAL_LENGTH;
-	if (parseTLV(request.buffer, request.index, &community) != SUCCESS ||
-		community.len >= COMM_STR_SIZE) return COMM_STR_ERR;
-	memcopy( (unsigned char *)remoteCommunity, request.buffer+community.vstart,
-		community.len );
-	remoteCommunity[community.len] = '\0';
-	if (request.buffer[community.start] == OCTET_STRING) {
-		seglen = community.nstart - community.start;
-		COPY_SEGMENT(community);
-		if ( (size=parseRequest(remoteCommunity)) >= 0 ) return size + seglen;
-		else return size;
-	}
-	return INVALID_DATA_TYPE;
+static void exportGlobals( SnmpAgentCtx *ctx )
+{
+	errorStatus = ctx->errorStatus; errorIndex = ctx->errorIndex;
+	strcpy(remoteCommunity, ctx->remoteCommunity);
+#ifdef ARDUINO
+	remoteIpAddr = ctx->remoteIpAddr;
+#else
+	strcpy(remoteIpAddr, ctx->remoteIpAddr);
+#endif
+	remotePort = ctx->remotePort;
 }
 
-static int parseVersion ( )
+static Boolean checkCommunityGlobal( SnmpAgentCtx *ctx, char *commstr, int reqType )
 {
-	int seglen, size;
-	tlvStructType tlv;
+	exportGlobals(ctx);
+	return checkCommunity(commstr, reqType);
+}
 
-	if (request.index >= request.len) return ILLEGAL_LENGTH;
-	if (parseTLV(request.buffer, request.index, &tlv) != SUCCESS ||
-		request.buffer[tlv.start] != INTEGER ||
-		request.buffer[tlv.vstart] != SNMP_V1) return ILLEGAL_DATA;
-	seglen = tlv.nstart - tlv.start;
-	COPY_SEGMENT(tlv);
-	size = parseCommunity();
-	if (size >= 0) return (size + seglen); else return size;
+void setCheckCommunity ( Boolean (*func)(char *commstr, int reqtype) )
+{
+	checkCommunity = func;
+	snmpAgent.checkCommunity = func ? checkCommunityGlobal : NULL;
 }
 
-int parseSNMPMessage ( )
+void setCheckCommunityCtx( SnmpAgentCtx *ctx, Boolean (*func)(SnmpAgentCtx *ctx, char *commstr, int reqtype) )
 {
-	int  seglen, size, respLoc;
-	tlvStructType tlv;
+	ctx->checkCommunity = func;
+}
 
-	if (request.index >= request.len) return ILLEGAL_LENGTH;
-	if ((size=parseTLV(request.buffer, request.index, &tlv)) != SUCCESS) return size;
-	if (request.buffer[tlv.start] != SEQUENCE_OF) return ILLEGAL_DATA;
-	seglen = tlv.vstart - tlv.start;
-	respLoc = tlv.start;
-	COPY_SEGMENT(tlv);
-	size = parseVersion();
-	if (size >= 0) return (size + insertRespLen(&request, tlv.start, &response, respLoc, size) + 1);
-		else return size;
+void setMibLockCtx( SnmpAgentCtx *ctx, void (*lock)(SnmpAgentCtx *ctx, Boolean exclusive), void (*unlock)(SnmpAgentCtx *ctx) )
+{
+	ctx->lockMib = lock; ctx->unlockMib = unlock;
 }
 
-void setCheckCommunity ( Boolean (*func)(char *commstr, int reqtype) )
+int parseSNMPMessage( void )
 {
-	checkCommunity = func;
+	int len;
+
+	importGlobals();
+	len = parseSNMPMessageCtx(&snmpAgent);
+	exportGlobals(&snmpAgent);
+	return len;
+}
+
+SnmpAgentCtx *newSnmpAgentCtx( MIBLIST *mibtree, char *rocommstr, char *rwcommstr )
+{
+	SnmpAgentCtx *ctx;
+	struct messageStruct *msg;
+
+	/* The context, its two message structures and their buffers are allocated in one block */
+	ctx = (SnmpAgentCtx *)malloc(sizeof(SnmpAgentCtx) + 2*sizeof(struct messageStruct) +
+		REQUEST_BUFFER_SIZE + RESPONSE_BUFFER_SIZE);
+	if (ctx == NULL) return NULL;
+	memset(ctx, 0, sizeof(SnmpAgentCtx));
+	msg = (struct messageStruct *)(ctx+1);
+	ctx->request = msg; ctx->response = msg+1;
+	ctx->request->buffer = (unsigned char *)(msg+2); ctx->request->size = REQUEST_BUFFER_SIZE;
+	ctx->response->buffer = ctx->request->buffer+REQUEST_BUFFER_SIZE; ctx->response->size = RESPONSE_BUFFER_SIZE;
+	ctx->mibTree = mibtree;
+	ctx->roCommunity = rocommstr; ctx->rwCommunity = rwcommstr;
+#ifndef ARDUINO
+	ctx->snmpfd = -1;
+#endif
+	return ctx;
+}
+
+void freeSnmpAgentCtx( SnmpAgentCtx *ctx )
+{
+#ifndef ARDUINO
+	if (ctx->snmpfd >= 0)
+#ifdef _WIN32
+		closesocket(ctx->snmpfd);
+#else
+		close(ctx->snmpfd);
+#endif
+	if (ctx->batch) free(ctx->batch);
+#endif
+	free(ctx);
 }
 
 #ifdef ARDUINO
@@ -508,6 +551,8 @@ int initSnmpAgent( int port, char *entoid, char *rocommstr, char *rwcommstr )
 	enterpriseOID = entoid;
 	roCommunity = rocommstr; rwCommunity = rwcommstr;
 	mibTree = miblistnew(0);
+	snmpAgent.request = &request; snmpAgent.response = &response;
+	importGlobals();
 #ifdef ARDUINO_ETHERNET
 	Ethernet.begin(hostMacAddr, hostIpAddr, dnsServer, hostGateway, hostNetmask);
 #else
@@ -526,47 +571,54 @@ int initSnmpAgent( int port, char *entoid, char *rocommstr, char *rwcommstr )
 	return SUCCESS;
 }
 
-int processSNMP( void )
+int processSNMPCtx( SnmpAgentCtx *ctx )
 {
+	struct messageStruct *request = ctx->request, *response = ctx->response;
+
 	if (Udp.parsePacket() < REQUEST_BUFFER_SIZE) {
-		remoteIpAddr = Udp.remoteIP(); remotePort = Udp.remotePort();
-		request.len = Udp.read(request.buffer, REQUEST_BUFFER_SIZE);
-		if (request.len > 0) {
-			request.index = 0;
-			response.index = 0;
-			response.len = parseSNMPMessage();
-			if (response.len > 0) {
-				response.index = response.len;
-				Udp.beginPacket(remoteIpAddr, remotePort);
-				Udp.write(response.buffer, response.index);
+		ctx->remoteIpAddr = Udp.remoteIP(); ctx->remotePort = Udp.remotePort();
+		request->len = Udp.read(request->buffer, REQUEST_BUFFER_SIZE);
+		if (request->len > 0) {
+			request->index = 0;
+			response->index = 0;
+			response->len = parseSNMPMessageCtx(ctx);
+			if (response->len > 0) {
+				Udp.beginPacket(ctx->remoteIpAddr, ctx->remotePort);
+				Udp.write(response->buffer+response->index, response->len);
 				Udp.endPacket();
 			}
-			return response.len;
+			return response->len;
 		}
 	}
 	return FAIL;
 }
 
+int processSNMP( void )
+{
+	int len;
+
+	importGlobals();
+	len = processSNMPCtx(&snmpAgent);
+	exportGlobals(&snmpAgent);
+	return len;
+}
+
 #else
 
-int gethostaddr( char *hostname, struct sockaddr_in *sin )
+/* Prints a response, which is built at the end of its buffer */
+static void showResponse( struct messageStruct *response )
 {
-	struct hostent *he;
-	char machine_name[ 32 ];
+	struct messageStruct msg;
 
-	if (hostname == NULL || hostname[0] == '\x00')
-	{
-		if (gethostname (machine_name, sizeof (machine_name)))
-			return FAIL;
-	}
-	else
-		strcpy(machine_name, hostname);
-	he = gethostbyname (machine_name);
-	if (he == NULL) return FAIL;
-	memset (sin, 0, sizeof (struct sockaddr_in));
-	sin->sin_family = AF_INET;
-	memmove (&sin->sin_addr, he->h_addr_list[0], he->h_length); /* first entry */
-	return SUCCESS;
+	msg.buffer = response->buffer+response->index; msg.len = response->len;
+	showMessage(&msg);
+}
+
+/* Resolves through the default resolver of resolver.h, which caches the
+   addresses of host names. */
+int gethostaddr( char *hostname, struct sockaddr_storage *addr )
+{
+	return resolve(NULL, hostname, addr);
 }
 
 uint32_t sysUpTime( void )	/* in hundredths of a second */
@@ -580,10 +632,25 @@ uint32_t sysUpTime( void )	/* in hundredths of a second */
 		return (uint32_t)((time(NULL)-startTime)*100);
 }
 
-static int snmpfd;
+int bindSnmpAgentCtx( SnmpAgentCtx *ctx, int port )
+{
+	/* One socket for both IPv6 and IPv4 requesters */
+	if ((ctx->snmpfd = sockopen(port, reusePort)) < 0) {
+		if (debug)
+#ifdef _WIN32
+			printf("Unable to bind to UDP port %d during initialisation (%d).\n", port, WSAGetLastError());
+#else
+			printf("Unable to bind to UDP port %d during initialisation (%d).\n", port, errno);
+#endif
+		return FAIL;
+	}
+	else
+		return SUCCESS;
+}
+
 int initSnmpAgent( int port, char *entoid, char *rocommstr, char *rwcommstr )
 {
-	struct sockaddr_in servaddr;
+	struct sockaddr_storage servaddr;
 #ifdef _WIN32
 	WSADATA wsaData;
 	if (WSAStartup(MAKEWORD(2, 0), &wsaData) != 0) {
@@ -599,77 +666,163 @@ int initSnmpAgent( int port, char *entoid, char *rocommstr, char *rwcommstr )
 	enterpriseOID = entoid;
 	roCommunity = rocommstr; rwCommunity = rwcommstr;
 	mibTree = miblistnew(0);
-  gethostaddr( NULL, &servaddr ); inet_ntop(AF_INET, &(servaddr.sin_addr), hostIpAddr, 16);
+	snmpAgent.request = &request; snmpAgent.response = &response;
+	importGlobals();
+	gethostaddr( NULL, &servaddr ); sockaddrntop((struct sockaddr *)&servaddr, hostIpAddr);
 	if (debug)
 #ifdef _WIN32
 		printf ("Local Windows system host address is %s\n", hostIpAddr);
 #else
 		printf ("Local system host address is %s\n", hostIpAddr);
 #endif
-	snmpfd = socket(PF_INET, SOCK_DGRAM, 0);
-	servaddr.sin_family = AF_INET;
-	servaddr.sin_addr.s_addr = INADDR_ANY;
-	servaddr.sin_port = htons(port);
-	if (bind(snmpfd, (struct sockaddr *)&servaddr, sizeof(servaddr)) != 0 ) {
-		if (debug)
-#ifdef _WIN32
-			printf("Unable to bind to UDP port %d during initialisation (%d).\n", port, WSAGetLastError());
-#else
-			printf("Unable to bind to UDP port %d during initialisation (%d).\n", port, errno);
-#endif
-		return FAIL;
-	}
-	else
-		return SUCCESS;
+	return bindSnmpAgentCtx(&snmpAgent, port);
 }
 
-int processSNMP( void )
+int processSNMPCtx( SnmpAgentCtx *ctx )
 {
 #ifdef _WIN32
 	int fromlen;
 #else
 	socklen_t fromlen;
 #endif
-	struct sockaddr from;
-		
+	struct sockaddr_storage from;
+	struct messageStruct *request = ctx->request, *response = ctx->response;
+
 	fromlen = sizeof(from);
-	request.len = recvfrom(snmpfd, request.buffer, REQUEST_BUFFER_SIZE, 0, &from, &fromlen);
-	if (request.len > 0) {
-		inet_ntop(AF_INET, &(((struct sockaddr_in *)&from)->sin_addr), remoteIpAddr, 16);
-		remotePort = ntohs(((struct sockaddr_in *)&from)->sin_port);
+	request->len = recvfrom(ctx->snmpfd, request->buffer, request->size, 0, (struct sockaddr *)&from, &fromlen);
+	if (request->len > 0) {
+		sockaddrntop((struct sockaddr *)&from, ctx->remoteIpAddr);
+		ctx->remotePort = sockaddrport((struct sockaddr *)&from);
 		if (debug) {
-			printf("\nReceive %d bytes from %s:%u", request.len, remoteIpAddr, remotePort);
-			showMessage(&request);
+			printf("\nReceive %d bytes from %s:%u", request->len, ctx->remoteIpAddr, ctx->remotePort);
+			showMessage(request);
 		}
-		request.index = 0;
-		response.index = 0;
-		response.len = parseSNMPMessage();
-		if (response.len > 0) {
-			response.index = response.len;
-			sendto(snmpfd, response.buffer, response.index, 0,
+		request->index = 0;
+		response->index = 0;
+		response->len = parseSNMPMessageCtx(ctx);
+		if (response->len > 0) {
+			sendto(ctx->snmpfd, response->buffer+response->index, response->len, 0,
 						 (struct sockaddr *)&from, fromlen);
 			if (debug) {
-				if (errorStatus==0) printf("Response:");
-				else printf("Response with Error Status %u, Index %u:", errorStatus, errorIndex);
-				showMessage(&response);
+				if (ctx->errorStatus==0) printf("Response:");
+				else printf("Response with Error Status %u, Index %u:", ctx->errorStatus, ctx->errorIndex);
+				showResponse(response);
 			}
 		}
 		else
 			if (debug) printf("Parse fail! Error %d at byte position %d. Error Status %u, Index %u\n",
-				response.len, request.index, errorStatus, errorIndex);
-		return response.len;
+				response->len, request->index, ctx->errorStatus, ctx->errorIndex);
+		return response->len;
 	}
 	else return FAIL;
 }
 
+#ifdef __linux__
+/* Request and response buffers for a batch of datagrams */
+struct snmpBatch {
+	struct mmsghdr rmsg[SNMP_BATCH_SIZE], smsg[SNMP_BATCH_SIZE];
+	struct iovec riov[SNMP_BATCH_SIZE], siov[SNMP_BATCH_SIZE];
+	struct sockaddr_storage from[SNMP_BATCH_SIZE];
+	struct messageStruct request[SNMP_BATCH_SIZE], response[SNMP_BATCH_SIZE];
+	unsigned char requestBuffer[SNMP_BATCH_SIZE][REQUEST_BUFFER_SIZE];
+	unsigned char responseBuffer[SNMP_BATCH_SIZE][RESPONSE_BUFFER_SIZE];
+};
+
+static struct snmpBatch *newBatch( void )
+{
+	struct snmpBatch *b;
+	int i;
+
+	if ((b = (struct snmpBatch *)malloc(sizeof(struct snmpBatch))) == NULL) return NULL;
+	for (i = 0; i < SNMP_BATCH_SIZE; i++) {
+		b->request[i].buffer = b->requestBuffer[i]; b->request[i].size = REQUEST_BUFFER_SIZE;
+		b->response[i].buffer = b->responseBuffer[i]; b->response[i].size = RESPONSE_BUFFER_SIZE;
+		b->riov[i].iov_base = b->requestBuffer[i]; b->riov[i].iov_len = REQUEST_BUFFER_SIZE;
+		memset(&b->rmsg[i], 0, sizeof(struct mmsghdr));
+		b->rmsg[i].msg_hdr.msg_iov = &b->riov[i];
+		b->rmsg[i].msg_hdr.msg_iovlen = 1;
+		b->rmsg[i].msg_hdr.msg_name = &b->from[i];
+	}
+	return b;
+}
+
+int processSNMPBatchCtx( SnmpAgentCtx *ctx, int result[] )
+{
+	struct snmpBatch *b;
+	struct messageStruct *request = ctx->request, *response = ctx->response;
+	int i, n, nrecv, nsend = 0;
+
+	if (ctx->batch == NULL && (ctx->batch = newBatch()) == NULL)
+		return FAIL;
+	b = ctx->batch;
+	for (i = 0; i < SNMP_BATCH_SIZE; i++)
+		b->rmsg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+	/* Wait for the first datagram, then take those already queued */
+	if ((nrecv = recvmmsg(ctx->snmpfd, b->rmsg, SNMP_BATCH_SIZE, MSG_WAITFORONE, NULL)) <= 0)
+		return FAIL;
+	for (i = 0; i < nrecv; i++) {
+		ctx->request = &b->request[i]; ctx->response = &b->response[i];
+		sockaddrntop((struct sockaddr *)&b->from[i], ctx->remoteIpAddr);
+		ctx->remotePort = sockaddrport((struct sockaddr *)&b->from[i]);
+		ctx->request->len = b->rmsg[i].msg_len;
+		if (debug) {
+			printf("\nReceive %d bytes from %s:%u", ctx->request->len, ctx->remoteIpAddr, ctx->remotePort);
+			showMessage(ctx->request);
+		}
+		ctx->request->index = 0;
+		ctx->response->index = 0;
+		result[i] = ctx->response->len = parseSNMPMessageCtx(ctx);
+		if (result[i] > 0) {
+			b->siov[i].iov_base = ctx->response->buffer+ctx->response->index; b->siov[i].iov_len = result[i];
+			memset(&b->smsg[nsend], 0, sizeof(struct mmsghdr));
+			b->smsg[nsend].msg_hdr.msg_iov = &b->siov[i];
+			b->smsg[nsend].msg_hdr.msg_iovlen = 1;
+			b->smsg[nsend].msg_hdr.msg_name = &b->from[i];
+			b->smsg[nsend].msg_hdr.msg_namelen = b->rmsg[i].msg_hdr.msg_namelen;
+			nsend++;
+			if (debug) {
+				if (ctx->errorStatus==0) printf("Response:");
+				else printf("Response with Error Status %u, Index %u:", ctx->errorStatus, ctx->errorIndex);
+				showResponse(ctx->response);
+			}
+		}
+		else
+			if (debug) printf("Parse fail! Error %d at byte position %d. Error Status %u, Index %u\n",
+				result[i], ctx->request->index, ctx->errorStatus, ctx->errorIndex);
+	}
+	ctx->request = request; ctx->response = response;
+	for (i = 0; i < nsend; i += n)
+		if ((n = sendmmsg(ctx->snmpfd, b->smsg+i, nsend-i, 0)) <= 0)
+			n = 1;  /* That response is dropped, not those after it */
+	return nrecv;
+}
+#else
+int processSNMPBatchCtx( SnmpAgentCtx *ctx, int result[] )
+{
+	result[0] = processSNMPCtx(ctx);
+	return 1;
+}
+#endif
+
+int processSNMP( void )
+{
+	int len;
+
+	importGlobals();
+	len = processSNMPCtx(&snmpAgent);
+	exportGlobals(&snmpAgent);
+	return len;
+}
+
 void exitSnmpAgent( void )
 {
 #ifdef _WIN32
-	closesocket(snmpfd);
+	closesocket(snmpAgent.snmpfd);
 	WSACleanup();
 #else
-	close(snmpfd);
+	close(snmpAgent.snmpfd);
 #endif
+	if ( snmpAgent.batch != NULL ) free(snmpAgent.batch);
 	if ( mibTree != NULL ) miblistfree(mibTree);
 }
 
@@ -684,12 +837,24 @@ void exitSnmpAgent( void )
  */
 int vblistParse(int reqType, struct messageStruct *vblist)
 {
-	vblist->index = 0;
-	response.index = 0;
-
-	response.len = parseSequenceOf ( reqType, vblist, &response );
+	MSGVIEW msg;
+	VBVIEW vb[VBVIEW_MAX(VB_BUFFER_SIZE)];
+
+	importGlobals();
+	response.index = response.size;
+	msg.vb = vb;
+	msg.vblistTlv = vblist->buffer;
+	if ((msg.nvb = vblistView(vblist->buffer, vblist->len, vb, VBVIEW_MAX(VB_BUFFER_SIZE))) < 0) {
+		snmpAgent.errorStatus = GEN_ERROR; snmpAgent.errorIndex = 0;
+		response.len = msg.nvb;
+	}
+	else {
+		msg.vblistLen = vblist->len;
+		response.len = parseVarBindList ( &snmpAgent, reqType, &msg, &response );
+	}
+	errorStatus = snmpAgent.errorStatus; errorIndex = snmpAgent.errorIndex;
 	if (response.len >= 0 ) {
-		memcopy(vblist->buffer, response.buffer, response.len);
+		memcopy(vblist->buffer, response.buffer+response.index, response.len);
 		vblist->len = response.len;
 	}
  	return response.len;
@@ -724,10 +889,9 @@ int trapBuild(struct messageStruct *trap, char *entoid, char *agentaddr, int gen
 	trap->buffer[trap->index++] = agentaddr[2];
 	trap->buffer[trap->index++] = agentaddr[3];
 #else
-	if (agentaddr == NULL)
-    inet_pton(AF_INET, hostIpAddr, (struct in_addr *) (trap->buffer+trap->index));
-	else
-    inet_pton(AF_INET, agentaddr, (struct in_addr *) (trap->buffer+trap->index));
+	/* 0.0.0.0 if the agent has no IPv4 address */
+	if (inet_pton(AF_INET, agentaddr ? agentaddr : hostIpAddr, (struct in_addr *) (trap->buffer+trap->index)) != 1)
+		memset(trap->buffer+trap->index, 0, 4);
 	trap->index += 4;
 #endif
 
@@ -771,8 +935,8 @@ void trapSend(struct messageStruct *trap, char *dst, uint16_t port_no, char *com
 	IPAddress dstAddr;
 #else
 	int snmpfd;
-	struct sockaddr_in servaddr, to;
-	char dstAddr[16];
+	struct sockaddr_storage servaddr, to;
+	char dstAddr[IP_STR_SIZE];
 #endif
 
 	int len = strlen(comm_str);
@@ -804,26 +968,25 @@ void trapSend(struct messageStruct *trap, char *dst, uint16_t port_no, char *com
 		Udp.endPacket();
 }
 #else
-	snmpfd = socket(PF_INET, SOCK_DGRAM, 0);
-	servaddr.sin_family = AF_INET;
-	servaddr.sin_addr.s_addr = INADDR_ANY;
-	to.sin_family = AF_INET;
-	if (gethostaddr(dst, &to) == SUCCESS) {
-		to.sin_port = htons(port_no);
-		for (servaddr.sin_port = htons(port_no);
-			bind(snmpfd, (struct sockaddr *)&servaddr, sizeof(servaddr)) != 0;
-			servaddr.sin_port = htons(++port_no));
+	if (gethostaddr(dst, &to) == SUCCESS &&
+		(snmpfd = socket(to.ss_family, SOCK_DGRAM, 0)) >= 0) {
+		sockaddrsetport((struct sockaddr *)&to, port_no);
+		memset(&servaddr, 0, sizeof(servaddr));
+		servaddr.ss_family = to.ss_family;  /* Any address */
+		for (sockaddrsetport((struct sockaddr *)&servaddr, port_no);
+			bind(snmpfd, (struct sockaddr *)&servaddr, sockaddrlen((struct sockaddr *)&servaddr)) != 0;
+			sockaddrsetport((struct sockaddr *)&servaddr, ++port_no));
 		if (debug) {
-      inet_ntop(AF_INET, &(to.sin_addr), dstAddr, 16);
+			sockaddrntop((struct sockaddr *)&to, dstAddr);
 			printf("Send trap to %s from port %d:", dstAddr, port_no);
 			showMessage(trap);
 		}
-		sendto(snmpfd, trap->buffer, trap->len, 0, (struct sockaddr *)&to, sizeof(to));
-	}
+		sendto(snmpfd, trap->buffer, trap->len, 0, (struct sockaddr *)&to, sockaddrlen((struct sockaddr *)&to));
 #ifdef _WIN32
 		closesocket(snmpfd);
 #else
 		close(snmpfd);
 #endif
+	}
 }
 #endif
@@ -95,6 +95,29 @@
 extern "C" {
 #endif
 
+/* An agent context owns the buffers and state needed to serve one request at a
+   time, so that several contexts may serve requests concurrently, from
+   different threads or at different ports. The global variables below form the
+   default context, snmpAgent, used by initSnmpAgent() and processSNMP(). */
+typedef struct snmpAgentCtx {
+	MIBLIST *mibTree;  // MIB tree served by this context
+	struct messageStruct *request, *response;
+	unsigned char errorStatus, errorIndex;
+	char *roCommunity, *rwCommunity, remoteCommunity[COMM_STR_SIZE];
+	Boolean (*checkCommunity)(struct snmpAgentCtx *ctx, char *commstr, int reqType);
+	void (*lockMib)(struct snmpAgentCtx *ctx, Boolean exclusive);
+	void (*unlockMib)(struct snmpAgentCtx *ctx);
+#ifdef ARDUINO
+	IPAddress remoteIpAddr;
+#else
+	char remoteIpAddr[IP_STR_SIZE];
+	int snmpfd;
+	struct snmpBatch *batch;  // buffers of processSNMPBatchCtx()
+#endif
+	uint16_t remotePort;
+	void *data;  // for use by the application
+} SnmpAgentCtx;
+
 /* Global variables */
 #ifdef ARDUINO
 extern IPAddress remoteIpAddr;
@@ -103,13 +126,15 @@ extern char hostIpAddr[], remoteIpAddr[];
 #endif
 extern uint16_t remotePort;
 extern char *enterpriseOID, *roCommunity, *rwCommunity, remoteCommunity[];
-extern Boolean (*checkCommnuity)(char *commstr, int reqType);
+extern Boolean (*checkCommunity)(char *commstr, int reqType);
 
-extern LIST *mibTree; 		// Holds the MIB tree for this agent
+extern MIBLIST *mibTree; 		// Holds the MIB tree for this agent
 extern struct messageStruct request, response;
 extern unsigned char requestBuffer[], responseBuffer[];
 extern unsigned char errorStatus, errorIndex;
 extern Boolean debug;
+extern Boolean reusePort;  // bind with SO_REUSEPORT, so several contexts may share a port
+extern SnmpAgentCtx snmpAgent;
 
 /* Prototypes */
 
@@ -130,6 +155,48 @@ int processSNMP( void );
 
 void exitSnmpAgent( void );
 
+/* Allocates a context, with its own request and response buffers, to serve
+   mibtree with the given community strings. Returns NULL if fail. */
+SnmpAgentCtx *newSnmpAgentCtx( MIBLIST *mibtree, char *rocommstr, char *rwcommstr );
+
+/* Frees a context allocated by newSnmpAgentCtx(), closing its socket if bound.
+   The MIB tree is not freed. */
+void freeSnmpAgentCtx( SnmpAgentCtx *ctx );
+
+/* Sets the function used by ctx to validate the requester's community string.
+   ctx->remoteIpAddr and ctx->remotePort identify the requester. */
+void setCheckCommunityCtx( SnmpAgentCtx *ctx, Boolean (*func)(SnmpAgentCtx *ctx, char *commstr, int reqtype) );
+
+/* Sets the functions called by ctx around its access to the MIB tree, so that
+   contexts on several threads may share it. The lock is exclusive for a Set
+   request, and may be shared otherwise. */
+void setMibLockCtx( SnmpAgentCtx *ctx, void (*lock)(SnmpAgentCtx *ctx, Boolean exclusive), void (*unlock)(SnmpAgentCtx *ctx) );
+
+/* Parses the SNMP message in ctx->request and constructs the response in
+   ctx->response. Returns response length or an error code (<0). */
+int parseSNMPMessageCtx( SnmpAgentCtx *ctx );
+
+/* As above, for the default context. */
+int parseSNMPMessage( void );
+
+#ifndef ARDUINO
+/* Binds ctx to a socket of its own listening at port. Returns Success(0) or Fail(-1).
+   Where reusePort is set, several contexts may bind to the same port, and the
+   system shares the requests among them. */
+int bindSnmpAgentCtx( SnmpAgentCtx *ctx, int port );
+#endif
+
+/* Receives a request for ctx, and sends the response. Returns response length or Fail(-1). */
+int processSNMPCtx( SnmpAgentCtx *ctx );
+
+#ifndef ARDUINO
+/* Receives up to SNMP_BATCH_SIZE requests waiting for ctx in one call, and
+   sends their responses in another. Each request's response length or error
+   code is put in result[]. Returns the number of requests received, or Fail(-1).
+   Where the system lacks recvmmsg(), a single request is processed. */
+int processSNMPBatchCtx( SnmpAgentCtx *ctx, int result[] );
+#endif
+
 uint32_t sysUpTime( void );
 
 /* Parses a varbind string into the global response buffer and returns its length. */
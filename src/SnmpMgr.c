@@ -78,10 +78,10 @@
 #endif
 
 #include "SnmpMgr.h"
+#include "resolver.h"
 
-int snmpfd;
-struct sockaddr_in cliaddr;
-char hostIpAddr[16], remoteIpAddr[16], remoteCommunity[COMM_STR_SIZE];
+int snmpfd, snmpFamily;
+char hostIpAddr[IP_STR_SIZE], remoteIpAddr[IP_STR_SIZE], remoteCommunity[COMM_STR_SIZE];
 struct messageStruct request, response, vblist;
 unsigned char errorStatus = 0, errorIndex = 0;
 unsigned int reqId = 1;
@@ -89,31 +89,18 @@ unsigned char requestBuffer[REQUEST_BUFFER_SIZE], responseBuffer[RESPONSE_BUFFER
 	vbBuffer[VB_BUFFER_SIZE];
 Boolean debug = FALSE;
 
-int gethostaddr( char *hostname, struct sockaddr_in *sin )
+/* Resolves through the default resolver of resolver.h, which caches the
+   addresses of host names. */
+int gethostaddr( char *hostname, struct sockaddr_storage *addr )
 {
-	struct hostent *he;
-	char machine_name[ 32 ];
-
-	if (hostname == NULL || hostname[0] == '\x00')
-	{
-		if (gethostname (machine_name, sizeof (machine_name)))
-			return FAIL;
-	}
-	else
-		strcpy(machine_name, hostname);
-	he = gethostbyname (machine_name);
-	if (he == NULL) return FAIL;
-	memset (sin, 0, sizeof (struct sockaddr_in));
-	sin->sin_family = AF_INET;
-	memmove (&sin->sin_addr, he->h_addr_list[ 0 ], he->h_length);
-	return SUCCESS;
+	return resolve(NULL, hostname, addr);
 }
 
 /* Initialise SNMP manager. Set port to 0 for ephemeral.
    Returns socket fd or -1 if fail. */
 int initSnmpMgr( int port )
 {
-	struct sockaddr_in servaddr;
+	struct sockaddr_storage servaddr;
 #ifdef _WIN32
 	WSADATA wsaData;
 	if (WSAStartup(MAKEWORD(2, 0), &wsaData) != 0) {
@@ -127,21 +114,17 @@ int initSnmpMgr( int port )
 	response.buffer = responseBuffer; response.size = RESPONSE_BUFFER_SIZE;
 	vblist.buffer = vbBuffer; vblist.size = VB_BUFFER_SIZE;
 	vblistReset(&vblist);
-  gethostaddr( NULL, &servaddr ); inet_ntop(AF_INET, &(servaddr.sin_addr), hostIpAddr, 16);
+  gethostaddr( NULL, &servaddr ); sockaddrntop((struct sockaddr *)&servaddr, hostIpAddr);
 	if (debug)
 #ifdef _WIN32
 		printf ("Local Windows system host address is %s\n", hostIpAddr);
 #else
 		printf ("Local system host address is %s\n", hostIpAddr);
 #endif
-	snmpfd = socket(PF_INET, SOCK_DGRAM, 0);
-	cliaddr.sin_family = AF_INET;
-	cliaddr.sin_addr.s_addr = INADDR_ANY;
-	cliaddr.sin_port = htons(port);
-	if (bind(snmpfd, (struct sockaddr *)&cliaddr, sizeof(cliaddr)) == 0)
-		return snmpfd;
-	else
-		return -1;
+	/* One socket for both IPv6 and IPv4 agents */
+	if ((snmpfd = sockopen(port, FALSE)) < 0) return -1;
+	snmpFamily = sockfamily(snmpfd);
+	return snmpfd;
 }
 
 void exitSnmpMgr( void )
@@ -199,8 +182,9 @@ int reqBuild(struct messageStruct *req, unsigned char reqType, unsigned int reqI
 int reqSend(struct messageStruct *req, struct messageStruct *resp,
 	char *dst, uint16_t port_no, char *comm_str, int time_out)
 {
-	struct sockaddr_in to;
-	char dstAddr[16];
+	struct sockaddr_storage to, mapped, from;
+	struct sockaddr *dstaddr;
+	char dstAddr[IP_STR_SIZE];
 #ifdef _WIN32
 	int fromlen;
 #else
@@ -208,7 +192,7 @@ int reqSend(struct messageStruct *req, struct messageStruct *resp,
 	fd_set readfds;
 	struct timeval tv;
 #endif
-	struct sockaddr from;
+	socklen_t tolen;
 
 	int len = strlen(comm_str);
 	memcopy(req->buffer+7+len, req->buffer, req->len);
@@ -233,7 +217,6 @@ int reqSend(struct messageStruct *req, struct messageStruct *resp,
 	req->len = ( 1 + insertRespLen(req, 0, req, 0, req->len) + req->len );
 
 	fromlen = sizeof(from);
-	to.sin_family = AF_INET;
 	if (gethostaddr(dst, &to)==SUCCESS) {
 #ifdef _WIN32
 		time_out *= 1000;
@@ -243,14 +226,16 @@ int reqSend(struct messageStruct *req, struct messageStruct *resp,
 		FD_SET ( snmpfd, &readfds );
 		tv.tv_sec = time_out; tv.tv_usec = 0;
 #endif
-		to.sin_port = htons(port_no);
+		sockaddrsetport((struct sockaddr *)&to, port_no);
+		dstaddr = sockaddrmap(snmpFamily, (struct sockaddr *)&to, &mapped, &tolen);
 		if (debug) {
-			getsockname(snmpfd, &from, &fromlen);
-      inet_ntop(AF_INET, &(to.sin_addr), dstAddr, 16);
-			printf("Send request to %s from port %u:", dstAddr, ntohs(((struct sockaddr_in *)&from)->sin_port));
+			getsockname(snmpfd, (struct sockaddr *)&from, &fromlen);
+			sockaddrntop((struct sockaddr *)&to, dstAddr);
+			printf("Send request to %s from port %u:", dstAddr, sockaddrport((struct sockaddr *)&from));
 			showMessage(req);
+			fromlen = sizeof(from);
 		}
-		sendto(snmpfd, req->buffer, req->len, 0, (struct sockaddr *)&to, sizeof(to));
+		sendto(snmpfd, req->buffer, req->len, 0, dstaddr, tolen);
 		resp->len = 0;
 #ifdef _WIN32
 #else
@@ -260,8 +245,9 @@ int reqSend(struct messageStruct *req, struct messageStruct *resp,
 		}
 		if (FD_ISSET(snmpfd, &readfds))
 #endif
-		resp->len = recvfrom(snmpfd, resp->buffer, RESPONSE_BUFFER_SIZE, 0, &from, &fromlen);
+		resp->len = recvfrom(snmpfd, resp->buffer, RESPONSE_BUFFER_SIZE, 0, (struct sockaddr *)&from, &fromlen);
 		if (resp->len > 0) {
+			sockaddrntop((struct sockaddr *)&from, remoteIpAddr);
 			if (debug) {
 				printf("Response:");
 				showMessage(resp);
@@ -273,60 +259,32 @@ int reqSend(struct messageStruct *req, struct messageStruct *resp,
 	return FAIL;
 }
 
+/* Copies the community string and varbind list of a decoded message. */
+static int copyMessage(MSGVIEW *msg, char *comm_str, struct messageStruct *vblist)
+{
+	if (msg->communityLen >= COMM_STR_SIZE || msg->vblistLen > vblist->size)
+		return FAIL;
+	memcopy((unsigned char *)comm_str, msg->community, msg->communityLen);
+	comm_str[msg->communityLen] = 0;
+	vblist->index = 0;
+	vblist->len = msg->vblistLen;
+	memcopy(vblist->buffer, msg->vblistTlv, vblist->len);
+	return SUCCESS;
+}
+
 /* Parses a SNMP response. Returns Success(0) or Fail(-1). */
 int parseResponse(struct messageStruct *resp, char *comm_str, unsigned int *reqId,
 	unsigned char *errorStatus, unsigned char *errorIndex, struct messageStruct *vblist)
 {
-	tlvStructType tlv;
+	MSGVIEW msg;
 
-	if (parseTLV(resp->buffer, 0, &tlv) != SUCCESS ||
-		resp->buffer[tlv.start] != SEQUENCE_OF)
-		return FAIL;
-	/* SNMP version */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != INTEGER || 
-		tlv.len != 1 || 
-		resp->buffer[tlv.vstart] != 0) 
-		return FAIL;
-	/* Community string */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != OCTET_STRING) 
-		return FAIL;
-	else {
-		memcopy((unsigned char *)comm_str, resp->buffer+tlv.vstart, tlv.len);
-		comm_str[tlv.len] = 0;
-	}
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) != SUCCESS ||
-		resp->buffer[tlv.start] != GET_RESPONSE)
-		return FAIL;
-	/* Request ID */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != INTEGER)
-		return FAIL;
-	else
-		*reqId = getValue(resp->buffer+tlv.vstart, tlv.len, INTEGER);
-	/* Error status */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != INTEGER)
-		return FAIL;
-	else
-		*errorStatus = getValue(resp->buffer+tlv.vstart, tlv.len, INTEGER);
-	/* Error index */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != INTEGER)
-		return FAIL;
-	else
-		*errorIndex = getValue(resp->buffer+tlv.vstart, tlv.len, INTEGER);
-	/* Varbind list */ 
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != SEQUENCE_OF)
+	if (msgView(resp->buffer, resp->len, &msg, NULL, 0) != SUCCESS ||
+		msg.version != SNMP_V1 || msg.pduType != GET_RESPONSE)
 		return FAIL;
-	else {
-		vblist->index = 0;
-		vblist->len = tlv.vstart - tlv.start + tlv.len;
-		memcopy(vblist->buffer, resp->buffer+tlv.start, vblist->len);
-	}
-	return SUCCESS;
+	*reqId = msg.reqId;
+	*errorStatus = msg.errorStatus;
+	*errorIndex = msg.errorIndex;
+	return copyMessage(&msg, comm_str, vblist);
 }
 
 /* Parses a SNMP trap. Returns Success(0) or Fail(-1). */
@@ -334,69 +292,16 @@ int parseTrap(struct messageStruct *resp, char *comm_str, OID *entoid,
 	char *agentaddr, unsigned int *gen, unsigned int *spec, unsigned int *timestamp,
 	struct messageStruct *vblist)
 {
-	tlvStructType tlv;
+	MSGVIEW msg;
 
-	if (parseTLV(resp->buffer, 0, &tlv) != SUCCESS ||
-		resp->buffer[tlv.start] != SEQUENCE_OF)
-		return FAIL;
-	/* SNMP version */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != INTEGER || 
-		tlv.len != 1 || 
-		resp->buffer[tlv.vstart] != 0) 
-		return FAIL;
-	/* Community string */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != OCTET_STRING) 
-		return FAIL;
-	else {
-		memcopy((unsigned char *)comm_str, resp->buffer+tlv.vstart, tlv.len);
-		comm_str[tlv.len] = 0;
-	}
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) != SUCCESS ||
-		resp->buffer[tlv.start] != TRAP_PACKET)
-		return FAIL;
-	/* Enterprise OID */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != OBJECT_IDENTIFIER)
-		return FAIL;
-	else
-		ber2oid(resp->buffer+tlv.vstart, tlv.len, entoid);
-	/* Agent IP Address */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != IP_ADDRESS || tlv.len != 4)
+	if (msgView(resp->buffer, resp->len, &msg, NULL, 0) != SUCCESS ||
+		msg.version != SNMP_V1 || msg.pduType != TRAP_PACKET)
 		return FAIL;
-	else {
-		sprintf(agentaddr, "%d.%d.%d.%d", resp->buffer[tlv.vstart],
-			resp->buffer[tlv.vstart+1], resp->buffer[tlv.vstart+2],
-			resp->buffer[tlv.vstart+3]);
-	}
-	/* Generic trap number */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != INTEGER)
-		return FAIL;
-	else
-		*gen = getValue(resp->buffer+tlv.vstart, tlv.len, INTEGER);
-	/* Specific trap number list */ 
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != INTEGER)
-		return FAIL;
-	else
-		*spec = getValue(resp->buffer+tlv.vstart, tlv.len, INTEGER);
-	/* Time stamp */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != TIMETICKS)
-		return FAIL;
-	else
-		*timestamp = getValue(resp->buffer+tlv.vstart, tlv.len, TIMETICKS);
-	/* Varbind list */
-	if (parseTLV(resp->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-		resp->buffer[tlv.start] != SEQUENCE_OF)
-		return FAIL;
-	else {
-		vblist->index = 0;
-		vblist->len = tlv.vstart - tlv.start + tlv.len;
-		memcopy(vblist->buffer, resp->buffer+tlv.start, vblist->len);
-	}
-	return SUCCESS;
+	ber2oid(msg.enterprise, msg.enterpriseLen, entoid);
+	sprintf(agentaddr, "%d.%d.%d.%d", msg.agentAddr[0], msg.agentAddr[1],
+		msg.agentAddr[2], msg.agentAddr[3]);
+	*gen = msg.generic;
+	*spec = msg.specific;
+	*timestamp = msg.timestamp;
+	return copyMessage(&msg, comm_str, vblist);
 }
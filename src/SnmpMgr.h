@@ -87,7 +87,8 @@ void exitSnmpMgr( void );
 int reqBuild(struct messageStruct *req, unsigned char reqType, unsigned int reqId,
 	struct messageStruct *vblist);
 
-/* Sends a SNMP request and wait for a response. Returns Success(0) or Fail(-1). */
+/* Sends a SNMP request and wait for a response, noting in remoteIpAddr where it
+   came from. Returns Success(0) or Fail(-1). */
 int reqSend(struct messageStruct *req, struct messageStruct *resp,
 	char *dst, uint16_t port_no, char *comm_str, int time_out);
 
@@ -0,0 +1,320 @@
+/*
+ * Access control list of the network managers allowed to query an agent, with
+ * their community strings, loaded from a keylist file.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+#include "acl.h"
+
+#define BUF_SIZE 256
+
+/* Parses an IPv4 or IPv6 address, with an optional prefix length, into addr
+   and bits. An IPv4 address is kept IPv4-mapped, its prefix 96 bits longer.
+   Returns Success(0) or Fail(-1). */
+static int aclparse(char *s, unsigned char *addr, int *bits)
+{
+	char buf[IP_STR_SIZE], *p;
+	int i, n, max = 128;
+
+	if ((n = strcspn(s, "/")) >= IP_STR_SIZE) return FAIL;
+	memcopy((unsigned char *)buf, (unsigned char *)s, n);
+	buf[n] = '\0';
+	memset(addr, 0, 16);
+	if (inet_pton(AF_INET, buf, addr+12) == 1) {
+		addr[10] = addr[11] = 0xFF;
+		max = 32;
+	}
+	else if (inet_pton(AF_INET6, buf, addr) != 1)
+		return FAIL;
+	if (s[n] == '/') {
+		for (p = s+n+1, *bits = 0; *p >= '0' && *p <= '9' && *bits <= max; p++)
+			*bits = *bits*10 + (*p - '0');
+		if (*bits > max || p == s+n+1 || *p != '\0') return FAIL;
+		*bits += 128 - max;
+	}
+	else {  /* 0.0.0.0, or ::, stands for all others */
+		for (i = 128 - max; i < 128 && addr[i/8] == 0; i += 8);
+		*bits = i < 128 ? 128 : 0;
+	}
+	for (i = 0; i < 16; i++)  /* Clear the host bits */
+		if (*bits <= i*8) addr[i] = 0;
+		else if (*bits < (i+1)*8) addr[i] &= 0xFF << ((i+1)*8 - *bits);
+	return SUCCESS;
+}
+
+/* Returns TRUE if s is a host name, of letters, digits, dots and hyphens */
+static Boolean aclisname(char *s)
+{
+	if (*s == '\0' || *s == '.' || *s == '-') return FALSE;
+	for ( ; *s; s++)
+		if (!((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') ||
+			(*s >= '0' && *s <= '9') || *s == '.' || *s == '-'))
+			return FALSE;
+	return TRUE;
+}
+
+static int aclhash(ACLTABLE *t, unsigned char *addr, int bits)
+{
+	uint32_t h = 2166136261U;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		h = (h ^ addr[i]) * 16777619U;
+	h = (h + bits) * 2654435761U;
+	return (h ^ (h >> 16)) & (t->nslot - 1);
+}
+
+/* Returns the entry of the longest prefix listed that holds addr, NULL if none */
+static ACLENTRY *aclfind(ACLTABLE *t, unsigned char *addr)
+{
+	ACLENTRY *e;
+	unsigned char net[16];
+	int bits, i;
+
+	memcopy(net, addr, 16);
+	for (bits = 128; bits >= 0; bits--) {
+		if (bits < 128)  /* Clear the next host bit */
+			net[bits/8] &= 0xFF << (8 - bits%8);
+		if (!(t->prefixes[bits/64] & ((uint64_t)1 << (bits%64)))) continue;
+		for (i = aclhash(t, net, bits); t->slot[i]; i = (i+1) & (t->nslot-1)) {
+			e = &t->entry[t->slot[i]-1];
+			if (e->bits == bits && memcmp(e->addr, net, 16) == 0) return e;
+		}
+	}
+	return NULL;
+}
+
+static void acltablefree(ACLTABLE *t)
+{
+	if (t) {
+		free(t->entry);
+		free(t->slot);
+		free(t);
+	}
+}
+
+/* Builds a table of the entries in keylist */
+static ACLTABLE *acltablenew(LIST *keylist)
+{
+	ACLTABLE *t;
+	ACLENTRY *e;
+	KEY *key;
+	int i, n = keylistsize(keylist);
+
+	if ((t = (ACLTABLE *)malloc(sizeof(ACLTABLE))) == NULL) return NULL;
+	for (t->nslot = 8; t->nslot < 2*n; t->nslot <<= 1)
+		;
+	t->entry = (ACLENTRY *)malloc((n ? n : 1) * sizeof(ACLENTRY));
+	t->slot = (int *)calloc(t->nslot, sizeof(int));
+	if (t->entry == NULL || t->slot == NULL) {
+		acltablefree(t);
+		return NULL;
+	}
+	t->size = 0;
+	memset(t->prefixes, 0, sizeof(t->prefixes));
+	for (key = keylistgohead(keylist); key; key = keylistgonext(keylist)) {
+		e = &t->entry[t->size];
+		if (aclparse(key->key, e->addr, &e->bits) == FAIL) {
+			if (!aclisname(key->key)) continue;
+			memset(e->addr, 0, 16);
+			e->bits = ACL_HOSTNAME;
+		}
+		strcpy(e->key, key->key);
+		e->roCommunity[0] = e->rwCommunity[0] = e->trapCommunity[0] = '\0';
+		sscanf(key->val, "%15[^,],%15[^,],%15s", e->roCommunity, e->rwCommunity, e->trapCommunity);
+		if (e->bits == ACL_HOSTNAME) {  /* A manager to send traps to, not looked up */
+			t->size++;
+			continue;
+		}
+		for (i = aclhash(t, e->addr, e->bits); t->slot[i]; i = (i+1) & (t->nslot-1))
+			if (t->entry[t->slot[i]-1].bits == e->bits && memcmp(t->entry[t->slot[i]-1].addr, e->addr, 16) == 0)
+				break;
+		if (t->slot[i]) {  /* The same network given twice, the last applies */
+			t->entry[t->slot[i]-1] = *e;
+			continue;
+		}
+		t->slot[i] = ++t->size;
+		t->prefixes[e->bits/64] |= (uint64_t)1 << (e->bits%64);
+	}
+	return t;
+}
+
+ACL *aclnew(char *fn)
+{
+	ACL *a;
+	LIST *keylist;
+
+	if ((a = (ACL *)malloc(sizeof(ACL))) == NULL) return NULL;
+	if ((a->fn = (char *)malloc(strlen(fn)+1)) == NULL) {
+		free(a);
+		return NULL;
+	}
+	strcpy(a->fn, fn);
+#ifndef _WIN32
+	pthread_rwlock_init(&a->lock, NULL);
+#endif
+#ifdef __linux__
+	a->wd = -1;
+	a->name = strrchr(a->fn, '/') ? strrchr(a->fn, '/')+1 : a->fn;
+#endif
+	a->table = NULL;
+	if (aclread(a) == FAIL) {  /* Start empty, denying all */
+		if ((keylist = keylistnew()) != NULL) {
+			a->table = acltablenew(keylist);
+			keylistfree(keylist);
+		}
+		if (a->table == NULL) {
+			aclfree(a);
+			return NULL;
+		}
+	}
+	return a;
+}
+
+void aclfree(ACL *a)
+{
+	acltablefree(a->table);
+#ifndef _WIN32
+	pthread_rwlock_destroy(&a->lock);
+#endif
+	free(a->fn);
+	free(a);
+}
+
+int aclread(ACL *a)
+{
+	LIST *keylist;
+	ACLTABLE *t, *old;
+
+	if ((keylist = keylistnew()) == NULL) return FAIL;
+	if (keylistread(keylist, a->fn) == FAIL || (t = acltablenew(keylist)) == NULL) {
+		keylistfree(keylist);
+		return FAIL;
+	}
+	keylistfree(keylist);
+#ifndef _WIN32
+	pthread_rwlock_wrlock(&a->lock);
+#endif
+	old = a->table;
+	a->table = t;
+#ifndef _WIN32
+	pthread_rwlock_unlock(&a->lock);
+#endif
+	acltablefree(old);
+	return t->size;
+}
+
+Boolean aclcheck(ACL *a, char *ipaddr, char *commstr, int reqtype)
+{
+	ACLENTRY *e;
+	unsigned char addr[16];
+	int bits;
+	Boolean ok;
+
+	if (aclparse(ipaddr, addr, &bits) == FAIL) memset(addr, 0, 16);
+#ifndef _WIN32
+	pthread_rwlock_rdlock(&a->lock);
+#endif
+	ok = (e = aclfind(a->table, addr)) != NULL && commstr[0] != '\0' &&
+		(strcmp(commstr, e->rwCommunity) == 0 ||
+		(reqtype != SET_REQUEST && strcmp(commstr, e->roCommunity) == 0));
+#ifndef _WIN32
+	pthread_rwlock_unlock(&a->lock);
+#endif
+	return ok;
+}
+
+int aclwalk(ACL *a, int (*func)(ACLENTRY *e, void *arg), void *arg)
+{
+	int i;
+
+#ifndef _WIN32
+	pthread_rwlock_rdlock(&a->lock);
+#endif
+	for (i = 0; i < a->table->size; )
+		if (func(&a->table->entry[i++], arg)) break;
+#ifndef _WIN32
+	pthread_rwlock_unlock(&a->lock);
+#endif
+	return i;
+}
+
+#ifdef __linux__
+int aclwatch(ACL *a)
+{
+	char dir[BUF_SIZE];
+	int fd;
+
+	/* Watch the directory, as editors often replace the file by another */
+	if (a->name == a->fn)
+		strcpy(dir, ".");
+	else
+		snprintf(dir, sizeof(dir), "%.*s", (int)(a->name - a->fn - 1), a->fn);
+	if ((fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) return FAIL;
+	if ((a->wd = inotify_add_watch(fd, dir[0] ? dir : "/", IN_CLOSE_WRITE | IN_MOVED_TO)) < 0) {
+		close(fd);
+		return FAIL;
+	}
+	return fd;
+}
+
+void aclnotify(int fd, void *arg)
+{
+	ACL *a = (ACL *)arg;
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *ev;
+	Boolean changed = FALSE;
+	ssize_t n;
+	char *p;
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		for (p = buf; p < buf + n; p += sizeof(struct inotify_event) + ev->len) {
+			ev = (struct inotify_event *)p;
+			if (ev->wd == a->wd && ev->len && strcmp(ev->name, a->name) == 0)
+				changed = TRUE;
+		}
+	if (changed) aclread(a);
+}
+#endif
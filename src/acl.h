@@ -0,0 +1,138 @@
+/*
+ * Access control list of the network managers allowed to query an agent, with
+ * their community strings, loaded from a keylist file.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+acl.c loads the agent's configuration file of authorised managers, in the
+keylist format <IP address>=<RO community>,<RW community>,<Trap community>,
+into a hash table, so that the community string of a request is checked
+without reading the file. An address may be IPv4 or IPv6, and a subnet,
+e.g. 192.168.1.0/24 or 2001:db8::/32, and the longest prefix that matches
+the requester applies. 0.0.0.0, or ::, stands for all others, as ::/0 does;
+0.0.0.0/0 stands for all other IPv4 requesters. A host name is kept as an
+entry of ACL_HOSTNAME bits, a manager to send traps to, which no requester
+matches, as its address is not known here. IPv4 addresses are kept
+IPv4-mapped, ::ffff:a.b.c.d, so that a prefix of either family is matched
+in one table. The table is replaced as a whole when the
+file is read again, and may be used meanwhile by other threads.
+
+ACL *aclnew(char *fn);
+	Instantiate an access control list of the file fn, and read it. Returns
+	NULL if fail. A file that cannot be read leaves the list empty, denying
+	all requests.
+
+void aclfree(ACL *a);
+	Free the access control list.
+
+int aclread(ACL *a);
+	Read the file again, and replace the list if it is read. Returns the
+	number of entries, or Fail(-1) with the list unchanged.
+
+Boolean aclcheck(ACL *a, char *ipaddr, char *commstr, int reqtype);
+	Returns TRUE if commstr is the RW community string of the entry of ipaddr,
+	as in ctx->remoteIpAddr, or its RO community string and reqtype is not
+	SET_REQUEST. An empty commstr is never accepted.
+
+int aclwalk(ACL *a, int (*func)(ACLENTRY *e, void *arg), void *arg);
+	Calls func for each entry in the order of the file, until func returns
+	non-zero. Returns the number of entries visited.
+
+int aclwatch(ACL *a);
+	Linux only. Returns an inotify descriptor that turns readable when the
+	file is written or replaced, or Fail(-1). It may be passed with the list
+	to evloopaddfd() and aclnotify().
+
+void aclnotify(int fd, void *arg);
+	Linux only. Consumes the events of the descriptor fd of aclwatch(), and
+	reads the file of the list arg again if it changed.
+*/
+
+#ifndef _ACL_H
+#define _ACL_H
+
+#include <stdint.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#include "keylist.h"
+#include "SnmpAgent.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ACL_HOSTNAME (-1)  /* bits of an entry of a host name */
+
+typedef struct {
+	char key[KEY_SIZE];  /* As in the file */
+	unsigned char addr[16];  /* Network address, IPv4 mapped */
+	int bits;  /* Prefix length, of the 128 bits, or ACL_HOSTNAME */
+	char roCommunity[COMM_STR_SIZE], rwCommunity[COMM_STR_SIZE], trapCommunity[COMM_STR_SIZE];
+} ACLENTRY;
+
+typedef struct {
+	int size;
+	ACLENTRY *entry;  /* In the order of the file */
+	int nslot;  /* A power of 2 */
+	int *slot;  /* Index of entry + 1, 0 if empty */
+	uint64_t prefixes[3];  /* Bit n set if a prefix of length n is listed */
+} ACLTABLE;
+
+typedef struct {
+	char *fn;
+	ACLTABLE *table;
+#ifndef _WIN32
+	pthread_rwlock_t lock;
+#endif
+#ifdef __linux__
+	int wd;  /* inotify watch of the directory of fn */
+	char *name;  /* Base name of fn */
+#endif
+} ACL;
+
+ACL *aclnew(char *fn);
+void aclfree(ACL *a);
+int aclread(ACL *a);
+Boolean aclcheck(ACL *a, char *ipaddr, char *commstr, int reqtype);
+int aclwalk(ACL *a, int (*func)(ACLENTRY *e, void *arg), void *arg);
+#ifdef __linux__
+int aclwatch(ACL *a);
+void aclnotify(int fd, void *arg);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
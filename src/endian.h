@@ -30,8 +30,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef _ENDIAN_H
-#define _ENDIAN_H
+#ifndef _USNMP_ENDIAN_H
+#define _USNMP_ENDIAN_H
 
 #include <stdint.h>
 
@@ -0,0 +1,187 @@
+/*
+ * Implements a single-threaded event loop for the agent on Linux.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifdef __linux__
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include "evloop.h"
+
+#define EV_EVENTS 16  /* Events taken per wait */
+
+EVLOOP *evloopnew(void)
+{
+	EVLOOP *l;
+
+	if ((l = (EVLOOP *)malloc(sizeof(EVLOOP))) == NULL) return NULL;
+	if ((l->epfd = epoll_create1(0)) < 0) {
+		free(l);
+		return NULL;
+	}
+	l->stop = FALSE;
+	l->watch = NULL;
+	return l;
+}
+
+void evloopfree(EVLOOP *l)
+{
+	EVWATCH *w;
+
+	while ((w = l->watch) != NULL) {
+		l->watch = w->next;
+		if (w->type == EV_TIMER) close(w->fd);
+		free(w);
+	}
+	close(l->epfd);
+	free(l);
+}
+
+static EVWATCH *evloopwatch(EVLOOP *l, int fd, int type, void *arg)
+{
+	EVWATCH *w;
+	struct epoll_event ev;
+
+	if ((w = (EVWATCH *)calloc(1, sizeof(EVWATCH))) == NULL) return NULL;
+	w->fd = fd; w->type = type; w->arg = arg;
+	ev.events = EPOLLIN;
+	ev.data.ptr = w;
+	if (epoll_ctl(l->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+		free(w);
+		return NULL;
+	}
+	w->next = l->watch;
+	l->watch = w;
+	return w;
+}
+
+int evloopaddagent(EVLOOP *l, SnmpAgentCtx *ctx, void (*func)(SnmpAgentCtx *ctx, int result))
+{
+	EVWATCH *w;
+
+	if (fcntl(ctx->snmpfd, F_SETFL, fcntl(ctx->snmpfd, F_GETFL) | O_NONBLOCK) != 0 ||
+		(w = evloopwatch(l, ctx->snmpfd, EV_AGENT, ctx)) == NULL)
+		return FAIL;
+	w->agent = func;
+	return SUCCESS;
+}
+
+int evloopaddfd(EVLOOP *l, int fd, void (*func)(int fd, void *arg), void *arg)
+{
+	EVWATCH *w;
+
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0 ||
+		(w = evloopwatch(l, fd, EV_FD, arg)) == NULL)
+		return FAIL;
+	w->func = func;
+	return SUCCESS;
+}
+
+int evloopaddtimer(EVLOOP *l, int mSec, void (*func)(void *arg), void *arg)
+{
+	EVWATCH *w;
+	struct itimerspec its;
+	int fd;
+
+	if ((fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK)) < 0) return FAIL;
+	its.it_interval.tv_sec = its.it_value.tv_sec = mSec / 1000;
+	its.it_interval.tv_nsec = its.it_value.tv_nsec = (mSec % 1000) * 1000000L;
+	if (timerfd_settime(fd, 0, &its, NULL) != 0 ||
+		(w = evloopwatch(l, fd, EV_TIMER, arg)) == NULL) {
+		close(fd);
+		return FAIL;
+	}
+	w->timer = func;
+	return fd;
+}
+
+int evloopdel(EVLOOP *l, int fd)
+{
+	EVWATCH *w, **p;
+
+	for (p = &l->watch; (w = *p) != NULL; p = &w->next)
+		if (w->fd == fd) {
+			epoll_ctl(l->epfd, EPOLL_CTL_DEL, fd, NULL);
+			if (w->type == EV_TIMER) close(fd);
+			*p = w->next;
+			free(w);
+			return SUCCESS;
+		}
+	return FAIL;
+}
+
+int evlooprun(EVLOOP *l)
+{
+	struct epoll_event ev[EV_EVENTS];
+	EVWATCH *w;
+	uint64_t expired;
+	int i, j, k, n, result[SNMP_BATCH_SIZE];
+
+	l->stop = FALSE;
+	while (!l->stop) {
+		if ((n = epoll_wait(l->epfd, ev, EV_EVENTS, -1)) < 0) {
+			if (errno == EINTR) continue;
+			return FAIL;
+		}
+		for (i = 0; i < n; i++) {
+			w = (EVWATCH *)ev[i].data.ptr;
+			switch (w->type) {
+				case EV_AGENT:
+					/* One batch per wakeup, so that timers are not starved */
+					k = processSNMPBatchCtx((SnmpAgentCtx *)w->arg, result);
+					if (w->agent)
+						for (j = 0; j < k; j++) w->agent((SnmpAgentCtx *)w->arg, result[j]);
+					break;
+				case EV_TIMER:
+					if (read(w->fd, &expired, sizeof(expired)) == sizeof(expired))
+						w->timer(w->arg);
+					break;
+				default:
+					w->func(w->fd, w->arg);
+			}
+		}
+	}
+	return SUCCESS;
+}
+
+void evloopstop(EVLOOP *l)
+{
+	l->stop = TRUE;
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*
+ * Implements a single-threaded event loop for the agent on Linux.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+The event loop waits on epoll for the agent's sockets, timers and any other
+file descriptors registered by the application, and calls their handlers in
+turn on the one thread. Periodic work thus runs between requests, never in
+the middle of one, and needs no signal handler or lock. Sockets are set
+non-blocking, and timers are timerfd's. Only Linux is supported.
+
+EVLOOP *evloopnew(void);
+	Instantiate an event loop with nothing to watch. Returns NULL if fail.
+
+void evloopfree(EVLOOP *l);
+	Free the event loop, closing its timers but not the other descriptors.
+
+int evloopaddagent(EVLOOP *l, SnmpAgentCtx *ctx, void (*func)(SnmpAgentCtx *ctx, int result));
+	Serves the requests arriving at the socket of ctx, in batches. func, if
+	not NULL, is called with the result of each request, e.g. to send a trap
+	on COMM_STR_MISMATCH. Returns Success(0) or Fail(-1).
+
+int evloopaddfd(EVLOOP *l, int fd, void (*func)(int fd, void *arg), void *arg);
+	Calls func whenever fd is readable. Returns Success(0) or Fail(-1).
+
+int evloopaddtimer(EVLOOP *l, int mSec, void (*func)(void *arg), void *arg);
+	Calls func every mSec milliseconds. Returns the timer's descriptor, which
+	may be passed to evloopdel(), or Fail(-1).
+
+int evloopdel(EVLOOP *l, int fd);
+	Stops watching fd, closing it if it is a timer. Returns Success(0) or Fail(-1).
+	A handler may stop watching its own descriptor, but not another's.
+
+int evlooprun(EVLOOP *l);
+	Waits for events and calls their handlers until evloopstop() is called.
+	Returns Success(0), or Fail(-1) if waiting fails.
+
+void evloopstop(EVLOOP *l);
+	Makes evlooprun() return after the handlers of the current events.
+*/
+
+#ifndef _EVLOOP_H
+#define _EVLOOP_H
+
+#include "SnmpAgent.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EV_FD    0
+#define EV_TIMER 1
+#define EV_AGENT 2
+
+typedef struct evwatch {
+	int fd;
+	int type;  /* EV_FD, EV_TIMER or EV_AGENT */
+	void (*func)(int fd, void *arg);
+	void (*timer)(void *arg);
+	void (*agent)(SnmpAgentCtx *ctx, int result);
+	void *arg;
+	struct evwatch *next;
+} EVWATCH;
+
+typedef struct {
+	int epfd;
+	Boolean stop;
+	EVWATCH *watch;
+} EVLOOP;
+
+EVLOOP *evloopnew(void);
+void evloopfree(EVLOOP *l);
+int evloopaddagent(EVLOOP *l, SnmpAgentCtx *ctx, void (*func)(SnmpAgentCtx *ctx, int result));
+int evloopaddfd(EVLOOP *l, int fd, void (*func)(int fd, void *arg), void *arg);
+int evloopaddtimer(EVLOOP *l, int mSec, void (*func)(void *arg), void *arg);
+int evloopdel(EVLOOP *l, int fd);
+int evlooprun(EVLOOP *l);
+void evloopstop(EVLOOP *l);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
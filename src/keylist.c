@@ -41,6 +41,7 @@
 char *strtrim(char *s);
 
 #define BUF_SIZE 256
+#define KEYLIST_CHUNK (16*(sizeof(KEY)+sizeof(NODE)))
 
 char *strtrim(char *s)
 {
@@ -67,8 +68,10 @@ char *strtrim(char *s)
 LIST *keylistnew()
 {
 	LIST *keylist;
-	if ((keylist=listnew(sizeof(KEY), 0)))
+	if ((keylist=listnew(sizeof(KEY), 0))) {
+		listsetpool(keylist, mempoolslab(KEYLIST_CHUNK));  /* Else of the heap */
 		return keylist;
+	}
 	else
 		return (LIST *) NULL;
 }
@@ -80,8 +83,11 @@ void keylistclear(LIST *keylist)
 
 void keylistfree(LIST *keylist)
 {
+	MEMPOOL *pool = keylist->pool;
+
 	keylistclear(keylist);
 	listfree(keylist);
+	if (pool) mempoolfree(pool);
 }
 
 int keyscan(char *buf, char *key, char *val)
@@ -89,10 +95,12 @@ int keyscan(char *buf, char *key, char *val)
 	int i, n, p = 0;
 
 	strtrim(buf);
-	/* First non-alphanum character indicates comment line */
-	if (!isalnum((int)buf[0])) return FAIL;
+	/* First non-alphanum character indicates comment line, but the colon
+	   of an IPv6 address such as ::1 */
+	if (!isalnum((int)buf[0]) && buf[0] != ':') return FAIL;
 	n = strlen(buf);
-	for (i = 0; buf[p]!='=' && p<n; i++, p++) key[i] = buf[p];
+	for (i = 0; buf[p]!='=' && p<n; p++)
+		if (i < KEY_SIZE-1) key[i++] = buf[p];
 	if (p == n)
 		return FAIL;
 	else
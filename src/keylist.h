@@ -30,7 +30,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-/* A keylist data file contains key-value pairs in the format <key>=<value>. */
+/* A keylist data file contains key-value pairs in the format <key>=<value>.
+   The keys of a keylist are allocated from a slab of mempool.h of its own,
+   freed with it by keylistfree(). */
 
 #ifndef _KEYLIST_H
 #define _KEYLIST_H
@@ -41,7 +43,7 @@
 extern "C" {
 #endif 
 
-#define KEY_SIZE 32
+#define KEY_SIZE 64  /* Holds an IPv6 subnet */
 #define VAL_SIZE 256
 
 typedef struct {
@@ -46,6 +46,7 @@ LIST *listnew(int datasize, int max)
 		l->eol = TRUE;
 		l->limit = max;  /* 0 for unlimited */
 		l->size = 0;
+		l->pool = NULL;
 		return l;
 	}
 	else
@@ -64,6 +65,11 @@ void listfree(LIST *l)
 	free(l);
 }
 
+void listsetpool(LIST *l, MEMPOOL *pool)
+{
+	l->pool = pool;
+}
+
 int listlimit(LIST *l)
 {
 	return l->limit;
@@ -84,10 +90,12 @@ void *listaddnode(LIST *l, int mode)
 	void *data;
 
 	if ((l->limit == 0 || l->size < l->limit) &&
-		(data=(void *)malloc(l->datasize)))
-		return listputnode(l, data, mode);
-	else
-		return NULL;
+		(data=memalloc(l->pool, l->datasize))) {
+		if (listputnode(l, data, mode))
+			return data;
+		memfree(l->pool, data, l->datasize);
+	}
+	return NULL;
 }
 
 void *listputnode(LIST *l, void *data, int mode)
@@ -95,7 +103,7 @@ void *listputnode(LIST *l, void *data, int mode)
 	NODE *n;
 
 	if ((l->limit == 0 || l->size < l->limit) &&
-		(n=(NODE *)malloc(sizeof(NODE)))) {
+		(n=(NODE *)memalloc(l->pool, sizeof(NODE)))) {
 		n->data = data;
 		if (l->head == NULL) {	/* empty list */
 			l->head = l->curr = n;
@@ -143,7 +151,7 @@ Boolean listdelnode(LIST *l)
 	if (l->curr == NULL)
 		return FALSE;
 	else {
-		free(l->curr->data);
+		memfree(l->pool, l->curr->data, l->datasize);
 		listcutnode(l);
 		return TRUE;
 	}
@@ -159,19 +167,19 @@ Boolean listcutnode(LIST *l)
 	else {
 		if (l->prev == NULL) {  /* first node */
 			l->head = l->curr = n->next;
-			free(n);
+			memfree(l->pool, n, sizeof(NODE));
 			if (l->head == NULL) l->eol = TRUE;  /* list is now empty */
 		}
 		else
 			if (n->next == NULL) {  /* last node */
 				l->prev->next = NULL;
 				l->curr = l->prev;
-				free(n);
+				memfree(l->pool, n, sizeof(NODE));
 				listgotail(l);  /* to set l->prev */
 			}
 			else {
 				l->curr = l->prev->next = n->next;
-				free(n);
+				memfree(l->pool, n, sizeof(NODE));
 			}
 		l->size--;
 		return TRUE;
@@ -188,7 +196,7 @@ void *listgetthis(LIST *l)
 
 void *listgetnext(LIST *l)
 {
-	if (l->curr == NULL)
+	if (l->curr == NULL || l->curr->next == NULL)
 		return NULL;
 	else
 		return l->curr->next->data;
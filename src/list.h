@@ -46,6 +46,12 @@ void listclear(LIST *l);
 void listfree(LIST *l);
 	Delete all nodes in the list and then free it.
 
+void listsetpool(LIST *l, MEMPOOL *pool);
+	Allocates the nodes of the empty list l, and their data buckets, from
+	pool, e.g. an arena of mempool.h for a list loaded and freed as a whole,
+	instead of the heap. Data put with listputnode() and later deleted with
+	listdelnode() must be from pool too.
+
 int listmax(LIST *l);
 	Returns the maximum number of nodes the list may have.
 
@@ -96,6 +102,7 @@ void *listgonext(LIST *l);
 #define _LIST_H
 
 #include "retval.h"
+#include "mempool.h"
 #ifndef Boolean
 #define Boolean signed char
 #endif
@@ -117,11 +124,13 @@ typedef struct {
 	Boolean eol;
 	int limit;
 	int size;
+	MEMPOOL *pool;  /* Of the nodes and data buckets, NULL for the heap */
 } LIST;
 
 LIST *listnew(int datasize, int max);
 void listclear(LIST *l);
 void listfree(LIST *l);
+void listsetpool(LIST *l, MEMPOOL *pool);
 int listlimit(LIST *l);
 int listsize(LIST *l);
 Boolean listeol(LIST *l);
@@ -0,0 +1,175 @@
+/*
+ * Allocates memory from pools: an arena for structures loaded and freed as a
+ * whole, and slabs of size classes for those added and deleted at run time.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "mempool.h"
+
+#define ROUND(size) (((size) + MEMPOOL_ALIGN-1) & ~(MEMPOOL_ALIGN-1))
+
+/* Takes a chunk of size bytes from the heap, and returns its space */
+static char *mempoolchunk(MEMPOOL *p, int size)
+{
+	MEMCHUNK *c;
+
+	if ((c = (MEMCHUNK *)malloc(sizeof(MEMCHUNK) + size)) == NULL)
+		return NULL;
+	c->next = p->chunks;
+	p->chunks = c;
+	p->heap += sizeof(MEMCHUNK) + size;
+	return (char *)(c + 1);
+}
+
+static void *arenaalloc(MEMPOOL *p, int size)
+{
+	char *block;
+
+	size = ROUND(size > 0 ? size : 1);
+	if (size > p->left) {
+		if (size > p->chunk / 4)  /* A chunk of its own, leaving the last one in use */
+			block = mempoolchunk(p, size);
+		else if ((block = mempoolchunk(p, p->chunk))) {
+			p->next = block + size;
+			p->left = p->chunk - size;
+		}
+		if (block == NULL) return NULL;
+	}
+	else {
+		block = p->next;
+		p->next += size;
+		p->left -= size;
+	}
+	p->used += size;
+	return block;
+}
+
+static void arenafree(MEMPOOL *p, void *ptr, int size)
+{
+	/* Taken back with the arena as a whole */
+	(void)p;
+	(void)ptr;
+	(void)size;
+}
+
+static void *slaballoc(MEMPOOL *p, int size)
+{
+	void **block;
+	int c;
+
+	size = ROUND(size > 0 ? size : 1);
+	if (size > MEMPOOL_MAX) {
+		if ((block = (void **)malloc(size)) == NULL) return NULL;
+		p->heap += size;
+	}
+	else if ((block = (void **)p->freelist[c = size/MEMPOOL_ALIGN - 1]))
+		p->freelist[c] = *block;
+	else
+		return arenaalloc(p, size);
+	p->used += size;
+	return block;
+}
+
+static void slabfree(MEMPOOL *p, void *ptr, int size)
+{
+	int c;
+
+	size = ROUND(size > 0 ? size : 1);
+	if (size > MEMPOOL_MAX) {
+		free(ptr);
+		p->heap -= size;
+	}
+	else {
+		c = size/MEMPOOL_ALIGN - 1;
+		*(void **)ptr = p->freelist[c];
+		p->freelist[c] = ptr;
+	}
+	p->used -= size;
+}
+
+static MEMPOOL *mempoolnew(int chunk)
+{
+	MEMPOOL *p;
+
+	if ((p = (MEMPOOL *)malloc(sizeof(MEMPOOL))) == NULL) return NULL;
+	memset(p, 0, sizeof(MEMPOOL));
+	p->chunk = chunk > 0 ? ROUND(chunk) : MEMPOOL_CHUNK;
+	return p;
+}
+
+MEMPOOL *mempoolarena(int chunk)
+{
+	MEMPOOL *p;
+
+	if ((p = mempoolnew(chunk))) {
+		p->alloc = arenaalloc;
+		p->free = arenafree;
+	}
+	return p;
+}
+
+MEMPOOL *mempoolslab(int chunk)
+{
+	MEMPOOL *p;
+
+	if ((p = mempoolnew(chunk))) {
+		p->alloc = slaballoc;
+		p->free = slabfree;
+	}
+	return p;
+}
+
+void mempoolfree(MEMPOOL *p)
+{
+	MEMCHUNK *c;
+
+	while ((c = p->chunks)) {
+		p->chunks = c->next;
+		free(c);
+	}
+	free(p);
+}
+
+void *memalloc(MEMPOOL *p, int size)
+{
+	return p ? p->alloc(p, size) : malloc(size);
+}
+
+void memfree(MEMPOOL *p, void *ptr, int size)
+{
+	if (p)
+		p->free(p, ptr, size);
+	else
+		free(ptr);
+}
@@ -0,0 +1,118 @@
+/*
+ * Allocates memory from pools: an arena for structures loaded and freed as a
+ * whole, and slabs of size classes for those added and deleted at run time.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+mempool.c takes memory from the heap in chunks, and hands it out in blocks,
+so that the many small nodes of a list or a MIB tree cost neither a malloc()
+each, nor its overhead, nor the fragmentation of the heap they leave, which
+on an ESP8266 or ESP32 may fail a malloc() with memory to spare.
+
+An arena hands out each block from the unused space of its last chunk, and
+never takes one back; its memory is returned as a whole by mempoolfree().
+It suits a structure loaded in bulk, such as a keylist read from a file.
+A slab keeps the blocks freed in a list for each size class, by multiples
+of MEMPOOL_ALIGN up to MEMPOOL_MAX bytes, and hands them out again before
+using the chunk. Larger blocks are taken from the heap one at a time.
+
+A pool is pluggable: its alloc and free functions may be replaced, e.g. to
+allocate from another heap. A NULL pool stands for the heap. A pool is not
+thread-safe; it is used by the thread that updates the structure it serves.
+
+MEMPOOL *mempoolarena(int chunk);
+MEMPOOL *mempoolslab(int chunk);
+	Instantiate an arena or a slab, taking chunk bytes at a time from the
+	heap, MEMPOOL_CHUNK if 0. Returns NULL if fail.
+
+void mempoolfree(MEMPOOL *p);
+	Frees the pool and its chunks, with every block handed out of them.
+
+void *memalloc(MEMPOOL *p, int size);
+	Returns a block of size bytes from the pool p, or from the heap if p is
+	NULL, aligned to MEMPOOL_ALIGN. Returns NULL if fail.
+
+void memfree(MEMPOOL *p, void *ptr, int size);
+	Returns the block ptr of size bytes, as allocated, to the pool p, or to
+	the heap if p is NULL.
+
+The pool counts in heap the bytes it has taken from the heap, and in used
+those of the blocks it has handed out, less those freed to a slab.
+*/
+
+#ifndef _MEMPOOL_H
+#define _MEMPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEMPOOL_ALIGN 8
+#if defined(__AVR_ATmega328P__)
+#define MEMPOOL_CHUNK 256
+#define MEMPOOL_MAX 64
+#elif defined(ARDUINO)
+#define MEMPOOL_CHUNK 2048
+#define MEMPOOL_MAX 256
+#else
+#define MEMPOOL_CHUNK 65536
+#define MEMPOOL_MAX 512
+#endif
+
+typedef union memchunk {
+	union memchunk *next;
+	double align;
+} MEMCHUNK;
+
+typedef struct mempool {
+	void *(*alloc)(struct mempool *p, int size);
+	void (*free)(struct mempool *p, void *ptr, int size);
+	MEMCHUNK *chunks;  /* Taken from the heap, the last first */
+	char *next;  /* Unused space of the last chunk */
+	int left;
+	int chunk;
+	void *freelist[MEMPOOL_MAX/MEMPOOL_ALIGN];  /* Blocks freed to a slab, by size class */
+	long heap, used;
+} MEMPOOL;
+
+MEMPOOL *mempoolarena(int chunk);
+MEMPOOL *mempoolslab(int chunk);
+void mempoolfree(MEMPOOL *p);
+void *memalloc(MEMPOOL *p, int size);
+void memfree(MEMPOOL *p, void *ptr, int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
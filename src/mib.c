@@ -30,17 +30,38 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdlib.h>
+#include "retval.h"
 #include "mib.h"
 
+/* Values moved to the heap take room by this many bytes */
+#define MIB_HEAP_ALIGN 16
+
 /* Octet String and OID are copied as-is, assumed as octet and BER-encoded
    respectively. Set size=0 for numeric values. */
-void mibsetvalue(MIB *thismib, void *u, int size)
+int mibsetvalue(MIB *thismib, void *u, int size)
 {
+	unsigned char *buf;
+	int room;
+
 	switch(thismib->dataType) {
 		case OCTET_STRING :
  		case OBJECT_IDENTIFIER :
  		case IP_ADDRESS :
-			memcopy(thismib->u.octetstring, (unsigned char *) u, size);
+			if (size > thismib->dataSize) {  /* Past the buffer, moved to a larger one */
+				if (size > MIB_DATA_SIZE)
+					return FAIL;
+				room = (size + MIB_HEAP_ALIGN-1) & ~(MIB_HEAP_ALIGN-1);
+				if ((buf = (unsigned char *)malloc(room)) == NULL)
+					return FAIL;
+				memcopy(buf, (unsigned char *) u, size);
+				mibfreevalue(thismib);
+				thismib->u.octetstring = buf;
+				thismib->dataSize = (unsigned short) room;
+				thismib->dataHeap = TRUE;
+			}
+			else
+				memcopy(thismib->u.octetstring, (unsigned char *) u, size);
 			thismib->dataLen = size;
 			break;
 		case INTEGER :
@@ -54,6 +75,15 @@ void mibsetvalue(MIB *thismib, void *u, int size)
 			thismib->dataLen = INT_SIZE;
 			break;
 	}
+	return SUCCESS;
+}
+
+void mibfreevalue(MIB *thismib)
+{
+	if (thismib->dataHeap) {
+		free(thismib->u.octetstring);
+		thismib->dataHeap = FALSE;
+	}
 }
 
 /* (*get)() is expected to compute or fetch, then fill in the new data in *mib.
@@ -41,24 +41,42 @@
 extern "C" {
 #endif 
 
+/* Room for an octet string, OID or IP address kept in the node itself */
+#if defined(__AVR_ATmega328P__)
+#define MIB_INLINE_SIZE 8
+#else
+#define MIB_INLINE_SIZE 24
+#endif
+
 typedef struct mib {
 	OID oid;
-	unsigned char dataType;
 	int dataLen;
 	union {
 		unsigned char *octetstring;
 		uint32_t intval;
 	} u;
-	char access;
 	int (*get)(struct mib *);
 	int (*set)(struct mib *, void *, int);
+	unsigned short dataSize;  /* Room of the buffer u.octetstring points to */
+	unsigned char dataType;
+	unsigned char dataInline;  /* Room for the value allocated right after the node */
+	unsigned char dataHeap;  /* TRUE if that buffer was allocated for the node */
+	char access;
 } MIB;
 
 /* Octet String and OID are copied as-is, assumed as octet and BER-encoded
-   respectively. Set size=0 for numeric values. */
-void mibsetvalue(MIB *thismib, void *u, int size);
+   respectively. Set size=0 for numeric values. A value longer than dataSize
+   is moved to a buffer of its own on the heap, up to MIB_DATA_SIZE bytes.
+   Returns SUCCESS, or FAIL if the value is too long or memory is short. */
+int mibsetvalue(MIB *thismib, void *u, int size);
+
+/* Frees the buffer of the value, if allocated for the node */
+void mibfreevalue(MIB *thismib);
 
-/* (*get)() is expected to compute or fetch, then fill in the new data in *mib.
+/* (*get)() is expected to compute or fetch, then fill in the new data in *mib,
+   with mibsetvalue() or within the dataSize bytes at u.octetstring. The agent
+   passes a copy of the node, since other threads may be reading the node, and
+   answers from the copy; the node itself keeps its value.
    (*set)() should actuate *data, then change the data in *mib.
    Both return a SNMP Operations function return codes defined in snmpdefs.h
 */
@@ -0,0 +1,338 @@
+/*
+ * Refreshes a MIB tree from its data file, reparsing only the lines that changed.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "mibfile.h"
+#include "mibutil.h"
+
+#define BUF_SIZE 256
+
+/* FNV-1a of a line */
+static uint64_t lineprint(unsigned char *p, int len)
+{
+	uint64_t h = 14695981039346656037ULL;
+
+	for (; len > 0; len--, p++)
+		h = (h ^ *p) * 1099511628211ULL;
+	return h;
+}
+
+static Boolean isoctet(unsigned char dataType)
+{
+	return dataType == OCTET_STRING || dataType == OBJECT_IDENTIFIER || dataType == IP_ADDRESS;
+}
+
+/* Frees the nodes staged for the tree and not yet put in it */
+static void mibfilediscard(MIBFILE *m)
+{
+	int i;
+
+	for (i = 0; i < m->nval; i++)
+		if (m->val[i].add)
+			miblistfreemib(m->miblist, m->val[i].mib);
+	m->nval = 0;
+}
+
+/* Stages the value of a changed line s. Returns Success(0), also for a line
+   with no value to stage, or Fail(-1) if memory is short, to be tried again. */
+static int mibfilestage(MIBFILE *m, int line, char *s)
+{
+	unsigned char octetdata[MIB_LINE_SIZE];
+	MIBFILEVAL *v;
+	MIB mib, *thismib;
+
+	if (s[0] == '\0' || s[0] == '#') return SUCCESS;
+	mib.u.octetstring = octetdata;
+	if (mibscan(&mib, s) == FAIL) return SUCCESS;
+	if (isoctet(mib.dataType) && mib.dataLen > MIB_DATA_SIZE) return SUCCESS;
+	thismib = miblistfind(m->miblist, &mib.oid);
+	if (thismib && thismib->dataType != mib.dataType) return SUCCESS;
+	if (m->nval == m->valloc) {
+		m->valloc = m->valloc ? 2*m->valloc : 64;
+		if ((v = (MIBFILEVAL *)realloc(m->val, m->valloc * sizeof(MIBFILEVAL))) == NULL) {
+			m->valloc = m->nval;
+			return FAIL;
+		}
+		m->val = v;
+	}
+	v = &m->val[m->nval];
+	v->line = line;
+	v->dataLen = mib.dataLen;
+	if (isoctet(mib.dataType))
+		memcopy(v->data, octetdata, mib.dataLen);
+	else
+		v->intval = mib.u.intval;
+	if ((v->add = thismib == NULL)) {  /* A node, built here, as miblistread() does */
+		if ((thismib = miblistnewmib(m->miblist, &mib.oid, mib.dataType, mib.access)) == NULL)
+			return FAIL;
+		if (isoctet(mib.dataType)) {
+			if (mibsetvalue(thismib, octetdata, mib.dataLen) != SUCCESS) {
+				miblistfreemib(m->miblist, thismib);
+				return FAIL;
+			}
+		}
+		else {
+			thismib->dataLen = mib.dataLen;
+			thismib->u.intval = mib.u.intval;
+		}
+	}
+	v->mib = thismib;
+	m->nval++;
+	return SUCCESS;
+}
+
+/* Compares each line of the file in buf with the one at its position before */
+static void mibfilelines(MIBFILE *m, unsigned char *buf, long size)
+{
+	unsigned char *p, *nl, *end = buf + size;
+	char s[MIB_LINE_SIZE];
+	uint64_t h, *print;
+	int i, len;
+
+	m->failed = 0;
+	for (i = 0, p = buf; p < end; p = nl + 1, i++) {
+		if ((nl = (unsigned char *)memchr(p, '\n', end - p)) == NULL) nl = end;
+		len = (int)(nl - p);
+		h = lineprint(p, len);
+		if (i < m->lines && m->print[i] == h) continue;
+		if (i >= m->plines) {
+			if ((print = (uint64_t *)realloc(m->print, 2*(i+1) * sizeof(uint64_t))) == NULL) {
+				m->failed++;
+				break;
+			}
+			m->print = print;
+			m->plines = 2*(i+1);
+		}
+		if (len > 0 && p[len-1] == '\r') len--;
+		if (len >= MIB_LINE_SIZE) len = MIB_LINE_SIZE-1;
+		memcopy((unsigned char *)s, p, len);
+		s[len] = '\0';
+		/* Kept only once staged, so that a line that is not is tried again */
+		if (mibfilestage(m, i, s) == SUCCESS)
+			m->print[i] = h;
+		else {
+			m->print[i] = ~h;
+			m->failed++;
+		}
+		m->parsed++;
+	}
+	m->lines = i;
+}
+
+MIBFILE *mibfilenew(MIBLIST *miblist, char *fn)
+{
+	MIBFILE *m;
+
+	if ((m = (MIBFILE *)malloc(sizeof(MIBFILE))) == NULL) return NULL;
+	memset(m, 0, sizeof(MIBFILE));
+	if ((m->fn = (char *)malloc(strlen(fn)+1)) == NULL) {
+		free(m);
+		return NULL;
+	}
+	strcpy(m->fn, fn);
+	m->miblist = miblist;
+	m->size = -1;  /* Not read yet */
+#ifdef __linux__
+	m->wd = -1;
+	m->name = strrchr(m->fn, '/') ? strrchr(m->fn, '/')+1 : m->fn;
+#endif
+	return m;
+}
+
+void mibfilefree(MIBFILE *m)
+{
+	mibfilediscard(m);
+	free(m->val);
+	free(m->print);
+	free(m->fn);
+	free(m);
+}
+
+int mibfilescan(MIBFILE *m)
+{
+	struct stat st;
+	unsigned char *buf;
+#ifdef _WIN32
+	FILE *f;
+#else
+	int fd;
+#endif
+
+	mibfilediscard(m);
+	if (stat(m->fn, &st) != 0) return FAIL;
+	if (m->failed == 0 && (long)st.st_size == m->size && (long)st.st_ino == m->ino && st.st_mtime == m->mtime
+#ifdef __linux__
+		&& st.st_mtim.tv_nsec == m->mtimeNsec
+#endif
+		)
+		return 0;
+#ifdef _WIN32
+	if ((f = fopen(m->fn, "rb")) == NULL) return FAIL;
+	if ((buf = (unsigned char *)malloc(st.st_size+1)) == NULL) {
+		fclose(f);
+		return FAIL;
+	}
+	st.st_size = (long)fread(buf, 1, st.st_size, f);
+	fclose(f);
+	mibfilelines(m, buf, (long)st.st_size);
+	free(buf);
+#else
+	if ((fd = open(m->fn, O_RDONLY)) < 0) return FAIL;
+	if (fstat(fd, &st) != 0) {  /* Of the file opened, should it be replaced since */
+		close(fd);
+		return FAIL;
+	}
+	if (st.st_size > 0) {
+		buf = (unsigned char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (buf == MAP_FAILED) {
+			close(fd);
+			return FAIL;
+		}
+		mibfilelines(m, buf, (long)st.st_size);
+		munmap(buf, st.st_size);
+	}
+	else
+		m->lines = 0;
+	close(fd);
+#endif
+	m->size = (long)st.st_size;
+	m->ino = (long)st.st_ino;
+	m->mtime = st.st_mtime;
+#ifdef __linux__
+	m->mtimeNsec = st.st_mtim.tv_nsec;
+#endif
+	m->reads++;
+	return m->nval;
+}
+
+/* Has the line of the value v, which could not be applied, tried again at
+   the next scan */
+static void mibfileretry(MIBFILE *m, MIBFILEVAL *v)
+{
+	m->print[v->line] = ~m->print[v->line];
+	m->failed++;
+}
+
+int mibfileapply(MIBFILE *m)
+{
+	MIBFILEVAL *v;
+	MIB *thismib;
+	int i, n = 0;
+
+	for (i = 0; i < m->nval; i++) {
+		v = &m->val[i];
+		thismib = v->mib;
+		if (v->add) {  /* Unless an earlier line of the file added the OID */
+			if ((thismib = miblistfind(m->miblist, &v->mib->oid)) == NULL) {
+				if (miblistput(m->miblist, v->mib)) {
+					v->add = FALSE;  /* Now of the tree */
+					n++;
+				}
+				else
+					mibfileretry(m, v);
+				continue;
+			}
+			if (thismib->dataType != v->mib->dataType) continue;
+		}
+		if (isoctet(thismib->dataType)) {
+			if (mibsetvalue(thismib, v->data, v->dataLen) != SUCCESS) {
+				mibfileretry(m, v);
+				continue;
+			}
+		}
+		else {
+			thismib->u.intval = v->intval;
+			thismib->dataLen = v->dataLen;
+		}
+		n++;
+	}
+	mibfilediscard(m);
+	m->applied += n;
+	return n;
+}
+
+int mibfileread(MIBFILE *m)
+{
+	return mibfilescan(m) == FAIL ? FAIL : mibfileapply(m);
+}
+
+#ifdef __linux__
+int mibfilewatch(MIBFILE *m)
+{
+	char dir[BUF_SIZE];
+	int fd;
+
+	/* Watch the directory, as a writer may replace the file by another */
+	if (m->name == m->fn)
+		strcpy(dir, ".");
+	else
+		snprintf(dir, sizeof(dir), "%.*s", (int)(m->name - m->fn - 1), m->fn);
+	if ((fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0) return FAIL;
+	if ((m->wd = inotify_add_watch(fd, dir[0] ? dir : "/", IN_CLOSE_WRITE | IN_MOVED_TO)) < 0) {
+		close(fd);
+		return FAIL;
+	}
+	return fd;
+}
+
+void mibfilenotify(int fd, void *arg)
+{
+	MIBFILE *m = (MIBFILE *)arg;
+	char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *ev;
+	Boolean changed = FALSE;
+	ssize_t n;
+	char *p;
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		for (p = buf; p < buf + n; p += sizeof(struct inotify_event) + ev->len) {
+			ev = (struct inotify_event *)p;
+			if (ev->wd == m->wd && ev->len && strcmp(ev->name, m->name) == 0)
+				changed = TRUE;
+		}
+	if (changed) mibfileread(m);
+}
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Refreshes a MIB tree from its data file, reparsing only the lines that changed.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+mibfile.c keeps a MIB tree up to date with its data file, in the format of
+miblistread(), as another process rewrites it. A refresh first compares the
+size, time and inode of the file with those of the last, and stops there if
+none changed. Otherwise the file is mapped into memory, and each line is
+compared by a 64-bit fingerprint with the line at the same position the last
+time; only the lines that differ are parsed by mibscan(). Their values are
+staged apart from the tree, and then applied in one pass, so that a request
+served with the tree locked during mibfileapply() sees either all or none
+of them.
+
+MIBFILE *mibfilenew(MIBLIST *miblist, char *fn);
+	Instantiate a refresher of miblist from the file fn, not yet read.
+	Returns NULL if fail.
+
+void mibfilefree(MIBFILE *m);
+	Free the refresher, but not the tree.
+
+int mibfilescan(MIBFILE *m);
+	Stages the values of the lines changed since the last scan. The tree is
+	only read, and may be served meanwhile by other threads. Returns the
+	number of values staged, 0 if the file has not changed, or Fail(-1) if
+	it cannot be read. A line not staged, or not applied, for want of memory
+	is tried again at the next scan, even if the file has not changed.
+
+int mibfileapply(MIBFILE *m);
+	Puts the staged values into the tree, and nodes for OIDs not in it.
+	Those threads must be kept out of the tree meanwhile, e.g. by the lock
+	of setMibLockCtx(). A value whose type is not that of its node, or too
+	long for its buffer, is left out. Returns the number of values applied.
+
+int mibfileread(MIBFILE *m);
+	mibfilescan() then mibfileapply(), for a tree served on the same thread.
+	Returns as mibfileapply(), or Fail(-1).
+
+int mibfilewatch(MIBFILE *m);
+	Linux only. Returns an inotify descriptor that turns readable when the
+	file is written or replaced, or Fail(-1). It may be passed with the
+	refresher to evloopaddfd() and mibfilenotify().
+
+void mibfilenotify(int fd, void *arg);
+	Linux only. Consumes the events of the descriptor fd of mibfilewatch(),
+	and calls mibfileread() with the refresher arg if the file changed.
+
+The refresher counts in reads the scans that found the file changed, in
+parsed the lines parsed, and in applied the values put into the tree. A
+node keeps its value when its line is removed from the file.
+*/
+
+#ifndef _MIBFILE_H
+#define _MIBFILE_H
+
+#include <stdint.h>
+#include <time.h>
+#include "miblist.h"
+#include "usnmp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	MIB *mib;  /* The node, or a new one to put in the tree */
+	Boolean add;
+	int line;  /* Of the file, from 0 */
+	int dataLen;
+	uint32_t intval;
+	unsigned char data[MIB_DATA_SIZE];
+} MIBFILEVAL;
+
+typedef struct {
+	MIBLIST *miblist;
+	char *fn;
+	long size, ino;  /* Of the file at the last scan */
+	time_t mtime;
+	long mtimeNsec;
+	uint64_t *print;  /* Fingerprint of each line */
+	int lines, plines;
+	int failed;  /* Lines not staged at the last scan, for want of memory */
+	MIBFILEVAL *val;  /* Staged */
+	int nval, valloc;
+	uint32_t reads, parsed, applied;
+#ifdef __linux__
+	int wd;  /* inotify watch of the directory of fn */
+	char *name;  /* Base name of fn */
+#endif
+} MIBFILE;
+
+MIBFILE *mibfilenew(MIBLIST *miblist, char *fn);
+void mibfilefree(MIBFILE *m);
+int mibfilescan(MIBFILE *m);
+int mibfileapply(MIBFILE *m);
+int mibfileread(MIBFILE *m);
+#ifdef __linux__
+int mibfilewatch(MIBFILE *m);
+void mibfilenotify(int fd, void *arg);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ * Loads a MIB tree from a binary image mapped into memory, and writes one.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include "mibimage.h"
+
+/* Heap first allocated as the image is written, and doubled when full */
+#define HEAP_CHUNK 65536
+/* Room of the slot of a value of len bytes */
+#define SLOT_SIZE(len) (((len) + 7) & ~7)
+/* Length of the longest prefix ber2oid() reads, that of "1.3.6.1.2.1" */
+#define OID_PREFIX_LEN 5
+
+static Boolean isoctet(unsigned char dataType)
+{
+	return dataType == OCTET_STRING || dataType == OBJECT_IDENTIFIER || dataType == IP_ADDRESS;
+}
+
+/* Maps the file fn copy-on-write, or on Windows reads it, into img->map.
+   Returns Success(0) or Fail(-1). */
+static int mibimagemap(MIBIMAGE *img, char *fn)
+{
+	struct stat st;
+#ifdef _WIN32
+	FILE *f;
+
+	if (stat(fn, &st) != 0 || st.st_size == 0 || (f = fopen(fn, "rb")) == NULL)
+		return FAIL;
+	if ((img->map = (unsigned char *)malloc(st.st_size)) == NULL) {
+		fclose(f);
+		return FAIL;
+	}
+	img->size = (long)fread(img->map, 1, st.st_size, f);
+	fclose(f);
+#else
+	int fd;
+
+	if ((fd = open(fn, O_RDONLY)) < 0) return FAIL;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return FAIL;
+	}
+	img->map = (unsigned char *)mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (img->map == MAP_FAILED) return FAIL;
+	img->size = (long)st.st_size;
+#endif
+	return SUCCESS;
+}
+
+static void mibimageunmap(MIBIMAGE *img)
+{
+#ifdef _WIN32
+	free(img->map);
+#else
+	munmap(img->map, img->size);
+#endif
+}
+
+/* Builds the nodes of the image in img->mib, checking each record against
+   the bounds of the heap, and the order of the OIDs. Returns Success(0) or
+   Fail(-1). */
+static int mibimagebuild(MIBIMAGE *img)
+{
+	MIBIMAGEHDR *hdr = (MIBIMAGEHDR *)img->map;
+	MIBIMAGEREC *rec = (MIBIMAGEREC *)(img->map + sizeof(MIBIMAGEHDR));
+	unsigned char *heap = img->map + hdr->heap, *name;
+	long heaplen = (long)hdr->size - hdr->heap;
+	MIB *thismib;
+	int i;
+
+	for (i = 0; i < img->count; i++, rec++) {
+		thismib = img->mib + i;
+		name = heap + rec->name;
+		if ((long)rec->name + 2 > heaplen || name[0] != OBJECT_IDENTIFIER || name[1] < OID_PREFIX_LEN ||
+			(long)rec->name + 2 + name[1] > heaplen ||
+			ber2oid(name+2, name[1], &thismib->oid) == 0 ||
+			(i > 0 && oidcmp(&thismib[-1].oid, &thismib->oid) >= 0))
+			return FAIL;
+		thismib->dataType = rec->dataType;
+		thismib->dataLen = rec->dataLen;
+		thismib->access = rec->access;
+		thismib->get = NULL;
+		thismib->set = NULL;
+		thismib->dataSize = 0;
+		thismib->dataInline = 0;
+		thismib->dataHeap = FALSE;
+		switch (rec->dataType) {
+			case OCTET_STRING :
+			case OBJECT_IDENTIFIER :
+			case IP_ADDRESS :
+				if (rec->dataLen > MIB_DATA_SIZE || (long)rec->value + SLOT_SIZE(rec->dataLen) > heaplen)
+					return FAIL;
+				thismib->u.octetstring = heap + rec->value;
+				thismib->dataSize = SLOT_SIZE(rec->dataLen);
+				break;
+			case INTEGER :
+			case TIMETICKS :
+			case COUNTER :
+			case GAUGE :
+			case NULL_ITEM :
+				thismib->u.intval = rec->value;
+				break;
+			default :
+				return FAIL;
+		}
+	}
+	return SUCCESS;
+}
+
+MIBIMAGE *mibimageopen(MIBLIST *miblist, char *fn)
+{
+	MIBIMAGE *img;
+	MIBIMAGEHDR *hdr;
+	Boolean empty = miblistsize(miblist) == 0;
+	int i;
+
+	if (miblist->block != NULL) return NULL;  /* One image to a tree */
+	if ((img = (MIBIMAGE *)malloc(sizeof(MIBIMAGE))) == NULL) return NULL;
+	if (mibimagemap(img, fn) == FAIL) {
+		free(img);
+		return NULL;
+	}
+	hdr = (MIBIMAGEHDR *)img->map;
+	img->mib = NULL;
+	img->count = 0;
+	if (img->size < (long)sizeof(MIBIMAGEHDR) || memcmp(hdr->magic, MIBIMAGE_MAGIC, 8) != 0 ||
+		hdr->version != MIBIMAGE_VERSION || hdr->order != MIBIMAGE_ORDER ||
+		hdr->dataSize != MIB_DATA_SIZE || hdr->size != img->size ||
+		hdr->heap < sizeof(MIBIMAGEHDR) || hdr->heap > hdr->size ||
+		hdr->count > (hdr->heap - sizeof(MIBIMAGEHDR)) / sizeof(MIBIMAGEREC) ||
+		(img->mib = (MIB *)malloc((hdr->count+1) * sizeof(MIB))) == NULL ||
+		(img->count = hdr->count, mibimagebuild(img)) == FAIL) {
+		free(img->mib);
+		mibimageunmap(img);
+		free(img);
+		return NULL;
+	}
+
+	/* In order, each node goes at the tail of the tree */
+	miblist->block = img->mib;
+	miblist->nblock = img->count;
+	for (i = 0; i < img->count; i++)
+		if (empty || miblistfind(miblist, &img->mib[i].oid) == NULL)
+			miblistput(miblist, img->mib + i);
+	miblistgohead(miblist);
+	return img;
+}
+
+void mibimageclose(MIBIMAGE *img)
+{
+	mibimageunmap(img);
+	free(img->mib);
+	free(img);
+}
+
+int mibimagewrite(MIBLIST *miblist, char *fn)
+{
+	MIBIMAGEHDR hdr;
+	MIBIMAGEREC *rec;
+	MIB *thismib;
+	unsigned char *heap = NULL, *p;
+	long heaplen = 0, heapalloc = 0;
+	int n = 0, len;
+	char tmp[FILENAME_MAX];
+	FILE *f;
+
+	if ((rec = (MIBIMAGEREC *)malloc((miblistsize(miblist)+1) * sizeof(MIBIMAGEREC))) == NULL)
+		return FAIL;
+	for (thismib = miblistgohead(miblist); thismib; thismib = miblistgonext(miblist)) {
+		if (heaplen + OID_SIZE*5+2 + MIB_DATA_SIZE > heapalloc) {
+			heapalloc = heapalloc ? 2*heapalloc : HEAP_CHUNK;
+			if ((p = (unsigned char *)realloc(heap, heapalloc)) == NULL) {
+				n = FAIL;
+				break;
+			}
+			heap = p;
+		}
+		p = heap + heaplen;
+		if ((len = oid2ber(&thismib->oid, p+2)) == 0 ||
+			(isoctet(thismib->dataType) && thismib->dataLen > MIB_DATA_SIZE))
+			continue;  /* Not of a prefix of str2oid(), or longer than a Set may make */
+		p[0] = OBJECT_IDENTIFIER;
+		p[1] = (unsigned char) len;
+		rec[n].name = (uint32_t) heaplen;
+		heaplen += len+2;
+		if (isoctet(thismib->dataType)) {
+			memcopy(heap + heaplen, thismib->u.octetstring, thismib->dataLen);
+			memset(heap + heaplen + thismib->dataLen, 0, SLOT_SIZE(thismib->dataLen) - thismib->dataLen);
+			rec[n].value = (uint32_t) heaplen;
+			heaplen += SLOT_SIZE(thismib->dataLen);
+		}
+		else
+			rec[n].value = thismib->u.intval;
+		rec[n].dataLen = (uint16_t) thismib->dataLen;
+		rec[n].dataType = thismib->dataType;
+		rec[n].access = thismib->access;
+		n++;
+	}
+
+	if (n != FAIL) {
+		memset(&hdr, 0, sizeof(hdr));
+		memcpy(hdr.magic, MIBIMAGE_MAGIC, 8);
+		hdr.version = MIBIMAGE_VERSION;
+		hdr.order = MIBIMAGE_ORDER;
+		hdr.count = n;
+		hdr.dataSize = MIB_DATA_SIZE;
+		hdr.heap = sizeof(hdr) + n * sizeof(MIBIMAGEREC);
+		hdr.size = hdr.heap + heaplen;
+		snprintf(tmp, sizeof(tmp), "%s.tmp", fn);
+		if ((f = fopen(tmp, "wb")) == NULL)
+			n = FAIL;
+		else {
+			if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+				(n > 0 && fwrite(rec, sizeof(MIBIMAGEREC), n, f) != (size_t)n) ||
+				(heaplen > 0 && fwrite(heap, 1, heaplen, f) != (size_t)heaplen))
+				n = FAIL;
+			if (fclose(f) != 0) n = FAIL;
+			if (n == FAIL)
+				remove(tmp);
+#ifdef _WIN32
+			else if (!MoveFileEx(tmp, fn, MOVEFILE_REPLACE_EXISTING)) {
+#else
+			else if (rename(tmp, fn) != 0) {
+#endif
+				remove(tmp);
+				n = FAIL;
+			}
+		}
+	}
+	free(heap);
+	free(rec);
+	return n;
+}
@@ -0,0 +1,122 @@
+/*
+ * Loads a MIB tree from a binary image mapped into memory, and writes one.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+mibimage.c saves a MIB tree as a binary image that an agent maps into memory
+at start-up, and serves the values from, where reading the data file with
+miblistread() parses every line, and allocates every node and string. The image is made
+for the host it was written on: its integers are in host order, and its
+values at most MIB_DATA_SIZE bytes long.
+
+The image is a header, an array of fixed-size records sorted by OID, and a
+heap. A record holds the type, access and length of a node, and its integer
+value, or the offset in the heap of its value. The OID of each node is kept
+in the heap BER-encoded, as an OBJECT IDENTIFIER TLV, and decoded at load.
+Each octet string, OID or IP address value has a slot of its own in the heap,
+its length rounded up to 8 bytes, which is the dataSize of the node; a Set
+of a value no longer is made in place, and a longer one moves the value to
+the heap of the process, as mibsetvalue() does. A value longer than
+MIB_DATA_SIZE, which a Set could not make either, is left out. The file is
+mapped copy-on-write, so the values set are never written back to it.
+
+MIBIMAGE *mibimageopen(MIBLIST *miblist, char *fn);
+	Maps the image fn, and puts its nodes into miblist, except those with an
+	OID already in it. The nodes are allocated as one block, the OID of each
+	decoded into it, and each put by miblistput(), which grows the array of
+	miblist and adds the node to its trie; the values stay in the image. It
+	saves over miblistread() the parsing of each line, and an allocation for
+	each node and string. Returns NULL if the image cannot be read, is not of
+	this format, version and host, or is not well-formed, or if miblist has
+	the block of an image already, in which case miblist is unchanged.
+
+void mibimageclose(MIBIMAGE *img);
+	Unmaps the image and frees its nodes. Those nodes must be out of their
+	tree by then, by miblistfree() or miblistclear(), which leave them to
+	mibimageclose().
+
+int mibimagewrite(MIBLIST *miblist, char *fn);
+	Writes the nodes of miblist as an image to a file of its own, and renames
+	it to fn, so that an agent that has fn mapped keeps the image it mapped.
+	Returns the number of nodes written, or Fail(-1).
+*/
+
+#ifndef _MIBIMAGE_H
+#define _MIBIMAGE_H
+
+#include <stdint.h>
+#include "miblist.h"
+#include "usnmp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MIBIMAGE_MAGIC "uSNMPIMG"
+#define MIBIMAGE_VERSION 2
+#define MIBIMAGE_ORDER 0x01020304  /* As written by the host */
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t order;
+	uint32_t count;  /* Number of records */
+	uint32_t dataSize;  /* MIB_DATA_SIZE of the host */
+	uint32_t heap;  /* Offset of the heap in the image */
+	uint32_t size;  /* Of the image, in bytes */
+} MIBIMAGEHDR;
+
+typedef struct {
+	uint32_t name;  /* Offset in the heap of the OID TLV */
+	uint32_t value;  /* Integer value, or offset in the heap of the value */
+	uint16_t dataLen;
+	unsigned char dataType;
+	char access;
+} MIBIMAGEREC;
+
+typedef struct {
+	unsigned char *map;  /* The image */
+	long size;
+	MIB *mib;  /* The nodes of the image, in one block */
+	int count;
+} MIBIMAGE;
+
+MIBIMAGE *mibimageopen(MIBLIST *miblist, char *fn);
+void mibimageclose(MIBIMAGE *img);
+int mibimagewrite(MIBLIST *miblist, char *fn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * Journals the values set in a MIB tree, and compacts them into its data file.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#define fsync(fd) _commit(fd)
+#define ftruncate(fd, size) _chsize(fd, size)
+#else
+#include <unistd.h>
+#endif
+#include "mibjournal.h"
+#include "mibutil.h"
+
+#if !defined(ARDUINO) && !defined(_WIN32)
+#define LOCK(j) pthread_mutex_lock(&(j)->lock)
+#define UNLOCK(j) pthread_mutex_unlock(&(j)->lock)
+#else
+#define LOCK(j)
+#define UNLOCK(j)
+#endif
+
+#define REC_SIZE (MIB_LINE_SIZE + 10)  /* Checksum, space, line, newline */
+
+/* FNV-1a of the line of a record */
+static uint32_t recsum(char *s, int len)
+{
+	uint32_t h = 2166136261u;
+
+	for (; len > 0; len--, s++)
+		h = (h ^ (unsigned char)*s) * 16777619u;
+	return h;
+}
+
+/* Puts the values of the records in the journal into the tree, up to the
+   first that is cut short. Returns the number put. */
+static int mibjournalreplay(MIBJOURNAL *j)
+{
+	char rec[REC_SIZE+1];
+	unsigned char octetdata[MIB_LINE_SIZE];
+	MIB mib, *thismib;
+	FILE *f;
+	int len, n = 0;
+
+	if ((f = fopen(j->fn, "r")) == NULL) return 0;
+	while (fgets(rec, sizeof(rec), f)) {
+		len = (int)strlen(rec);
+		if (len < 10 || rec[len-1] != '\n' || rec[8] != ' ' ||
+			strtoul(rec, NULL, 16) != recsum(rec+9, len-10))
+			break;
+		rec[len-1] = '\0';
+		mib.u.octetstring = octetdata;
+		if (mibscan(&mib, rec+9) == FAIL || (thismib = miblistfind(j->miblist, &mib.oid)) == NULL ||
+			thismib->dataType != mib.dataType)
+			continue;
+		if (mib.dataType == OCTET_STRING || mib.dataType == OBJECT_IDENTIFIER ||
+			mib.dataType == IP_ADDRESS) {
+			if (mibsetvalue(thismib, octetdata, mib.dataLen) != SUCCESS) continue;
+		}
+		else {
+			thismib->u.intval = mib.u.intval;
+			thismib->dataLen = mib.dataLen;
+		}
+		n++;
+	}
+	fclose(f);
+	return n;
+}
+
+#ifndef _WIN32
+/* Syncs the directory of fn, so that a rename to fn is durable */
+static void syncdir(char *fn)
+{
+	char dir[FILENAME_MAX], *p = strrchr(fn, '/');
+	int fd;
+
+	if (p) snprintf(dir, sizeof(dir), "%.*s", (int)(p - fn) + 1, fn);
+	else strcpy(dir, ".");
+	if ((fd = open(dir, O_RDONLY)) >= 0) {
+		fsync(fd);
+		close(fd);
+	}
+}
+#endif
+
+/* Writes the tree to a file of its own and renames it over the data file */
+static int mibjournalsnapshot(MIBJOURNAL *j)
+{
+	char tmp[FILENAME_MAX];
+	FILE *f;
+	int ok;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", j->datfn);
+	if ((f = fopen(tmp, "w")) == NULL) return FAIL;
+	miblistprint(j->miblist, f);
+	ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+	if (fclose(f) != 0 || !ok) {
+		remove(tmp);
+		return FAIL;
+	}
+#ifdef _WIN32
+	if (!MoveFileEx(tmp, j->datfn, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+#else
+	if (rename(tmp, j->datfn) != 0) {
+#endif
+		remove(tmp);
+		return FAIL;
+	}
+#ifndef _WIN32
+	syncdir(j->datfn);
+#endif
+	return SUCCESS;
+}
+
+/* Writes the records held. Called locked. */
+static int mibjournalwrite(MIBJOURNAL *j)
+{
+	int n, w;
+
+	for (n = 0; n < j->len; n += w)
+		if ((w = write(j->fd, j->buf + n, j->len - n)) <= 0) {
+			memmove(j->buf, j->buf + n, j->len - n);  /* Kept to try again */
+			j->len -= n;
+			j->size += n;
+			return FAIL;
+		}
+	j->size += j->len;
+	j->len = 0;
+	return SUCCESS;
+}
+
+/* Compacts the journal into the data file, whether due or not. Called locked. */
+static int mibjournalflatten(MIBJOURNAL *j)
+{
+	if (mibjournalwrite(j) == FAIL || mibjournalsnapshot(j) == FAIL) return FAIL;
+	/* The records are in the data file, so they may go */
+	if (ftruncate(j->fd, 0) != 0) return FAIL;
+	fsync(j->fd);
+	j->size = 0;
+	j->held = 0;
+	j->compactions++;
+	return SUCCESS;
+}
+
+MIBJOURNAL *mibjournalnew(MIBLIST *miblist, char *datfn, char *fn, long limit)
+{
+	MIBJOURNAL *j;
+	struct stat st;
+
+	if ((j = (MIBJOURNAL *)malloc(sizeof(MIBJOURNAL))) == NULL) return NULL;
+	memset(j, 0, sizeof(MIBJOURNAL));
+	j->miblist = miblist;
+	j->limit = limit;
+	j->fd = -1;
+#if !defined(ARDUINO) && !defined(_WIN32)
+	pthread_mutex_init(&j->lock, NULL);
+#endif
+	if ((j->datfn = (char *)malloc(strlen(datfn)+1)) == NULL ||
+		(j->fn = (char *)malloc(strlen(fn)+1)) == NULL) {
+		mibjournalfree(j);
+		return NULL;
+	}
+	strcpy(j->datfn, datfn);
+	strcpy(j->fn, fn);
+	mibjournalreplay(j);
+	if ((j->fd = open(fn, O_WRONLY | O_APPEND | O_CREAT, 0644)) < 0) {
+		mibjournalfree(j);
+		return NULL;
+	}
+	if (fstat(j->fd, &st) == 0) j->size = (long)st.st_size;
+	if (j->size > 0 && mibjournalflatten(j) == FAIL) {
+		mibjournalfree(j);
+		return NULL;
+	}
+	return j;
+}
+
+void mibjournalfree(MIBJOURNAL *j)
+{
+	if (j->fd >= 0) {
+		mibjournalsync(j);
+		close(j->fd);
+	}
+#if !defined(ARDUINO) && !defined(_WIN32)
+	pthread_mutex_destroy(&j->lock);
+#endif
+	free(j->buf);
+	free(j->datfn);
+	free(j->fn);
+	free(j);
+}
+
+int mibjournalappend(MIBJOURNAL *j, MIB *thismib)
+{
+	char s[MIB_LINE_SIZE], *buf;
+	int len, ret = SUCCESS;
+
+	mibprint(thismib, s);
+	len = (int)strlen(s);
+	LOCK(j);
+	if (j->len + REC_SIZE > j->alloc) {
+		if ((buf = (char *)realloc(j->buf, j->alloc + 64*REC_SIZE)) == NULL)
+			ret = FAIL;
+		else {
+			j->buf = buf;
+			j->alloc += 64*REC_SIZE;
+		}
+	}
+	if (ret == SUCCESS) {
+		j->len += sprintf(j->buf + j->len, "%08x %s\n", (unsigned int) recsum(s, len), s);
+		j->held++;
+		j->appended++;
+	}
+	UNLOCK(j);
+	return ret;
+}
+
+int mibjournalsync(MIBJOURNAL *j)
+{
+	int n;
+
+	LOCK(j);
+	if ((n = j->held) > 0) {
+		if (mibjournalwrite(j) == FAIL || fsync(j->fd) != 0)
+			n = FAIL;
+		else {
+			j->held = 0;
+			j->commits++;
+		}
+	}
+	UNLOCK(j);
+	return n;
+}
+
+int mibjournalcompact(MIBJOURNAL *j)
+{
+	int ret = 0;
+
+	LOCK(j);
+	if (j->size + j->len >= j->limit)
+		ret = mibjournalflatten(j) == FAIL ? FAIL : 1;
+	UNLOCK(j);
+	return ret;
+}
@@ -0,0 +1,112 @@
+/*
+ * Journals the values set in a MIB tree, and compacts them into its data file.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+mibjournal.c persists the values set in a MIB tree without rewriting its
+data file on every Set. The value of each node set is appended as a record
+to a journal, in memory first; mibjournalsync() writes the records held and
+makes them durable with a single fsync(), so that all the Sets of a batch
+of requests, or of a period, are committed together after their responses
+are sent. Once the journal has grown past its limit, mibjournalcompact()
+writes the whole tree to a temporary file, syncs it and renames it over the
+data file, then empties the journal. A crash at any point leaves either the
+data file before or after, and the journal replays onto either.
+
+A record is a line of mibprint(), e.g. B.1.6.0=S,W,41-42 [AB], preceded by
+its FNV-1a checksum in 8 hex digits and a space. A record cut short by a
+crash fails its checksum, and ends the replay.
+
+MIBJOURNAL *mibjournalnew(MIBLIST *miblist, char *datfn, char *fn, long limit);
+	Opens the journal fn of miblist, read from the data file datfn, creating
+	it if it does not exist. The values in it are put into the tree, and, if
+	there are any, compacted into datfn. The journal is compacted once it
+	holds limit bytes. Returns NULL if fail.
+
+void mibjournalfree(MIBJOURNAL *j);
+	Commits the records held, and closes the journal.
+
+int mibjournalappend(MIBJOURNAL *j, MIB *thismib);
+	Holds a record of the value of thismib, e.g. from its set callback.
+	Returns Success(0), or Fail(-1) if it cannot be held.
+
+int mibjournalsync(MIBJOURNAL *j);
+	Writes the records held to the journal, and syncs it. Returns the number
+	of records committed, 0 if none were held, or Fail(-1).
+
+int mibjournalcompact(MIBJOURNAL *j);
+	If the journal holds limit bytes, writes the tree to datfn and empties
+	the journal. Sets must be kept out of the tree meanwhile, e.g. by the
+	lock of setMibLockCtx() taken shared; Gets may go on. Returns 1 if the
+	journal was compacted, 0 if it was not due, or Fail(-1).
+
+The journal counts the records appended, the fsync() calls that committed
+them in commits, and the compactions.
+*/
+
+#ifndef _MIBJOURNAL_H
+#define _MIBJOURNAL_H
+
+#if !defined(ARDUINO) && !defined(_WIN32)
+#include <pthread.h>
+#endif
+#include "miblist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	MIBLIST *miblist;
+	char *datfn, *fn;
+	int fd;
+	long size, limit;  /* Of the journal, in bytes */
+	char *buf;  /* Records held */
+	int len, alloc, held;
+	uint32_t appended, commits, compactions;
+#if !defined(ARDUINO) && !defined(_WIN32)
+	pthread_mutex_t lock;
+#endif
+} MIBJOURNAL;
+
+MIBJOURNAL *mibjournalnew(MIBLIST *miblist, char *datfn, char *fn, long limit);
+void mibjournalfree(MIBJOURNAL *j);
+int mibjournalappend(MIBJOURNAL *j, MIB *thismib);
+int mibjournalsync(MIBJOURNAL *j);
+int mibjournalcompact(MIBJOURNAL *j);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,5 @@
 /*
- * Implements a MIB tree as a singly linked list, stored in lexicographic order.
+ * Implements a MIB tree as a sorted array, stored in lexicographic order.
  *
  * This file is part of uSNMP ("micro-SNMP").
  * uSNMP is released under a BSD-style license. The full text follows.
@@ -31,8 +31,8 @@
  */
 
 /*
- * Implements a MIB tree using a singly linked list with dynamically
- * allocate dmemory
+ * Implements a MIB tree using a sorted array of pointers to dynamically
+ * allocated MIB nodes
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -41,74 +41,218 @@
 #include <ctype.h>
 #include "miblist.h"
 
-LIST *miblistnew(int size)
+/* Number of array elements first allocated, and on an ATmega, the number
+   added each time the array is full. Elsewhere, the array is doubled. */
+#if defined(__AVR_ATmega328P__)
+#define MIBLIST_CHUNK 8
+#else
+#define MIBLIST_CHUNK 64
+#endif
+
+MIBLIST *miblistnew(int size)
 {
-	LIST *miblist;
-	if ((miblist=listnew(sizeof(MIB), size)))
+	MIBLIST *miblist;
+
+	if ((miblist=(MIBLIST *)malloc(sizeof(MIBLIST)))) {
+		miblist->mib = NULL;
+		miblist->alloc = 0;
+		miblist->size = 0;
+		miblist->limit = size;  /* 0 for unlimited */
+		miblist->curr = 0;
+		miblist->eol = TRUE;
+		miblist->tables = NULL;
+		miblist->block = NULL;
+		miblist->nblock = 0;
+		miblist->pool = NULL;
+#ifdef MIB_TRIE_INDEX
+		miblist->trie = mibtrienew();
+#endif
 		return miblist;
+	}
 	else
-		return (LIST *) NULL;
+		return (MIBLIST *) NULL;
 }
 
-void miblistclear(LIST *miblist)
+void miblistclear(MIBLIST *miblist)
 {
-	listgohead(miblist);
-	while (miblistdel(miblist))
+	/* Delete from the tail so that no node is shifted */
+	while (miblistgotail(miblist) && miblistdel(miblist))
 		;
+	miblistgohead(miblist);
 }
 
-void miblistfree(LIST *miblist)
+void miblistfree(MIBLIST *miblist)
 {
+	MIBTABLE *tbl;
+
 	miblistclear(miblist);
-	listfree(miblist);
+	while ((tbl=miblist->tables)) {
+		miblist->tables = tbl->next;
+		free(tbl);
+	}
+#ifdef MIB_TRIE_INDEX
+	if (miblist->trie) mibtriefree(miblist->trie);
+#endif
+	free(miblist->mib);
+	free(miblist);
+}
+
+/* Room for the value kept after a node of dataType */
+static int mibroom(unsigned char dataType)
+{
+	switch (dataType) {
+		case OCTET_STRING :
+		case OBJECT_IDENTIFIER :
+		case IP_ADDRESS :
+			return MIB_INLINE_SIZE;
+		default :
+			return 0;
+	}
+}
+
+void miblistsetpool(MIBLIST *miblist, MEMPOOL *pool)
+{
+	miblist->pool = pool;
+}
+
+MIB *miblistnewmib(MIBLIST *miblist, OID *oid, unsigned char dataType, char access)
+{
+	MIB *thismib;
+	int i, room = mibroom(dataType);
+
+	if ((thismib=(MIB *)memalloc(miblist->pool, sizeof(MIB) + room)) == NULL)
+		return NULL;
+	thismib->oid.len = oid->len;
+	for (i = 0; i < oid->len; i++)
+		thismib->oid.array[i] = oid->array[i];
+	thismib->dataType = dataType;
+	thismib->access = access;
+	thismib->dataSize = (unsigned short) room;
+	thismib->dataInline = (unsigned char) room;
+	thismib->dataHeap = FALSE;
+	if (room) {
+		thismib->u.octetstring = (unsigned char *)(thismib+1);
+		thismib->dataLen = 0;
+	}
+	else {
+		thismib->u.intval = 0;
+		thismib->dataLen = dataType == NULL_ITEM ? 0 : INT_SIZE;
+	}
+	thismib->get = NULL;
+	thismib->set = NULL;
+	return thismib;
+}
+
+void miblistfreemib(MIBLIST *miblist, MIB *mib)
+{
+	mibfreevalue(mib);
+	memfree(miblist->pool, mib, sizeof(MIB) + mib->dataInline);
+}
+
+/* Binary search for oid. Returns the index of the first node that is not
+   lexicographically smaller than oid, and sets *cmp to 0 if it is equal. */
+static int miblistsearch(MIBLIST *miblist, OID *oid, int *cmp)
+{
+	int lo = 0, hi = miblist->size, mid;
+
+	*cmp = 1;
+	while (lo < hi) {
+		mid = (lo + hi) >> 1;
+		if (oidcmp(&miblist->mib[mid]->oid, oid) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < miblist->size)
+		*cmp = oidcmp(&miblist->mib[lo]->oid, oid);
+	return lo;
+}
+
+/* Inserts mib at index i, shifting the nodes after it. */
+static MIB *miblistinsert(MIBLIST *miblist, int i, MIB *mib)
+{
+	int alloc;
+	MIB **p;
+
+	if (miblist->limit != 0 && miblist->size >= miblist->limit)
+		return NULL;
+	if (miblist->size == miblist->alloc) {
+#if defined(__AVR_ATmega328P__)
+		alloc = miblist->alloc + MIBLIST_CHUNK;
+#else
+		alloc = miblist->alloc ? miblist->alloc * 2 : MIBLIST_CHUNK;
+#endif
+		if ((p=(MIB **)realloc(miblist->mib, alloc*sizeof(MIB *))) == NULL)
+			return NULL;
+		miblist->mib = p;
+		miblist->alloc = alloc;
+	}
+#ifdef MIB_TRIE_INDEX
+	/* Indexed first, so that a node is in both the array and the trie, or neither */
+	if (miblist->trie && mibtrieadd(miblist->trie, mib) == NULL)
+		return NULL;
+#endif
+	if (i < miblist->size)
+		memmove(miblist->mib+i+1, miblist->mib+i, (miblist->size-i)*sizeof(MIB *));
+	miblist->mib[i] = mib;
+	miblist->size++;
+	miblist->curr = i;
+	miblist->eol = FALSE;
+	return mib;
 }
 
 /* *data is a user-supplied space to hold the data. size
    refers to the length of this supplied space; and may be set to 0 for
    interger/gauge/counter/timertick types as it will default to 4. */
-MIB *miblistadd(LIST *miblist, char *oidstr, unsigned char dataType, char access,
+MIB *miblistadd(MIBLIST *miblist, char *oidstr, unsigned char dataType, char access,
 	void *data, int size)
 {
-	int i;
+	int i, cmp;
 	OID oid;
 	MIB *thismib;
 
 	str2oid(oidstr, &oid);
-	if ((thismib=miblistgooid(miblist, &oid)))
+	i = miblistsearch(miblist, &oid, &cmp);
+	if (cmp == 0 || (thismib=(MIB *)memalloc(miblist->pool, sizeof(MIB))) == NULL)
 		return NULL;
-	if (listeol(miblist))
-		thismib = (MIB *) listaddnode(miblist, AFTER);
-	else
-		thismib = (MIB *) listaddnode(miblist, BEFORE);  
 	thismib->access = access;
 	thismib->dataType = dataType;
 	thismib->oid.len = oid.len;
-	for (i = 0; i<oid.len; i++)
-		thismib->oid.array[i] = oid.array[i];
+	for (cmp = 0; cmp<oid.len; cmp++)
+		thismib->oid.array[cmp] = oid.array[cmp];
 	thismib->get = NULL;
 	thismib->set = NULL;
+	thismib->dataInline = 0;  /* The value is in the buffer of the user */
+	thismib->dataHeap = FALSE;
 	if (dataType == OCTET_STRING || dataType == OBJECT_IDENTIFIER ||
       dataType == IP_ADDRESS) {
 		thismib->u.octetstring = (unsigned char *) data;
 		thismib->dataLen = size;
+		thismib->dataSize = (unsigned short) size;  /* Longer values are moved off it */
 	}
 	else {
 		thismib->u.intval = 0;
 		thismib->dataLen = INT_SIZE;
+		thismib->dataSize = 0;
+	}
+	if (miblistinsert(miblist, i, thismib) == NULL) {
+		miblistfreemib(miblist, thismib);
+		return NULL;
 	}
 	return thismib;
 }
 
-MIB *miblistput(LIST *miblist, MIB *mib)
+MIB *miblistput(MIBLIST *miblist, MIB *mib)
 {
-	miblistgooid(miblist, &mib->oid); 																																													
-	if (listeol(miblist))
-		return (MIB *) listputnode(miblist, mib, AFTER);
-	else
-		return (MIB *) listputnode(miblist, mib, BEFORE);
+	int cmp;
+
+	/* Nodes put in order, as from a MIB image, go after the tail unsearched */
+	if (miblist->size == 0 || oidcmp(&miblist->mib[miblist->size-1]->oid, &mib->oid) < 0)
+		return miblistinsert(miblist, miblist->size, mib);
+	return miblistinsert(miblist, miblistsearch(miblist, &mib->oid, &cmp), mib);
 }
 
-MIB *miblistset(LIST *miblist, OID *oid, void *u, int size)
+MIB *miblistset(MIBLIST *miblist, OID *oid, void *u, int size)
 {
 	MIB *thismib;
 
@@ -120,66 +264,191 @@ MIB *miblistset(LIST *miblist, OID *oid, void *u, int size)
 		return NULL;
 }
 
-Boolean miblistdel(LIST *miblist)
+Boolean miblistdel(MIBLIST *miblist)
 {
 	MIB *thismib;
+	int i;
 
-	if ( (thismib=(MIB *)listgetthis(miblist))==NULL )
+	if ( (thismib=miblistgetthis(miblist))==NULL )
 		return FALSE;
 	else {
-		if (thismib->dataType == OCTET_STRING || thismib->dataType == OBJECT_IDENTIFIER)
-			free(thismib->u.octetstring);
-		return listdelnode(miblist);
+#ifdef MIB_TRIE_INDEX
+		if (miblist->trie && mibtriefind(miblist->trie, &thismib->oid) == thismib)
+			mibtriedel(miblist->trie, &thismib->oid);
+#endif
+		if (thismib < miblist->block || thismib >= miblist->block + miblist->nblock)
+			miblistfreemib(miblist, thismib);
+		else
+			mibfreevalue(thismib);
+		i = miblist->curr;
+		miblist->size--;
+		if (i < miblist->size)
+			memmove(miblist->mib+i, miblist->mib+i+1, (miblist->size-i)*sizeof(MIB *));
+		else
+			miblist->eol = TRUE;
+		return TRUE;
 	}
 }
 
-MIB *miblistgooid(LIST *miblist, OID *oid)
+MIB *miblistgooid(MIBLIST *miblist, OID *oid)
 {
-	MIB *thismib;
-	int i;
+	int cmp;
 
-	if ( (thismib=(MIB *)listgetthis(miblist))==NULL ||
-		oidcmp(oid, &thismib->oid)<0 )
-		thismib=(MIB *)listgohead(miblist);
-	while ( thismib && (i=oidcmp(oid, &thismib->oid))>0 )
-		thismib=(MIB *)listgonext(miblist);
-	if (thismib==NULL || i)
+	/* A GetNext walk asks for the current node, so check it before searching */
+	if (!miblist->eol && oidcmp(&miblist->mib[miblist->curr]->oid, oid) == 0)
+		return miblist->mib[miblist->curr];
+	miblist->curr = miblistsearch(miblist, oid, &cmp);
+	miblist->eol = (miblist->curr >= miblist->size);
+	if (cmp)
 		return (MIB *)NULL;
 	else
-		return (MIB *)thismib;
+		return miblist->mib[miblist->curr];
 }
 
-int miblistsize(LIST *miblist)
+int miblistsize(MIBLIST *miblist)
 {
-	return listsize(miblist);
+	return miblist->size;
 }
 
-MIB *miblistgetthis(LIST *miblist)
+MIB *miblistgetthis(MIBLIST *miblist)
 {
-	return (MIB *)listgetthis(miblist);
+	if (miblist->eol)
+		return NULL;
+	else
+		return miblist->mib[miblist->curr];
 }
 
-MIB *miblistgetnext(LIST *miblist)
+MIB *miblistgetnext(MIBLIST *miblist)
 {
-	return (MIB *)listgetnext(miblist);
+	if (miblist->eol || miblist->curr+1 >= miblist->size)
+		return NULL;
+	else
+		return miblist->mib[miblist->curr+1];
 }
 
-MIB *miblistgetprev(LIST *miblist)
+MIB *miblistgetprev(MIBLIST *miblist)
 {
-	return (MIB *)listgetprev(miblist);
+	if (miblist->curr == 0 || miblist->curr > miblist->size)
+		return NULL;
+	else
+		return miblist->mib[miblist->curr-1];
 }
 
-MIB *miblistgohead(LIST *miblist)
+MIB *miblistgohead(MIBLIST *miblist)
 {
-	return (MIB *)listgohead(miblist);
+	miblist->curr = 0;
+	miblist->eol = (miblist->size == 0);
+	return miblistgetthis(miblist);
 }
 
-MIB *miblistgotail(LIST *miblist)
+MIB *miblistgotail(MIBLIST *miblist)
 {
-	return (MIB *)listgotail(miblist);
+	if (miblist->size == 0)
+		return NULL;
+	miblist->curr = miblist->size - 1;
+	miblist->eol = FALSE;
+	return miblist->mib[miblist->curr];
 }
 
-MIB *miblistgonext(LIST *miblist)
+MIB *miblistgonext(MIBLIST *miblist)
 {
-	return (MIB *)listgonext(miblist);
+	if (miblist->eol)
+		return NULL;
+	if (++miblist->curr >= miblist->size) {  /* past the tail node */
+		miblist->curr = miblist->size;
+		miblist->eol = TRUE;
+		return NULL;
+	}
+	return miblist->mib[miblist->curr];
+}
+
+MIB *miblistfind(MIBLIST *miblist, OID *oid)
+{
+	int i, cmp;
+
+#ifdef MIB_TRIE_INDEX
+	if (miblist->trie)
+		return mibtriefind(miblist->trie, oid);
+#endif
+	i = miblistsearch(miblist, oid, &cmp);
+	if (cmp)
+		return NULL;
+	else
+		return miblist->mib[i];
+}
+
+MIB *miblistfindnext(MIBLIST *miblist, OID *oid)
+{
+	int i, cmp;
+
+#ifdef MIB_TRIE_INDEX
+	if (miblist->trie)
+		return mibtrienext(miblist->trie, oid);
+#endif
+	i = miblistsearch(miblist, oid, &cmp);
+	if (cmp == 0) i++;
+	if (i < miblist->size)
+		return miblist->mib[i];
+	else
+		return NULL;
+}
+
+int miblistwalk(MIBLIST *miblist, OID *prefix, int (*func)(MIB *mib, void *arg), void *arg)
+{
+	int i, j, n = 0, cmp;
+	MIB *thismib;
+
+#ifdef MIB_TRIE_INDEX
+	if (miblist->trie)
+		return mibtriewalk(miblist->trie, prefix, func, arg);
+#endif
+	for (i = miblistsearch(miblist, prefix, &cmp); i < miblist->size; i++) {
+		thismib = miblist->mib[i];
+		if (thismib->oid.len < prefix->len)
+			break;
+		for (j = 0; j < prefix->len && thismib->oid.array[j] == prefix->array[j]; j++)
+			;
+		if (j < prefix->len)
+			break;  /* Past the subtree */
+		n++;
+		if (func(thismib, arg))
+			break;
+	}
+	return n;
+}
+
+MIBTABLE *miblistaddtable(MIBLIST *miblist, char *oidstr, unsigned int mincol,
+	unsigned int maxcol, void *data)
+{
+	MIBTABLE *tbl;
+	OID oid;
+
+	str2oid(oidstr, &oid);
+	for (tbl = miblist->tables; tbl; tbl = tbl->next)
+		if (oidcmp(&tbl->oid, &oid) == 0)
+			return NULL;
+	if ((tbl=(MIBTABLE *)malloc(sizeof(MIBTABLE))) == NULL)
+		return NULL;
+	tbl->oid = oid;
+	tbl->mincol = mincol;
+	tbl->maxcol = maxcol;
+	tbl->data = data;
+	tbl->get = NULL;
+	tbl->nextindex = NULL;
+	tbl->set = NULL;
+	tbl->next = miblist->tables;
+	miblist->tables = tbl;
+	return tbl;
+}
+
+MIBTABLE *miblistgettable(MIBLIST *miblist, OID *oid)
+{
+	MIBTABLE *tbl;
+	unsigned int col;
+	OID index;
+
+	for (tbl = miblist->tables; tbl; tbl = tbl->next)
+		if (mibtablecell(tbl, oid, &col, &index) == SUCCESS)
+			return tbl;
+	return NULL;
 }
@@ -1,5 +1,5 @@
 /*
- * Implements a MIB tree as a singly linked list, stored in lexicographic order.
+ * Implements a MIB tree as a sorted array, stored in lexicographic order.
  *
  * This file is part of uSNMP ("micro-SNMP").
  * uSNMP is released under a BSD-style license. The full text follows.
@@ -30,37 +30,147 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+miblist.c implements a MIB tree as a contiguous array of pointers to MIB nodes,
+kept in lexicographic order of their OIDs. A node is located by binary search,
+and the successor of the current node is the next array element.
+
+MIBLIST *miblistnew(int max);
+	Instantiate an empty MIB tree. max is the maximum number of nodes the tree
+	may have, 0 if unlimited.
+
+void miblistclear(MIBLIST *l);
+void miblistfree(MIBLIST *l);
+	Delete all nodes in the tree, and for miblistfree(), free the tree too.
+	Nodes in the block of a MIB image of mibimage.h are left to its owner.
+
+int miblistsize(MIBLIST *l);
+	Returns the number of nodes in the tree.
+
+void miblistsetpool(MIBLIST *l, MEMPOOL *pool);
+	Allocates the nodes of the empty tree l from pool, e.g. a slab of
+	mempool.h for a tree with nodes added and deleted, or an arena for one
+	loaded as a whole, instead of the heap.
+
+MIB *miblistnewmib(MIBLIST *l, OID *oid, unsigned char dataType, char access);
+void miblistfreemib(MIBLIST *l, MIB *mib);
+	Allocates a node of oid from the pool of the tree, with room right after
+	it for a value of MIB_INLINE_SIZE bytes where it is not an integer; and
+	frees it, e.g. if it has not been put into the tree. A longer value is
+	kept on the heap by mibsetvalue(). Returns NULL if fail.
+
+MIB *miblistput(MIBLIST *l, MIB *mib);
+	Puts the node mib into the tree, in order of its OID, and returns it, or
+	NULL if the tree has a node of that OID or it cannot be indexed. The
+	tree then owns mib, and frees it by miblistfreemib(), through its pool.
+	A node not made by miblistnewmib() must be allocated likewise, with
+	dataInline the room after it for the value, 0 if none, and dataHeap set
+	only if the value was allocated by mibsetvalue().
+
+MIB *miblistgooid(MIBLIST *l, OID *oid);
+	Makes the node with oid current and returns it. If it is not found, NULL is
+	returned and the current node is the first one that is lexicographically
+	greater than oid, or eol is set if there is none.
+
+MIB *miblistgetthis(MIBLIST *l);
+MIB *miblistgetnext(MIBLIST *l);
+MIB *miblistgetprev(MIBLIST *l);
+	Returns the current, next or previous node respectively. The current node
+	is unchanged.
+
+MIB *miblistgohead(MIBLIST *l);
+MIB *miblistgotail(MIBLIST *l);
+MIB *miblistgonext(MIBLIST *l);
+	Makes respectively the head, tail or next node current and returns it.
+	miblistgonext() sets eol and returns NULL past the tail node.
+
+MIB *miblistfind(MIBLIST *l, OID *oid);
+MIB *miblistfindnext(MIBLIST *l, OID *oid);
+	Returns respectively the node with oid, or the first node that is
+	lexicographically greater than oid, NULL if there is none. Unlike
+	miblistgooid(), the current node is unchanged. Where MIB_TRIE_INDEX is
+	defined, the lookup is made in the trie index of the tree.
+
+int miblistwalk(MIBLIST *l, OID *prefix, int (*func)(MIB *mib, void *arg), void *arg);
+	Calls func for each node in the subtree of prefix, in lexicographic order,
+	until func returns non-zero. Returns the number of nodes visited.
+	Conceptual tables are not visited.
+
+MIBTABLE *miblistaddtable(MIBLIST *l, char *oidstr, unsigned int mincol,
+	unsigned int maxcol, void *data);
+	Registers a conceptual table on the entry OID oidstr, with columns mincol
+	to maxcol, and returns it so that its callbacks may be set with
+	mibtablesetcallback(). data is passed to the callbacks in tbl->data.
+	Returns NULL if a table is already registered on oidstr.
+
+MIBTABLE *miblistgettable(MIBLIST *l, OID *oid);
+	Returns the table that oid is a cell of, NULL if none.
+*/
+
 #ifndef _MIBLIST_H
 #define _MIBLIST_H
 
 #include "list.h"
 #include "mib.h"
+#include "mibtable.h"
+#ifdef MIB_TRIE_INDEX
+#include "mibtrie.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif 
 
-LIST *miblistnew(int size);
-void miblistclear(LIST *l);
-void miblistfree(LIST *l);
+typedef struct {
+	MIB **mib;		/* Array of pointers to MIB nodes, in lexicographic order */
+	int alloc;		/* Number of allocated array elements */
+	int size;			/* Number of MIB nodes */
+	int limit;		/* Maximum number of MIB nodes, 0 if unlimited */
+	int curr;			/* Index of the current MIB node */
+	Boolean eol;
+	MIBTABLE *tables;	/* Conceptual tables registered on the tree */
+	MIB *block;		/* Nodes allocated as one, e.g. by mibimageopen(), not */
+	int nblock;		/* freed by miblistdel() */
+	MEMPOOL *pool;	/* Of the MIB nodes, NULL for the heap */
+#ifdef MIB_TRIE_INDEX
+	MIBTRIE *trie;	/* Index of the MIB nodes, NULL if not available */
+#endif
+} MIBLIST;
+
+MIBLIST *miblistnew(int size);
+void miblistclear(MIBLIST *l);
+void miblistfree(MIBLIST *l);
+int miblistsize(MIBLIST *l);
+void miblistsetpool(MIBLIST *l, MEMPOOL *pool);
+MIB *miblistnewmib(MIBLIST *l, OID *oid, unsigned char dataType, char access);
+void miblistfreemib(MIBLIST *l, MIB *mib);
 
 /* *data is a user-supplied space to hold the data of the MIB node. size
    refers to the length of this supplied space; and may be set to 0 for
-   interger/gauge/counter/timertick types as it will default to 4. */
-MIB *miblistadd(LIST *l, char *oidstr, unsigned char dataType, char access,
+   interger/gauge/counter/timertick types as it will default to 4. A value
+   later set longer than size is moved to a buffer of the node's own. */
+MIB *miblistadd(MIBLIST *l, char *oidstr, unsigned char dataType, char access,
 	void *data, int size);
 
-MIB *miblistput(LIST *l, MIB *mib);
-Boolean miblistdel(LIST *l);
-
-MIB *miblistset(LIST *l, OID *oid, void *u, int size);
-MIB *miblistgooid(LIST *l, OID *oid);
-MIB *miblistgetthis(LIST *l);
-MIB *miblistgetnext(LIST *l);
-MIB *miblistgetprev(LIST *l);
-MIB *miblistgohead(LIST *l);
-MIB *miblistgotail(LIST *l);
-MIB *miblistgonext(LIST *l);
+MIB *miblistput(MIBLIST *l, MIB *mib);
+Boolean miblistdel(MIBLIST *l);
+
+MIB *miblistset(MIBLIST *l, OID *oid, void *u, int size);
+MIB *miblistgooid(MIBLIST *l, OID *oid);
+MIB *miblistgetthis(MIBLIST *l);
+MIB *miblistgetnext(MIBLIST *l);
+MIB *miblistgetprev(MIBLIST *l);
+MIB *miblistgohead(MIBLIST *l);
+MIB *miblistgotail(MIBLIST *l);
+MIB *miblistgonext(MIBLIST *l);
+
+MIB *miblistfind(MIBLIST *l, OID *oid);
+MIB *miblistfindnext(MIBLIST *l, OID *oid);
+int miblistwalk(MIBLIST *l, OID *prefix, int (*func)(MIB *mib, void *arg), void *arg);
+
+MIBTABLE *miblistaddtable(MIBLIST *l, char *oidstr, unsigned int mincol,
+	unsigned int maxcol, void *data);
+MIBTABLE *miblistgettable(MIBLIST *l, OID *oid);
 
 #ifdef __cplusplus
 }
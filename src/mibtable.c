@@ -0,0 +1,121 @@
+/*
+ * Conceptual tables whose rows are resolved by user callbacks.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "retval.h"
+#include "mibtable.h"
+
+void mibtablesetcallback(MIBTABLE *tbl,
+	int (*get)(MIBTABLE *tbl, unsigned int col, OID *index, MIB *vb),
+	int (*nextindex)(MIBTABLE *tbl, unsigned int col, OID *index),
+	int (*set)(MIBTABLE *tbl, unsigned int col, OID *index, MIB *vb, void *data, int len))
+{
+	tbl->get = get;
+	tbl->nextindex = nextindex;
+	tbl->set = set;
+}
+
+int mibtablecell(MIBTABLE *tbl, OID *oid, unsigned int *col, OID *index)
+{
+	int i;
+
+	if (oid->len <= tbl->oid.len + 1)
+		return FAIL;  /* No index */
+	for (i = 0; i < tbl->oid.len; i++)
+		if (oid->array[i] != tbl->oid.array[i])
+			return FAIL;
+	*col = oid->array[i++];
+	if (*col < tbl->mincol || *col > tbl->maxcol)
+		return FAIL;
+	for (index->len = 0; i < oid->len; i++)
+		index->array[index->len++] = oid->array[i];
+	return SUCCESS;
+}
+
+int mibtableget(MIBTABLE *tbl, MIB *vb)
+{
+	unsigned int col;
+	OID index;
+
+	if (tbl->get == NULL || mibtablecell(tbl, &vb->oid, &col, &index) != SUCCESS)
+		return OID_NOT_FOUND;
+	vb->access = (tbl->set != NULL) ? RD_WR : RD_ONLY;
+	vb->get = NULL;
+	vb->set = NULL;
+	return tbl->get(tbl, col, &index, vb);
+}
+
+int mibtableset(MIBTABLE *tbl, MIB *vb, void *data, int len)
+{
+	unsigned int col;
+	OID index;
+
+	if (tbl->set == NULL)
+		return RD_ONLY_ACCESS;
+	if (mibtablecell(tbl, &vb->oid, &col, &index) != SUCCESS)
+		return OID_NOT_FOUND;
+	return tbl->set(tbl, col, &index, vb, data, len);
+}
+
+int mibtablenext(MIBTABLE *tbl, OID *oid, OID *next)
+{
+	int i;
+	unsigned int col = tbl->mincol;
+	OID index;
+
+	index.len = 0;
+	for (i = 0; i < tbl->oid.len && i < oid->len; i++)
+		if (oid->array[i] != tbl->oid.array[i]) {
+			if (oid->array[i] > tbl->oid.array[i])
+				return FAIL;  /* oid is past the table */
+			break;  /* oid is before the table */
+		}
+	if (i == tbl->oid.len && oid->len > i && oid->array[i] >= tbl->mincol) {
+		/* oid is in the table; continue from its column and index */
+		col = oid->array[i++];
+		for ( ; i < oid->len && index.len < OID_SIZE; i++)
+			index.array[index.len++] = oid->array[i];
+	}
+	if (tbl->nextindex == NULL)
+		return FAIL;
+	for ( ; col <= tbl->maxcol; col++, index.len = 0)
+		if (tbl->nextindex(tbl, col, &index) == SUCCESS) {
+			if (tbl->oid.len + 1 + index.len > OID_SIZE)
+				return FAIL;
+			*next = tbl->oid;
+			next->array[next->len++] = col;
+			for (i = 0; i < index.len; i++)
+				next->array[next->len++] = index.array[i];
+			return SUCCESS;
+		}
+	return FAIL;
+}
@@ -0,0 +1,106 @@
+/*
+ * Conceptual tables whose rows are resolved by user callbacks.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+A conceptual table is registered on the OID of its entry, e.g. ifEntry, with
+miblistaddtable(). A cell of the table has the OID <entry>.<column>.<index>,
+where the index is one or more sub-identifiers that name the row. Rather than
+a MIB node per cell, the table is served by callbacks that take the column and
+index of a cell, so rows may come straight from the device's own data.
+
+int (*get)(MIBTABLE *tbl, unsigned int col, OID *index, MIB *vb);
+	Fills in the dataType, value and dataLen of the cell in *vb, whose oid is
+	set by the agent and whose u.octetstring points to MIB_DATA_SIZE bytes.
+	Returns NO_ERR, OID_NOT_FOUND if there is no such row, or another SNMP
+	Operations function return code defined in snmpdefs.h.
+
+int (*nextindex)(MIBTABLE *tbl, unsigned int col, OID *index);
+	Replaces *index with that of the next row, in lexicographic order, that
+	has a value in column col. index->len is 0 to ask for the first row.
+	*index need not be that of an existing row. Returns SUCCESS, or FAIL if
+	there are no more rows.
+
+int (*set)(MIBTABLE *tbl, unsigned int col, OID *index, MIB *vb, void *data, int len);
+	As the set callback of a MIB node. *vb holds the current value of the
+	cell, and data and len the new one. The table is read-only if set is NULL.
+
+For the callbacks, an index is held in an OID whose array[0] is the first
+sub-identifier of the index, not an OID prefix character.
+*/
+
+#ifndef _MIBTABLE_H
+#define _MIBTABLE_H
+
+#include "mib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif 
+
+typedef struct mibtable {
+	OID oid;						/* OID of the table entry */
+	unsigned int mincol;	/* Sub-identifier of the first column */
+	unsigned int maxcol;	/* Sub-identifier of the last column */
+	void *data;					/* User data, e.g. the device's own table */
+	int (*get)(struct mibtable *, unsigned int, OID *, MIB *);
+	int (*nextindex)(struct mibtable *, unsigned int, OID *);
+	int (*set)(struct mibtable *, unsigned int, OID *, MIB *, void *, int);
+	struct mibtable *next;	/* Next table registered on the MIB tree */
+} MIBTABLE;
+
+void mibtablesetcallback(MIBTABLE *tbl,
+	int (*get)(MIBTABLE *tbl, unsigned int col, OID *index, MIB *vb),
+	int (*nextindex)(MIBTABLE *tbl, unsigned int col, OID *index),
+	int (*set)(MIBTABLE *tbl, unsigned int col, OID *index, MIB *vb, void *data, int len));
+
+/* Splits oid into the column and index of a cell of tbl. Returns SUCCESS, or
+   FAIL if oid is not that of a cell of tbl. */
+int mibtablecell(MIBTABLE *tbl, OID *oid, unsigned int *col, OID *index);
+
+/* Gets the value of the cell at vb->oid into *vb, and sets its access.
+   Returns a SNMP Operations function return code defined in snmpdefs.h. */
+int mibtableget(MIBTABLE *tbl, MIB *vb);
+
+/* Sets the cell at vb->oid to data. Returns a SNMP Operations function return
+   code defined in snmpdefs.h. */
+int mibtableset(MIBTABLE *tbl, MIB *vb, void *data, int len);
+
+/* Finds the OID of the first cell of tbl that is lexicographically greater
+   than oid. Returns SUCCESS, or FAIL if there is none. */
+int mibtablenext(MIBTABLE *tbl, OID *oid, OID *next);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
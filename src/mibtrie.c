@@ -0,0 +1,280 @@
+/*
+ * Implements an arc-by-arc trie index over the nodes of a MIB tree.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "retval.h"
+#include "mibtrie.h"
+
+/* Binary search for arc among the children of node. Returns the index of the
+   first child whose arc is not smaller, and sets *found if it is equal. */
+static int triesearch(TRIENODE *node, unsigned int arc, int *found)
+{
+	int lo = 0, hi = node->nchild, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) >> 1;
+		if (node->child[mid].arc < arc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*found = (lo < node->nchild && node->child[lo].arc == arc);
+	return lo;
+}
+
+/* Returns the child of node for arc, adding it if it does not exist. */
+static TRIENODE *triechild(TRIENODE *node, unsigned int arc)
+{
+	int i, found, alloc;
+	TRIENODE *p;
+
+	/* Nodes added in order, as from a MIB image, are on or past the last child */
+	if (node->nchild == 0 || node->child[node->nchild-1].arc < arc) {
+		i = node->nchild;
+		found = 0;
+	}
+	else if (node->child[node->nchild-1].arc == arc)
+		return node->child+node->nchild-1;
+	else
+		i = triesearch(node, arc, &found);
+	if (found)
+		return node->child+i;
+	if (node->nchild == node->alloc) {
+		alloc = node->alloc ? node->alloc * 2 : 1;
+		if ((p=(TRIENODE *)realloc(node->child, alloc*sizeof(TRIENODE))) == NULL)
+			return NULL;
+		node->child = p;
+		node->alloc = alloc;
+	}
+	if (i < node->nchild)
+		memmove(node->child+i+1, node->child+i, (node->nchild-i)*sizeof(TRIENODE));
+	node->nchild++;
+	p = node->child+i;
+	p->arc = arc;
+	p->nchild = p->alloc = 0;
+	p->mib = NULL;
+	p->child = NULL;
+	return p;
+}
+
+static void triefree(TRIENODE *node)
+{
+	int i;
+
+	for (i = 0; i < node->nchild; i++)
+		triefree(node->child+i);
+	free(node->child);
+}
+
+/* Returns the trie node of the first len arcs of oid, NULL if not found. */
+static TRIENODE *triefind(MIBTRIE *t, OID *oid, int len)
+{
+	TRIENODE *node = &t->root;
+	int i, j, found;
+
+	for (i = 0; i < len; i++) {
+		j = triesearch(node, oid->array[i], &found);
+		if (!found)
+			return NULL;
+		node = node->child+j;
+	}
+	return node;
+}
+
+/* Returns the first MIB node in the subtree of node, node itself included. */
+static MIB *triefirst(TRIENODE *node)
+{
+	int i;
+	MIB *mib;
+
+	if (node->mib)
+		return node->mib;
+	for (i = 0; i < node->nchild; i++)
+		if ((mib=triefirst(node->child+i)))
+			return mib;
+	return NULL;
+}
+
+static MIB *trienext(TRIENODE *node, OID *oid, int depth)
+{
+	int i, found;
+	MIB *mib;
+
+	if (depth == oid->len)
+		i = found = 0;  /* All of node's descendants are greater than oid */
+	else {
+		i = triesearch(node, oid->array[depth], &found);
+		if (found) {
+			if ((mib=trienext(node->child+i, oid, depth+1)))
+				return mib;
+			i++;
+		}
+	}
+	for ( ; i < node->nchild; i++)
+		if ((mib=triefirst(node->child+i)))
+			return mib;
+	return NULL;
+}
+
+/* Removes child i of node if it indexes no MIB node, nor has children. */
+static void trieprune(TRIENODE *node, int i)
+{
+	TRIENODE *child = node->child+i;
+
+	if (child->mib == NULL && child->nchild == 0) {
+		free(child->child);
+		node->nchild--;
+		if (i < node->nchild)
+			memmove(node->child+i, node->child+i+1, (node->nchild-i)*sizeof(TRIENODE));
+	}
+}
+
+static MIB *triedel(TRIENODE *node, OID *oid, int depth)
+{
+	int i, found;
+	MIB *mib;
+
+	if (depth == oid->len) {
+		mib = node->mib;
+		node->mib = NULL;
+		return mib;
+	}
+	i = triesearch(node, oid->array[depth], &found);
+	if (!found)
+		return NULL;
+	if ((mib=triedel(node->child+i, oid, depth+1)))
+		trieprune(node, i);  /* The now empty branch */
+	return mib;
+}
+
+/* Removes the empty branch along the first len arcs of oid, as left by an
+   add that failed part of the way. */
+static void trieundo(TRIENODE *node, OID *oid, int depth, int len)
+{
+	int i, found;
+
+	if (depth == len)
+		return;
+	i = triesearch(node, oid->array[depth], &found);
+	if (!found)
+		return;
+	trieundo(node->child+i, oid, depth+1, len);
+	trieprune(node, i);
+}
+
+static int triewalk(TRIENODE *node, int (*func)(MIB *mib, void *arg), void *arg, int *stop)
+{
+	int i, n = 0;
+
+	if (node->mib) {
+		n++;
+		if (func(node->mib, arg))
+			{ *stop = TRUE; return n; }
+	}
+	for (i = 0; i < node->nchild && !*stop; i++)
+		n += triewalk(node->child+i, func, arg, stop);
+	return n;
+}
+
+MIBTRIE *mibtrienew(void)
+{
+	MIBTRIE *t;
+
+	if ((t=(MIBTRIE *)malloc(sizeof(MIBTRIE)))) {
+		t->root.arc = 0;
+		t->root.nchild = t->root.alloc = 0;
+		t->root.mib = NULL;
+		t->root.child = NULL;
+		t->size = 0;
+	}
+	return t;
+}
+
+void mibtriefree(MIBTRIE *t)
+{
+	triefree(&t->root);
+	free(t);
+}
+
+MIB *mibtrieadd(MIBTRIE *t, MIB *mib)
+{
+	TRIENODE *node = &t->root;
+	int i;
+
+	for (i = 0; i < mib->oid.len; i++)
+		if ((node=triechild(node, mib->oid.array[i])) == NULL) {
+			trieundo(&t->root, &mib->oid, 0, i);
+			return NULL;
+		}
+	if (node->mib)
+		return NULL;
+	node->mib = mib;
+	t->size++;
+	return mib;
+}
+
+MIB *mibtriedel(MIBTRIE *t, OID *oid)
+{
+	MIB *mib;
+
+	if ((mib=triedel(&t->root, oid, 0)))
+		t->size--;
+	return mib;
+}
+
+MIB *mibtriefind(MIBTRIE *t, OID *oid)
+{
+	TRIENODE *node;
+
+	if ((node=triefind(t, oid, oid->len)))
+		return node->mib;
+	else
+		return NULL;
+}
+
+MIB *mibtrienext(MIBTRIE *t, OID *oid)
+{
+	return trienext(&t->root, oid, 0);
+}
+
+int mibtriewalk(MIBTRIE *t, OID *prefix, int (*func)(MIB *mib, void *arg), void *arg)
+{
+	TRIENODE *node;
+	int stop = FALSE;
+
+	if ((node=triefind(t, prefix, prefix->len)))
+		return triewalk(node, func, arg, &stop);
+	else
+		return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Implements an arc-by-arc trie index over the nodes of a MIB tree.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+mibtrie.c indexes MIB nodes by their OIDs in a trie, one trie node per
+sub-identifier (arc). MIB nodes that share a prefix share the trie nodes of
+that prefix, and the children of a trie node are kept in a contiguous array in
+ascending order of arc. A lookup thus costs in proportion to the depth of the
+OID, not the number of MIB nodes. array[0] of an OID, the prefix character,
+is treated as the first arc. The trie does not own the MIB nodes it indexes.
+
+The trie is an index on top of the MIB nodes, which keep their full OIDs,
+so it adds to the memory of the tree rather than saving the prefixes: a
+trie node of 32 bytes on a 64-bit host for each arc not shared, with up to
+as much again of spare room in the child arrays, whose room is doubled as
+they grow. A table of 100000 leaves takes about 53 bytes a leaf more.
+
+MIBTRIE *mibtrienew(void);
+	Instantiate an empty trie.
+
+void mibtriefree(MIBTRIE *t);
+	Free the trie, but not the MIB nodes it indexes.
+
+MIB *mibtrieadd(MIBTRIE *t, MIB *mib);
+	Indexes mib by its OID and returns it, or NULL if the OID is already
+	indexed or memory is exhausted, in which case the trie is unchanged.
+
+MIB *mibtriedel(MIBTRIE *t, OID *oid);
+	Removes oid from the trie and returns its MIB node, NULL if not found.
+
+MIB *mibtriefind(MIBTRIE *t, OID *oid);
+	Returns the MIB node of oid, NULL if not found.
+
+MIB *mibtrienext(MIBTRIE *t, OID *oid);
+	Returns the first MIB node that is lexicographically greater than oid,
+	NULL if there is none. oid need not be in the trie.
+
+int mibtriewalk(MIBTRIE *t, OID *prefix, int (*func)(MIB *mib, void *arg), void *arg);
+	Calls func for each MIB node in the subtree of prefix, in lexicographic
+	order, until func returns non-zero. Returns the number of nodes visited.
+*/
+
+#ifndef _MIBTRIE_H
+#define _MIBTRIE_H
+
+#include "mib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif 
+
+typedef struct trienode {
+	unsigned int arc;		/* Sub-identifier of this node */
+	int nchild;					/* Number of children */
+	int alloc;					/* Number of allocated children */
+	MIB *mib;						/* MIB node whose OID ends here, NULL if none */
+	struct trienode *child;	/* Children in ascending order of arc */
+} TRIENODE;
+
+typedef struct {
+	TRIENODE root;
+	int size;						/* Number of indexed MIB nodes */
+} MIBTRIE;
+
+MIBTRIE *mibtrienew(void);
+void mibtriefree(MIBTRIE *t);
+MIB *mibtrieadd(MIBTRIE *t, MIB *mib);
+MIB *mibtriedel(MIBTRIE *t, OID *oid);
+MIB *mibtriefind(MIBTRIE *t, OID *oid);
+MIB *mibtrienext(MIBTRIE *t, OID *oid);
+int mibtriewalk(MIBTRIE *t, OID *prefix, int (*func)(MIB *mib, void *arg), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -37,7 +37,7 @@
 #include <string.h>
 #include "mibutil.h"
 
-#define BUF_SIZE 256
+#define BUF_SIZE MIB_LINE_SIZE
 
 /* Prints the MIB data as a keylist string in s. */
 void mibprint(MIB *thismib, char *s)
@@ -91,7 +91,8 @@ int mibscan(MIB *thismib, char *s)
 	char dataType, access, oidstr[MIB_DATA_SIZE], str[BUF_SIZE];
 	OID oid;
 
-	sscanf(s, "%[^=]=%c,%c,%s", oidstr, &dataType, &access, str);
+	str[0] = '\0';  /* An empty octet string has no value */
+	if (sscanf(s, "%[^=]=%c,%c,%s", oidstr, &dataType, &access, str) < 3) return FAIL;
 	if (str2oid(oidstr, &oid) == 0) return FAIL;
 	thismib->oid.len = oid.len;
 	for (i = 0; i<oid.len; i++)
@@ -112,7 +113,8 @@ int mibscan(MIB *thismib, char *s)
 			break;
 		case 'A' :
 			thismib->dataType = IP_ADDRESS;
-			thismib->dataLen = str2oct(str, thismib->u.octetstring);
+			if ((thismib->dataLen = str2oct(str, thismib->u.octetstring)) != IP_ADDRESS_SIZE)
+				return FAIL;
 			break;
 		case 'I' :
 			thismib->dataType = INTEGER;
@@ -134,14 +136,27 @@ int mibscan(MIB *thismib, char *s)
 			thismib->u.intval = atoi(str);
 			thismib->dataLen = INT_SIZE;
 			break;
+		default :
+			return FAIL;
 	}
 	return SUCCESS;
 }
 
+/* Copies the value scanned into mib to thismib. Returns Success(0) or Fail(-1) */
+static int mibcopyvalue(MIB *thismib, MIB *mib)
+{
+	if (thismib->dataType==OBJECT_IDENTIFIER || thismib->dataType==OCTET_STRING ||
+      thismib->dataType==IP_ADDRESS)
+		return mibsetvalue(thismib, mib->u.octetstring, mib->dataLen);
+	thismib->dataLen = mib->dataLen;
+	thismib->u.intval = mib->u.intval;
+	return SUCCESS;
+}
+
 /*
  * Reads from a file and populates a MIB list.
  */
-int miblistread(LIST *miblist, char *fn)
+int miblistread(MIBLIST *miblist, char *fn)
 {
 	char buf[BUF_SIZE];
 	unsigned char octetdata[BUF_SIZE];
@@ -151,26 +166,15 @@ int miblistread(LIST *miblist, char *fn)
 	if ((f = fopen(fn, "r"))) {
 		while (fgets(buf, BUF_SIZE, f)) {
 			mib.u.octetstring = octetdata;     // reset u
-			if (mibscan(&mib, buf) == SUCCESS) {
+			if (mibscan(&mib, buf) == SUCCESS && mib.dataLen <= MIB_DATA_SIZE) {
 				if ((thismib=miblistgooid(miblist, &mib.oid))==NULL) {
-					thismib = malloc(sizeof(MIB));
-					*thismib = mib;
-					if (thismib->dataType==OBJECT_IDENTIFIER || thismib->dataType==OCTET_STRING ||
-              thismib->dataType==IP_ADDRESS) {
-						if (mib.dataLen < MIB_DATA_SIZE)
-							thismib->u.octetstring = malloc(MIB_DATA_SIZE);
-						else
-							thismib->u.octetstring = malloc(mib.dataLen);
-					}
-          thismib->get = NULL;
-					thismib->set = NULL;
-					miblistput(miblist, thismib);
+					if ((thismib = miblistnewmib(miblist, &mib.oid, mib.dataType, mib.access)) == NULL)
+						continue;
+					if (mibcopyvalue(thismib, &mib) != SUCCESS || miblistput(miblist, thismib) == NULL)
+						miblistfreemib(miblist, thismib);
 				}
-				if (thismib->dataType==OBJECT_IDENTIFIER || thismib->dataType==OCTET_STRING ||
-            thismib->dataType==IP_ADDRESS)
-					memcopy(thismib->u.octetstring, mib.u.octetstring, mib.dataLen);
-				else
-					thismib->u.intval = mib.u.intval;
+				else if (thismib->dataType == mib.dataType)
+					mibcopyvalue(thismib, &mib);  /* Unchanged if it fails */
 			}
 		}
 		fclose(f);
@@ -180,20 +184,20 @@ int miblistread(LIST *miblist, char *fn)
 		return FAIL;
 }
 
-void miblistprint(LIST *miblist, FILE *f)
+void miblistprint(MIBLIST *miblist, FILE *f)
 {
 	MIB *thismib;
 	char s[BUF_SIZE];
 
-	thismib=(MIB *)listgohead(miblist);
+	thismib=miblistgohead(miblist);
 	while (thismib) {
 		mibprint(thismib, s);
 		fprintf(f, "%s\n", s);
-		thismib=(MIB *)listgonext(miblist);
+		thismib=miblistgonext(miblist);
 	}
 }
 
-int miblistwrite(LIST *miblist, char *fn)
+int miblistwrite(MIBLIST *miblist, char *fn)
 {
 	FILE *f;
 
@@ -206,25 +210,25 @@ int miblistwrite(LIST *miblist, char *fn)
 		return FAIL;
 }
 
-void vblistPrint(struct messageStruct *vblist, FILE *f)
+void vbviewPrint(VBVIEW *vb, int n, FILE *f)
 {
-	MIB vb;
-	unsigned char octetdata[BUF_SIZE];
+	MIB mib;
 	char s[BUF_SIZE];
 
-	vb.u.octetstring = octetdata;
-	if (vblistGet(vblist, &vb, 0) > 0) {
-		mibprint(&vb, s);
+	for (; n > 0; n--, vb++) {
+		vbviewMib(vb, &mib);
+		mibprint(&mib, s);
 		fprintf(f, "%s\n", s);
-		vb.u.octetstring = octetdata;     // reset u
-		while (vblistGet(vblist, &vb, 1) > 0) {
-			mibprint(&vb, s);
-			fprintf(f, "%s\n", s);
-			vb.u.octetstring = octetdata;   // reset u
-		}
 	}
 }
 
+void vblistPrint(struct messageStruct *vblist, FILE *f)
+{
+	VBVIEW vb[VBVIEW_MAX(RESPONSE_BUFFER_SIZE)];
+
+	vbviewPrint(vb, vblistView(vblist->buffer, vblist->len, vb, VBVIEW_MAX(RESPONSE_BUFFER_SIZE)), f);
+}
+
 /*
  * Display packet, mainly used for debugging.
  */
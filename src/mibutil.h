@@ -33,6 +33,7 @@
 
 #ifndef _MIBUTIL_H
 #define _MIBUTIL_H
+#include <stdio.h>
 
 #include "octet.h"
 #include "miblist.h"
@@ -42,19 +43,26 @@
 extern "C" {
 #endif
 
-/* Prints the MIB data as a keylist string in s. */
+/* Size of a keylist string of MIB data, with an octet string of MIB_DATA_SIZE
+   bytes in hex and as text. */
+#define MIB_LINE_SIZE (4*MIB_DATA_SIZE + 128)
+
+/* Prints the MIB data as a keylist string in s, of MIB_LINE_SIZE bytes. */
 void mibprint(MIB *thismib, char *s);
 
 /* Scans a keylist string of MIB data into the MIB structure. */
 int mibscan(MIB *thismib, char *s);
 
 /* Reads from a file and populates a MIB list. */
-int miblistread(LIST *l, char *fn);
+int miblistread(MIBLIST *l, char *fn);
 
-void miblistprint(LIST *l, FILE *f);
-int miblistwrite(LIST *l, char *fn);
+void miblistprint(MIBLIST *l, FILE *f);
+int miblistwrite(MIBLIST *l, char *fn);
 void vblistPrint(struct messageStruct *vblist, FILE *f);
 
+/* Prints n varbind views, one per line. */
+void vbviewPrint(VBVIEW *vb, int n, FILE *f);
+
 /* Display packet, mainly used for debugging. */
 void showMessage(struct messageStruct *pkt);
 
@@ -185,11 +185,14 @@ int ber2oid(unsigned char *str, int len, OID *oid)
 	if ( oid->array[0] == 'U' )
 		oid->len = 0;
 	else {
-		while (i < len) {
+		while (i < len && j < OID_SIZE) {
 			k = 0;
-			while (str[i] & '\x80')
+			while (i < len-1 && (str[i] & '\x80'))
 				k = (k | (str[i++] & '\x7F')) << 7;
-			oid->array[j++] = k | str[i++];
+			oid->array[j++] = k | (str[i++] & '\x7F');
+		}
+		if (i < len) {  /* Too long for the OID array */
+			oid->array[0] = 'U'; j = 0;
 		}
 		oid->len = j;
 	}
@@ -0,0 +1,334 @@
+/*
+ * Packs any number of varbinds into the fewest requests that fit an agent,
+ * learning the size each agent can answer from its tooBig errors.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "planner.h"
+#include "resolver.h"
+
+#define PLANNER_WAYS 4  /* Slots an agent may take in the cache */
+#define PLAN_CHUNK 1024
+
+/* An outstanding request of a batch */
+typedef struct {
+	PLAN *plan;
+	int a, b;
+	int size;
+} PLANREQ;
+
+/* Finds the cache entry of the agent at to, taking the least recently used
+   of its slots if it is not known */
+static PLANAGENT *planagent(PLANNER *pl, struct sockaddr *to)
+{
+	unsigned int h = sockaddrhash(to);
+	PLANAGENT *a, *lru = NULL;
+	int i;
+
+	pl->clock++;
+	for (i = 0; i < PLANNER_WAYS; i++) {
+		a = &pl->agent[(h + i) & pl->mask];
+		if (sockaddreq((struct sockaddr *)&a->addr, to)) {  /* Empty slots have no family */
+			a->used = pl->clock;
+			return a;
+		}
+		if (lru == NULL || a->used < lru->used) lru = a;
+	}
+	memcpy(&lru->addr, to, sockaddrlen(to));
+	lru->limit = pl->size;
+	lru->ok = 0;
+	lru->used = pl->clock;
+	return lru;
+}
+
+/* Makes room for len more bytes in *buf of *alloc. Returns Success(0) or Fail(-1). */
+static int planroom(unsigned char **buf, int *alloc, int used, int len)
+{
+	unsigned char *p;
+
+	if (used + len <= *alloc) return SUCCESS;
+	if ((p = (unsigned char *)realloc(*buf, *alloc + PLAN_CHUNK + len)) == NULL) return FAIL;
+	*buf = p;
+	*alloc += PLAN_CHUNK + len;
+	return SUCCESS;
+}
+
+static void planwait(PLAN *plan, int a, int b)
+{
+	if (a >= b) return;
+	plan->wait[plan->nwait].a = a;
+	plan->wait[plan->nwait].b = b;
+	plan->nwait++;
+}
+
+/* Gives the varbinds from a up to b the result status */
+static void planfail(PLAN *plan, int a, int b, int status)
+{
+	for (; a < b; a++) {
+		plan->vb[a].status = status;
+		plan->pending--;
+	}
+}
+
+/* Completes a request of the batch */
+static void planresponse(POLLER *p, MSGVIEW *msg, void *arg)
+{
+	PLANREQ *r = (PLANREQ *)arg;
+	PLAN *plan = r->plan;
+	PLANAGENT *agent = planagent(plan->pl, (struct sockaddr *)&plan->to);
+	PLANVB *v;
+	unsigned char l[3];
+	int i, len, hlen, k, half;
+
+	(void)p;  /* That of the planner, plan->pl->p */
+	plan->outstanding--;
+	if (msg == NULL)
+		planfail(plan, r->a, r->b, FAIL);
+	else if (msg->errorStatus == NO_ERR && msg->nvb == r->b - r->a) {
+		if (r->size > agent->ok) agent->ok = r->size;
+		for (i = 0; i < msg->nvb; i++) {
+			v = &plan->vb[r->a + i];
+			/* Kept with its SEQUENCE header, for vbView() */
+			len = (int)(msg->vb[i].val + msg->vb[i].valLen - msg->vb[i].name);
+			hlen = buildLength(l, len);
+			if (planroom(&plan->res, &plan->resAlloc, plan->resLen, 1 + hlen + len) != SUCCESS) {
+				planfail(plan, r->a + i, r->b, FAIL);
+				break;
+			}
+			v->resOff = plan->resLen;
+			v->resLen = 1 + hlen + len;
+			plan->res[plan->resLen] = SEQUENCE;
+			memcopy(plan->res + plan->resLen + 1, l, hlen);
+			memcopy(plan->res + plan->resLen + 1 + hlen, msg->vb[i].name, len);
+			plan->resLen += v->resLen;
+			v->status = SUCCESS;
+			plan->pending--;
+		}
+	}
+	else if (msg->errorStatus == TOO_BIG && r->b - r->a > 1) {
+		plan->tooBig++;
+		half = (r->a + r->b) / 2;
+		len = plan->vb[r->b-1].off + plan->vb[r->b-1].len - plan->vb[half].off;
+		k = plan->vb[half].off - plan->vb[r->a].off;
+		if (len < k) len = k;  /* The larger half */
+		if (len < agent->ok) len = agent->ok;
+		if (len < agent->limit) agent->limit = len;
+		planwait(plan, half, r->b);
+		planwait(plan, r->a, half);
+	}
+	else if (msg->errorStatus != NO_ERR && msg->errorIndex >= 1 &&
+		(int) msg->errorIndex <= r->b - r->a && plan->reqType != SET_REQUEST) {
+		k = r->a + msg->errorIndex - 1;
+		planfail(plan, k, k+1, msg->errorStatus);
+		planwait(plan, k+1, r->b);
+		planwait(plan, r->a, k);
+	}
+	else
+		planfail(plan, r->a, r->b, msg->errorStatus != NO_ERR ? (int) msg->errorStatus : FAIL);
+	free(r);
+}
+
+/* Sends the next range waiting, or as much of it as fits the ceiling of the
+   agent. Returns 1 if sent, 0 if none is waiting or the poller is full, or
+   Fail(-1). */
+static int plansend(PLAN *plan)
+{
+	unsigned char buf[REQUEST_BUFFER_SIZE];
+	struct messageStruct vblist;
+	PLANRANGE *w;
+	PLANREQ *r;
+	int limit, c, size, hlen, ret;
+
+	if (plan->nwait == 0) return 0;
+	w = &plan->wait[plan->nwait-1];
+	limit = planagent(plan->pl, (struct sockaddr *)&plan->to)->limit;
+	for (c = w->a + 1; c < w->b && plan->vb[c].off + plan->vb[c].len - plan->vb[w->a].off <= limit; c++);
+	size = plan->vb[c-1].off + plan->vb[c-1].len - plan->vb[w->a].off;
+	if ((r = (PLANREQ *)malloc(sizeof(PLANREQ))) == NULL) return FAIL;
+	r->plan = plan;
+	r->a = w->a;
+	r->b = c;
+	r->size = size;
+	buf[0] = SEQUENCE_OF;
+	hlen = 1 + buildLength(buf+1, size);
+	if (hlen + size > REQUEST_BUFFER_SIZE) {  /* A varbind too big for any request */
+		free(r);
+		return FAIL;
+	}
+	memcopy(buf+hlen, plan->req + plan->vb[w->a].off, size);
+	vblist.buffer = buf;
+	vblist.len = vblist.size = hlen + size;
+	vblist.index = 0;
+	if ((ret = pollersend(plan->pl->p, (struct sockaddr *)&plan->to, plan->community, plan->reqType, &vblist,
+		planresponse, r)) < 0) {
+		free(r);
+		return ret == BUFFER_FULL ? 0 : FAIL;
+	}
+	if (c < w->b) w->a = c;
+	else plan->nwait--;
+	plan->outstanding++;
+	plan->requests++;
+	return 1;
+}
+
+PLANNER *plannernew(POLLER *p, int agents, int size)
+{
+	PLANNER *pl;
+	int n;
+
+	for (n = PLANNER_WAYS; n < agents; n <<= 1);
+	if ((pl = (PLANNER *)malloc(sizeof(PLANNER))) == NULL) return NULL;
+	if ((pl->agent = (PLANAGENT *)calloc(n, sizeof(PLANAGENT))) == NULL) {
+		free(pl);
+		return NULL;
+	}
+	pl->p = p;
+	pl->size = size > PLANNER_SIZE ? PLANNER_SIZE : size;
+	pl->mask = n - 1;
+	pl->clock = 0;
+	return pl;
+}
+
+void plannerfree(PLANNER *pl)
+{
+	free(pl->agent);
+	free(pl);
+}
+
+int plannerlimit(PLANNER *pl, struct sockaddr *to)
+{
+	return planagent(pl, to)->limit;
+}
+
+PLAN *plannew(PLANNER *pl, struct sockaddr *to, char *community, unsigned char reqType)
+{
+	PLAN *plan;
+
+	if (strlen(community) >= COMM_STR_SIZE) return NULL;
+	if ((plan = (PLAN *)malloc(sizeof(PLAN))) == NULL) return NULL;
+	memset(plan, 0, sizeof(PLAN));
+	plan->pl = pl;
+	memcpy(&plan->to, to, sockaddrlen(to));
+	strcpy(plan->community, community);
+	plan->reqType = reqType;
+	return plan;
+}
+
+void planfree(PLAN *plan)
+{
+	free(plan->vb);
+	free(plan->req);
+	free(plan->res);
+	free(plan->wait);
+	free(plan);
+}
+
+int planadd(PLAN *plan, char *oidstr, unsigned char dataType, void *val, int vlen)
+{
+	unsigned char buf[VB_BUFFER_SIZE+4];
+	struct messageStruct list;
+	PLANVB *vb;
+	int len, hlen;
+
+	/* The varbind is built as the only one of a list, and taken out of it */
+	list.buffer = buf; list.size = sizeof(buf);
+	vblistReset(&list);
+	if (vblistAdd(&list, oidstr, dataType, val, vlen) < 0) return FAIL;
+	hlen = 1 + parseLength(buf+1, &len);
+	if (plan->n == plan->alloc) {
+		if ((vb = (PLANVB *)realloc(plan->vb, (plan->alloc + 64) * sizeof(PLANVB))) == NULL)
+			return FAIL;
+		plan->vb = vb;
+		plan->alloc += 64;
+	}
+	if (planroom(&plan->req, &plan->reqAlloc, plan->reqLen, len) != SUCCESS) return FAIL;
+	vb = &plan->vb[plan->n];
+	vb->off = plan->reqLen;
+	vb->len = len;
+	vb->status = FAIL;
+	memcopy(plan->req + plan->reqLen, buf+hlen, len);
+	plan->reqLen += len;
+	return plan->n++;
+}
+
+int planstart(PLAN *plan)
+{
+	free(plan->wait);
+	if ((plan->wait = (PLANRANGE *)malloc((plan->n + 1) * sizeof(PLANRANGE))) == NULL)
+		return FAIL;
+	plan->nwait = 0;
+	plan->pending = plan->n;
+	plan->requests = plan->tooBig = 0;
+	plan->resLen = 0;
+	planwait(plan, 0, plan->n);
+	return planpump(plan);
+}
+
+int planpump(PLAN *plan)
+{
+	int n = 0, ret;
+
+	while ((ret = plansend(plan)) > 0) n++;
+	if (ret < 0) {  /* What waits cannot be sent */
+		for (; plan->nwait > 0; plan->nwait--)
+			planfail(plan, plan->wait[plan->nwait-1].a, plan->wait[plan->nwait-1].b, FAIL);
+		return n ? n : FAIL;
+	}
+	return n;
+}
+
+Boolean plandone(PLAN *plan)
+{
+	return plan->pending == 0 && plan->outstanding == 0;
+}
+
+int planrun(PLAN *plan)
+{
+	int i;
+
+	if (planstart(plan) < 0) return FAIL;
+	while (!plandone(plan)) {
+		planpump(plan);
+		if (pollerwait(plan->pl->p, POLLER_TICK) < 0) return FAIL;
+	}
+	for (i = 0; i < plan->n; i++)
+		if (plan->vb[i].status != SUCCESS) return FAIL;
+	return SUCCESS;
+}
+
+int planresult(PLAN *plan, int i, VBVIEW *vb)
+{
+	if (plan->vb[i].status != SUCCESS) return plan->vb[i].status;
+	return vbView(plan->res + plan->vb[i].resOff, plan->vb[i].resLen, vb) > 0 ? SUCCESS : FAIL;
+}
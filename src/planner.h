@@ -0,0 +1,166 @@
+/*
+ * Packs any number of varbinds into the fewest requests that fit an agent,
+ * learning the size each agent can answer from its tooBig errors.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+planner.c sends a batch of varbinds to an agent, in as few requests as
+fit the size of request it can answer. The varbinds are packed in order
+into requests of up to a ceiling, in bytes of the varbind list. A request
+answered tooBig is split in half, and each half sent again, and the
+ceiling of the agent lowered to the larger half, but not below the
+largest request it has answered. The ceilings are kept in a cache of a
+number of agents, shared by all batches of the planner, so that later
+batches to an agent are packed to fit at once. The requests go through a
+poller of poller.h, which times them out and retries them.
+
+PLANNER *plannernew(POLLER *p, int agents, int size);
+	Instantiate a planner sending through p, keeping the ceilings of up to
+	agents agents, the least recently used replaced. An agent not known
+	starts at a ceiling of size bytes, at most PLANNER_SIZE. Returns NULL if
+	fail.
+
+void plannerfree(PLANNER *pl);
+	Free the planner. Its batches must be freed first.
+
+int plannerlimit(PLANNER *pl, struct sockaddr *to);
+	Returns the ceiling of the agent at to.
+
+PLAN *plannew(PLANNER *pl, struct sockaddr *to, char *community, unsigned char reqType);
+	Instantiate a batch of varbinds to send to the agent at to with the
+	community string, in requests of reqType. Returns NULL if fail.
+
+void planfree(PLAN *plan);
+	Free the batch. Its requests must not be outstanding.
+
+int planadd(PLAN *plan, char *oidstr, unsigned char dataType, void *val, int vlen);
+	Adds a varbind, as vblistAdd() does. Returns its index in the batch,
+	from 0, or Fail(-1).
+
+int planstart(PLAN *plan);
+	Sends the first requests of the batch. Returns the number sent, or
+	Fail(-1).
+
+int planpump(PLAN *plan);
+	Sends the requests waiting, while the poller has room. Returns the
+	number sent.
+
+Boolean plandone(PLAN *plan);
+	Returns TRUE when every varbind of the batch has a result.
+
+int planrun(PLAN *plan);
+	Starts the batch, and waits on the poller for it to be done. Returns
+	Success(0) if every varbind was answered without error, else Fail(-1).
+
+int planresult(PLAN *plan, int i, VBVIEW *vb);
+	Returns the result of the varbind i: Success(0), with the varbind of
+	the response in vb; the error status of the agent, e.g. NO_SUCH_NAME;
+	or Fail(-1) if it timed out.
+
+A request failing on one of its varbinds of a Get or GetNext has that
+varbind take the error status, and the others sent again. A Set request
+failing has all its varbinds take the error status; a Set split for being
+tooBig is no longer applied at once. plan->requests counts
+the requests sent, and plan->tooBig those answered tooBig.
+*/
+
+#ifndef _PLANNER_H
+#define _PLANNER_H
+
+#include "list.h"
+#include "poller.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The largest varbind list that fits in a request, with the message header
+   and a community string of up to COMM_STR_SIZE */
+#define PLANNER_SIZE (REQUEST_BUFFER_SIZE - 64)
+
+typedef struct {
+	struct sockaddr_storage addr;
+	int limit;  /* Ceiling of the varbind list, in bytes */
+	int ok;  /* Largest answered */
+	uint32_t used;
+} PLANAGENT;
+
+typedef struct planner {
+	POLLER *p;
+	int size;
+	unsigned int mask;
+	PLANAGENT *agent;
+	uint32_t clock;  /* Counts lookups, to find the least recently used */
+} PLANNER;
+
+typedef struct {
+	int off, len;  /* Of its TLV in the requests */
+	int resOff, resLen;  /* and in the results */
+	int status;
+} PLANVB;
+
+typedef struct {
+	int a, b;  /* The varbinds from a up to b */
+} PLANRANGE;
+
+typedef struct {
+	PLANNER *pl;
+	struct sockaddr_storage to;
+	char community[COMM_STR_SIZE];
+	unsigned char reqType;
+	int n, alloc;
+	PLANVB *vb;
+	unsigned char *req, *res;  /* Varbind TLVs of the requests, and of the results */
+	int reqLen, reqAlloc, resLen, resAlloc;
+	PLANRANGE *wait;  /* Ranges waiting to be sent, the next last */
+	int nwait, outstanding, pending;  /* pending: varbinds with no result */
+	uint32_t requests, tooBig;
+} PLAN;
+
+PLANNER *plannernew(POLLER *p, int agents, int size);
+void plannerfree(PLANNER *pl);
+int plannerlimit(PLANNER *pl, struct sockaddr *to);
+PLAN *plannew(PLANNER *pl, struct sockaddr *to, char *community, unsigned char reqType);
+void planfree(PLAN *plan);
+int planadd(PLAN *plan, char *oidstr, unsigned char dataType, void *val, int vlen);
+int planstart(PLAN *plan);
+int planpump(PLAN *plan);
+Boolean plandone(PLAN *plan);
+int planrun(PLAN *plan);
+int planresult(PLAN *plan, int i, VBVIEW *vb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
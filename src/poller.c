@@ -0,0 +1,290 @@
+/*
+ * Asynchronous SNMP requests to many targets over one socket, matched to their
+ * responses by request ID and source, with timeouts and retries.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <fcntl.h>
+#include <time.h>
+#endif
+#include "poller.h"
+#include "resolver.h"
+
+#define POLLER_RCVBUF (1 << 22)
+
+/* Milliseconds from an arbitrary start, wrapping around */
+static uint32_t pollclock(void)
+{
+#ifdef _WIN32
+	return (uint32_t) GetTickCount();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t) (now.tv_sec * 1000 + now.tv_nsec / 1000000);
+#endif
+}
+
+static void wheeladd(POLLER *p, POLLREQ *r)
+{
+	POLLREQ **slot = &p->wheel[(r->due / POLLER_TICK) & (POLLER_WHEEL-1)];
+
+	r->wprev = NULL;
+	if ((r->wnext = *slot)) r->wnext->wprev = r;
+	*slot = r;
+}
+
+static void wheeldel(POLLER *p, POLLREQ *r)
+{
+	if (r->wprev) r->wprev->wnext = r->wnext;
+	else p->wheel[(r->due / POLLER_TICK) & (POLLER_WHEEL-1)] = r->wnext;
+	if (r->wnext) r->wnext->wprev = r->wprev;
+}
+
+/* Takes r off the wheel and out of the hash table, and frees it */
+static void reqdone(POLLER *p, POLLREQ *r)
+{
+	POLLREQ **h = &p->hash[r->reqId & p->hmask];
+
+	wheeldel(p, r);
+	while (*h != r) h = &(*h)->hnext;
+	*h = r->hnext;
+	r->hnext = p->free;
+	p->free = r;
+	p->n--;
+}
+
+static void reqsend(POLLER *p, POLLREQ *r, uint32_t now)
+{
+	sendto(p->fd, (char *)r->msg, r->len, 0, (struct sockaddr *)&r->to, r->tolen);
+	r->tries++;
+	r->due = now + p->timeout;
+	wheeladd(p, r);
+}
+
+/* Builds the request of r backwards in its buffer. Returns its length, or
+   BUFFER_FULL. */
+static int reqbuild(POLLREQ *r, char *community, unsigned char reqType,
+	struct messageStruct *vblist)
+{
+	struct messageStruct m;
+	unsigned char empty[2] = { SEQUENCE_OF, 0 };
+	int len, clen = strlen(community);
+
+	m.buffer = r->buf; m.size = m.index = m.len = REQUEST_BUFFER_SIZE;
+	if ((len = vblist ? prependBytes(&m, vblist->buffer, vblist->len) :
+		prependBytes(&m, empty, 2)) < 0 ||
+		prependInt(&m, INTEGER, 0) < 0 || prependInt(&m, INTEGER, 0) < 0 ||
+		prependInt(&m, INTEGER, r->reqId) < 0)
+		return BUFFER_FULL;
+	len = m.size - m.index;
+	if (prependHeader(&m, reqType, len) < 0 ||
+		prependBytes(&m, (unsigned char *)community, clen) < 0 ||
+		prependHeader(&m, OCTET_STRING, clen) < 0 || prependInt(&m, INTEGER, 0) < 0)
+		return BUFFER_FULL;
+	len = m.size - m.index;
+	if (prependHeader(&m, SEQUENCE, len) < 0) return BUFFER_FULL;
+	r->msg = m.buffer + m.index;
+	return m.size - m.index;
+}
+
+POLLER *pollernew(int fd, int size, int timeout, int retries)
+{
+	POLLER *p;
+	int i, n, rcvbuf = POLLER_RCVBUF;
+#ifdef _WIN32
+	u_long on = 1;
+#endif
+
+	for (n = 1; n < 2*size; n <<= 1);
+	if ((p = (POLLER *)malloc(sizeof(POLLER))) == NULL) return NULL;
+	memset(p, 0, sizeof(POLLER));
+	if ((p->req = (POLLREQ *)malloc(size * sizeof(POLLREQ))) == NULL ||
+		(p->hash = (POLLREQ **)calloc(n, sizeof(POLLREQ *))) == NULL) {
+		pollerfree(p);
+		return NULL;
+	}
+	for (i = 0; i < size; i++) {
+		p->req[i].hnext = p->free;
+		p->free = &p->req[i];
+	}
+	p->fd = fd;
+	p->family = sockfamily(fd);
+	p->size = size;
+	p->hmask = n - 1;
+	p->timeout = timeout < POLLER_TICK ? POLLER_TICK : timeout;
+	p->retries = retries;
+	p->tick = pollclock() / POLLER_TICK;
+	/* Request IDs start apart from those of an earlier run */
+	p->nextId = (pollclock() & 0xFFFFF) << 8 | 1;
+	/* Responses to a burst of requests arrive together */
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char *)&rcvbuf, sizeof(rcvbuf));
+#ifdef _WIN32
+	ioctlsocket(fd, FIONBIO, &on);
+#else
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#endif
+	return p;
+}
+
+void pollerfree(POLLER *p)
+{
+	free(p->req);
+	free(p->hash);
+	free(p);
+}
+
+int pollersend(POLLER *p, struct sockaddr *to, char *community, unsigned char reqType,
+	struct messageStruct *vblist, void (*func)(POLLER *p, MSGVIEW *msg, void *arg), void *arg)
+{
+	POLLREQ *r = p->free, **h;
+	struct sockaddr *a;
+
+	if (r == NULL) return BUFFER_FULL;
+	r->reqId = p->nextId;
+	if ((r->len = reqbuild(r, community, reqType, vblist)) < 0) return FAIL;
+	if (++p->nextId > 0x7FFFFFFF) p->nextId = 1;
+	p->free = r->hnext;
+	h = &p->hash[r->reqId & p->hmask];
+	r->hnext = *h;
+	*h = r;
+	p->n++;
+	/* Kept as sent, and as a response comes from, on the socket */
+	if ((a = sockaddrmap(p->family, to, &r->to, &r->tolen)) != (struct sockaddr *)&r->to)
+		memcpy(&r->to, a, r->tolen);
+	r->tries = 0;
+	r->func = func;
+	r->arg = arg;
+	reqsend(p, r, pollclock());
+	p->sent++;
+	return r->reqId;
+}
+
+int pollerread(POLLER *p)
+{
+	struct sockaddr_storage from;
+	MSGVIEW msg;
+	POLLREQ *r;
+	void (*func)(POLLER *p, MSGVIEW *msg, void *arg);
+	void *arg;
+	int len, done = 0;
+#ifdef _WIN32
+	int fromlen;
+#else
+	socklen_t fromlen;
+#endif
+
+	for (;;) {
+		fromlen = sizeof(from);
+		if ((len = recvfrom(p->fd, (char *)p->rbuf, RESPONSE_BUFFER_SIZE, 0,
+			(struct sockaddr *)&from, &fromlen)) < 0)
+			break;
+		if (msgView(p->rbuf, len, &msg, p->vb, VBVIEW_MAX(RESPONSE_BUFFER_SIZE)) != SUCCESS ||
+			msg.pduType != GET_RESPONSE) {
+			p->stray++;
+			continue;
+		}
+		for (r = p->hash[msg.reqId & p->hmask]; r; r = r->hnext)
+			if (r->reqId == msg.reqId &&
+				sockaddreq((struct sockaddr *)&r->to, (struct sockaddr *)&from))
+				break;
+		if (r == NULL) {  /* Late, duplicated or spoofed */
+			p->stray++;
+			continue;
+		}
+		func = r->func; arg = r->arg;
+		reqdone(p, r);
+		p->answered++;
+		done++;
+		func(p, &msg, arg);
+	}
+	return done;
+}
+
+int pollerexpire(POLLER *p)
+{
+	uint32_t now = pollclock(), t = now / POLLER_TICK;
+	POLLREQ *r, *next;
+	void (*func)(POLLER *p, MSGVIEW *msg, void *arg);
+	void *arg;
+	int done = 0;
+
+	/* The slots from the last expired to now, each once at most. The slot
+	   of now is expired again next time, as requests may yet fall due in it. */
+	if (t - p->tick >= POLLER_WHEEL) p->tick = t - (POLLER_WHEEL-1);
+	for (; ; p->tick++) {
+		for (r = p->wheel[p->tick & (POLLER_WHEEL-1)]; r; r = next) {
+			next = r->wnext;
+			if ((int32_t)(r->due - now) > 0) continue;  /* A turn of the wheel later */
+			if (r->tries <= p->retries) {
+				wheeldel(p, r);
+				reqsend(p, r, now);
+				p->retried++;
+				continue;
+			}
+			func = r->func; arg = r->arg;
+			reqdone(p, r);
+			p->timedout++;
+			done++;
+			func(p, NULL, arg);
+		}
+		if (p->tick == t) break;
+	}
+	return done;
+}
+
+int pollerwait(POLLER *p, int mSec)
+{
+	fd_set readfds;
+	struct timeval tv;
+
+	if (mSec > POLLER_TICK) mSec = POLLER_TICK;
+	FD_ZERO(&readfds);
+	FD_SET(p->fd, &readfds);
+	tv.tv_sec = 0; tv.tv_usec = mSec * 1000;
+	if (select(p->fd+1, &readfds, NULL, NULL, &tv) < 0 && errno != EINTR)
+		return FAIL;
+	return pollerread(p) + pollerexpire(p);
+}
+
+int pollerpending(POLLER *p)
+{
+	return p->n;
+}
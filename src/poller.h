@@ -0,0 +1,155 @@
+/*
+ * Asynchronous SNMP requests to many targets over one socket, matched to their
+ * responses by request ID and source, with timeouts and retries.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+poller.c keeps many requests of a manager outstanding at once on one UDP
+socket, so that thousands of agents are polled from a single thread. Each
+request is given a request ID of its own, and a response is matched to it
+by that ID and the address and port it was sent to. A request not answered
+within the timeout is sent again, up to the retries, and then given up.
+Requests are found by ID in a hash table, and their timeouts kept in a
+timer wheel of POLLER_WHEEL slots of POLLER_TICK milliseconds, so that
+neither grows in cost with the number outstanding. A request is completed
+by calling its callback, with the response, or NULL if it timed out.
+
+POLLER *pollernew(int fd, int size, int timeout, int retries);
+	Instantiate a poller on the UDP socket fd, e.g. from initSnmpMgr(0), of
+	at most size requests outstanding, each tried every timeout milliseconds
+	and sent again up to retries times. fd is made non-blocking. Returns
+	NULL if fail.
+
+void pollerfree(POLLER *p);
+	Free the poller, not closing fd, without calling the callbacks of the
+	requests outstanding.
+
+int pollersend(POLLER *p, struct sockaddr *to, char *community, unsigned char reqType,
+	struct messageStruct *vblist, void (*func)(POLLER *p, MSGVIEW *msg, void *arg), void *arg);
+	Sends a request of reqType with vblist, as built by vblistAdd(), or no
+	varbind if NULL, to the agent at to, IPv4 or IPv6, with the community
+	string. func is called with arg once, when the response arrives or the
+	request times out. Returns the request ID, BUFFER_FULL if size requests are
+	outstanding, or Fail(-1) if the request does not fit in a message.
+
+int pollerread(POLLER *p);
+	Receives the datagrams waiting at the socket, completing the requests
+	they answer. Returns the number completed.
+
+int pollerexpire(POLLER *p);
+	Sends again the requests due for a retry, and completes those out of
+	retries. Returns the number completed.
+
+int pollerwait(POLLER *p, int mSec);
+	Waits up to mSec milliseconds, and at most POLLER_TICK, for responses,
+	then calls pollerread() and pollerexpire(). Returns the number of
+	requests completed, or Fail(-1) if waiting fails.
+
+int pollerpending(POLLER *p);
+	Returns the number of requests outstanding.
+
+A callback may send further requests, but not call pollerread(),
+pollerexpire() or pollerwait(). The MSGVIEW it is given, and the varbinds
+it points to, are valid only until it returns. The poller counts in sent
+the requests sent, in retried the times they were sent again, in answered
+those completed by a response, in timedout those given up, and in stray
+the datagrams that matched no request. To run a poller in an event
+loop, call pollerread() when fd is readable and pollerexpire() on a timer of
+POLLER_TICK. A poller is used by one thread.
+*/
+
+#ifndef _POLLER_H
+#define _POLLER_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+#include "varbind.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POLLER_TICK 10
+#define POLLER_WHEEL 1024
+
+struct poller;
+
+typedef struct pollreq {
+	uint32_t reqId;
+	struct sockaddr_storage to;
+	socklen_t tolen;
+	int tries;
+	uint32_t due;  /* Time of the next try, in milliseconds */
+	void (*func)(struct poller *p, MSGVIEW *msg, void *arg);
+	void *arg;
+	unsigned char *msg;  /* The request, kept for retries */
+	int len;
+	struct pollreq *hnext;  /* In its hash bucket, or the free list */
+	struct pollreq *wnext, *wprev;  /* In its wheel slot */
+	unsigned char buf[REQUEST_BUFFER_SIZE];
+} POLLREQ;
+
+typedef struct poller {
+	int fd, family;
+	int size, n;
+	int timeout, retries;
+	POLLREQ *req, *free;
+	POLLREQ **hash;
+	unsigned int hmask;
+	POLLREQ *wheel[POLLER_WHEEL];
+	uint32_t tick;  /* The next slot of the wheel to expire */
+	uint32_t nextId;
+	uint32_t sent, retried, answered, timedout, stray;
+	unsigned char rbuf[RESPONSE_BUFFER_SIZE];
+	VBVIEW vb[VBVIEW_MAX(RESPONSE_BUFFER_SIZE)];
+} POLLER;
+
+POLLER *pollernew(int fd, int size, int timeout, int retries);
+void pollerfree(POLLER *p);
+int pollersend(POLLER *p, struct sockaddr *to, char *community, unsigned char reqType,
+	struct messageStruct *vblist, void (*func)(POLLER *p, MSGVIEW *msg, void *arg), void *arg);
+int pollerread(POLLER *p);
+int pollerexpire(POLLER *p);
+int pollerwait(POLLER *p, int mSec);
+int pollerpending(POLLER *p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
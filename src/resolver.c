@@ -0,0 +1,447 @@
+/*
+ * Resolves host names to addresses through a cache, with a worker path that
+ * keeps lookups off the thread sending requests, and handles the IPv4 and
+ * IPv6 addresses of sockets.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+#include "resolver.h"
+
+#define RESOLVER_WAYS 4  /* Slots a name may take in the cache */
+
+#ifndef _WIN32
+#define LOCK(r) pthread_mutex_lock(&(r)->lock)
+#define UNLOCK(r) pthread_mutex_unlock(&(r)->lock)
+#else
+#define LOCK(r)
+#define UNLOCK(r)
+#endif
+
+static RESOLVER *hostResolver = NULL;  /* The default, made on first use */
+
+/* Seconds from an arbitrary start */
+static time_t resolvernow(void)
+{
+#ifdef _WIN32
+	return (time_t) (GetTickCount() / 1000);
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec;
+#endif
+}
+
+static unsigned int resolverhash(char *name)
+{
+	unsigned int h = 2166136261u;
+
+	for (; *name; name++)
+		h = (h ^ (unsigned char) *name) * 16777619u;
+	return h;
+}
+
+/* Looks name up in DNS or the hosts file, for an address of a family this
+   host has. Returns Success(0) or Fail(-1). */
+static int resolverlookup(char *name, struct sockaddr_storage *addr)
+{
+	struct addrinfo hints, *res;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_ADDRCONFIG;
+	if (getaddrinfo(name, NULL, &hints, &res) != 0) return FAIL;
+	memset(addr, 0, sizeof(struct sockaddr_storage));
+	memcpy(addr, res->ai_addr, res->ai_addrlen);
+	freeaddrinfo(res);
+	return SUCCESS;
+}
+
+/* Keeping an entry is worth the more, the higher this is */
+static int resolverworth(RESOLVERENTRY *e)
+{
+	return e->state == RESOLVER_EMPTY ? 0 : e->state == RESOLVER_ASKED ? 2 : 1;
+}
+
+/* Finds the entry of name, or if create, takes one for it: an empty slot,
+   else the least recently used, one not asked for preferred. */
+static RESOLVERENTRY *resolverfind(RESOLVER *r, char *name, unsigned int h, Boolean create)
+{
+	RESOLVERENTRY *e, *lru = NULL;
+	int i;
+
+	r->clock++;
+	for (i = 0; i < RESOLVER_WAYS; i++) {
+		e = &r->entry[(h + i) & r->mask];
+		if (e->state != RESOLVER_EMPTY && e->hash == h && strcmp(e->name, name) == 0) {
+			e->used = r->clock;
+			return e;
+		}
+		if (lru == NULL || resolverworth(e) < resolverworth(lru) ||
+			(resolverworth(e) == resolverworth(lru) && e->used < lru->used))
+			lru = e;
+	}
+	if (!create) return NULL;
+	strcpy(lru->name, name);
+	lru->hash = h;
+	lru->state = RESOLVER_EMPTY;
+	lru->used = r->clock;
+	return lru;
+}
+
+/* Caches the result of a lookup of name. Called locked. */
+static void resolverstore(RESOLVER *r, char *name, int status, struct sockaddr_storage *addr)
+{
+	RESOLVERENTRY *e = resolverfind(r, name, resolverhash(name), TRUE);
+
+	if (status == SUCCESS) {
+		e->state = RESOLVER_OK;
+		e->addr = *addr;
+		e->expires = resolvernow() + r->ttl;
+	}
+	else {
+		e->state = RESOLVER_FAILED;
+		e->expires = resolvernow() + r->negttl;
+		r->failed++;
+	}
+}
+
+/* Answers host from its numeric form or the cache, setting *name to the
+   name to look up otherwise. Returns Success(0), Fail(-1), or
+   RESOLVER_PENDING if not answered. Called locked. */
+static int resolvercached(RESOLVER *r, char *host, char *buf, char **name, RESOLVERENTRY **entry,
+	struct sockaddr_storage *addr)
+{
+	struct sockaddr_in *sin = (struct sockaddr_in *)addr;
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)addr;
+	RESOLVERENTRY *e;
+
+	memset(addr, 0, sizeof(struct sockaddr_storage));
+	if (host == NULL || host[0] == '\0') {
+		if (gethostname(buf, RESOLVER_NAME)) return FAIL;
+		buf[RESOLVER_NAME-1] = '\0';
+		host = buf;
+	}
+	*name = host;
+	*entry = NULL;
+	if (inet_pton(AF_INET, host, &sin->sin_addr) == 1) {
+		sin->sin_family = AF_INET;
+		return SUCCESS;
+	}
+	if (inet_pton(AF_INET6, host, &sin6->sin6_addr) == 1) {
+		sin6->sin6_family = AF_INET6;
+		return SUCCESS;
+	}
+	if (strlen(host) >= RESOLVER_NAME) return RESOLVER_PENDING;
+	if ((*entry = e = resolverfind(r, host, resolverhash(host), FALSE)) == NULL ||
+		e->state == RESOLVER_ASKED || e->expires <= resolvernow())
+		return RESOLVER_PENDING;
+	r->hits++;
+	if (e->state == RESOLVER_FAILED) return FAIL;
+	*addr = e->addr;
+	return SUCCESS;
+}
+
+RESOLVER *resolvernew(int size, int ttl, int negttl)
+{
+	RESOLVER *r;
+	int n;
+
+	for (n = RESOLVER_WAYS; n < size; n <<= 1);
+	if ((r = (RESOLVER *)malloc(sizeof(RESOLVER))) == NULL) return NULL;
+	memset(r, 0, sizeof(RESOLVER));
+	if ((r->entry = (RESOLVERENTRY *)calloc(n, sizeof(RESOLVERENTRY))) == NULL ||
+		(r->queue = malloc(RESOLVER_QUEUE * RESOLVER_NAME)) == NULL) {
+		free(r->entry);
+		free(r);
+		return NULL;
+	}
+	r->mask = n - 1;
+	r->ttl = ttl;
+	r->negttl = negttl;
+#ifndef _WIN32
+	pthread_mutex_init(&r->lock, NULL);
+	pthread_cond_init(&r->asked, NULL);
+#endif
+	return r;
+}
+
+void resolverfree(RESOLVER *r)
+{
+#ifndef _WIN32
+	pthread_mutex_destroy(&r->lock);
+	pthread_cond_destroy(&r->asked);
+#endif
+	free(r->queue);
+	free(r->entry);
+	free(r);
+}
+
+int resolve(RESOLVER *r, char *host, struct sockaddr_storage *addr)
+{
+	RESOLVERENTRY *e;
+	char buf[RESOLVER_NAME], *name;
+	int ret;
+
+	if (r == NULL) {
+		if (hostResolver == NULL)
+			hostResolver = resolvernew(RESOLVER_SIZE, RESOLVER_TTL, RESOLVER_NEGTTL);
+		if ((r = hostResolver) == NULL) return FAIL;
+	}
+	LOCK(r);
+	ret = resolvercached(r, host, buf, &name, &e, addr);
+	if (ret == RESOLVER_PENDING) r->misses++;
+	UNLOCK(r);
+	if (ret != RESOLVER_PENDING) return ret;
+	ret = resolverlookup(name, addr);
+	if (strlen(name) < RESOLVER_NAME) {
+		LOCK(r);
+		resolverstore(r, name, ret, addr);
+		UNLOCK(r);
+	}
+	return ret;
+}
+
+#ifndef _WIN32
+int resolverask(RESOLVER *r, char *host, struct sockaddr_storage *addr)
+{
+	RESOLVERENTRY *e;
+	char buf[RESOLVER_NAME], *name;
+	int ret;
+
+	LOCK(r);
+	if ((ret = resolvercached(r, host, buf, &name, &e, addr)) != RESOLVER_PENDING ||
+		(e && e->state == RESOLVER_ASKED)) {
+		UNLOCK(r);
+		return ret;
+	}
+	if (strlen(name) >= RESOLVER_NAME) {  /* Too long to queue */
+		UNLOCK(r);
+		return resolve(r, name, addr);
+	}
+	if (r->head - r->tail < RESOLVER_QUEUE) {  /* Else asked again later */
+		strcpy(r->queue[r->head++ % RESOLVER_QUEUE], name);
+		resolverfind(r, name, resolverhash(name), TRUE)->state = RESOLVER_ASKED;
+		r->misses++;
+		pthread_cond_signal(&r->asked);
+	}
+	UNLOCK(r);
+	return RESOLVER_PENDING;
+}
+
+int resolverrun(RESOLVER *r)
+{
+	char name[RESOLVER_NAME];
+	struct sockaddr_storage addr;
+	int ret;
+
+	LOCK(r);
+	while (!r->stop) {
+		if (r->head == r->tail) {
+			pthread_cond_wait(&r->asked, &r->lock);
+			continue;
+		}
+		strcpy(name, r->queue[r->tail++ % RESOLVER_QUEUE]);
+		UNLOCK(r);
+		ret = resolverlookup(name, &addr);
+		LOCK(r);
+		resolverstore(r, name, ret, &addr);
+	}
+	UNLOCK(r);
+	return SUCCESS;
+}
+#endif
+
+void resolverstop(RESOLVER *r)
+{
+	LOCK(r);
+	r->stop = TRUE;
+#ifndef _WIN32
+	pthread_cond_broadcast(&r->asked);
+#endif
+	UNLOCK(r);
+}
+
+int sockopen(int port, Boolean reuse)
+{
+	struct sockaddr_in6 sin6;
+	struct sockaddr_in sin;
+	int fd, off = 0, on = 1;
+
+	if ((fd = socket(AF_INET6, SOCK_DGRAM, 0)) >= 0) {
+		setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (char *)&off, sizeof(off));
+#ifdef SO_REUSEPORT
+		if (reuse) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (char *)&on, sizeof(on));
+#endif
+		memset(&sin6, 0, sizeof(sin6));
+		sin6.sin6_family = AF_INET6;
+		sin6.sin6_addr = in6addr_any;
+		sin6.sin6_port = htons(port);
+		if (port < 0 || bind(fd, (struct sockaddr *)&sin6, sizeof(sin6)) == 0) return fd;
+#ifdef _WIN32
+		closesocket(fd);
+		if (WSAGetLastError() != WSAEADDRNOTAVAIL && WSAGetLastError() != WSAEAFNOSUPPORT)
+			return FAIL;
+#else
+		close(fd);
+		if (errno != EADDRNOTAVAIL && errno != EAFNOSUPPORT) return FAIL;  /* e.g. port in use */
+#endif
+	}
+	/* No IPv6 on this host */
+	if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0) return FAIL;
+#ifdef SO_REUSEPORT
+	if (reuse) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (char *)&on, sizeof(on));
+#endif
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = INADDR_ANY;
+	sin.sin_port = htons(port);
+	if (port < 0 || bind(fd, (struct sockaddr *)&sin, sizeof(sin)) == 0) return fd;
+#ifdef _WIN32
+	closesocket(fd);
+#else
+	close(fd);
+#endif
+	return FAIL;
+}
+
+int sockfamily(int fd)
+{
+	struct sockaddr_storage a;
+	socklen_t len = sizeof(a);
+
+	if (getsockname(fd, (struct sockaddr *)&a, &len) != 0) return AF_INET;
+	return a.ss_family;
+}
+
+struct sockaddr *sockaddrmap(int family, struct sockaddr *a, struct sockaddr_storage *buf, socklen_t *len)
+{
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)buf;
+
+	if (family != AF_INET6 || a->sa_family != AF_INET) {
+		*len = sockaddrlen(a);
+		return a;
+	}
+	memset(sin6, 0, sizeof(struct sockaddr_in6));
+	sin6->sin6_family = AF_INET6;
+	sin6->sin6_port = ((struct sockaddr_in *)a)->sin_port;
+	sin6->sin6_addr.s6_addr[10] = sin6->sin6_addr.s6_addr[11] = 0xFF;
+	memcpy(&sin6->sin6_addr.s6_addr[12], &((struct sockaddr_in *)a)->sin_addr, 4);
+	*len = sizeof(struct sockaddr_in6);
+	return (struct sockaddr *)buf;
+}
+
+void sockaddrunmap(struct sockaddr_storage *a)
+{
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)a;
+	struct sockaddr_in sin;
+
+	if (a->ss_family != AF_INET6 || !IN6_IS_ADDR_V4MAPPED(&sin6->sin6_addr)) return;
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = sin6->sin6_port;
+	memcpy(&sin.sin_addr, &sin6->sin6_addr.s6_addr[12], 4);
+	memcpy(a, &sin, sizeof(sin));
+}
+
+socklen_t sockaddrlen(struct sockaddr *a)
+{
+	return a->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+}
+
+unsigned int sockaddrport(struct sockaddr *a)
+{
+	return ntohs(a->sa_family == AF_INET6 ? ((struct sockaddr_in6 *)a)->sin6_port :
+		((struct sockaddr_in *)a)->sin_port);
+}
+
+void sockaddrsetport(struct sockaddr *a, unsigned int port)
+{
+	if (a->sa_family == AF_INET6)
+		((struct sockaddr_in6 *)a)->sin6_port = htons(port);
+	else
+		((struct sockaddr_in *)a)->sin_port = htons(port);
+}
+
+char *sockaddrntop(struct sockaddr *a, char *buf)
+{
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)a;
+
+	if (a->sa_family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&sin6->sin6_addr))
+		inet_ntop(AF_INET, &sin6->sin6_addr.s6_addr[12], buf, IP_STR_SIZE);
+	else if (a->sa_family == AF_INET6)
+		inet_ntop(AF_INET6, &sin6->sin6_addr, buf, IP_STR_SIZE);
+	else
+		inet_ntop(AF_INET, &((struct sockaddr_in *)a)->sin_addr, buf, IP_STR_SIZE);
+	return buf;
+}
+
+Boolean sockaddreq(struct sockaddr *a, struct sockaddr *b)
+{
+	if (a->sa_family != b->sa_family) return FALSE;
+	if (a->sa_family == AF_INET6)
+		return ((struct sockaddr_in6 *)a)->sin6_port == ((struct sockaddr_in6 *)b)->sin6_port &&
+			memcmp(&((struct sockaddr_in6 *)a)->sin6_addr, &((struct sockaddr_in6 *)b)->sin6_addr, 16) == 0;
+	return ((struct sockaddr_in *)a)->sin_port == ((struct sockaddr_in *)b)->sin_port &&
+		((struct sockaddr_in *)a)->sin_addr.s_addr == ((struct sockaddr_in *)b)->sin_addr.s_addr;
+}
+
+unsigned int sockaddrhash(struct sockaddr *a)
+{
+	unsigned char *p;
+	unsigned int h = 2166136261u, n;
+
+	if (a->sa_family == AF_INET6) {
+		p = (unsigned char *)&((struct sockaddr_in6 *)a)->sin6_addr;
+		n = 16;
+	}
+	else {
+		p = (unsigned char *)&((struct sockaddr_in *)a)->sin_addr;
+		n = 4;
+	}
+	for (; n > 0; n--, p++)
+		h = (h ^ *p) * 16777619u;
+	return h ^ sockaddrport(a);
+}
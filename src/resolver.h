@@ -0,0 +1,193 @@
+/*
+ * Resolves host names to addresses through a cache, with a worker path that
+ * keeps lookups off the thread sending requests.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+resolver.c resolves host names to IPv4 or IPv6 addresses with getaddrinfo(),
+and keeps the answers in a cache, each for ttl seconds, and the names that
+could not be resolved for negttl seconds, so that a name is looked up once
+however many requests are sent to it. A numeric address is converted at
+once, and not cached. The cache is a hash table of a fixed number of
+entries, the least recently used of a name's slots replaced. gethostaddr()
+of SnmpAgent.c and SnmpMgr.c, used by reqSend() and trapSend(), resolves
+through a cache of RESOLVER_SIZE entries made on first use.
+
+RESOLVER *resolvernew(int size, int ttl, int negttl);
+	Instantiate a resolver of a cache of size entries, keeping an address
+	for ttl seconds and a failure for negttl seconds. Returns NULL if fail.
+
+void resolverfree(RESOLVER *r);
+	Free the resolver. Its workers must have returned.
+
+int resolve(RESOLVER *r, char *host, struct sockaddr_storage *addr);
+	Resolves host, or the name of this host if NULL or empty, into addr, its
+	port 0, looking it up and waiting if not in the cache. r is the default
+	resolver if NULL. Returns Success(0), or Fail(-1) if not resolved.
+
+int resolverask(RESOLVER *r, char *host, struct sockaddr_storage *addr);
+	As resolve(), but not waiting: if host is not in the cache, it is queued
+	for a worker to look up, and RESOLVER_PENDING returned. Ask again later
+	for the answer. *nix only.
+
+int resolverrun(RESOLVER *r);
+	Runs a worker, looking up the names queued, until resolverstop(). Call
+	it from threads of their own; several may run at once. *nix only.
+
+void resolverstop(RESOLVER *r);
+	Makes the workers return.
+
+The resolver counts in hits the names answered from the cache, in misses
+those looked up, and in failed those that could not be resolved. On *nix,
+functions of a resolver may be called from several threads.
+
+The socket functions below let the agent, manager and trap paths serve
+both address families from one socket. An IPv4 peer of a dual-stack
+socket appears as an IPv4-mapped IPv6 address, ::ffff:a.b.c.d; addresses
+received are unmapped, so that an IPv4 peer is seen as such whatever the
+socket, and mapped again when sent to.
+
+int sockopen(int port, Boolean reuse);
+	Opens a UDP socket for IPv6 and IPv4, or IPv4 only where IPv6 is not
+	available, bound to port, ephemeral if 0, not bound if less. reuse sets
+	SO_REUSEPORT where there is one. Returns the socket, or Fail(-1).
+
+int sockfamily(int fd);
+	Returns the address family of the socket fd, AF_INET or AF_INET6.
+
+struct sockaddr *sockaddrmap(int family, struct sockaddr *a, struct sockaddr_storage *buf, socklen_t *len);
+	Returns a, or an IPv4 a mapped in buf for a socket of family AF_INET6,
+	with its length in len, to be passed to sendto().
+
+void sockaddrunmap(struct sockaddr_storage *a);
+	Turns an IPv4-mapped IPv6 address a into the IPv4 address.
+
+socklen_t sockaddrlen(struct sockaddr *a);
+	Returns the length of a, by its family.
+
+unsigned int sockaddrport(struct sockaddr *a);
+void sockaddrsetport(struct sockaddr *a, unsigned int port);
+	Get and set the port of a, in host order.
+
+char *sockaddrntop(struct sockaddr *a, char *buf);
+	Writes the address of a as text, an IPv4-mapped address as IPv4, into
+	buf of IP_STR_SIZE, and returns buf.
+
+Boolean sockaddreq(struct sockaddr *a, struct sockaddr *b);
+	Returns TRUE if a and b are the same address and port.
+
+unsigned int sockaddrhash(struct sockaddr *a);
+	Returns a hash of the address and port of a.
+*/
+
+#ifndef _RESOLVER_H
+#define _RESOLVER_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#endif
+#include <stdint.h>
+#include <time.h>
+#include "list.h"
+#include "usnmp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESOLVER_SIZE 256  /* Entries of the default resolver */
+#define RESOLVER_TTL 300
+#define RESOLVER_NEGTTL 30
+#define RESOLVER_NAME 256  /* Names as long are looked up, not cached */
+#define RESOLVER_QUEUE 64  /* Names queued for the workers */
+#define RESOLVER_PENDING 1
+
+#define RESOLVER_EMPTY 0
+#define RESOLVER_OK 1
+#define RESOLVER_FAILED 2
+#define RESOLVER_ASKED 3
+
+typedef struct {
+	char name[RESOLVER_NAME];
+	unsigned int hash;
+	unsigned char state;
+	struct sockaddr_storage addr;
+	time_t expires;
+	uint32_t used;
+} RESOLVERENTRY;
+
+typedef struct resolver {
+	int ttl, negttl;
+	unsigned int mask;
+	RESOLVERENTRY *entry;
+	uint32_t clock;  /* Counts lookups, to find the least recently used */
+	char (*queue)[RESOLVER_NAME];  /* Names for the workers, a ring */
+	unsigned int head, tail;
+	Boolean stop;
+#ifndef _WIN32
+	pthread_mutex_t lock;
+	pthread_cond_t asked;
+#endif
+	uint32_t hits, misses, failed;
+} RESOLVER;
+
+RESOLVER *resolvernew(int size, int ttl, int negttl);
+void resolverfree(RESOLVER *r);
+int resolve(RESOLVER *r, char *host, struct sockaddr_storage *addr);
+#ifndef _WIN32
+int resolverask(RESOLVER *r, char *host, struct sockaddr_storage *addr);
+int resolverrun(RESOLVER *r);
+#endif
+void resolverstop(RESOLVER *r);
+
+int sockopen(int port, Boolean reuse);
+int sockfamily(int fd);
+struct sockaddr *sockaddrmap(int family, struct sockaddr *a, struct sockaddr_storage *buf, socklen_t *len);
+void sockaddrunmap(struct sockaddr_storage *a);
+socklen_t sockaddrlen(struct sockaddr *a);
+unsigned int sockaddrport(struct sockaddr *a);
+void sockaddrsetport(struct sockaddr *a, unsigned int port);
+char *sockaddrntop(struct sockaddr *a, char *buf);
+Boolean sockaddreq(struct sockaddr *a, struct sockaddr *b);
+unsigned int sockaddrhash(struct sockaddr *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -93,6 +93,7 @@
 #define RD_WR             'W'
 
 #define INT_SIZE        4           /* size of Integer, Gauge and Counter type */
+#define IP_ADDRESS_SIZE 4           /* size of IpAddress type */
 #define MAX_INTEGER     2147483647  /* 2^31-1 */
 #define MIN_INTEGER    -2147483648
 #define MAX_COUNTER     4294967295  /* 2^32-1 */
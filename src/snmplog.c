@@ -0,0 +1,324 @@
+/*
+ * An append-only binary log of received traps and responses, written to
+ * and read from a memory-mapped file.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "snmplog.h"
+#include "resolver.h"
+
+#define SNMPLOG_MAGIC "uSNMPLOG"
+#define SNMPLOG_VERSION 2
+#define LOGREC_SIZE 48  /* Before the enterprise OID */
+
+/* Offsets of the header fields */
+#define HDR_VERSION 8
+#define HDR_END 12
+#define HDR_INDEX 16
+#define HDR_SPAN 20
+#define HDR_FIRST 24
+#define HDR_FIRSTUSEC 28
+#define HDR_LAST 32
+
+static uint32_t get32(unsigned char *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint16_t get16(unsigned char *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/* Writes the state of the writer to the header */
+static void loghead(SNMPLOG *l)
+{
+	h2nl_byte(l->lastIndex, l->map+HDR_INDEX);
+	h2nl_byte(l->span, l->map+HDR_SPAN);
+	h2nl_byte(l->first, l->map+HDR_FIRST);
+	h2nl_byte(l->firstUsec, l->map+HDR_FIRSTUSEC);
+	h2nl_byte(l->last, l->map+HDR_LAST);
+	h2nl_byte(l->end, l->map+HDR_END);  /* Last, as readers go by it */
+}
+
+/* Appends the index record of the records since the last one */
+static void logindex(SNMPLOG *l)
+{
+	unsigned char *p = l->map + l->end;
+
+	memset(p, 0, LOGREC_SIZE);
+	h2ns_byte(LOGREC_SIZE, p);
+	p[2] = SNMPLOG_INDEX_TYPE;
+	h2nl_byte(l->first, p+4);
+	h2nl_byte(l->firstUsec, p+8);
+	h2nl_byte(l->span, p+32);
+	h2nl_byte(l->lastIndex, p+36);
+	h2nl_byte(l->last, p+40);
+	l->lastIndex = l->end;
+	l->end += LOGREC_SIZE;
+	l->span = 0;
+}
+
+/* Maps the log file of fd */
+static SNMPLOG *logmap(int fd, uint32_t size, Boolean writable)
+{
+	SNMPLOG *l;
+
+	if ((l = (SNMPLOG *)malloc(sizeof(SNMPLOG))) == NULL) return NULL;
+	l->map = (unsigned char *)mmap(NULL, size, writable ? PROT_READ|PROT_WRITE : PROT_READ,
+		MAP_SHARED, fd, 0);
+	if (l->map == MAP_FAILED) {
+		free(l);
+		return NULL;
+	}
+	l->fd = fd;
+	l->size = size;
+	l->writable = writable;
+	l->end = get32(l->map+HDR_END);
+	l->lastIndex = get32(l->map+HDR_INDEX);
+	l->span = get32(l->map+HDR_SPAN);
+	l->first = get32(l->map+HDR_FIRST);
+	l->firstUsec = get32(l->map+HDR_FIRSTUSEC);
+	l->last = get32(l->map+HDR_LAST);
+	return l;
+}
+
+/* Checks the header of the log file of fd, of size bytes */
+static Boolean logcheck(int fd, uint32_t size)
+{
+	unsigned char hdr[SNMPLOG_HEADER];
+
+	return size >= SNMPLOG_HEADER && pread(fd, hdr, SNMPLOG_HEADER, 0) == SNMPLOG_HEADER &&
+		memcmp(hdr, SNMPLOG_MAGIC, 8) == 0 && get32(hdr+HDR_VERSION) == SNMPLOG_VERSION &&
+		get32(hdr+HDR_END) >= SNMPLOG_HEADER && get32(hdr+HDR_END) <= size;
+}
+
+SNMPLOG *snmplognew(char *fn, uint32_t size)
+{
+	unsigned char hdr[SNMPLOG_HEADER];
+	struct stat st;
+	SNMPLOG *l;
+	int fd;
+
+	if ((fd = open(fn, O_RDWR|O_CREAT, 0644)) < 0) return NULL;
+	if (fstat(fd, &st) != 0) goto fail;
+	if (st.st_size == 0) {  /* New, so allocated in full */
+		if (size < SNMPLOG_HEADER + 2*LOGREC_SIZE ||
+			(posix_fallocate(fd, 0, size) != 0 && ftruncate(fd, size) != 0))
+			goto fail;
+		memset(hdr, 0, SNMPLOG_HEADER);
+		memcopy(hdr, (unsigned char *)SNMPLOG_MAGIC, 8);
+		h2nl_byte(SNMPLOG_VERSION, hdr+HDR_VERSION);
+		h2nl_byte(SNMPLOG_HEADER, hdr+HDR_END);
+		if (pwrite(fd, hdr, SNMPLOG_HEADER, 0) != SNMPLOG_HEADER) goto fail;
+	}
+	else if (st.st_size > 0xFFFFFFFFL || !logcheck(fd, (uint32_t)st.st_size))
+		goto fail;
+	else
+		size = (uint32_t)st.st_size;
+	if ((l = logmap(fd, size, TRUE)) != NULL) return l;
+fail:
+	close(fd);
+	return NULL;
+}
+
+SNMPLOG *snmplogopen(char *fn)
+{
+	struct stat st;
+	SNMPLOG *l;
+	int fd;
+
+	if ((fd = open(fn, O_RDONLY)) < 0) return NULL;
+	if (fstat(fd, &st) == 0 && st.st_size <= 0xFFFFFFFFL && logcheck(fd, (uint32_t)st.st_size) &&
+		(l = logmap(fd, (uint32_t)st.st_size, FALSE)) != NULL)
+		return l;
+	close(fd);
+	return NULL;
+}
+
+void snmplogfree(SNMPLOG *l)
+{
+	if (l->writable && l->span > 0) {
+		logindex(l);
+		loghead(l);
+	}
+	munmap(l->map, l->size);
+	close(l->fd);
+	free(l);
+}
+
+int snmplogappend(SNMPLOG *l, struct sockaddr *from, MSGVIEW *msg)
+{
+	struct timeval now;
+	unsigned char *p = l->map + l->end;
+	int elen = msg->pduType == TRAP_PACKET ? msg->enterpriseLen : 0;
+	int vlen = msg->vblistTlv ? msg->vblistLen : 0;
+	int len = (LOGREC_SIZE + elen + vlen + 3) & ~3;
+
+	/* Room is kept for the index record that closes the span */
+	if (l->end + len + LOGREC_SIZE > l->size) return BUFFER_FULL;
+	gettimeofday(&now, NULL);
+	h2ns_byte(len, p);
+	p[2] = msg->pduType;
+	p[3] = elen;
+	h2nl_byte((uint32_t)now.tv_sec, p+4);
+	h2nl_byte((uint32_t)now.tv_usec, p+8);
+	if (from->sa_family == AF_INET6)
+		memcopy(p+12, (unsigned char *)&((struct sockaddr_in6 *)from)->sin6_addr, 16);
+	else {  /* IPv4-mapped */
+		memset(p+12, 0, 10);
+		p[22] = p[23] = 0xFF;
+		memcopy(p+24, (unsigned char *)&((struct sockaddr_in *)from)->sin_addr, 4);
+	}
+	h2ns_byte(sockaddrport(from), p+28);
+	h2ns_byte(vlen, p+30);
+	if (msg->pduType == TRAP_PACKET) {
+		h2nl_byte(msg->generic, p+32);
+		h2nl_byte(msg->specific, p+36);
+		h2nl_byte(msg->timestamp, p+40);
+		memcopy(p+44, msg->agentAddr, 4);
+		memcopy(p+LOGREC_SIZE, msg->enterprise, elen);
+	}
+	else {
+		h2nl_byte(msg->reqId, p+32);
+		h2nl_byte(msg->errorStatus, p+36);
+		h2nl_byte(msg->errorIndex, p+40);
+		memset(p+44, 0, 4);
+	}
+	memcopy(p+LOGREC_SIZE+elen, msg->vblistTlv, vlen);
+	memset(p+LOGREC_SIZE+elen+vlen, 0, len-LOGREC_SIZE-elen-vlen);
+	l->end += len;
+	if (l->span++ == 0) {
+		l->first = (uint32_t)now.tv_sec;
+		l->firstUsec = (uint32_t)now.tv_usec;
+	}
+	l->last = (uint32_t)now.tv_sec;
+	if (l->span == SNMPLOG_INDEX) logindex(l);
+	loghead(l);
+	return SUCCESS;
+}
+
+void snmplogsync(SNMPLOG *l)
+{
+	msync(l->map, l->end, MS_SYNC);
+}
+
+uint32_t snmplognext(SNMPLOG *l, uint32_t pos, LOGREC *rec)
+{
+	uint32_t end = l->writable ? l->end : get32(l->map+HDR_END);
+	unsigned char *p;
+	int len;
+
+	if (end > l->size) return 0;
+	for (pos = pos ? pos : SNMPLOG_HEADER; pos + LOGREC_SIZE <= end; pos += len) {
+		p = l->map + pos;
+		if ((len = get16(p)) < LOGREC_SIZE || pos + len > end) return 0;
+		if (p[2] == SNMPLOG_INDEX_TYPE) continue;
+		rec->type = p[2];
+		rec->sec = get32(p+4);
+		rec->usec = get32(p+8);
+		rec->addr = p+12;
+		rec->port = get16(p+28);
+		rec->vblistLen = get16(p+30);
+		rec->enterpriseLen = p[3];
+		if (LOGREC_SIZE + rec->enterpriseLen + rec->vblistLen > len) return 0;
+		if (rec->type == TRAP_PACKET) {
+			rec->generic = get32(p+32);
+			rec->specific = get32(p+36);
+			rec->timestamp = get32(p+40);
+			rec->reqId = rec->errorStatus = rec->errorIndex = 0;
+			rec->agentAddr = p+44;
+		}
+		else {
+			rec->reqId = get32(p+32);
+			rec->errorStatus = get32(p+36);
+			rec->errorIndex = get32(p+40);
+			rec->generic = rec->specific = rec->timestamp = 0;
+			rec->agentAddr = NULL;
+		}
+		rec->enterprise = p+LOGREC_SIZE;
+		rec->vblist = p+LOGREC_SIZE+rec->enterpriseLen;
+		return pos + len;
+	}
+	return 0;
+}
+
+uint32_t snmplogseek(SNMPLOG *l, uint32_t since)
+{
+	uint32_t end = l->writable ? l->end : get32(l->map+HDR_END);
+	uint32_t idx = l->writable ? l->lastIndex : get32(l->map+HDR_INDEX);
+	uint32_t pos = end;
+	unsigned char *p;
+
+	/* The records since the last index, then each span indexed, newest first */
+	if ((l->writable ? l->span : get32(l->map+HDR_SPAN)) > 0) {
+		if ((l->writable ? l->last : get32(l->map+HDR_LAST)) < since) return end;
+		pos = idx ? idx + LOGREC_SIZE : SNMPLOG_HEADER;
+	}
+	while (idx >= SNMPLOG_HEADER && idx + LOGREC_SIZE <= end) {
+		p = l->map + idx;
+		if (p[2] != SNMPLOG_INDEX_TYPE || get32(p+40) < since) break;
+		idx = get32(p+36);
+		pos = idx ? idx + LOGREC_SIZE : SNMPLOG_HEADER;
+	}
+	return pos;
+}
+
+Boolean snmplogmatch(LOGREC *rec, unsigned char *prefix, int len)
+{
+	unsigned char *p, *next, *name, *end;
+	int vlen, olen;
+
+	if (rec->enterpriseLen >= len && memcmp(rec->enterprise, prefix, len) == 0)
+		return TRUE;
+	if (rec->vblistLen < 2) return FALSE;
+	end = rec->vblist + rec->vblistLen;
+	p = rec->vblist + 1;
+	p += parseLength(p, &vlen);  /* Into the varbind list */
+	while (p + 2 < end && *p == SEQUENCE) {
+		p += 1 + parseLength(p+1, &vlen);  /* Into the varbind, at its name */
+		next = p + vlen;
+		if (*p != OBJECT_IDENTIFIER) break;
+		name = p + 1 + parseLength(p+1, &olen);
+		if (olen >= len && name + len <= end && memcmp(name, prefix, len) == 0)
+			return TRUE;
+		p = next;
+	}
+	return FALSE;
+}
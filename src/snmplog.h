@@ -0,0 +1,155 @@
+/*
+ * An append-only binary log of received traps and responses, written to
+ * and read from a memory-mapped file.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+snmplog.c records traps and responses in a binary file, one record per
+message, with the time it was logged, its source, the fields of its PDU
+header and its varbind list as BER, all as received. The file is
+allocated in full when created, and mapped into memory, so that a record
+is appended with a copy, and a reader scans it without reading or parsing
+text. After every SNMPLOG_INDEX records, an index record notes their number
+and time span, and where the previous index record is, so that a reader may
+skip the spans before a given time. *nix only.
+
+The file starts with a header of SNMPLOG_HEADER bytes: "uSNMPLOG", then the
+version, the end of the records, the offset of the last index record, and
+the number of records since, with the times of the first and last, each a
+32-bit integer in network byte order. A record is laid out as
+
+	0	length of the record, 16 bits, padded to a multiple of 4
+	2	PDU type, or SNMPLOG_INDEX_TYPE
+	3	length of the enterprise OID, 0 but for a trap
+	4	time logged, in seconds and microseconds since the epoch, 32 bits each
+	12	source IPv6 address, or IPv4-mapped IPv4 address, 16 bytes
+	28	source port, 16 bits
+	30	length of the varbind list, 16 bits
+	32	request ID, error status and error index, or, for a trap, its
+		generic and specific trap numbers and time stamp, 32 bits each
+	44	the agent address of a trap
+	48	the enterprise OID of a trap, BER-encoded, then the varbind list TLV
+
+An index record holds, in place of the request ID, error status and error
+index, the number of records indexed, the offset of the previous index
+record, and the time in seconds of the last record indexed; its time is
+that of the first.
+
+SNMPLOG *snmplognew(char *fn, uint32_t size);
+	Opens the log file fn for appending, creating it of size bytes, at most
+	4GB, if it does not exist or is empty. Returns NULL if fail, or if fn is
+	not a log file.
+
+SNMPLOG *snmplogopen(char *fn);
+	Opens the log file fn for reading. Records appended meanwhile by
+	another process are seen. Returns NULL if fail.
+
+void snmplogfree(SNMPLOG *l);
+	Close the log file, writing the index of the records appended since the
+	last index record.
+
+int snmplogappend(SNMPLOG *l, struct sockaddr *from, MSGVIEW *msg);
+	Appends the message msg, decoded by msgView(), from from. Returns
+	Success(0), or BUFFER_FULL if the file is full.
+
+void snmplogsync(SNMPLOG *l);
+	Flushes the records appended to the file.
+
+uint32_t snmplognext(SNMPLOG *l, uint32_t pos, LOGREC *rec);
+	Decodes in rec the record at pos, the first if pos is 0, skipping index
+	records. Returns the position of the record after it, or 0 at the end.
+	The fields of rec point into the file mapping.
+
+uint32_t snmplogseek(SNMPLOG *l, uint32_t since);
+	Returns the position, to be given to snmplognext(), of the first span of
+	records of which the last was logged at or after since, a time in seconds.
+
+Boolean snmplogmatch(LOGREC *rec, unsigned char *prefix, int len);
+	Returns TRUE if the enterprise OID or the name of a varbind of rec starts
+	with the BER-encoded OID prefix of len bytes, e.g. from str2ber().
+*/
+
+#ifndef _SNMPLOG_H
+#define _SNMPLOG_H
+
+#include <netinet/in.h>
+#include "list.h"
+#include "varbind.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SNMPLOG_HEADER 64
+#define SNMPLOG_INDEX 4096
+#define SNMPLOG_INDEX_TYPE 0
+
+typedef struct {
+	unsigned char type;  /* PDU type */
+	uint32_t sec, usec;
+	unsigned char *addr;  /* The 16 bytes of the source address */
+	uint16_t port;
+	uint32_t reqId, errorStatus, errorIndex;  /* Not a trap */
+	uint32_t generic, specific, timestamp;  /* Trap only */
+	unsigned char *agentAddr;
+	unsigned char *enterprise;
+	int enterpriseLen;
+	unsigned char *vblist;  /* The varbind list TLV */
+	int vblistLen;
+} LOGREC;
+
+typedef struct {
+	int fd;
+	unsigned char *map;
+	uint32_t size;
+	Boolean writable;
+	uint32_t end;  /* Of the records */
+	uint32_t lastIndex;  /* Offset of the last index record */
+	uint32_t span, first, firstUsec, last;  /* Records since it, and their time */
+} SNMPLOG;
+
+SNMPLOG *snmplognew(char *fn, uint32_t size);
+SNMPLOG *snmplogopen(char *fn);
+void snmplogfree(SNMPLOG *l);
+int snmplogappend(SNMPLOG *l, struct sockaddr *from, MSGVIEW *msg);
+void snmplogsync(SNMPLOG *l);
+uint32_t snmplognext(SNMPLOG *l, uint32_t pos, LOGREC *rec);
+uint32_t snmplogseek(SNMPLOG *l, uint32_t since);
+Boolean snmplogmatch(LOGREC *rec, unsigned char *prefix, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
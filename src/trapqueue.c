@@ -0,0 +1,308 @@
+/*
+ * Queues traps for sending from the agent loop, coalescing repeats and
+ * limiting the rate of each kind.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef ARDUINO
+#include <Arduino.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "trapqueue.h"
+
+#if !defined(ARDUINO) && !defined(_WIN32)
+#define LOCK(q) pthread_mutex_lock(&(q)->lock)
+#define UNLOCK(q) pthread_mutex_unlock(&(q)->lock)
+#else
+#define LOCK(q)
+#define UNLOCK(q)
+#endif
+
+/* Milliseconds from an arbitrary start, wrapping around */
+static uint32_t trapclock(void)
+{
+#ifdef ARDUINO
+	return (uint32_t) millis();
+#elif defined(_WIN32)
+	return (uint32_t) GetTickCount();
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t) (now.tv_sec * 1000 + now.tv_nsec / 1000000);
+#endif
+}
+
+/* Adds the tokens of the time since k was last filled. Returns TRUE if k
+   has a token. */
+static Boolean trapfill(TRAPKEY *k, uint32_t now)
+{
+	uint32_t full = k->interval * k->burst;
+
+	if (k->interval == 0) {
+		k->last = now;
+		return TRUE;
+	}
+	if (now - k->last >= full - k->credit)
+		k->credit = full;
+	else
+		k->credit += now - k->last;
+	k->last = now;
+	return k->credit >= k->interval;
+}
+
+/* Finds the key of the enterprise OID TLV ent, or makes it. Returns NULL if
+   all keys are in use. */
+static TRAPKEY *trapkey(TRAPQUEUE *q, unsigned char *ent, int gen, int spec)
+{
+	TRAPKEY *k, *lru = NULL;
+	uint32_t now = trapclock();
+	int i;
+
+	for (i = 0, k = q->key; i < q->nkeys; i++, k++) {
+		if (k->gen == gen && k->spec == spec && k->ent[1] == ent[1] &&
+			memcmp(k->ent, ent, ent[1]+2) == 0)
+			return k;
+		if (!k->fixed && k->pending == 0 && (lru == NULL || now - k->last > now - lru->last))
+			lru = k;
+	}
+	if (q->nkeys < TRAPQUEUE_KEYS)
+		k = q->key + q->nkeys++;
+	else if ((k = lru) == NULL)
+		return NULL;
+	memset(k, 0, sizeof(TRAPKEY));
+	memcopy(k->ent, ent, ent[1]+2);
+	k->gen = gen;
+	k->spec = spec;
+	k->interval = q->interval;
+	k->burst = q->burst;
+	k->credit = k->interval * k->burst;
+	k->last = now;
+	return k;
+}
+
+/* Builds in trap the PDU of slot s, with the count varbind if coalesced.
+   Returns FALSE if trap is too small. */
+static Boolean trapbuildout(TRAPQUEUE *q, TRAPSLOT *s, struct messageStruct *trap)
+{
+	tlvStructType vbl;
+	int len;
+
+	if (s->count > 1 && q->count[1] > 0) {
+		parseTLV(s->pdu, s->vbl, &vbl);
+		trap->index = trap->size;
+		len = prependInt(trap, COUNTER, s->count);
+		len += prependBytes(trap, q->count, q->count[1]+2);
+		len += prependHeader(trap, SEQUENCE, len);
+		len += prependBytes(trap, s->pdu+vbl.vstart, vbl.len);
+		len += prependHeader(trap, SEQUENCE_OF, len);
+		len += prependBytes(trap, s->pdu+s->body, s->vbl-s->body);
+		len += prependHeader(trap, TRAP_PACKET, len);
+		if (len == trap->size - trap->index) {  /* None was BUFFER_FULL */
+			memcopy(trap->buffer, trap->buffer+trap->index, len);
+			trap->len = len;
+			return TRUE;
+		}
+	}
+	if (s->len > trap->size) return FALSE;
+	memcopy(trap->buffer, s->pdu, s->len);
+	trap->len = s->len;
+	return TRUE;
+}
+
+TRAPQUEUE *trapqueuenew(int size, uint32_t interval, int burst, char *countoid)
+{
+	TRAPQUEUE *q;
+	int i;
+
+	if ((q = (TRAPQUEUE *)malloc(sizeof(TRAPQUEUE))) == NULL) return NULL;
+	if ((q->slot = (TRAPSLOT *)malloc(size * sizeof(TRAPSLOT))) == NULL) {
+		free(q);
+		return NULL;
+	}
+	for (i = 0; i < size; i++)
+		if ((q->slot[i].pdu = (unsigned char *)malloc(REQUEST_BUFFER_SIZE)) == NULL) {
+			q->size = i;
+			trapqueuefree(q);
+			return NULL;
+		}
+	q->size = size;
+	q->n = q->nkeys = 0;
+	q->interval = interval;
+	q->burst = burst > 0 ? burst : 1;
+	q->count[0] = OBJECT_IDENTIFIER;
+	q->count[1] = countoid ? str2ber(countoid, q->count+2) : 0;
+	q->queued = q->coalesced = q->sent = q->dropped = q->overflow = 0;
+#if !defined(ARDUINO) && !defined(_WIN32)
+	pthread_mutex_init(&q->lock, NULL);
+#endif
+	return q;
+}
+
+void trapqueuefree(TRAPQUEUE *q)
+{
+	int i;
+
+	for (i = 0; i < q->size; i++)
+		free(q->slot[i].pdu);
+	free(q->slot);
+#if !defined(ARDUINO) && !defined(_WIN32)
+	pthread_mutex_destroy(&q->lock);
+#endif
+	free(q);
+}
+
+int trapqueuelimit(TRAPQUEUE *q, char *entoid, int gen, int spec, uint32_t interval, int burst)
+{
+	unsigned char ent[OID_SIZE*5+2];
+	TRAPKEY *k;
+
+	ent[0] = OBJECT_IDENTIFIER;
+	ent[1] = str2ber(entoid, ent+2);
+	LOCK(q);
+	if ((k = trapkey(q, ent, gen, spec)) != NULL) {
+		k->interval = interval;
+		k->burst = burst > 0 ? burst : 1;
+		k->credit = k->interval * k->burst;
+		k->fixed = TRUE;
+	}
+	UNLOCK(q);
+	return k ? SUCCESS : FAIL;
+}
+
+int trapqueuepush(TRAPQUEUE *q, struct messageStruct *trap)
+{
+	tlvStructType pdu, ent, addr, gen, spec, ts, vbl;
+	unsigned char *buf = trap->buffer;
+	TRAPSLOT *s;
+	TRAPKEY *k;
+	int i, n;
+
+	/* The fields of the PDU, as built by trapBuild() */
+	if (trap->len > REQUEST_BUFFER_SIZE || buf[0] != TRAP_PACKET ||
+		parseTLV(buf, 0, &pdu) < 0 || parseTLV(buf, pdu.nstart, &ent) < 0 ||
+		buf[ent.start] != OBJECT_IDENTIFIER || ent.len > OID_SIZE*5 ||
+		parseTLV(buf, ent.nstart, &addr) < 0 || parseTLV(buf, addr.nstart, &gen) < 0 ||
+		parseTLV(buf, gen.nstart, &spec) < 0 || parseTLV(buf, spec.nstart, &ts) < 0 ||
+		parseTLV(buf, ts.nstart, &vbl) < 0 || vbl.vstart + vbl.len != trap->len)
+		return FAIL;
+
+	LOCK(q);
+	if ((k = trapkey(q, buf+ent.start, getValue(buf+gen.vstart, gen.len, INTEGER),
+		getValue(buf+spec.vstart, spec.len, INTEGER))) == NULL) {
+		q->dropped++;
+		q->overflow++;
+		UNLOCK(q);
+		return FAIL;
+	}
+	n = trap->len - vbl.start;
+	for (i = 0, s = q->slot; i < q->n; i++, s++)
+		if (s->key == k && s->len - s->vbl == n && memcmp(s->pdu+s->vbl, buf+vbl.start, n) == 0) {
+			k->coalesced++;
+			q->coalesced++;
+			n = ++s->count;
+			UNLOCK(q);
+			return n;
+		}
+	if (q->n == q->size || (k->interval > 0 && k->pending >= k->burst)) {
+		if (q->n == q->size) q->overflow++;
+		k->dropped++;
+		q->dropped++;
+		UNLOCK(q);
+		return FAIL;
+	}
+	s = q->slot + q->n++;
+	memcopy(s->pdu, buf, trap->len);
+	s->key = k;
+	s->count = 1;
+	s->len = trap->len;
+	s->body = ent.start;
+	s->vbl = vbl.start;
+	k->pending++;
+	k->queued++;
+	q->queued++;
+	UNLOCK(q);
+	return 1;
+}
+
+int trapqueuedrain(TRAPQUEUE *q, struct messageStruct *trap, int max,
+	void (*send)(struct messageStruct *trap, void *arg), void *arg)
+{
+	TRAPSLOT s;
+	uint32_t now;
+	Boolean built;
+	int i, n = 0;
+
+	while (max <= 0 || n < max) {
+		LOCK(q);
+		now = trapclock();
+		for (i = 0; i < q->n && !trapfill(q->slot[i].key, now); i++);
+		if (i == q->n) {
+			UNLOCK(q);
+			break;
+		}
+		s = q->slot[i];
+		s.key->credit -= s.key->interval;
+		s.key->pending--;
+		if ((built = trapbuildout(q, &s, trap))) {
+			s.key->sent++;
+			q->sent++;
+		}
+		else {
+			s.key->dropped++;
+			q->dropped++;
+		}
+		for (q->n--; i < q->n; i++)  /* Keeping the buffer of s for reuse */
+			q->slot[i] = q->slot[i+1];
+		q->slot[q->n] = s;
+		UNLOCK(q);
+		if (built) {
+			send(trap, arg);
+			n++;
+		}
+	}
+	return n;
+}
+
+void trapqueuewalk(TRAPQUEUE *q, int (*func)(TRAPKEY *k, void *arg), void *arg)
+{
+	int i;
+
+	LOCK(q);
+	for (i = 0; i < q->nkeys && func(q->key+i, arg) == 0; i++);
+	UNLOCK(q);
+}
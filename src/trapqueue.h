@@ -0,0 +1,144 @@
+/*
+ * Queues traps for sending from the agent loop, coalescing repeats and
+ * limiting the rate of each kind.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+trapqueue.c holds trap PDUs built by trapBuild() until the agent loop sends
+them, so that a burst of traps costs the code raising them no more than a
+copy. Traps are keyed by their enterprise OID, generic and specific trap
+number, and each key has a token bucket: a trap of the key is sent only
+when a token is left, one token being added every interval milliseconds up
+to burst tokens. A trap identical to one still queued, but for its time
+stamp, is not queued again but counted; when sent, the count is appended
+as a Counter varbind if the queue has a count OID. Traps that cannot be
+queued are dropped, and counted.
+
+TRAPQUEUE *trapqueuenew(int size, uint32_t interval, int burst, char *countoid);
+	Instantiate a queue of size traps, with the token bucket of each key
+	adding a token every interval milliseconds up to burst tokens, no limit
+	if interval is 0. countoid, e.g. "P.38644.30.0.1", is the OID of the
+	count varbind, none if NULL. Returns NULL if fail.
+
+void trapqueuefree(TRAPQUEUE *q);
+	Free the queue, with the traps it holds.
+
+int trapqueuelimit(TRAPQUEUE *q, char *entoid, int gen, int spec, uint32_t interval, int burst);
+	Sets the token bucket of the key (entoid, gen, spec) apart from the
+	others, e.g. to send AUTHENTICATE_FAIL traps more seldom. Returns
+	Success(0), or Fail(-1) if there are TRAPQUEUE_KEYS keys already.
+
+int trapqueuepush(TRAPQUEUE *q, struct messageStruct *trap);
+	Queues trap, a PDU built by trapBuild(). trap is not changed. Returns the
+	number of traps it now stands for, more than 1 if coalesced, or Fail(-1)
+	if dropped: as the queue is full, or as burst traps of its key wait.
+
+int trapqueuedrain(TRAPQUEUE *q, struct messageStruct *trap, int max,
+	void (*send)(struct messageStruct *trap, void *arg), void *arg);
+	Takes out the queued traps that have a token, oldest first, up to max
+	of them if max > 0, and calls send with each, built in trap, with arg.
+	trap may be changed by send, e.g. by trapSend(). Returns the number sent.
+
+void trapqueuewalk(TRAPQUEUE *q, int (*func)(TRAPKEY *k, void *arg), void *arg);
+	Calls func with each key and its counters, until func returns non-zero.
+
+The counters of all keys are summed in queued, coalesced, sent and dropped
+of the queue; overflow counts the traps dropped as the queue or its keys
+were full. On *nix, functions of a queue may be called from
+several threads; send is called outside its lock.
+*/
+
+#ifndef _TRAPQUEUE_H
+#define _TRAPQUEUE_H
+
+#if !defined(ARDUINO) && !defined(_WIN32)
+#include <pthread.h>
+#endif
+#include "list.h"
+#include "varbind.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Keys of the token buckets; the least recently used one with no trap
+   queued is reused for a new key. */
+#define TRAPQUEUE_KEYS 8
+
+typedef struct {
+	unsigned char ent[OID_SIZE*5+2];  /* TLV of the enterprise OID */
+	int gen, spec;
+	uint32_t interval;
+	int burst;
+	uint32_t credit, last;  /* Of the token bucket, in milliseconds */
+	int pending;  /* Traps queued */
+	Boolean fixed;  /* Set by trapqueuelimit(), never reused */
+	uint32_t queued, coalesced, sent, dropped;
+} TRAPKEY;
+
+typedef struct {
+	TRAPKEY *key;
+	uint32_t count;  /* Traps coalesced into it */
+	int len;
+	int body, vbl;  /* Index of the enterprise OID and varbind list */
+	unsigned char *pdu;
+} TRAPSLOT;
+
+typedef struct {
+	int size, n;
+	TRAPSLOT *slot;  /* Oldest first */
+	int nkeys;
+	TRAPKEY key[TRAPQUEUE_KEYS];
+	uint32_t interval;
+	int burst;
+	unsigned char count[OID_SIZE*5+2];  /* TLV of the count OID */
+	uint32_t queued, coalesced, sent, dropped, overflow;
+#if !defined(ARDUINO) && !defined(_WIN32)
+	pthread_mutex_t lock;
+#endif
+} TRAPQUEUE;
+
+TRAPQUEUE *trapqueuenew(int size, uint32_t interval, int burst, char *countoid);
+void trapqueuefree(TRAPQUEUE *q);
+int trapqueuelimit(TRAPQUEUE *q, char *entoid, int gen, int spec, uint32_t interval, int burst);
+int trapqueuepush(TRAPQUEUE *q, struct messageStruct *trap);
+int trapqueuedrain(TRAPQUEUE *q, struct messageStruct *trap, int max,
+	void (*send)(struct messageStruct *trap, void *arg), void *arg);
+void trapqueuewalk(TRAPQUEUE *q, int (*func)(TRAPKEY *k, void *arg), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * Receives traps in batches, decoded in place into a ring for another
+ * thread to consume.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* for recvmmsg() */
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/socket.h>
+#include <time.h>
+#endif
+#include "traprecv.h"
+#include "resolver.h"
+
+#define TRAPRECV_RCVBUF (1 << 22)
+
+/* The receiving thread publishes a record by storing head after filling it,
+   and the consuming thread frees it by storing tail after reading it. */
+#ifdef __GNUC__
+#define LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else  /* x86, where stores are not reordered with each other */
+#define LOAD_ACQUIRE(p) (*(volatile unsigned int *)(p))
+#define STORE_RELEASE(p, v) (*(volatile unsigned int *)(p) = (v))
+#endif
+
+#ifdef __linux__
+typedef struct {
+	struct mmsghdr msgs[TRAPRECV_BATCH];
+	struct iovec iov[TRAPRECV_BATCH];
+} TRAPBATCH;
+#endif
+
+/* Decodes the datagram of t in place */
+static void trapdecode(TRAPRECV *r, TRAPREC *t)
+{
+	sockaddrunmap(&t->from);
+	t->status = msgView(t->buf, t->len, &t->msg, t->vb, TRAPRECV_VB);
+	if (t->status == SUCCESS && t->msg.pduType != TRAP_PACKET)
+		t->status = INVALID_PDU_TYPE;
+	if (t->status != SUCCESS) r->bad++;
+}
+
+TRAPRECV *traprecvnew(int fd, int size)
+{
+	TRAPRECV *r;
+	int n, rcvbuf = TRAPRECV_RCVBUF;
+#ifdef _WIN32
+	DWORD wait = TRAPRECV_WAIT;
+#else
+	struct timeval wait = { 0, TRAPRECV_WAIT * 1000 };
+#endif
+
+	for (n = 1; n < size; n <<= 1);
+	if ((r = (TRAPRECV *)malloc(sizeof(TRAPRECV))) == NULL) return NULL;
+	memset(r, 0, sizeof(TRAPRECV));
+	if ((r->rec = (TRAPREC *)malloc(n * sizeof(TRAPREC))) == NULL ||
+		(r->scratch = (unsigned char *)malloc(RESPONSE_BUFFER_SIZE)) == NULL) {
+		traprecvfree(r);
+		return NULL;
+	}
+#ifdef __linux__
+	if ((r->batch = malloc(sizeof(TRAPBATCH))) == NULL) {
+		traprecvfree(r);
+		return NULL;
+	}
+	memset(r->batch, 0, sizeof(TRAPBATCH));
+#endif
+	r->fd = fd;
+	r->mask = n - 1;
+	/* A deeper socket buffer rides out bursts, and a timeout lets the
+	   receiving thread see traprecvstop() */
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (char *)&rcvbuf, sizeof(rcvbuf));
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&wait, sizeof(wait));
+	return r;
+}
+
+void traprecvfree(TRAPRECV *r)
+{
+	free(r->rec);
+	free(r->scratch);
+	free(r->batch);
+	free(r);
+}
+
+#ifdef __linux__
+int traprecvpoll(TRAPRECV *r)
+{
+	TRAPBATCH *b = (TRAPBATCH *)r->batch;
+	TRAPREC *t;
+	unsigned int head = r->head;
+	int i, n, nrecv;
+
+	n = (r->mask + 1) - (head - LOAD_ACQUIRE(&r->tail));
+	if (n > TRAPRECV_BATCH) n = TRAPRECV_BATCH;
+	if (n == 0) {  /* Full, so the datagrams queued are dropped */
+		for (i = 0; i < TRAPRECV_BATCH; i++) {
+			b->iov[i].iov_base = r->scratch;
+			b->iov[i].iov_len = RESPONSE_BUFFER_SIZE;
+			b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+			b->msgs[i].msg_hdr.msg_iovlen = 1;
+			b->msgs[i].msg_hdr.msg_name = NULL;
+		}
+		if ((nrecv = recvmmsg(r->fd, b->msgs, TRAPRECV_BATCH, MSG_WAITFORONE, NULL)) > 0)
+			r->dropped += nrecv;
+		return 0;
+	}
+	for (i = 0; i < n; i++) {
+		t = &r->rec[(head + i) & r->mask];
+		b->iov[i].iov_base = t->buf;
+		b->iov[i].iov_len = RESPONSE_BUFFER_SIZE;
+		b->msgs[i].msg_hdr.msg_iov = &b->iov[i];
+		b->msgs[i].msg_hdr.msg_iovlen = 1;
+		b->msgs[i].msg_hdr.msg_name = &t->from;
+		b->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+	}
+	/* Wait for the first datagram, then take those already queued */
+	if ((nrecv = recvmmsg(r->fd, b->msgs, n, MSG_WAITFORONE, NULL)) < 0)
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : FAIL;
+	for (i = 0; i < nrecv; i++) {
+		t = &r->rec[(head + i) & r->mask];
+		t->len = b->msgs[i].msg_len;
+		trapdecode(r, t);
+	}
+	r->received += nrecv;
+	STORE_RELEASE(&r->head, head + nrecv);
+	return nrecv;
+}
+#else
+int traprecvpoll(TRAPRECV *r)
+{
+	TRAPREC *t;
+	unsigned int head = r->head;
+#ifdef _WIN32
+	int fromlen = sizeof(struct sockaddr_storage);
+#else
+	socklen_t fromlen = sizeof(struct sockaddr_storage);
+#endif
+
+	if (head - LOAD_ACQUIRE(&r->tail) > r->mask) {  /* Full */
+		if (recv(r->fd, (char *)r->scratch, RESPONSE_BUFFER_SIZE, 0) >= 0)
+			r->dropped++;
+		return 0;
+	}
+	t = &r->rec[head & r->mask];
+	if ((t->len = recvfrom(r->fd, (char *)t->buf, RESPONSE_BUFFER_SIZE, 0,
+		(struct sockaddr *)&t->from, &fromlen)) < 0)
+#ifdef _WIN32
+		return WSAGetLastError() == WSAETIMEDOUT ? 0 : FAIL;
+#else
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : FAIL;
+#endif
+	trapdecode(r, t);
+	r->received++;
+	STORE_RELEASE(&r->head, head + 1);
+	return 1;
+}
+#endif
+
+int traprecvrun(TRAPRECV *r)
+{
+	while (!LOAD_ACQUIRE(&r->stop))
+		if (traprecvpoll(r) == FAIL) return FAIL;
+	return SUCCESS;
+}
+
+void traprecvstop(TRAPRECV *r)
+{
+	STORE_RELEASE(&r->stop, 1);
+}
+
+TRAPREC *traprecvpeek(TRAPRECV *r)
+{
+	if (r->tail == LOAD_ACQUIRE(&r->head)) return NULL;
+	return &r->rec[r->tail & r->mask];
+}
+
+TRAPREC *traprecvwait(TRAPRECV *r, int mSec)
+{
+	TRAPREC *t;
+#ifndef _WIN32
+	struct timespec nap = { 0, 1000000 };
+#endif
+
+	for ( ; (t = traprecvpeek(r)) == NULL && mSec > 0; mSec--)
+#ifdef _WIN32
+		Sleep(1);
+#else
+		nanosleep(&nap, NULL);
+#endif
+	return t;
+}
+
+void traprecvpop(TRAPRECV *r)
+{
+	STORE_RELEASE(&r->tail, r->tail + 1);
+}
@@ -0,0 +1,138 @@
+/*
+ * Receives traps in batches, decoded in place into a ring for another
+ * thread to consume.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+/*
+traprecv.c receives traps for a manager at a high rate. The receiving
+thread reads datagrams straight into the records of a ring, with one
+recvmmsg() call per batch on Linux, and decodes each in place with
+msgView(). A consuming thread takes the records in order, to format or
+store them. The ring has one producer and one consumer, and no lock. When
+it is full, datagrams are read and dropped, and counted.
+
+TRAPRECV *traprecvnew(int fd, int size);
+	Instantiate a receiver of the bound UDP socket fd, with a ring of size
+	records, rounded up to a power of 2. Returns NULL if fail.
+
+void traprecvfree(TRAPRECV *r);
+	Free the receiver, not closing fd.
+
+int traprecvpoll(TRAPRECV *r);
+	Receiving thread: waits up to TRAPRECV_WAIT milliseconds for datagrams,
+	and puts those queued, up to TRAPRECV_BATCH, in the ring. Returns the
+	number put, or Fail(-1) if the socket fails.
+
+int traprecvrun(TRAPRECV *r);
+	Receiving thread: calls traprecvpoll() until traprecvstop() is called.
+	Returns Success(0), or Fail(-1) if the socket fails.
+
+void traprecvstop(TRAPRECV *r);
+	Makes traprecvrun() return within TRAPRECV_WAIT milliseconds.
+
+TRAPREC *traprecvpeek(TRAPRECV *r);
+	Consuming thread: returns the oldest record in the ring, or NULL if it
+	is empty. The record stays valid until traprecvpop().
+
+TRAPREC *traprecvwait(TRAPRECV *r, int mSec);
+	As traprecvpeek(), waiting up to mSec milliseconds for a record.
+
+void traprecvpop(TRAPRECV *r);
+	Consuming thread: hands the oldest record back to the ring.
+
+A record holds the datagram and its sender, an IPv4 sender on a dual-stack
+socket as AF_INET, and status, the result of
+msgView(), or INVALID_PDU_TYPE if it is not a trap. The views of at most
+TRAPRECV_VB varbinds are kept; a trap with more has status BUFFER_FULL and
+those decoded. The receiving thread counts in received the records put in
+the ring, in bad those of them that are not a valid trap, and in dropped
+the datagrams that found it full.
+*/
+
+#ifndef _TRAPRECV_H
+#define _TRAPRECV_H
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+#include "varbind.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRAPRECV_BATCH 64
+#define TRAPRECV_WAIT 100
+#define TRAPRECV_VB 32
+
+typedef struct {
+	int len;
+	struct sockaddr_storage from;
+	int status;
+	MSGVIEW msg;
+	VBVIEW vb[TRAPRECV_VB];
+	unsigned char buf[RESPONSE_BUFFER_SIZE];
+} TRAPREC;
+
+typedef struct {
+	int fd;
+	unsigned int mask;
+	TRAPREC *rec;
+	unsigned int stop;
+	uint32_t received, bad, dropped;
+	unsigned int head;  /* Next record to put, written by the receiving thread */
+	char pad[64];  /* Keeps head and tail on cache lines of their own */
+	unsigned int tail;  /* Next record to take, written by the consuming thread */
+	char pad2[64];
+	unsigned char *scratch;  /* Where datagrams are dropped */
+	void *batch;  /* Headers of recvmmsg() */
+} TRAPRECV;
+
+TRAPRECV *traprecvnew(int fd, int size);
+void traprecvfree(TRAPRECV *r);
+int traprecvpoll(TRAPRECV *r);
+int traprecvrun(TRAPRECV *r);
+void traprecvstop(TRAPRECV *r);
+TRAPREC *traprecvpeek(TRAPRECV *r);
+TRAPREC *traprecvwait(TRAPRECV *r, int mSec);
+void traprecvpop(TRAPRECV *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,278 @@
+/*
+ * A trap sink sends each trap to a list of managers over one socket.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* for sendmmsg() */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+#include "trapsink.h"
+
+#define TRAPSINK_CHUNK 8
+#define TRAP_HEADER_SIZE (COMM_STR_SIZE+12)  /* SEQUENCE, version and community */
+
+static unsigned char version[] = { INTEGER, 1, 0 };
+
+/* Resolves the name of d, keeping the address it had if that fails. The
+   address is kept as sent from a socket of family. */
+static void trapresolve(TRAPDEST *d, int family, time_t now)
+{
+	struct addrinfo hints, *res;
+	struct sockaddr_storage addr;
+	struct sockaddr *a;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_ADDRCONFIG;
+	if (getaddrinfo(d->name, NULL, &hints, &res) == 0) {
+		memset(&addr, 0, sizeof(addr));
+		memcopy((unsigned char *)&addr, (unsigned char *)res->ai_addr, res->ai_addrlen);
+		sockaddrsetport((struct sockaddr *)&addr, d->port);
+		if ((a = sockaddrmap(family, (struct sockaddr *)&addr, &d->addr, &d->addrlen)) != (struct sockaddr *)&d->addr)
+			memcopy((unsigned char *)&d->addr, (unsigned char *)a, d->addrlen);
+		d->resolved = TRUE;
+		freeaddrinfo(res);
+	}
+	d->resolveTime = now;
+}
+
+/* Builds in hdr the message header of a trap PDU of len bytes for d. Returns
+   the index of the header in hdr, or an error code (<0). */
+static int trapheader(TRAPDEST *d, unsigned char *hdr, int len)
+{
+	struct messageStruct h;
+	int clen = strlen(d->community), n;
+
+	h.buffer = hdr; h.size = TRAP_HEADER_SIZE; h.index = h.size;
+	n = prependBytes(&h, (unsigned char *)d->community, clen);
+	n += prependHeader(&h, OCTET_STRING, clen);
+	n += prependBytes(&h, version, sizeof(version));
+	if (prependHeader(&h, SEQUENCE, n + len) < 0) return BUFFER_FULL;
+	return h.index;
+}
+
+TRAPSINK *trapsinknew(int refresh)
+{
+	TRAPSINK *s;
+
+	if ((s = (TRAPSINK *)malloc(sizeof(TRAPSINK))) == NULL) return NULL;
+	if ((s->fd = sockopen(-1, FALSE)) < 0) {  /* For IPv6 and IPv4 managers */
+		free(s);
+		return NULL;
+	}
+	s->family = sockfamily(s->fd);
+	s->refresh = refresh;
+	s->size = s->alloc = 0;
+	s->dest = NULL;
+#ifndef _WIN32
+	pthread_mutex_init(&s->lock, NULL);
+#endif
+	return s;
+}
+
+void trapsinkfree(TRAPSINK *s)
+{
+	trapsinkclear(s);
+	free(s->dest);
+#ifdef _WIN32
+	closesocket(s->fd);
+#else
+	close(s->fd);
+	pthread_mutex_destroy(&s->lock);
+#endif
+	free(s);
+}
+
+int trapsinkadd(TRAPSINK *s, char *dst, uint16_t port, char *commstr)
+{
+	TRAPDEST d, *p;
+	int ret = SUCCESS;
+
+	if (strlen(commstr) >= COMM_STR_SIZE) return FAIL;
+	if ((d.name = (char *)malloc(strlen(dst)+1)) == NULL) return FAIL;
+	strcpy(d.name, dst);
+	d.port = port;
+	strcpy(d.community, commstr);
+	d.resolved = FALSE;
+	trapresolve(&d, s->family, time(NULL));  /* Outside the lock, as it may block */
+#ifndef _WIN32
+	pthread_mutex_lock(&s->lock);
+#endif
+	if (s->size == s->alloc) {
+		if ((p = (TRAPDEST *)realloc(s->dest, (s->alloc+TRAPSINK_CHUNK)*sizeof(TRAPDEST))) == NULL)
+			ret = FAIL;
+		else {
+			s->dest = p;
+			s->alloc += TRAPSINK_CHUNK;
+		}
+	}
+	if (ret == SUCCESS)
+		s->dest[s->size++] = d;
+	else
+		free(d.name);
+#ifndef _WIN32
+	pthread_mutex_unlock(&s->lock);
+#endif
+	return ret;
+}
+
+void trapsinkclear(TRAPSINK *s)
+{
+#ifndef _WIN32
+	pthread_mutex_lock(&s->lock);
+#endif
+	while (s->size > 0)
+		free(s->dest[--s->size].name);
+#ifndef _WIN32
+	pthread_mutex_unlock(&s->lock);
+#endif
+}
+
+void trapsinkrefresh(TRAPSINK *s)
+{
+	TRAPDEST d;
+	time_t now = time(NULL);
+	int i;
+
+	if (s->refresh == 0) return;
+	for (i = 0; ; i++) {
+#ifndef _WIN32
+		pthread_mutex_lock(&s->lock);
+#endif
+		while (i < s->size && now - s->dest[i].resolveTime < s->refresh) i++;
+		if (i < s->size && (d.name = (char *)malloc(strlen(s->dest[i].name)+1)) != NULL) {
+			strcpy(d.name, s->dest[i].name);
+			d.port = s->dest[i].port;
+			d.addr = s->dest[i].addr;
+			d.addrlen = s->dest[i].addrlen;
+			d.resolved = FALSE;
+			s->dest[i].resolveTime = now;
+		}
+		else
+			i = s->size;
+#ifndef _WIN32
+		pthread_mutex_unlock(&s->lock);
+#endif
+		if (i == s->size) break;
+
+		trapresolve(&d, s->family, now);  /* Outside the lock, as it may block */
+#ifndef _WIN32
+		pthread_mutex_lock(&s->lock);
+#endif
+		/* Unless the destinations changed meanwhile */
+		if (d.resolved && i < s->size && s->dest[i].port == d.port && strcmp(s->dest[i].name, d.name) == 0) {
+			s->dest[i].addr = d.addr;
+			s->dest[i].addrlen = d.addrlen;
+			s->dest[i].resolved = TRUE;
+		}
+#ifndef _WIN32
+		pthread_mutex_unlock(&s->lock);
+#endif
+		free(d.name);
+	}
+}
+
+int trapsinksend(TRAPSINK *s, struct messageStruct *trap)
+{
+	unsigned char hdr[SNMP_BATCH_SIZE][TRAP_HEADER_SIZE];
+	char dstAddr[IP_STR_SIZE];
+	TRAPDEST *d;
+	int i, n, h, sent = 0;
+#ifdef __linux__
+	struct mmsghdr msg[SNMP_BATCH_SIZE];
+	struct iovec iov[SNMP_BATCH_SIZE][2];
+	int j, k;
+#else
+	unsigned char *buf;
+
+	if ((buf = (unsigned char *)malloc(TRAP_HEADER_SIZE + trap->len)) == NULL) return FAIL;
+#endif
+
+#ifndef _WIN32
+	pthread_mutex_lock(&s->lock);
+#endif
+	for (i = 0; i < s->size; ) {
+		/* Headers for a batch of destinations, the PDU being shared */
+		for (n = 0; i < s->size && n < SNMP_BATCH_SIZE; i++) {
+			d = &s->dest[i];
+			if (!d->resolved || (h = trapheader(d, hdr[n], trap->len)) < 0)
+				continue;
+			if (debug) {
+				printf("Send trap to %s:%u\n", sockaddrntop((struct sockaddr *)&d->addr, dstAddr), d->port);
+			}
+#ifdef __linux__
+			iov[n][0].iov_base = hdr[n]+h; iov[n][0].iov_len = TRAP_HEADER_SIZE-h;
+			iov[n][1].iov_base = trap->buffer; iov[n][1].iov_len = trap->len;
+			memset(&msg[n], 0, sizeof(struct mmsghdr));
+			msg[n].msg_hdr.msg_iov = iov[n];
+			msg[n].msg_hdr.msg_iovlen = 2;
+			msg[n].msg_hdr.msg_name = &d->addr;
+			msg[n].msg_hdr.msg_namelen = d->addrlen;
+#else
+			memcopy(buf, hdr[n]+h, TRAP_HEADER_SIZE-h);
+			memcopy(buf+TRAP_HEADER_SIZE-h, trap->buffer, trap->len);
+			if (sendto(s->fd, (char *)buf, TRAP_HEADER_SIZE-h+trap->len, 0,
+				(struct sockaddr *)&d->addr, d->addrlen) > 0)
+				sent++;
+#endif
+			n++;
+		}
+#ifdef __linux__
+		for (j = 0; j < n; j += k) {
+			if ((k = sendmmsg(s->fd, msg+j, n-j, 0)) <= 0)
+				k = 1;  /* That destination is skipped, not those after it */
+			else
+				sent += k;
+		}
+#endif
+	}
+#ifndef _WIN32
+	pthread_mutex_unlock(&s->lock);
+#endif
+#ifndef __linux__
+	free(buf);
+#endif
+	return sent;
+}
@@ -0,0 +1,121 @@
+/*
+ * A trap sink sends each trap to a list of managers over one socket.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+trapsink.c sends the traps of an agent to a list of destinations, each a
+manager with its own port and community string, over one socket kept open.
+Destination names are resolved when added, and again by trapsinkrefresh()
+once refresh seconds have passed, so that sending a trap costs no lookups.
+On Linux, the copies of a trap for all destinations go out in batches of
+SNMP_BATCH_SIZE with sendmmsg(), sharing the trap PDU; elsewhere they are
+sent one by one.
+
+TRAPSINK *trapsinknew(int refresh);
+	Instantiate a trap sink with no destination, with its socket. Names are
+	resolved again after refresh seconds, never if 0. Returns NULL if fail.
+
+void trapsinkfree(TRAPSINK *s);
+	Free the trap sink, closing its socket.
+
+int trapsinkadd(TRAPSINK *s, char *dst, uint16_t port, char *commstr);
+	Adds the destination dst, a host name or IPv4 or IPv6 address, at port with the
+	community string commstr. Returns Success(0), or Fail(-1) if it cannot
+	be added. A name not resolved is kept, and tried again by
+	trapsinkrefresh().
+
+void trapsinkclear(TRAPSINK *s);
+	Removes all destinations.
+
+void trapsinkrefresh(TRAPSINK *s);
+	Resolves again the names last resolved refresh seconds ago or more. The
+	lookups are made outside the lock, which trapsinksend() takes, so call
+	it from a thread or timer that may wait for them, not the send path.
+
+int trapsinksend(TRAPSINK *s, struct messageStruct *trap);
+	Sends trap, a PDU built by trapBuild(), to every destination resolved,
+	at the address last resolved. trap is not changed. Returns the number of
+	destinations sent to, or Fail(-1).
+
+Functions of a trap sink may be called from several threads.
+*/
+
+#ifndef _TRAPSINK_H
+#define _TRAPSINK_H
+
+#include <time.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <pthread.h>
+#include <netinet/in.h>
+#endif
+#include "SnmpAgent.h"
+#include "resolver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	char *name;
+	uint16_t port;
+	char community[COMM_STR_SIZE];
+	struct sockaddr_storage addr;  /* As sent from the socket */
+	socklen_t addrlen;
+	Boolean resolved;
+	time_t resolveTime;  /* Of the last attempt */
+} TRAPDEST;
+
+typedef struct {
+	int fd, family;
+	int refresh;
+	int size, alloc;
+	TRAPDEST *dest;
+#ifndef _WIN32
+	pthread_mutex_t lock;
+#endif
+} TRAPSINK;
+
+TRAPSINK *trapsinknew(int refresh);
+void trapsinkfree(TRAPSINK *s);
+int trapsinkadd(TRAPSINK *s, char *dst, uint16_t port, char *commstr);
+void trapsinkclear(TRAPSINK *s);
+void trapsinkrefresh(TRAPSINK *s);
+int trapsinksend(TRAPSINK *s, struct messageStruct *trap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
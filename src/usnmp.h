@@ -34,7 +34,9 @@
 #define _USNMP_H
 
 #define COMM_STR_SIZE 16
-/* Allocated size in each MIB leaf to hold an octet string or OID */
+/* An IPv4 or IPv6 address as text, as INET6_ADDRSTRLEN */
+#define IP_STR_SIZE 46
+/* Longest octet string or OID that a MIB leaf holds; see MIB_INLINE_SIZE */
 #if defined(__AVR_ATmega328P__)
 #define MIB_DATA_SIZE 32
 #else
@@ -57,6 +59,13 @@
 #define OID_SIZE 16
 #endif
 
+/* Index the MIB tree with a trie, so that a lookup costs in proportion to
+   the depth of the OID rather than the number of MIB nodes, at the cost of
+   the memory of the trie, as mibtrie.h tells. */
+#if !defined(__AVR_ATmega328P__)
+#define MIB_TRIE_INDEX
+#endif
+
 /* Buffers to hold request and response packets, and a varbind pair. */
 #if defined(__AVR_ATmega328P__)
 #define REQUEST_BUFFER_SIZE 	96
@@ -68,4 +77,8 @@
 #define VB_BUFFER_SIZE 256
 #endif
 
+/* Requests received and answered together by processSNMPBatchCtx(), where
+   the system can receive or send several datagrams in one call. */
+#define SNMP_BATCH_SIZE 16
+
 #endif
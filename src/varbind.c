@@ -85,7 +85,7 @@ int parseLength(unsigned char *msg, int *len)
 /* Given a length, builds the length field of a TLV and returns the size of this field. */
 int buildLength(unsigned char *buffer, int len)
 {
-	int tlen;
+	int tlen = 0;  /* For a length over 0xFFFF, not encoded */
 	
 	if (len < 0x80) {
 		tlen = 1;
@@ -124,6 +124,92 @@ int insertRespLen(struct messageStruct *request, int reqStart, struct messageStr
 	return tlen;
 }
 
+/*
+ * The prepend functions build a message backwards, from msg->index towards the
+ * start of its buffer, so that the length of each TLV is known when its header
+ * is written. Each lowers msg->index by, and returns, the size written; or
+ * returns BUFFER_FULL if there is no room.
+ */
+int prependBytes(struct messageStruct *msg, unsigned char *data, int len)
+{
+	if (msg->index < len) return BUFFER_FULL;
+	msg->index -= len;
+	memcopy(msg->buffer+msg->index, data, len);
+	return len;
+}
+
+int prependHeader(struct messageStruct *msg, unsigned char type, int len)
+{
+	unsigned char l[3];
+	int tlen = buildLength(l, len);
+
+	if (tlen == 0 || msg->index < tlen+1) return BUFFER_FULL;
+	msg->index -= tlen;
+	memcopy(msg->buffer+msg->index, l, tlen);
+	msg->buffer[--msg->index] = type;
+	return tlen+1;
+}
+
+int prependInt(struct messageStruct *msg, unsigned char type, uint32_t val)
+{
+	int len = 0;
+	int32_t v = (int32_t) val;
+	unsigned char b;
+
+	if (msg->index < INT_SIZE+3) return BUFFER_FULL;
+	if (type == INTEGER)
+		do {  /* Until the remaining bytes are all sign bits */
+			msg->buffer[--msg->index] = b = (unsigned char) (v & 0xFF);
+			v >>= 8;
+			len++;
+		} while (!((v == 0 && !(b & '\x80')) || (v == -1 && (b & '\x80'))));
+	else
+		do {  /* Until the remaining bytes are 0, with a leading 0 if the first bit is a 1 */
+			msg->buffer[--msg->index] = b = (unsigned char) (val & 0xFF);
+			val >>= 8;
+			len++;
+		} while (val != 0 || (b & '\x80'));
+	msg->buffer[--msg->index] = (unsigned char) len;
+	msg->buffer[--msg->index] = type;
+	return len+2;
+}
+
+int prependOid(struct messageStruct *msg, OID *oid)
+{
+	unsigned char ber[OID_SIZE*5];
+	int len, hlen;
+
+	len = oid2ber(oid, ber);
+	if ((len = prependBytes(msg, ber, len)) < 0 ||
+		(hlen = prependHeader(msg, OBJECT_IDENTIFIER, len)) < 0)
+		return BUFFER_FULL;
+	return len+hlen;
+}
+
+int prependValue(struct messageStruct *msg, MIB *mib)
+{
+	int len, hlen;
+
+	switch(mib->dataType) {
+		case OCTET_STRING :
+		case OBJECT_IDENTIFIER :
+		case IP_ADDRESS :
+			if ((len = prependBytes(msg, mib->u.octetstring, mib->dataLen)) < 0 ||
+				(hlen = prependHeader(msg, mib->dataType, len)) < 0)
+				return BUFFER_FULL;
+			return len+hlen;
+		case INTEGER :
+		case TIMETICKS :
+		case COUNTER :
+		case GAUGE :
+			return prependInt(msg, mib->dataType, mib->u.intval);
+		case NULL_ITEM :
+			return prependHeader(msg, NULL_ITEM, 0);
+		default :
+			return INVALID_DATA_TYPE;
+	}
+}
+
 /* Compacts BER-encoded integer and returns the compacted size. */ 
 int compactInt(unsigned char *tlv)
 {
@@ -215,10 +301,14 @@ int parseTLV(unsigned char *msg, int index, tlvStructType *tlv)
 			tlv->nstart = tlv->vstart + tlv->len;
 			break;
 		case INTEGER:
+			if (tlv->len > INT_SIZE) return ILLEGAL_LENGTH;
+			tlv->nstart = tlv->vstart + tlv->len;
+			break;
 		case COUNTER:
 		case GAUGE:
-		case TIMETICKS:
-			if (tlv->len > INT_SIZE) return ILLEGAL_LENGTH;
+		case TIMETICKS:  /* May take a leading 0 */
+			if (tlv->len > INT_SIZE+1 || (tlv->len == INT_SIZE+1 && msg[tlv->vstart] != 0))
+				return ILLEGAL_LENGTH;
 			tlv->nstart = tlv->vstart + tlv->len;
 			break;
 		case OBJECT_IDENTIFIER:
@@ -232,6 +322,214 @@ int parseTLV(unsigned char *msg, int index, tlvStructType *tlv)
 	return SUCCESS;
 }
 
+/* Extracts the TLV at index of msg, which must end by end, whatever its type.
+   Returns Success(0) or ILLEGAL_LENGTH. */
+static int viewTLV(unsigned char *msg, int index, int end, tlvStructType *tlv)
+{
+	int tlen;
+
+	if (index+2 > end) return ILLEGAL_LENGTH;
+	if (msg[index+1] == 0x80) return ILLEGAL_LENGTH;  /* Indefinite length */
+	tlen = msg[index+1] & '\x80' ? (msg[index+1] & '\x7F') + 1 : 1;
+	if (tlen > 3 || index+1+tlen > end) return ILLEGAL_LENGTH;
+	tlv->start = index;
+	parseLength(msg+index+1, &(tlv->len));
+	tlv->vstart = index + 1 + tlen;
+	tlv->nstart = tlv->vstart + tlv->len;
+	return tlv->nstart > end ? ILLEGAL_LENGTH : SUCCESS;
+}
+
+/* Extracts the value of an integer, counter, gauge or timetick TLV. */
+static int viewInt(unsigned char *msg, tlvStructType *tlv, uint32_t *val)
+{
+	if (tlv->len < 1 || tlv->len > INT_SIZE+1 ||
+		(tlv->len == INT_SIZE+1 && (msg[tlv->start] == INTEGER || msg[tlv->vstart] != 0)))
+		return ILLEGAL_LENGTH;
+	*val = getValue(msg+tlv->vstart, tlv->len, msg[tlv->start]);
+	return SUCCESS;
+}
+
+/* Decodes the varbind at index of msg, which must end by end, into vb. Returns
+   Success(0), ILLEGAL_DATA if it is not a SEQUENCE, or INVALID_DATA_TYPE if its
+   name or value is malformed. */
+static int viewVarBind(unsigned char *msg, int index, int end, VBVIEW *vb, int *next)
+{
+	tlvStructType seq, name, value;
+
+	if (viewTLV(msg, index, end, &seq) != SUCCESS || msg[seq.start] != SEQUENCE)
+		return ILLEGAL_DATA;
+	*next = seq.nstart;
+	if (viewTLV(msg, seq.vstart, seq.nstart, &name) != SUCCESS ||
+		msg[name.start] != OBJECT_IDENTIFIER || name.len == 0 ||
+		viewTLV(msg, name.nstart, seq.nstart, &value) != SUCCESS ||
+		value.nstart != seq.nstart)
+		return INVALID_DATA_TYPE;
+	vb->name = msg+name.start;
+	vb->oid = msg+name.vstart; vb->oidLen = name.len;
+	vb->value = msg+value.start;
+	vb->val = msg+value.vstart; vb->valLen = value.len;
+	vb->type = msg[value.start];
+	vb->intval = 0;
+	switch (vb->type) {
+		case NULL_ITEM:
+			if (value.len != 0) return INVALID_DATA_TYPE;
+			break;
+		case IP_ADDRESS:
+			if (value.len != 4) return INVALID_DATA_TYPE;
+			break;
+		case INTEGER:
+		case COUNTER:
+		case GAUGE:
+		case TIMETICKS:
+			if (viewInt(msg, &value, &vb->intval) != SUCCESS) return INVALID_DATA_TYPE;
+			break;
+		case OBJECT_IDENTIFIER:
+		case OCTET_STRING:
+		case OPAQUE_TYPE:
+			break;
+		default:
+			return INVALID_DATA_TYPE;
+	}
+	return SUCCESS;
+}
+
+/* Decodes the varbinds of the list TLV at index of msg, counting them in *n.
+   A NULL vb validates them only. */
+static int viewVarBinds(unsigned char *msg, tlvStructType *list, VBVIEW *vb, int maxvb, int *n)
+{
+	VBVIEW v;
+	int pos, ret;
+
+	for (*n = 0, pos = list->vstart; pos < list->nstart; (*n)++) {
+		if (vb != NULL && *n == maxvb) return BUFFER_FULL;
+		if ((ret = viewVarBind(msg, pos, list->nstart, vb ? vb + *n : &v, &pos)) != SUCCESS)
+			return ret;
+	}
+	return SUCCESS;
+}
+
+/* Decodes the varbind TLV of up to len bytes at buf into vb. Returns its
+   size, or an error code (<0). */
+int vbView(unsigned char *buf, int len, VBVIEW *vb)
+{
+	int next, ret;
+
+	return (ret = viewVarBind(buf, 0, len, vb, &next)) == SUCCESS ? next : ret;
+}
+
+/* Decodes the varbind list TLV of up to len bytes at buf into at most maxvb
+   views. Returns the number of varbinds, or an error code (<0). */
+int vblistView(unsigned char *buf, int len, VBVIEW *vb, int maxvb)
+{
+	tlvStructType list;
+	int n, ret;
+
+	if (viewTLV(buf, 0, len, &list) != SUCCESS || buf[0] != SEQUENCE_OF)
+		return ILLEGAL_DATA;
+	return (ret = viewVarBinds(buf, &list, vb, maxvb, &n)) == SUCCESS ? n : ret;
+}
+
+/*
+ * The message is checked from the front, each TLV within the one enclosing
+ * it, and each field is recorded in msg as it is reached. Error codes are
+ * those of the agent: COMM_STR_ERR for a malformed community, REQ_ID_ERR,
+ * ILLEGAL_ERR_STATUS or ILLEGAL_ERR_INDEX for the PDU header, and the codes of
+ * vblistView() for the varbinds, with msg->nvb of them decoded.
+ */
+int msgView(unsigned char *buf, int len, MSGVIEW *msg, VBVIEW *vb, int maxvb)
+{
+	tlvStructType tlv;
+	int end;
+
+	memset(msg, 0, sizeof(MSGVIEW));
+	msg->vb = vb;
+	if (viewTLV(buf, 0, len, &tlv) != SUCCESS) return ILLEGAL_LENGTH;
+	if (buf[0] != SEQUENCE_OF) return ILLEGAL_DATA;
+	msg->len = end = tlv.nstart;
+
+	/* Version */
+	if (viewTLV(buf, tlv.vstart, end, &tlv) != SUCCESS) return ILLEGAL_LENGTH;
+	if (buf[tlv.start] != INTEGER || viewInt(buf, &tlv, &msg->version) != SUCCESS)
+		return ILLEGAL_DATA;
+	msg->versionTlv = buf+tlv.start;
+
+	/* Community */
+	if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS) return COMM_STR_ERR;
+	msg->community = buf+tlv.vstart; msg->communityLen = tlv.len;
+	if (buf[tlv.start] != OCTET_STRING) return INVALID_DATA_TYPE;
+
+	/* PDU */
+	if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS) return ILLEGAL_LENGTH;
+	msg->pduTlv = buf+tlv.start;
+	msg->pduType = buf[tlv.start];
+	end = tlv.nstart;
+	if (msg->pduType == TRAP_PACKET) {
+		if (viewTLV(buf, tlv.vstart, end, &tlv) != SUCCESS || buf[tlv.start] != OBJECT_IDENTIFIER)
+			return ILLEGAL_DATA;
+		msg->enterprise = buf+tlv.vstart; msg->enterpriseLen = tlv.len;
+		if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS || buf[tlv.start] != IP_ADDRESS ||
+			tlv.len != 4)
+			return ILLEGAL_DATA;
+		msg->agentAddr = buf+tlv.vstart;
+		if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS || buf[tlv.start] != INTEGER ||
+			viewInt(buf, &tlv, &msg->generic) != SUCCESS)
+			return ILLEGAL_DATA;
+		if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS || buf[tlv.start] != INTEGER ||
+			viewInt(buf, &tlv, &msg->specific) != SUCCESS)
+			return ILLEGAL_DATA;
+		if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS || buf[tlv.start] != TIMETICKS ||
+			viewInt(buf, &tlv, &msg->timestamp) != SUCCESS)
+			return ILLEGAL_DATA;
+	}
+	else
+		if (VALID_REQUEST(msg->pduType) || msg->pduType == GET_RESPONSE) {
+			if (viewTLV(buf, tlv.vstart, end, &tlv) != SUCCESS || buf[tlv.start] != INTEGER ||
+				viewInt(buf, &tlv, &msg->reqId) != SUCCESS)
+				return REQ_ID_ERR;
+			msg->reqIdTlv = buf+tlv.start;
+			if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS || buf[tlv.start] != INTEGER ||
+				viewInt(buf, &tlv, &msg->errorStatus) != SUCCESS)
+				return ILLEGAL_ERR_STATUS;
+			msg->errStatusTlv = buf+tlv.start;
+			if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS || buf[tlv.start] != INTEGER ||
+				viewInt(buf, &tlv, &msg->errorIndex) != SUCCESS)
+				return ILLEGAL_ERR_INDEX;
+			msg->errIndexTlv = buf+tlv.start;
+		}
+		else return INVALID_PDU_TYPE;
+
+	/* Varbind list */
+	if (viewTLV(buf, tlv.nstart, end, &tlv) != SUCCESS || buf[tlv.start] != SEQUENCE_OF)
+		return ILLEGAL_DATA;
+	msg->vblistTlv = buf+tlv.start;
+	msg->vblistLen = tlv.nstart - tlv.start;
+	return viewVarBinds(buf, &tlv, vb, maxvb, &msg->nvb);
+}
+
+/* Fills a MIB node from a varbind view. An octet string value is pointed to
+   in the message, not copied, so the node is read-only: its dataSize is 0. */
+void vbviewMib(VBVIEW *vb, MIB *mib)
+{
+	ber2oid(vb->oid, vb->oidLen, &mib->oid);
+	mib->dataType = vb->type;
+	switch (vb->type) {
+		case INTEGER:
+		case COUNTER:
+		case GAUGE:
+		case TIMETICKS:
+			mib->u.intval = vb->intval;
+			mib->dataLen = INT_SIZE;
+			mib->dataSize = 0;
+			break;
+		default:
+			mib->u.octetstring = vb->val;
+			mib->dataLen = vb->valLen;
+			mib->dataSize = 0;
+	}
+	mib->access = '-'; mib->get = NULL; mib->set = NULL;
+	mib->dataInline = 0; mib->dataHeap = 0;
+}
+
 /* Resets a varbind list to empty. */
 void vblistReset(struct messageStruct *vblist)
 {
@@ -239,17 +537,18 @@ void vblistReset(struct messageStruct *vblist)
 	vblist->buffer[1] = '\0';
 	vblist->len = 2;
 	vblist->index = 2;
+	vblist->nvb = 0;
 }
 
 /* Adds a varbind into a varbind list. Returns the total length of the resultant list. */
 int vblistAdd(struct messageStruct *vblist, char *oidstr, unsigned char dataType, void *val, int vlen )
 {
-	static struct messageStruct vb;
-	static unsigned char vbBuffer[VB_BUFFER_SIZE];
-	vb.buffer = vbBuffer; vb.size = VB_BUFFER_SIZE;
-
+	struct messageStruct vb;
+	unsigned char vbBuffer[VB_BUFFER_SIZE];
 	unsigned char *tlv;
-	int length; uint32_t *p;
+	int length;
+
+	vb.buffer = vbBuffer; vb.size = VB_BUFFER_SIZE;
 
 	/* SEQUENCE header */
 	vb.buffer[0] = SEQUENCE;
@@ -303,52 +602,35 @@ int vblistAdd(struct messageStruct *vblist, char *oidstr, unsigned char dataType
 }
 
 /* Traverses a varbind list where opt=0 for first varbind, non-zero for next.
-   Returns the nth order of the extracted varbind. */
+   Returns the nth order of the extracted varbind. The position of the next
+   varbind is kept in vblist->index, and their count in vblist->nvb, so that
+   each call decodes one varbind. A value is copied within vb->dataSize. */
 int vblistGet(struct messageStruct *vblist, MIB *vb, unsigned char opt)
 {
-	static unsigned char i = 0;
-	static tlvStructType tlv;
+	tlvStructType list;
+	VBVIEW v;
+	unsigned char *u = vb->u.octetstring;
+	unsigned short size = vb->dataSize;
 
+	if (viewTLV(vblist->buffer, 0, vblist->len, &list) != SUCCESS ||
+		vblist->buffer[0] != SEQUENCE_OF)
+		return FAIL;
 	if ( opt == 0 ) {
-		if (parseTLV(vblist->buffer, 0, &tlv) != SUCCESS ||
-			vblist->buffer[tlv.start] != SEQUENCE_OF)
-			return FAIL;
-		else i = 0;
+		vblist->index = list.vstart;
+		vblist->nvb = 0;
 	}
-	if (tlv.nstart < vblist->len) {
-		if (parseTLV(vblist->buffer, tlv.nstart, &tlv) !=SUCCESS ||
-			vblist->buffer[tlv.start] != SEQUENCE )
-			return FAIL;
-		if (parseTLV(vblist->buffer, tlv.nstart, &tlv) != SUCCESS ||
-			vblist->buffer[tlv.start] != OBJECT_IDENTIFIER )
-			return FAIL;
-		else
-			ber2oid(vblist->buffer+tlv.vstart, tlv.len, &(vb->oid));
-		if (parseTLV(vblist->buffer, tlv.nstart, &tlv) !=SUCCESS )
-			return FAIL;
-		else {
-			vb->dataType = vblist->buffer[tlv.start];
-		 	switch(vb->dataType) {
-				case NULL_ITEM:
-					break;
-				case OCTET_STRING :
-				case OBJECT_IDENTIFIER :
-				case IP_ADDRESS :
-					memcopy(vb->u.octetstring, vblist->buffer+tlv.vstart, tlv.len);
-					vb->dataLen = tlv.len;
-					break;
-				case INTEGER :
-				case TIMETICKS :
-				case COUNTER :
-				case GAUGE :
-	 				vb->u.intval = getValue(vblist->buffer+tlv.vstart, tlv.len, INTEGER);
-					vb->dataLen = INT_SIZE;
-					break;
-				default :
-					return FAIL;
-      }
-			vb->access='-'; vb->get = NULL; vb->set = NULL;
-			return ++i;
-		}
-	} else return 0;
+	if (vblist->index >= list.nstart) return 0;
+
+	if (viewVarBind(vblist->buffer, vblist->index, list.nstart, &v, &vblist->index) != SUCCESS)
+		return FAIL;
+	vblist->nvb++;
+	vbviewMib(&v, vb);
+	vb->dataSize = size;
+	if (vb->dataType != INTEGER && vb->dataType != COUNTER && vb->dataType != GAUGE &&
+		vb->dataType != TIMETICKS) {
+		vb->u.octetstring = u;
+		if (v.valLen > size) return FAIL;  /* No room for the value */
+		memcopy(vb->u.octetstring, v.val, v.valLen);
+	}
+	return vblist->nvb;
 }
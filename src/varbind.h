@@ -76,6 +76,7 @@ struct messageStruct {
 	int size;
 	int len;
 	int index;
+	int nvb;  /* Varbinds passed by vblistGet() */
 };
 
 typedef struct {
@@ -85,6 +86,56 @@ typedef struct {
 	int nstart; 	/* Absolute Index of the next TLV */
 } tlvStructType;
 
+/* A varbind as it lies in a message. Its fields point into the message,
+   which must outlive the view. */
+typedef struct {
+	unsigned char *name;	/* The NAME (OID) TLV */
+	unsigned char *oid;		/* and its BER-encoded value */
+	int oidLen;
+	unsigned char *value;	/* The value TLV */
+	unsigned char *val;		/* and its V field */
+	int valLen;
+	unsigned char type;		/* Data type of the value */
+	uint32_t intval;			/* Value of an integer, counter, gauge or timetick */
+} VBVIEW;
+
+/* The most varbinds a message of size bytes can hold, each taking at least 7.
+   On a board, whose stack cannot hold views of that many, at most
+   VBVIEW_LIMIT; a message of more is answered tooBig. */
+#if defined(__AVR_ATmega328P__)
+#define VBVIEW_LIMIT 4
+#elif defined(ARDUINO)
+#define VBVIEW_LIMIT 16  /* ESP8266 and ESP32, 512 bytes of views */
+#endif
+#ifdef VBVIEW_LIMIT
+#define VBVIEW_MAX(size) ((size)/7 < VBVIEW_LIMIT ? (size)/7 : VBVIEW_LIMIT)
+#else
+#define VBVIEW_MAX(size) ((size)/7)
+#endif
+
+/* A SNMP message as it lies in its buffer. Pointers to TLVs are NULL until
+   the decoder reaches them. */
+typedef struct {
+	int len;							/* Size of the message TLV */
+	uint32_t version;
+	unsigned char *versionTlv;		/* Followed by the community TLV */
+	unsigned char *community;		/* Community string, not terminated */
+	int communityLen;
+	unsigned char *pduTlv;
+	unsigned char pduType;
+	unsigned char *reqIdTlv;			/* Followed by the error status and index TLVs */
+	unsigned char *errStatusTlv, *errIndexTlv;
+	uint32_t reqId, errorStatus, errorIndex;
+	unsigned char *enterprise;		/* Trap only: BER-encoded enterprise OID */
+	int enterpriseLen;
+	unsigned char *agentAddr;		/* Trap only: the 4 bytes of the agent address */
+	uint32_t generic, specific, timestamp;  /* Trap only */
+	unsigned char *vblistTlv;
+	int vblistLen;						/* Size of the varbind list TLV */
+	VBVIEW *vb;							/* Views of the varbinds */
+	int nvb;								/* and their number */
+} MSGVIEW;
+
 /* Computes the length field of a TLV and returns the size of this Length field. */
 int parseLength(unsigned char *msg, int *len);
 
@@ -95,6 +146,22 @@ int buildLength(unsigned char *buffer, int len);
    L element of the response TLV and returns the size of this length field. */
 int insertRespLen(struct messageStruct *request, int reqStart, struct messageStruct *response, int respStart, int size);
 
+/* Prepend functions build a message backwards, from msg->index towards the
+   start of its buffer. Each returns the size written, or BUFFER_FULL. */
+int prependBytes(struct messageStruct *msg, unsigned char *data, int len);
+
+/* Prepends the type and length fields of a TLV. */
+int prependHeader(struct messageStruct *msg, unsigned char type, int len);
+
+/* Prepends an integer, counter, gauge or timetick TLV in its shortest encoding. */
+int prependInt(struct messageStruct *msg, unsigned char type, uint32_t val);
+
+/* Prepends an OID TLV. */
+int prependOid(struct messageStruct *msg, OID *oid);
+
+/* Prepends a TLV of the value of a MIB node. */
+int prependValue(struct messageStruct *msg, MIB *mib);
+
 /* Compacts BER-encoded integer and returns the compacted size. */ 
 int compactInt(unsigned char *tlv);
 
@@ -104,6 +171,23 @@ uint32_t getValue(unsigned char *vptr, int vlen, unsigned char datatype);
 /* Extracts a TLV from msg starting at index. Return Success(0) or error code (<0). */ 
 int parseTLV(unsigned char *msg, int index, tlvStructType *tlv);
 
+/* Decodes the varbind TLV of up to len bytes at buf into vb. Returns its
+   size, or an error code (<0). */
+int vbView(unsigned char *buf, int len, VBVIEW *vb);
+
+/* Decodes the varbind list TLV of up to len bytes at buf into at most maxvb
+   views. Returns the number of varbinds, or an error code (<0). */
+int vblistView(unsigned char *buf, int len, VBVIEW *vb, int maxvb);
+
+/* Validates and decodes a SNMP message of len bytes at buf, with the views of
+   at most maxvb varbinds in vb. Returns Success(0) or an error code (<0); on
+   error, msg holds what was decoded before it. */
+int msgView(unsigned char *buf, int len, MSGVIEW *msg, VBVIEW *vb, int maxvb);
+
+/* Fills a MIB node from a varbind view. An octet string value is pointed to
+   in the message, not copied. */
+void vbviewMib(VBVIEW *vb, MIB *mib);
+
 /* Resets a varbind list to empty. */
 void vblistReset(struct messageStruct *vblist);
 
@@ -111,7 +195,10 @@ void vblistReset(struct messageStruct *vblist);
 int vblistAdd(struct messageStruct *vblist, char *oidstr, unsigned char dataType, void *val, int vlen );
 
 /* Traverses a varbind list where opt=0 for first varbind, non-zero for next.
-   Returns the nth order of the extracted varbind. */
+   Returns the nth order of the extracted varbind, 0 past the last, or
+   Fail(-1) if malformed or if a value is longer than vb->dataSize, the room
+   at vb->u.octetstring it is copied to. The position of the next varbind is
+   kept in vblist->index, and the number passed in vblist->nvb. */
 int vblistGet(struct messageStruct *vblist, MIB *vb, unsigned char opt);
 
 #ifdef __cplusplus
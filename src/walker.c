@@ -0,0 +1,308 @@
+/*
+ * A SNMP walk of a subtree by several GetNext chains at once, each over a range
+ * of its columns, pipelined through the poller of poller.h.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "walker.h"
+#include "resolver.h"
+
+#define WALK_CHUNK 1024
+
+/* The chains of an outstanding request, in the order of its varbinds */
+typedef struct {
+	WALKER *w;
+	int n;
+	int *chain;
+} WALKREQ;
+
+static unsigned char nullvalue[] = { NULL_ITEM, 0 };
+
+/* Compares the BER-encoded OIDs a and b. The encoding keeps their order, as
+   the last byte of each sub-identifier, and only it, is below 0x80. */
+static int bercmp(unsigned char *a, int alen, unsigned char *b, int blen)
+{
+	int c;
+
+	if ((c = memcmp(a, b, alen < blen ? alen : blen)) != 0) return c;
+	return alen - blen;
+}
+
+/* Keeps a copy of the varbind vb found by c. Returns Success(0) or Fail(-1). */
+static int walkkeep(WALKCHAIN *c, VBVIEW *vb)
+{
+	unsigned char l[3];
+	int len = (int)(vb->val + vb->valLen - vb->name), llen = buildLength(l, len);
+	unsigned char *buf;
+
+	if (c->len + 1 + llen + len > c->alloc) {
+		if ((buf = (unsigned char *)realloc(c->buf, c->alloc + WALK_CHUNK + len)) == NULL)
+			return FAIL;
+		c->buf = buf;
+		c->alloc += WALK_CHUNK + len;
+	}
+	c->buf[c->len++] = SEQUENCE;
+	memcopy(c->buf+c->len, l, llen);
+	memcopy(c->buf+c->len+llen, vb->name, len);
+	c->len += llen + len;
+	return SUCCESS;
+}
+
+/* Splits the subtree into ranges, one a column from that of f, the first
+   object found. The subtree is a table, of which the entry is numbered 1,
+   or its entry. */
+static void walksplit(WALKER *w, VBVIEW *f)
+{
+	OID root, col;
+	int i, n, c;
+
+	ber2oid(w->root, w->rootLen, &root);
+	ber2oid(f->oid, f->oidLen, &col);
+	if (col.len >= root.len + 3 && col.array[root.len] == 1)
+		c = root.len + 1;
+	else if (col.len >= root.len + 2)
+		c = root.len;
+	else
+		return;  /* A scalar */
+	col.len = c + 1;
+	for (i = 1; i < w->chains; i++) {
+		col.array[c]++;
+		n = oid2ber(&col, w->chain[i].from);
+		w->chain[i].fromLen = n;
+		memcopy(w->chain[i-1].end, w->chain[i].from, n);
+		w->chain[i-1].endLen = n;
+		w->chain[i].endLen = 0;
+		w->chain[i].len = 0;
+		w->chain[i].state = WALK_READY;
+	}
+	w->nchain = w->chains;
+}
+
+/* Advances c with the varbind vb returned for it */
+static void walkstep(WALKER *w, WALKCHAIN *c, VBVIEW *vb)
+{
+	c->state = WALK_DONE;
+	if (vb->oidLen <= w->rootLen || memcmp(vb->oid, w->root, w->rootLen) != 0 ||
+		(c->endLen && bercmp(vb->oid, vb->oidLen, c->end, c->endLen) >= 0))
+		return;  /* Past the range */
+	if (bercmp(vb->oid, vb->oidLen, c->from, c->fromLen) <= 0 || vb->oidLen > OID_SIZE*5 ||
+		walkkeep(c, vb) != SUCCESS) {
+		w->status = FAIL;  /* The agent goes backwards, or no memory */
+		return;
+	}
+	memcopy(c->from, vb->oid, vb->oidLen);
+	c->fromLen = vb->oidLen;
+	c->state = WALK_READY;
+	w->found++;
+	if (w->nchain == 1 && w->found == 1 && w->chains > 1) walksplit(w, vb);
+}
+
+/* Completes a request of the walk */
+static void walkresponse(POLLER *p, MSGVIEW *msg, void *arg)
+{
+	WALKREQ *r = (WALKREQ *)arg;
+	WALKER *w = r->w;
+	int i, state = WALK_READY;
+
+	(void)p;  /* That of the walker, w->p */
+	w->outstanding--;
+	if (msg == NULL) {
+		w->status = FAIL;
+		state = WALK_DONE;
+	}
+	else if (msg->errorStatus == NO_SUCH_NAME && msg->errorIndex >= 1 && msg->errorIndex <= (uint32_t)r->n)
+		w->chain[r->chain[msg->errorIndex-1]].state = WALK_DONE;  /* The end of the MIB */
+	else if (msg->errorStatus == TOO_BIG && r->n > 1)
+		w->maxvb = r->n / 2;
+	else if (msg->errorStatus != NO_ERR || msg->nvb != r->n) {
+		w->status = msg->errorStatus != NO_ERR ? (int) msg->errorStatus : FAIL;
+		state = WALK_DONE;
+	}
+	else {
+		for (i = 0; i < r->n; i++)
+			walkstep(w, &w->chain[r->chain[i]], &msg->vb[i]);
+		state = WALK_DONE;
+	}
+	/* The chains not stepped are sent again, or end with the walk */
+	for (i = 0; i < r->n; i++)
+		if (w->chain[r->chain[i]].state == WALK_SENT)
+			w->chain[r->chain[i]].state = state;
+	free(r);
+}
+
+/* Sends a request for the next of up to maxvb chains ready. Returns 1 if
+   sent, 0 if none is ready or the poller is full, or Fail(-1). */
+static int walksend(WALKER *w)
+{
+	unsigned char buf[REQUEST_BUFFER_SIZE];
+	struct messageStruct m, vblist;
+	WALKREQ *r;
+	WALKCHAIN *c;
+	int i, k, len, vlen, total = 0;
+
+	if ((r = (WALKREQ *)malloc(sizeof(WALKREQ) + w->maxvb * sizeof(int))) == NULL)
+		return FAIL;
+	r->w = w;
+	r->chain = (int *)(r + 1);
+	for (r->n = 0, i = 0; i < w->nchain && r->n < w->maxvb; i++) {
+		k = (w->next + i) % w->nchain;
+		if (w->chain[k].state == WALK_READY) r->chain[r->n++] = k;
+	}
+	if (r->n == 0) {
+		free(r);
+		return 0;
+	}
+	/* Built backwards, the last varbind first */
+	m.buffer = buf; m.size = m.index = m.len = REQUEST_BUFFER_SIZE;
+	for (i = r->n - 1; i >= 0; i--) {
+		c = &w->chain[r->chain[i]];
+		if ((vlen = prependBytes(&m, nullvalue, sizeof(nullvalue))) < 0 ||
+			(len = prependBytes(&m, c->from, c->fromLen)) < 0 ||
+			(vlen += len, len = prependHeader(&m, OBJECT_IDENTIFIER, c->fromLen)) < 0 ||
+			(vlen += len, len = prependHeader(&m, SEQUENCE, vlen)) < 0) {
+			free(r);
+			return FAIL;
+		}
+		total += vlen + len;
+	}
+	if (prependHeader(&m, SEQUENCE_OF, total) < 0) {
+		free(r);
+		return FAIL;
+	}
+	vblist.buffer = buf + m.index;
+	vblist.len = vblist.size = m.size - m.index;
+	vblist.index = 0;
+	if ((len = pollersend(w->p, (struct sockaddr *)&w->to, w->community, GET_NEXT_REQUEST, &vblist, walkresponse, r)) < 0) {
+		free(r);
+		return len == BUFFER_FULL ? 0 : FAIL;
+	}
+	for (i = 0; i < r->n; i++)
+		w->chain[r->chain[i]].state = WALK_SENT;
+	w->next = (r->chain[r->n-1] + 1) % w->nchain;
+	w->outstanding++;
+	w->requests++;
+	return 1;
+}
+
+WALKER *walkernew(POLLER *p, struct sockaddr *to, char *community, char *oid,
+	int chains, int maxvb, int window)
+{
+	WALKER *w;
+
+	if (strlen(community) >= COMM_STR_SIZE || chains < 1 || maxvb < 1 || window < 1)
+		return NULL;
+	if ((w = (WALKER *)malloc(sizeof(WALKER))) == NULL) return NULL;
+	memset(w, 0, sizeof(WALKER));
+	if ((w->rootLen = str2ber(oid, w->root)) == 0 ||
+		(w->chain = (WALKCHAIN *)calloc(chains, sizeof(WALKCHAIN))) == NULL) {
+		walkerfree(w);
+		return NULL;
+	}
+	w->p = p;
+	memcpy(&w->to, to, sockaddrlen(to));
+	strcpy(w->community, community);
+	w->chains = chains;
+	w->maxvb = maxvb;
+	w->window = window;
+	return w;
+}
+
+void walkerfree(WALKER *w)
+{
+	int i;
+
+	if (w->chain)
+		for (i = 0; i < w->chains; i++)
+			free(w->chain[i].buf);
+	free(w->chain);
+	free(w);
+}
+
+int walkerstart(WALKER *w)
+{
+	memcopy(w->chain[0].from, w->root, w->rootLen);
+	w->chain[0].fromLen = w->rootLen;
+	w->chain[0].endLen = 0;
+	w->chain[0].len = 0;
+	w->chain[0].state = WALK_READY;
+	w->nchain = 1;
+	w->next = 0;
+	w->status = SUCCESS;
+	w->found = w->requests = 0;
+	return walkerpump(w) == 1 ? SUCCESS : FAIL;
+}
+
+int walkerpump(WALKER *w)
+{
+	int n = 0, ret;
+
+	while (w->status == SUCCESS && w->outstanding < w->window) {
+		if ((ret = walksend(w)) < 0) w->status = FAIL;
+		if (ret <= 0) break;
+		n++;
+	}
+	return n;
+}
+
+Boolean walkerdone(WALKER *w)
+{
+	int i;
+
+	if (w->outstanding > 0) return FALSE;
+	if (w->status != SUCCESS) return TRUE;
+	for (i = 0; i < w->nchain; i++)
+		if (w->chain[i].state == WALK_READY) return FALSE;
+	return TRUE;
+}
+
+int walkerrun(WALKER *w)
+{
+	if (walkerstart(w) != SUCCESS) return FAIL;
+	while (!walkerdone(w)) {
+		walkerpump(w);
+		if (pollerwait(w->p, POLLER_TICK) < 0) return FAIL;
+	}
+	return w->status;
+}
+
+void walkereach(WALKER *w, void (*func)(VBVIEW *vb, void *arg), void *arg)
+{
+	VBVIEW vb;
+	int i, pos, n;
+
+	for (i = 0; i < w->nchain; i++)
+		for (pos = 0; pos < w->chain[i].len && (n = vbView(w->chain[i].buf+pos,
+			w->chain[i].len-pos, &vb)) > 0; pos += n)
+			func(&vb, arg);
+}
@@ -0,0 +1,139 @@
+/*
+ * A SNMP walk of a subtree by several GetNext chains at once, each over a range
+ * of its columns, pipelined through the poller of poller.h.
+ *
+ *
+ * This file is part of uSNMP ("micro-SNMP").
+ * uSNMP is released under a BSD-style license. The full text follows.
+ *
+ * Copyright (c) 2022 Francis Tay. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, is hereby granted without fee provided that the following
+ * conditions are met:
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Francis Tay nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ * THIS SOFTWARE IS PROVIDED BY FRANCIS TAY AND CONTRIBUTERS 'AS
+ * IS' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOTLIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.	IN NO EVENT SHALL FRANCIS TAY OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARAY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+walker.c walks a subtree of an agent, as usnmpgetnext would one GetNext at
+a time, but splits it into disjoint ranges walked at once. The first
+GetNext finds the first object, say root.1.c.x of the column c of a table;
+the ranges then start at the columns root.1.c, root.1.c+1 ... up to the
+number of chains, the last running to the end of the subtree. The subtree
+may be that of the entry of the table instead, root.c.x. Each chain
+walks its range by GetNext from the last OID it found. The current OIDs of
+up to maxvb chains are sent in one request, and up to window requests are
+outstanding, through a poller that times out and retries them. The
+varbinds found are kept by range, so that they are in lexicographic order
+when all ranges are done. A subtree of scalars is walked by one chain, and
+the chains past the last column of a table end with their first request.
+
+WALKER *walkernew(POLLER *p, struct sockaddr *to, char *community, char *oid,
+	int chains, int maxvb, int window);
+	Instantiate a walk of the subtree oid, e.g. "B.2.2", of the agent at to
+	with the community string, by at most chains ranges, maxvb varbinds a
+	request and window requests outstanding, sent through p. Returns NULL if
+	fail.
+
+void walkerfree(WALKER *w);
+	Free the walk and the varbinds found. Its requests must not be
+	outstanding.
+
+int walkerstart(WALKER *w);
+	Sends the first request. Returns Success(0) or Fail(-1).
+
+int walkerpump(WALKER *w);
+	Sends the requests of the chains ready, while the window and the poller
+	have room. Returns the number sent.
+
+Boolean walkerdone(WALKER *w);
+	Returns TRUE when the walk has ended, with none of its requests
+	outstanding.
+
+int walkerrun(WALKER *w);
+	Starts the walk, and waits on the poller for it to end. Returns
+	Success(0), or w->status, Fail(-1) if a request timed out, or the error
+	status of a response that ended it.
+
+void walkereach(WALKER *w, void (*func)(VBVIEW *vb, void *arg), void *arg);
+	Calls func with arg for each varbind found, in lexicographic order.
+
+An agent answers a request for an OID past the end of its MIB with the
+error noSuchName, and the index of the varbind: its chain ends, and the
+others in the request are sent again. A request too big for the agent is
+sent again split in two. w->found counts the varbinds found, and
+w->requests the requests sent. Walks may share a poller, each driven by
+walkerpump() on the one thread.
+*/
+
+#ifndef _WALKER_H
+#define _WALKER_H
+
+#include "list.h"
+#include "poller.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WALK_READY 0
+#define WALK_SENT 1
+#define WALK_DONE 2
+
+typedef struct {
+	unsigned char from[OID_SIZE*5];  /* BER of the OID to get the next of */
+	int fromLen;
+	unsigned char end[OID_SIZE*5];  /* The range ends before it, or with the subtree if endLen is 0 */
+	int endLen;
+	int state;  /* WALK_READY, WALK_SENT or WALK_DONE */
+	unsigned char *buf;  /* The varbind TLVs found */
+	int len, alloc;
+} WALKCHAIN;
+
+typedef struct walker {
+	POLLER *p;
+	struct sockaddr_storage to;
+	char community[COMM_STR_SIZE];
+	unsigned char root[OID_SIZE*5];
+	int rootLen;
+	int chains, nchain;  /* Chains at most, and in use */
+	int maxvb, window, outstanding;
+	int next;  /* The chain to send first, in turn */
+	WALKCHAIN *chain;
+	int status;
+	uint32_t found, requests;
+} WALKER;
+
+WALKER *walkernew(POLLER *p, struct sockaddr *to, char *community, char *oid,
+	int chains, int maxvb, int window);
+void walkerfree(WALKER *w);
+int walkerstart(WALKER *w);
+int walkerpump(WALKER *w);
+Boolean walkerdone(WALKER *w);
+int walkerrun(WALKER *w);
+void walkereach(WALKER *w, void (*func)(VBVIEW *vb, void *arg), void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif